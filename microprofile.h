@@ -146,6 +146,12 @@ typedef uint16_t MicroProfileGroupId;
 #define MICROPROFILE_COUNTER_SUB(name, count) do{} while(0)
 #define MICROPROFILE_COUNTER_SET(name, count) do{} while(0)
 #define MICROPROFILE_COUNTER_SET_LIMIT(name, count) do{} while(0)
+#define MICROPROFILE_FLOW_BEGIN(id) do{} while(0)
+#define MICROPROFILE_FLOW_END(id) do{} while(0)
+#define MICROPROFILE_REQUEST(id) do{} while(0)
+#define MICROPROFILE_SCOPE_ASYNC(scope, var)
+#define MICROPROFILE_SCOPEI_ASYNC(scope, group, name, color)
+#define MICROPROFILE_AWAIT(scope, awaiter) (awaiter)
 
 
 #define MICROPROFILE_COUNTER_CONFIG(name, type)
@@ -165,6 +171,10 @@ typedef uint16_t MicroProfileGroupId;
 #define MicroProfileEnableCategory(a) do{} while(0)
 #define MicroProfileDisableCategory(a) do{} while(0)
 #define MicroProfileGetEnableAllGroups() false
+#define MicroProfileSetEnableAllThreads(a) do{} while(0)
+#define MicroProfileGetEnableAllThreads() false
+#define MicroProfileEnableThread(a) do{} while(0)
+#define MicroProfileDisableThread(a) do{} while(0)
 #define MicroProfileSetForceMetaCounters(a)
 #define MicroProfileGetForceMetaCounters() 0
 #define MicroProfileEnableMetaCounter(c) do{} while(0)
@@ -179,6 +189,25 @@ typedef uint16_t MicroProfileGroupId;
 #define MicroProfileGpuBegin(c) do{} while(0)
 #define MicroProfileGpuEnd() 0
 #define MicroProfileGpuSubmit(w) do{} while(0)
+#define MicroProfileFlowBegin(id) do{} while(0)
+#define MicroProfileFlowEnd(id) do{} while(0)
+#define MICROPROFILE_FIBER_THREAD ((uint32_t)-1)
+#define MicroProfileFiberRegister(name) MICROPROFILE_FIBER_THREAD
+#define MicroProfileFiberUnregister(fiber) do{} while(0)
+#define MicroProfileFiberSwitch(from, to) do{} while(0)
+#define MicroProfileSetRequest(id) do{} while(0)
+#define MicroProfileSetSampleRate(token, rate) do{} while(0)
+#define MicroProfileSetGroupSampleRate(group, rate) do{} while(0)
+#define MicroProfileSetOverheadBudget(f) do{} while(0)
+#define MicroProfileCalibrate() 0.f
+#define MicroProfileSetOverheadSubtract(b) do{} while(0)
+#define MicroProfileSetAggregateOnly(b) do{} while(0)
+#define MicroProfileFlightRecorderStart(path, size) false
+#define MicroProfileFlightRecorderStop() do{} while(0)
+#define MicroProfileFlightRecorderLoad(path, window) false
+#define MicroProfileCrashDumpStart(path) false
+#define MicroProfileCrashDumpStop() do{} while(0)
+#define MicroProfileCrashDumpWrite() do{} while(0)
 
 #else
 
@@ -189,6 +218,7 @@ typedef uint16_t MicroProfileGroupId;
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <type_traits>
 #endif
 
 #ifndef MICROPROFILE_API
@@ -247,6 +277,13 @@ typedef uint32_t MicroProfileProcessIdType;
 #elif defined(__linux__)
 #include <unistd.h>
 #include <time.h>
+#include <sched.h>
+#if defined(__has_include) && defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define MP_RSEQ 1
+#endif
+#endif
 inline int64_t MicroProfileTicksPerSecondCpu()
 {
 	return 1000000000ll;
@@ -268,6 +305,22 @@ inline int64_t MicroProfileGetTick()
 typedef uint64_t MicroProfileThreadIdType;
 #define MP_GETCURRENTPROCESSID() getpid()
 typedef uint32_t MicroProfileProcessIdType;
+#ifndef MP_GETCURRENTCPU
+inline int MicroProfileGetCurrentCpu()
+{
+#ifdef MP_RSEQ
+	//glibc registers rseq for every thread, and the kernel keeps cpu_id current, so this avoids the call
+	if(__rseq_size)
+	{
+		int nCpu = (int)((volatile struct rseq*)((char*)__builtin_thread_pointer() + __rseq_offset))->cpu_id;
+		if(nCpu >= 0)
+			return nCpu;
+	}
+#endif
+	return sched_getcpu();
+}
+#define MP_GETCURRENTCPU() MicroProfileGetCurrentCpu()
+#endif
 #endif
 
 
@@ -299,12 +352,22 @@ typedef uint32_t MicroProfileProcessIdType;
 #define MICROPROFILE_META_CPU(name, count) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp_meta,__LINE__) = MicroProfileGetMetaToken(name); MicroProfileMetaUpdate(MICROPROFILE_TOKEN_PASTE(g_mp_meta,__LINE__), count, MicroProfileTokenTypeCpu)
 #define MICROPROFILE_META_GPU(name, count) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp_meta,__LINE__) = MicroProfileGetMetaToken(name); MicroProfileMetaUpdate(MICROPROFILE_TOKEN_PASTE(g_mp_meta,__LINE__), count, MicroProfileTokenTypeGpu)
 #define MICROPROFILE_LABEL(group, name) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__) = MicroProfileGetLabelToken(group); MicroProfileLabel(MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__), name)
+#if MICROPROFILE_LABEL_DEFERRED
+#define MICROPROFILE_LABELF(group, name, ...) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__) = MicroProfileGetLabelToken(group); MicroProfileLabelFormatDeferred(MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__), name, ## __VA_ARGS__)
+#else
 #define MICROPROFILE_LABELF(group, name, ...) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__) = MicroProfileGetLabelToken(group); MicroProfileLabelFormat(MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__), name, ## __VA_ARGS__)
+#endif
 #define MICROPROFILE_COUNTER_ADD(name, count) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__) = MicroProfileGetCounterToken(name); MicroProfileCounterAdd(MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__), count)
 #define MICROPROFILE_COUNTER_SUB(name, count) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__) = MicroProfileGetCounterToken(name); MicroProfileCounterAdd(MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__), -(int64_t)count)
 #define MICROPROFILE_COUNTER_SET(name, count) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__) = MicroProfileGetCounterToken(name); MicroProfileCounterSet(MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__), count)
 #define MICROPROFILE_COUNTER_SET_LIMIT(name, count) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__) = MicroProfileGetCounterToken(name); MicroProfileCounterSetLimit(MICROPROFILE_TOKEN_PASTE(g_mp_counter,__LINE__), count)
 #define MICROPROFILE_COUNTER_CONFIG(name, type, limit, flags) MicroProfileCounterConfig(name, type, limit, flags
+#define MICROPROFILE_FLOW_BEGIN(id) MicroProfileFlowBegin(id)
+#define MICROPROFILE_FLOW_END(id) MicroProfileFlowEnd(id)
+#define MICROPROFILE_REQUEST(id) MicroProfileSetRequest(id)
+#define MICROPROFILE_SCOPE_ASYNC(scope, var) MicroProfileAsyncScope scope(g_mp_##var)
+#define MICROPROFILE_SCOPEI_ASYNC(scope, group, name, color) static MicroProfileToken MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__) = MicroProfileGetToken(group, name, color, MicroProfileTokenTypeCpu); MicroProfileAsyncScope scope(MICROPROFILE_TOKEN_PASTE(g_mp,__LINE__))
+#define MICROPROFILE_AWAIT(scope, awaiter) MicroProfileAsyncAwait(scope, awaiter)
 
 #ifndef MICROPROFILE_USE_THREAD_NAME_CALLBACK
 #define MICROPROFILE_USE_THREAD_NAME_CALLBACK 0
@@ -314,10 +377,67 @@ typedef uint32_t MicroProfileProcessIdType;
 #define MICROPROFILE_PER_THREAD_BUFFER_SIZE (2048<<10)
 #endif
 
+#ifndef MICROPROFILE_PER_FIBER_BUFFER_SIZE
+#define MICROPROFILE_PER_FIBER_BUFFER_SIZE (128<<10) //log bytes of a fiber. fibers are usually many and short lived, so their logs are kept smaller than thread logs
+#endif
+
+#ifndef MICROPROFILE_LOG_WIDE
+#define MICROPROFILE_LOG_WIDE 0 //16 byte log entries with a 64 bit tick, a 32 bit timer index and the cpu the event was logged on. halves the entries per buffer
+#endif
+
+#ifndef MICROPROFILE_LOG_COMPACT
+#define MICROPROFILE_LOG_COMPACT 0 //4 byte log entries storing ticks as the delta to the previous entry of the thread. roughly doubles the entries per buffer
+#endif
+
+#if MICROPROFILE_LOG_COMPACT && MICROPROFILE_LOG_WIDE
+#error "MICROPROFILE_LOG_COMPACT and MICROPROFILE_LOG_WIDE are exclusive"
+#endif
+
+#ifndef MICROPROFILE_PER_CPU_LOG
+#define MICROPROFILE_PER_CPU_LOG 0 //timers write to per cpu buffers tagged with their thread, which flip sorts into the thread logs. capture memory scales with cores rather than threads
+#endif
+
+#ifndef MICROPROFILE_PER_CPU_LOG_EVENTS_PER_FLIP
+#define MICROPROFILE_PER_CPU_LOG_EVENTS_PER_FLIP (64<<10) //expected events per cpu between flips. each cpu buffer holds twice this, rounded up to a power of two
+#endif
+
+#ifndef MICROPROFILE_PER_CPU_LOG_THREAD_BUFFER_MIN
+#define MICROPROFILE_PER_CPU_LOG_THREAD_BUFFER_MIN (64<<10) //bytes a thread log starts with in per cpu mode. grown to hold the frame history, up to MICROPROFILE_PER_THREAD_BUFFER_SIZE
+#endif
+
+#ifndef MICROPROFILE_MAX_CPUS
+#define MICROPROFILE_MAX_CPUS 256
+#endif
+
 #ifndef MICROPROFILE_PER_THREAD_GPU_BUFFER_SIZE
 #define MICROPROFILE_PER_THREAD_GPU_BUFFER_SIZE (1024<<10)
 #endif
 
+#ifndef MICROPROFILE_CACHE_LINE_SIZE
+#define MICROPROFILE_CACHE_LINE_SIZE 64 //padding between fields written by different threads
+#endif
+
+#ifndef MICROPROFILE_SIMD
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MICROPROFILE_SIMD 1 //sse4.2 and avx2 kernels for the per timer statistics, picked at runtime
+#else
+#define MICROPROFILE_SIMD 0
+#endif
+#endif
+
+#ifndef MICROPROFILE_PREALLOCATE_THREAD_BUFFERS
+#define MICROPROFILE_PREALLOCATE_THREAD_BUFFERS 1 //allocate log buffers in MicroProfileOnThreadCreate, so timers never allocate or take page faults. label buffers are allocated by the first label of a thread
+#endif
+
+#ifndef MICROPROFILE_HUGE_PAGES
+#define MICROPROFILE_HUGE_PAGES 1 //back buffers that are a multiple of 2mb with huge pages where the os allows it
+#endif
+
+#ifndef MICROPROFILE_ALLOC_PAGES
+#define MICROPROFILE_ALLOC_PAGES(nSize) MicroProfileAllocPages(nSize) //must return zeroed memory. define together with MICROPROFILE_FREE_PAGES to plug in another allocator
+#define MICROPROFILE_FREE_PAGES(p, nSize) MicroProfileFreePages(p, nSize)
+#endif
+
 #ifndef MICROPROFILE_MAX_FRAME_HISTORY
 #define MICROPROFILE_MAX_FRAME_HISTORY 512
 #endif
@@ -346,8 +466,12 @@ typedef uint32_t MicroProfileProcessIdType;
 #define MICROPROFILE_WEBSERVER_SOCKET_BUFFER_SIZE (16<<10)
 #endif
 
+#ifndef MICROPROFILE_LABEL_BYTES_PER_FRAME
+#define MICROPROFILE_LABEL_BYTES_PER_FRAME (1<<10) //label bytes per thread and frame the label buffer is sized for
+#endif
+
 #ifndef MICROPROFILE_LABEL_BUFFER_SIZE
-#define MICROPROFILE_LABEL_BUFFER_SIZE (1024<<10)
+#define MICROPROFILE_LABEL_BUFFER_SIZE MicroProfilePow2Ceil(MICROPROFILE_MAX_FRAME_HISTORY * MICROPROFILE_LABEL_BYTES_PER_FRAME) //per thread, must be a power of two. labels are dropped rather than overwriting labels of frames still in history
 #endif
 
 #ifndef MICROPROFILE_GPU_MAX_QUERIES
@@ -366,6 +490,30 @@ typedef uint32_t MicroProfileProcessIdType;
 #define MICROPROFILE_LABEL_MAX_LEN 256
 #endif
 
+#ifndef MICROPROFILE_LABEL_DEFERRED
+#define MICROPROFILE_LABEL_DEFERRED 0 //MICROPROFILE_LABELF stores the format pointer and packed arguments, and formats only when the label is displayed. format strings must be literals
+#endif
+
+#ifndef MICROPROFILE_LABEL_DEFERRED_STRING_MAX
+#define MICROPROFILE_LABEL_DEFERRED_STRING_MAX 64 //string arguments of deferred labels are copied and truncated to this length
+#endif
+
+#ifndef MICROPROFILE_LABEL_INTERN
+#define MICROPROFILE_LABEL_INTERN 0 //MICROPROFILE_LABEL strings are stored once in a global table and logged by id
+#endif
+
+#ifndef MICROPROFILE_LABEL_INTERN_MAX
+#define MICROPROFILE_LABEL_INTERN_MAX 4096 //distinct interned strings, must be a power of two. labels past this are stored per thread
+#endif
+
+#ifndef MICROPROFILE_LABEL_INTERN_BUFFER_SIZE
+#define MICROPROFILE_LABEL_INTERN_BUFFER_SIZE (128<<10)
+#endif
+
+#ifndef MICROPROFILE_LABEL_INTERN_CACHE
+#define MICROPROFILE_LABEL_INTERN_CACHE 64 //per thread cache of recently interned strings
+#endif
+
 #ifndef MICROPROFILE_EMBED_HTML
 #define MICROPROFILE_EMBED_HTML 1
 #endif
@@ -374,16 +522,100 @@ typedef uint32_t MicroProfileProcessIdType;
 #define MICROPROFILE_GPU_TIMERS_MULTITHREADED 0
 #endif
 
+#ifndef MICROPROFILE_FLOW_MAX
+#define MICROPROFILE_FLOW_MAX (4<<10) //max flow events resolved per frame
+#endif
+
+#ifndef MICROPROFILE_FLOW_CRITICAL_PATH_MAX
+#define MICROPROFILE_FLOW_CRITICAL_PATH_MAX 64
+#endif
+
+#ifndef MICROPROFILE_REQUEST_MAX
+#define MICROPROFILE_REQUEST_MAX 1024 //max requests tracked per aggregation window
+#endif
+
+#ifndef MICROPROFILE_REQUEST_TIMERS_MAX
+#define MICROPROFILE_REQUEST_TIMERS_MAX 16 //max distinct timers attributed per request
+#endif
+
+#ifndef MICROPROFILE_REQUEST_EXEMPLARS
+#define MICROPROFILE_REQUEST_EXEMPLARS 8 //slowest requests kept per aggregation window
+#endif
+
+#ifndef MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES
+#define MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES (2<<10)
+#endif
+
+#ifndef MICROPROFILE_OVERHEAD_BUDGET
+#define MICROPROFILE_OVERHEAD_BUDGET 0.f //fraction of frame time instrumentation may cost before timers are throttled. 0 disables the governor
+#endif
+
+#ifndef MICROPROFILE_GOVERNOR_EVENT_NS
+#define MICROPROFILE_GOVERNOR_EVENT_NS 20 //estimated cost of logging one enter or leave
+#endif
+
+#ifndef MICROPROFILE_GOVERNOR_MAX_RATE
+#define MICROPROFILE_GOVERNOR_MAX_RATE 4096 //timers still over budget at this sample rate are disabled
+#endif
+
+#ifndef MICROPROFILE_GOVERNOR_BACKOFF_FRAMES
+#define MICROPROFILE_GOVERNOR_BACKOFF_FRAMES 120
+#endif
+
+#ifndef MICROPROFILE_CALIBRATE
+#define MICROPROFILE_CALIBRATE 1 //measure the cost of an enter/leave pair at startup
+#endif
+
+#ifndef MICROPROFILE_OVERHEAD_SUBTRACT
+#define MICROPROFILE_OVERHEAD_SUBTRACT 0 //subtract the calibrated cost of child scopes from timer times
+#endif
+
+#ifndef MICROPROFILE_AGGREGATE_ONLY
+#define MICROPROFILE_AGGREGATE_ONLY 0 //support MicroProfileSetAggregateOnly, where timers update per thread totals instead of logging every scope
+#endif
+
+#ifndef MICROPROFILE_AGGREGATE_ONLY_HOLD
+#define MICROPROFILE_AGGREGATE_ONLY_HOLD 600 //frames detailed logging stays on after a web request or a dump
+#endif
+
+#ifndef MICROPROFILE_FLIGHT_RECORDER
+#define MICROPROFILE_FLIGHT_RECORDER 0 //support MicroProfileFlightRecorderStart, streaming every frame to a size capped memory mapped file
+#endif
+
+#ifndef MICROPROFILE_FLIGHT_RECORDER_SIZE
+#define MICROPROFILE_FLIGHT_RECORDER_SIZE (256<<20) //default size of a recording. the oldest frames are overwritten when it is full
+#endif
+
+#ifndef MICROPROFILE_FLIGHT_RECORDER_META_SIZE
+#define MICROPROFILE_FLIGHT_RECORDER_META_SIZE (4<<20) //part of a recording holding group, timer and counter names
+#endif
+
+#ifndef MICROPROFILE_FLIGHT_RECORDER_STAGE_SIZE
+#define MICROPROFILE_FLIGHT_RECORDER_STAGE_SIZE (8<<20) //frames queued for the recorder thread. frames that do not fit are dropped
+#endif
+
+#ifndef MICROPROFILE_CRASH_DUMP
+#define MICROPROFILE_CRASH_DUMP 0 //support MicroProfileCrashDumpStart, writing the last frames from SIGSEGV, SIGABRT, SIGTERM and SIGUSR1 handlers
+#endif
+
+#ifndef MICROPROFILE_CRASH_DUMP_FRAMES
+#define MICROPROFILE_CRASH_DUMP_FRAMES 32 //frames in a crash dump, ending with the frame being captured
+#endif
+
+#ifndef MICROPROFILE_CRASH_DUMP_STACK_SIZE
+#define MICROPROFILE_CRASH_DUMP_STACK_SIZE (64<<10) //signal stack the handlers run on, so stack overflows on the thread calling MicroProfileCrashDumpStart are dumped
+#endif
+
 #define MICROPROFILE_FORCEENABLECPUGROUP(s) MicroProfileForceEnableGroup(s, MicroProfileTokenTypeCpu)
 #define MICROPROFILE_FORCEDISABLECPUGROUP(s) MicroProfileForceDisableGroup(s, MicroProfileTokenTypeCpu)
 #define MICROPROFILE_FORCEENABLEGPUGROUP(s) MicroProfileForceEnableGroup(s, MicroProfileTokenTypeGpu)
 #define MICROPROFILE_FORCEDISABLEGPUGROUP(s) MicroProfileForceDisableGroup(s, MicroProfileTokenTypeGpu)
 
 #define MICROPROFILE_INVALID_TICK ((uint64_t)-1)
-#define MICROPROFILE_GROUP_MASK_ALL 0xffffffffffff
 
 
 #define MICROPROFILE_INVALID_TOKEN (uint64_t)0
+#define MICROPROFILE_FIBER_THREAD ((uint32_t)-1) //the os thread's own context, as opposed to a registered fiber
 
 enum MicroProfileTokenType
 {
@@ -428,9 +660,16 @@ MICROPROFILE_API void MicroProfileLeave(MicroProfileToken nToken, uint64_t nTick
 MICROPROFILE_API void MicroProfileLabel(MicroProfileToken nToken, const char* pName);
 MICROPROFILE_FORMAT(2, 3) MICROPROFILE_API void MicroProfileLabelFormat(MicroProfileToken nToken, const char* pName, ...);
 MICROPROFILE_API void MicroProfileLabelFormatV(MicroProfileToken nToken, const char* pName, va_list args);
+MICROPROFILE_API void MicroProfileLabelDeferred(MicroProfileToken nToken, const void* pData, uint32_t nSize); //! store a label packed by MicroProfileLabelFormatDeferred
+MICROPROFILE_API void MicroProfileFlowBegin(uint64_t nFlowId); //! mark that work with the given id (48 bits) is handed off from the current thread
+MICROPROFILE_API void MicroProfileFlowEnd(uint64_t nFlowId); //! mark that work with the given id is picked up on the current thread
+MICROPROFILE_API uint32_t MicroProfileAsyncId();
+MICROPROFILE_API uint64_t MicroProfileAsyncEnter(MicroProfileToken nToken, uint32_t nAsyncId, bool bResume);
+MICROPROFILE_API void MicroProfileAsyncLeave(MicroProfileToken nToken, uint64_t nTickStart, uint32_t nAsyncId, bool bSuspend);
+//tokens hold the group index + 1 above the timer index, so no valid token equals MICROPROFILE_INVALID_TOKEN
 inline uint16_t MicroProfileGetTimerIndex(MicroProfileToken t){ return (t&0xffff); }
-inline uint64_t MicroProfileGetGroupMask(MicroProfileToken t){ return ((t>>16)&MICROPROFILE_GROUP_MASK_ALL);}
-inline MicroProfileToken MicroProfileMakeToken(uint64_t nGroupMask, uint16_t nTimer){ return (nGroupMask<<16) | nTimer;}
+inline uint16_t MicroProfileGetGroupIndex(MicroProfileToken t){ return (uint16_t)(((t>>16)&0xffff) - 1); }
+inline MicroProfileToken MicroProfileMakeToken(uint16_t nGroupIndex, uint16_t nTimer){ return ((uint64_t)(nGroupIndex + 1)<<16) | nTimer;}
 
 MICROPROFILE_API void MicroProfileFlip(); //! call once per frame.
 MICROPROFILE_API void MicroProfileTogglePause();
@@ -440,12 +679,26 @@ MICROPROFILE_API float MicroProfileGetTime(const char* pGroup, const char* pName
 
 MICROPROFILE_API void MicroProfileOnThreadCreate(const char* pThreadName); //should be called from newly created threads
 MICROPROFILE_API void MicroProfileOnThreadExit(); //call on exit to reuse log
+MICROPROFILE_API uint32_t MicroProfileFiberRegister(const char* pFiberName); //! fibers get their own log and scope stack, and show up as virtual threads. each takes one of the MICROPROFILE_MAX_THREADS logs, MICROPROFILE_FIBER_THREAD is returned when none is free
+MICROPROFILE_API void MicroProfileFiberUnregister(uint32_t nFiber);
+MICROPROFILE_API void MicroProfileFiberSwitch(uint32_t nFrom, uint32_t nTo); //! call on the os thread right before switching fibers. MICROPROFILE_FIBER_THREAD is the thread itself
+MICROPROFILE_API void MicroProfileSetRequest(uint64_t nRequestId); //! attribute work on the current thread to a request (48 bits). 0 means no request
+MICROPROFILE_API void MicroProfileSetSampleRate(MicroProfileToken nToken, uint32_t nRate); //! record only 1 in nRate calls of a cpu timer, per thread. counts and times are scaled back up and shown as estimated
+MICROPROFILE_API void MicroProfileSetGroupSampleRate(const char* pGroup, uint32_t nRate); //! sample rate for all current and future timers in a group
+MICROPROFILE_API void MicroProfileSetOverheadBudget(float fFraction); //! throttle the noisiest timers when estimated instrumentation cost exceeds this fraction of frame time. 0 disables
+MICROPROFILE_API float MicroProfileCalibrate(); //! measure the cost of an enter/leave pair on the calling thread. returns ms per pair
+MICROPROFILE_API void MicroProfileSetOverheadSubtract(bool bSubtract); //! subtract the calibrated cost of child scopes from inclusive and exclusive times
+MICROPROFILE_API void MicroProfileSetAggregateOnly(bool bAggregateOnly); //! keep only per timer totals, no timelines, labels or flows. detailed logging resumes while the viewer is open. requires MICROPROFILE_AGGREGATE_ONLY
 MICROPROFILE_API void MicroProfileSetForceEnable(bool bForceEnable);
 MICROPROFILE_API bool MicroProfileGetForceEnable();
 MICROPROFILE_API void MicroProfileSetEnableAllGroups(bool bEnable); 
 MICROPROFILE_API void MicroProfileEnableCategory(const char* pCategory); 
 MICROPROFILE_API void MicroProfileDisableCategory(const char* pCategory); 
 MICROPROFILE_API bool MicroProfileGetEnableAllGroups();
+MICROPROFILE_API void MicroProfileSetEnableAllThreads(bool bEnable); //! when off, only threads enabled with MicroProfileEnableThread log anything. applied at the next flip
+MICROPROFILE_API bool MicroProfileGetEnableAllThreads();
+MICROPROFILE_API void MicroProfileEnableThread(const char* pThreadName);
+MICROPROFILE_API void MicroProfileDisableThread(const char* pThreadName);
 MICROPROFILE_API void MicroProfileSetForceMetaCounters(bool bEnable); 
 MICROPROFILE_API bool MicroProfileGetForceMetaCounters();
 MICROPROFILE_API void MicroProfileEnableMetaCounter(const char* pMet);
@@ -456,6 +709,8 @@ MICROPROFILE_API int MicroProfileGetCurrentAggregateFrames();
 MICROPROFILE_API MicroProfile* MicroProfileGet();
 MICROPROFILE_API void MicroProfileGetRange(uint32_t nPut, uint32_t nGet, uint32_t nRange[2][2]);
 MICROPROFILE_API std::recursive_mutex& MicroProfileGetMutex();
+MICROPROFILE_API void* MicroProfileAllocPages(size_t nSize); //! zeroed and pre-faulted memory for thread and context switch buffers
+MICROPROFILE_API void MicroProfileFreePages(void* p, size_t nSize);
 
 MICROPROFILE_API void MicroProfileContextSwitchTraceStart();
 MICROPROFILE_API void MicroProfileContextSwitchTraceStop();
@@ -469,6 +724,15 @@ struct MicroProfileThreadInfo
 MICROPROFILE_API void MicroProfileContextSwitchSearch(uint32_t* pContextSwitchStart, uint32_t* pContextSwitchEnd, uint64_t nBaseTicksCpu, uint64_t nBaseTicksEndCpu);
 MICROPROFILE_API uint32_t MicroProfileContextSwitchGatherThreads(uint32_t nContextSwitchStart, uint32_t nContextSwitchEnd, MicroProfileThreadInfo* Threads, uint32_t* nNumThreadsBase);
 
+struct MicroProfileFlowSegment
+{
+	uint32_t nLogIndex;
+	int64_t nTickStart;
+	int64_t nTickEnd;
+};
+
+MICROPROFILE_API uint32_t MicroProfileFlowCriticalPath(MicroProfileFlowSegment* pSegments, uint32_t nMaxSegments, int64_t* pTicksActive); //! critical path of the last processed frame, ordered from the end of the frame backwards
+
 MICROPROFILE_API const char* MicroProfileGetProcessName(MicroProfileProcessIdType nId, char* Buffer, uint32_t nSize);
 
 MICROPROFILE_API void MicroProfileDumpFile(const char* pPath, MicroProfileDumpType eType, uint32_t nFrames);
@@ -478,6 +742,25 @@ MICROPROFILE_API void MicroProfileWebServerStart();
 MICROPROFILE_API void MicroProfileWebServerStop();
 MICROPROFILE_API uint32_t MicroProfileWebServerPort();
 
+struct MicroProfileFlightRecorderWindow
+{
+	double fTimeBegin; //utc seconds of the frames to load, 0 leaves that end open
+	double fTimeEnd;
+	double fRecordingBegin; //filled in by the load
+	double fRecordingEnd;
+	uint32_t nFramesRecorded;
+	uint32_t nFramesInWindow;
+	uint32_t nFramesLoaded; //the last frames of the window, limited by MICROPROFILE_MAX_FRAME_HISTORY
+	uint32_t nFramesDropped;
+};
+
+MICROPROFILE_API bool MicroProfileFlightRecorderStart(const char* pPath, uint64_t nSize); //! streams every frame to pPath, keeping the last nSize bytes. 0 uses MICROPROFILE_FLIGHT_RECORDER_SIZE
+MICROPROFILE_API void MicroProfileFlightRecorderStop();
+MICROPROFILE_API bool MicroProfileFlightRecorderLoad(const char* pPath, MicroProfileFlightRecorderWindow* pWindow); //! replaces the profiler state with a window of a recording, for tools dumping it
+MICROPROFILE_API bool MicroProfileCrashDumpStart(const char* pPath); //! opens pPath and installs signal handlers writing the last frames to it, in the flight recorder layout
+MICROPROFILE_API void MicroProfileCrashDumpStop();
+MICROPROFILE_API void MicroProfileCrashDumpWrite(); //! async signal safe, for applications calling it from their own handlers
+
 MICROPROFILE_API void MicroProfileGpuInitGL();
 MICROPROFILE_API void MicroProfileGpuInitD3D11(struct ID3D11Device* pDevice);
 MICROPROFILE_API void MicroProfileGpuInitD3D12(struct ID3D12Device* pDevice, struct ID3D12CommandQueue* pCommandQueue);
@@ -519,14 +802,179 @@ struct MicroProfileScopeHandler
 	}
 };
 
+//scope that may span co_await. each resumed segment is entered and left on the thread it runs on,
+//so only async scopes may be live across a suspension point.
+struct MicroProfileAsyncScope
+{
+	MicroProfileToken nToken;
+	uint64_t nTick;
+	uint32_t nAsyncId;
+	MicroProfileAsyncScope(MicroProfileToken Token):nToken(Token)
+	{
+		nAsyncId = MicroProfileAsyncId();
+		nTick = MicroProfileAsyncEnter(nToken, nAsyncId, false);
+	}
+	~MicroProfileAsyncScope()
+	{
+		MicroProfileAsyncLeave(nToken, nTick, nAsyncId, false);
+	}
+	void Suspend()
+	{
+		MicroProfileAsyncLeave(nToken, nTick, nAsyncId, true);
+		nTick = MICROPROFILE_INVALID_TICK;
+	}
+	void Resume()
+	{
+		nTick = MicroProfileAsyncEnter(nToken, nAsyncId, true);
+	}
+};
+
+//wraps an awaiter so the scope is suspended before the coroutine is handed off and resumed on the thread that continues it
+template<typename T>
+struct MicroProfileAsyncAwaiter
+{
+	T& Awaiter;
+	MicroProfileAsyncScope& Scope;
+	bool bSuspended;
+	bool await_ready()
+	{
+		return Awaiter.await_ready();
+	}
+	//suspends before handing off, since the coroutine may run elsewhere before this returns.
+	//when it continues without suspending (false, or its own handle) the flag still pairs the resume with it
+	template<typename H>
+	auto await_suspend(H Handle) -> decltype(((T*)0)->await_suspend(Handle))
+	{
+		Scope.Suspend();
+		bSuspended = true;
+		return Awaiter.await_suspend(Handle);
+	}
+	auto await_resume() -> decltype(((T*)0)->await_resume())
+	{
+		//not reached through await_suspend when await_ready returned true
+		if(bSuspended)
+		{
+			bSuspended = false;
+			Scope.Resume();
+		}
+		return Awaiter.await_resume();
+	}
+};
+
+template<typename T>
+MicroProfileAsyncAwaiter<typename std::remove_reference<T>::type> MicroProfileAsyncAwait(MicroProfileAsyncScope& Scope, T&& Awaiter)
+{
+	MicroProfileAsyncAwaiter<typename std::remove_reference<T>::type> A = { Awaiter, Scope, false };
+	return A;
+}
+
+//deferred labels: a marker, the format pointer and the arguments, each prefixed by its type
+#define MICROPROFILE_LABEL_DEFERRED_MARKER 1
+enum MicroProfileLabelArg
+{
+	MicroProfileLabelArgEnd = 0,
+	MicroProfileLabelArgInt = 'i',
+	MicroProfileLabelArgDouble = 'd',
+	MicroProfileLabelArgPointer = 'p',
+	MicroProfileLabelArgString = 's',
+};
+
+struct MicroProfileLabelPacker
+{
+	char* pPut;
+	char* pEnd;
+	void Put(char nType, const void* pData, uint32_t nSize)
+	{
+		//arguments that don't fit are dropped and print as '?'
+		if(pPut + 1 + nSize >= pEnd)
+		{
+			pEnd = pPut;
+			return;
+		}
+		*pPut++ = nType;
+		memcpy(pPut, pData, nSize);
+		pPut += nSize;
+	}
+	void PutString(const char* pString)
+	{
+		size_t nLen = pString ? strlen(pString) : 0;
+		uint8_t nSize = (uint8_t)(nLen < MICROPROFILE_LABEL_DEFERRED_STRING_MAX ? nLen : MICROPROFILE_LABEL_DEFERRED_STRING_MAX);
+		if(pPut + 2 + nSize >= pEnd)
+		{
+			pEnd = pPut;
+			return;
+		}
+		*pPut++ = MicroProfileLabelArgString;
+		*pPut++ = (char)nSize;
+		memcpy(pPut, pString, nSize);
+		pPut += nSize;
+	}
+};
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type MicroProfileLabelPackArg(MicroProfileLabelPacker& P, T Value)
+{
+	int64_t nValue = (int64_t)Value;
+	P.Put(MicroProfileLabelArgInt, &nValue, sizeof(nValue));
+}
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type MicroProfileLabelPackArg(MicroProfileLabelPacker& P, T Value)
+{
+	double fValue = (double)Value;
+	P.Put(MicroProfileLabelArgDouble, &fValue, sizeof(fValue));
+}
+template<typename T>
+typename std::enable_if<std::is_pointer<T>::value>::type MicroProfileLabelPackArg(MicroProfileLabelPacker& P, T Value)
+{
+	const void* pValue = (const void*)Value;
+	P.Put(MicroProfileLabelArgPointer, &pValue, sizeof(pValue));
+}
+inline void MicroProfileLabelPackArg(MicroProfileLabelPacker& P, const char* pString)
+{
+	P.PutString(pString);
+}
+inline void MicroProfileLabelPackArg(MicroProfileLabelPacker& P, char* pString)
+{
+	P.PutString(pString);
+}
+
+inline void MicroProfileLabelPackArgs(MicroProfileLabelPacker&)
+{
+}
+template<typename T, typename... Args>
+void MicroProfileLabelPackArgs(MicroProfileLabelPacker& P, T Value, Args... Rest)
+{
+	MicroProfileLabelPackArg(P, Value);
+	MicroProfileLabelPackArgs(P, Rest...);
+}
+
+template<typename... Args>
+void MicroProfileLabelFormatDeferred(MicroProfileToken nToken, const char* pFormat, Args... Rest)
+{
+	char Buffer[MICROPROFILE_LABEL_MAX_LEN];
+	MicroProfileLabelPacker P = { Buffer, Buffer + sizeof(Buffer) };
+	*P.pPut++ = MICROPROFILE_LABEL_DEFERRED_MARKER;
+	memcpy(P.pPut, &pFormat, sizeof(pFormat));
+	P.pPut += sizeof(pFormat);
+	MicroProfileLabelPackArgs(P, Rest...);
+	MicroProfileLabelDeferred(nToken, Buffer, (uint32_t)(P.pPut - Buffer));
+}
+
+#ifndef MICROPROFILE_MAX_COUNTERS
 #define MICROPROFILE_MAX_COUNTERS 512
+#endif
+#ifndef MICROPROFILE_MAX_COUNTER_NAME_CHARS
 #define MICROPROFILE_MAX_COUNTER_NAME_CHARS (MICROPROFILE_MAX_COUNTERS*16)
+#endif
 
-#define MICROPROFILE_MAX_GROUPS 48 //dont bump! no. of bits used it bitmask
+#ifndef MICROPROFILE_MAX_GROUPS
+#define MICROPROFILE_MAX_GROUPS 128
+#endif
 #define MICROPROFILE_MAX_CATEGORIES 16
 #define MICROPROFILE_MAX_GRAPHS 5
 #define MICROPROFILE_GRAPH_HISTORY 128
-#define MICROPROFILE_BUFFER_SIZE ((MICROPROFILE_PER_THREAD_BUFFER_SIZE)/sizeof(MicroProfileLogEntry))
+#define MICROPROFILE_BUFFER_SIZE ((MICROPROFILE_PER_THREAD_BUFFER_SIZE)/sizeof(MicroProfileLogWord))
+#define MICROPROFILE_FIBER_BUFFER_SIZE ((MICROPROFILE_PER_FIBER_BUFFER_SIZE)/sizeof(MicroProfileLogWord))
 #define MICROPROFILE_GPU_BUFFER_SIZE ((MICROPROFILE_PER_THREAD_GPU_BUFFER_SIZE)/sizeof(MicroProfileLogEntry))
 #define MICROPROFILE_GPU_FRAMES ((MICROPROFILE_GPU_FRAME_DELAY)+1)
 #define MICROPROFILE_MAX_CONTEXT_SWITCH_THREADS 256
@@ -537,11 +985,15 @@ struct MicroProfileScopeHandler
 
 
 #ifndef MICROPROFILE_MAX_TIMERS
-#define MICROPROFILE_MAX_TIMERS 1024
+#define MICROPROFILE_MAX_TIMERS 1024 //at most 8192, the timer index is stored in 13 bits of each log entry
 #endif
 
 #ifndef MICROPROFILE_MAX_THREADS
+#if MICROPROFILE_PER_CPU_LOG
+#define MICROPROFILE_MAX_THREADS 256 //thread logs only take memory for what they log in per cpu mode
+#else
 #define MICROPROFILE_MAX_THREADS 32
+#endif
 #endif 
 
 #ifndef MICROPROFILE_UNPACK_RED
@@ -581,10 +1033,18 @@ struct MicroProfileScopeHandler
 #define MICROPROFILE_MINIZ 0
 #endif
 
+#ifndef MICROPROFILE_DUMP_FILE_BUFFER_SIZE
+#define MICROPROFILE_DUMP_FILE_BUFFER_SIZE (1<<20) //dump files are written by the dump writer thread in blocks of this size
+#endif
+
 #ifndef MICROPROFILE_COUNTER_HISTORY
 #define MICROPROFILE_COUNTER_HISTORY 1
 #endif
 
+#ifndef MICROPROFILE_COUNTER_SHARDED
+#define MICROPROFILE_COUNTER_SHARDED 1 //MicroProfileCounterAdd writes to a slot owned by the calling thread, readers sum the slots
+#endif
+
 #ifdef _WIN32
 #include <basetsd.h>
 typedef UINT_PTR MpSocket;
@@ -639,18 +1099,93 @@ enum MicroProfileCounterFlags
 	MICROPROFILE_COUNTER_FLAG_LEAF			= 0x20,
 };
 
+#if MICROPROFILE_LOG_WIDE
+struct MicroProfileLogEntry
+{
+	uint64_t nTick;
+	uint32_t nTimerIndex;
+	uint16_t nCpu;
+	uint16_t nType;
+};
+#else
 typedef uint64_t MicroProfileLogEntry;
+#endif
 
-struct MicroProfileTimer
+#if MICROPROFILE_LOG_COMPACT
+typedef uint32_t MicroProfileLogWord; //entries take 1-3 words, see MicroProfileLogCompactRead
+#else
+typedef MicroProfileLogEntry MicroProfileLogWord;
+#endif
+
+#define MICROPROFILE_GROUP_MASK_WORDS ((MICROPROFILE_MAX_GROUPS + 64) / 64)
+
+//bitmap of groups, indexed by group index + 1 like the token. bit 0 is never set, so testing the group of MICROPROFILE_INVALID_TOKEN fails
+struct MicroProfileGroupMask
 {
-	uint64_t nTicks;
-	uint32_t nCount;
+	uint64_t nBits[MICROPROFILE_GROUP_MASK_WORDS];
+
+	bool Test(uint32_t nGroup) const
+	{
+		uint32_t nBit = (uint16_t)(nGroup + 1);
+		return 0 != ((nBits[nBit / 64] >> (nBit % 64)) & 1);
+	}
+	void Set(uint32_t nGroup)
+	{
+		uint32_t nBit = (uint16_t)(nGroup + 1);
+		nBits[nBit / 64] |= 1ull << (nBit % 64);
+	}
+	void Clear(uint32_t nGroup)
+	{
+		uint32_t nBit = (uint16_t)(nGroup + 1);
+		nBits[nBit / 64] &= ~(1ull << (nBit % 64));
+	}
+	void Toggle(uint32_t nGroup)
+	{
+		uint32_t nBit = (uint16_t)(nGroup + 1);
+		nBits[nBit / 64] ^= 1ull << (nBit % 64);
+	}
+	void Reset()
+	{
+		memset(nBits, 0, sizeof(nBits));
+	}
+	bool Any() const
+	{
+		uint64_t nAny = 0;
+		for(uint32_t i = 0; i < MICROPROFILE_GROUP_MASK_WORDS; ++i)
+			nAny |= nBits[i];
+		return 0 != nAny;
+	}
+	bool Contains(const MicroProfileGroupMask& Mask) const
+	{
+		for(uint32_t i = 0; i < MICROPROFILE_GROUP_MASK_WORDS; ++i)
+			if(Mask.nBits[i] & ~nBits[i])
+				return false;
+		return true;
+	}
+	void Add(const MicroProfileGroupMask& Mask)
+	{
+		for(uint32_t i = 0; i < MICROPROFILE_GROUP_MASK_WORDS; ++i)
+			nBits[i] |= Mask.nBits[i];
+	}
+	void Remove(const MicroProfileGroupMask& Mask)
+	{
+		for(uint32_t i = 0; i < MICROPROFILE_GROUP_MASK_WORDS; ++i)
+			nBits[i] &= ~Mask.nBits[i];
+	}
+	bool operator==(const MicroProfileGroupMask& Mask) const
+	{
+		return 0 == memcmp(nBits, Mask.nBits, sizeof(nBits));
+	}
+	bool operator!=(const MicroProfileGroupMask& Mask) const
+	{
+		return !(*this == Mask);
+	}
 };
 
 struct MicroProfileCategory
 {
 	char pName[MICROPROFILE_NAME_MAX_LEN];
-	uint64_t nGroupMask;
+	MicroProfileGroupMask nGroupMask;
 };
 
 struct MicroProfileGroupInfo
@@ -663,6 +1198,7 @@ struct MicroProfileGroupInfo
 	uint32_t nColor;
 	uint32_t nCategory;
 	MicroProfileTokenType Type;
+	uint32_t nSampleRate;
 };
 
 struct MicroProfileTimerInfo
@@ -711,6 +1247,57 @@ struct MicroProfileContextSwitch
 	int64_t nTicks : 56;
 };
 
+struct MicroProfileFlowEvent
+{
+	uint64_t nFlowId;
+	int64_t nTick;
+	uint32_t nLogIndex;
+	uint32_t nBegin;
+};
+
+
+struct MicroProfileRequestTimer
+{
+	uint32_t nTimer;
+	int64_t nTicks;
+};
+
+struct MicroProfileRequest
+{
+	uint64_t nRequestId;
+	int64_t nTickStart;
+	int64_t nTickEnd;
+	int64_t nTicksActive;
+	uint32_t nNumTimers;
+	MicroProfileRequestTimer Timers[MICROPROFILE_REQUEST_TIMERS_MAX];
+};
+
+struct MicroProfileRequestEntry
+{
+	uint32_t nLogIndex;
+	MicroProfileLogEntry LE;
+};
+
+struct MicroProfileRequestExemplar
+{
+	MicroProfileRequest Request;
+	uint32_t nNumEntries;
+	MicroProfileRequestEntry Entries[MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES];
+};
+
+struct MicroProfileRequestState
+{
+	MicroProfileRequest Requests[MICROPROFILE_REQUEST_MAX];
+	uint32_t nNumRequests;
+	uint32_t nDropped;
+	uint32_t nWindowFrames;
+	uint32_t nScanFrames; //frames added since the exemplars were last read from the thread logs
+	uint32_t nScanExemplars; //exemplars holding the entries of the current window, 0 once the window is cleared
+	uint32_t nNumExemplars;
+	uint32_t nExemplarRequests; //requests seen in the window the exemplars were picked from
+	uint32_t nExemplarDropped;
+	MicroProfileRequestExemplar Exemplars[MICROPROFILE_REQUEST_EXEMPLARS];
+};
 
 struct MicroProfileFrameState
 {
@@ -718,28 +1305,314 @@ struct MicroProfileFrameState
 	int64_t nFrameStartGpu;
 	uint32_t nFrameStartGpuTimer;
 	uint32_t nLogStart[MICROPROFILE_MAX_THREADS];
+	uint32_t nLabelStart[MICROPROFILE_MAX_THREADS];
+#if MICROPROFILE_LOG_COMPACT
+	int64_t nLogStartTick[MICROPROFILE_MAX_THREADS]; //tick the compact entry at nLogStart is relative to
+#endif
 };
 
-struct MicroProfileThreadLog
-{
-	MicroProfileLogEntry*	Log;
-	std::atomic<uint32_t>	nPut;
-	std::atomic<uint32_t>	nGet;
+#if MICROPROFILE_FLIGHT_RECORDER || MICROPROFILE_CRASH_DUMP
+//a recording is a header page, append only meta chunks naming groups, timers and counters, then a ring of frame chunks.
+//every chunk carries a hash of its payload and frame chunks a sequence number, so readers stop at the first chunk torn by a crash
+#define MP_FLIGHT_MAGIC 0x5246504d //'MPFR'
+#define MP_FLIGHT_CHUNK_MAGIC 0x4b48434d //'MCHK'
+#define MP_FLIGHT_VERSION 1
+#define MP_FLIGHT_HEADER_SIZE (4<<10)
+#define MP_FLIGHT_FLAG_META_FULL 0x1
+#define MP_FLIGHT_HASH_SEED 2166136261u
+
+enum
+{
+	MP_FLIGHT_CHUNK_FRAME,
+	MP_FLIGHT_CHUNK_WRAP, //the ring continues at the start
+	MP_FLIGHT_CHUNK_GROUP,
+	MP_FLIGHT_CHUNK_TIMER,
+	MP_FLIGHT_CHUNK_COUNTER,
+};
 
-	MicroProfileLogEntry*	LogGpu;
-	std::atomic<uint32_t>	nPutGpu;
-	uint32_t				nStartGpu;
-	uint32_t				bActiveGpu;
-	void*					pContextGpu;
+struct MicroProfileFlightHeader
+{
+	uint32_t nMagic;
+	uint32_t nVersion;
+	uint32_t nFlags;
+	uint32_t nPad;
+	uint64_t nFileSize;
+	uint64_t nMetaOffset;
+	uint64_t nMetaSize;
+	uint64_t nMetaBytes; //meta chunks written
+	uint64_t nRingOffset;
+	uint64_t nRingSize;
+	uint64_t nTail; //oldest frame chunk, moved before the ring overwrites it
+	uint64_t nSeqTail;
+	uint64_t nHead; //where the next frame chunk goes, moved after it is written
+	uint64_t nSeqHead;
+	int64_t nTicksPerSecond;
+	int64_t nTickReference; //tick at nTimeReference, to place frames in time
+	int64_t nTimeReference;
+	uint64_t nDroppedChunks;
+};
 
-	uint32_t 				nActive;
-	uint32_t 				nGpu;
-	MicroProfileThreadIdType nThreadId;
-	uint32_t 				nLogIndex;
+struct MicroProfileFlightChunk
+{
+	uint32_t nMagic;
+	uint32_t nType;
+	uint32_t nSize; //payload bytes following the chunk. chunks are padded to 8 bytes
+	uint32_t nHash;
+	uint64_t nSeq;
+};
 
-	uint32_t				nStack[MICROPROFILE_STACK_MAX];
-	int64_t					nChildTickStack[MICROPROFILE_STACK_MAX];
-	uint32_t				nStackPos;
+//meta payloads, followed by the name
+struct MicroProfileFlightGroup
+{
+	uint32_t nIndex;
+	uint32_t nType;
+	uint32_t nColor;
+	uint32_t nPad;
+};
+
+struct MicroProfileFlightTimer
+{
+	uint32_t nIndex;
+	uint32_t nGroup;
+	uint32_t nColor;
+	uint32_t nPad;
+};
+
+struct MicroProfileFlightCounter
+{
+	uint32_t nIndex;
+	int32_t nParent; //counters are named relative to their parent
+	uint32_t nFormat;
+	uint32_t nFlags;
+	int64_t nLimit;
+};
+
+//frame payload is the frame, each thread followed by its events, the context switches and a value per counter
+struct MicroProfileFlightFrame
+{
+	uint64_t nFrameIndex;
+	int64_t nTickStart;
+	int64_t nTickEnd;
+	uint32_t nNumThreads;
+	uint32_t nNumContextSwitches;
+	uint32_t nNumCounters;
+	uint32_t nDroppedFrames;
+};
+
+struct MicroProfileFlightThread
+{
+	uint64_t nThreadId;
+	uint32_t nLogIndex;
+	uint32_t nNumEvents;
+	uint32_t nFiber;
+	uint32_t nPad;
+	char Name[64];
+};
+
+struct MicroProfileFlightEvent
+{
+	int64_t nValue; //full tick, payload, or the length of the label string following the event
+	uint32_t nIndex;
+	uint16_t nType;
+	uint16_t nCpu;
+};
+
+struct MicroProfileFlightContextSwitch
+{
+	int64_t nTicks;
+	uint64_t nThreadIn;
+	uint64_t nThreadOut;
+	uint64_t nProcessIn;
+	uint32_t nCpu;
+	uint32_t nPad;
+};
+#endif
+
+#if MICROPROFILE_FLIGHT_RECORDER
+struct MicroProfileFlightRecorder
+{
+	char* pStage; //chunks queued by flip for the recorder thread
+	uint32_t nStageSize;
+	std::atomic<uint64_t> nStagePut;
+	std::atomic<uint64_t> nStageGet;
+	uint32_t nGroups; //meta queued so far
+	uint32_t nTimers;
+	uint32_t nCounters;
+	uint32_t nCounterFormat[MICROPROFILE_MAX_COUNTERS];
+	uint32_t nCounterFlags[MICROPROFILE_MAX_COUNTERS];
+	int64_t nCounterLimit[MICROPROFILE_MAX_COUNTERS];
+	uint32_t nContextSwitchGet;
+	uint32_t nDroppedFrames;
+
+	MicroProfileFlightHeader* pHeader; //the mapped file, written by the recorder thread
+	char* pFile;
+	uint64_t nFileSize;
+#ifdef _WIN32
+	void* hFile;
+	void* hMapping;
+#else
+	int nFile;
+#endif
+	MicroProfileThread Thread;
+	std::atomic<uint32_t> nStop;
+};
+#endif
+
+#if MICROPROFILE_CRASH_DUMP && (defined(__APPLE__) || defined(__linux__))
+#include <signal.h>
+#define MP_CRASH_DUMP_NUM_SIGNALS 4
+
+//everything the signal handler touches is allocated by MicroProfileCrashDumpStart
+struct MicroProfileCrashDump
+{
+	int nFile;
+	std::atomic<uint32_t> nBusy;
+	struct sigaction Previous[MP_CRASH_DUMP_NUM_SIGNALS];
+	void* pStack;
+	stack_t PreviousStack;
+	int64_t nTicksPerSecond;
+	int64_t nTickReference;
+	int64_t nTimeReference;
+
+	uint64_t nFilePos; //where Buffer goes in the file
+	uint32_t nBuffered;
+	uint64_t nChunkPos;
+	uint32_t nChunkSize;
+	uint32_t nChunkHash;
+	bool bError;
+	char Buffer[16<<10];
+
+	uint32_t nLogEnd[MICROPROFILE_MAX_THREADS]; //snapshot taken when the signal arrives
+	int64_t nCounters[MICROPROFILE_MAX_COUNTERS];
+	int64_t nTickEnd;
+};
+#endif
+
+struct MicroProfileThreadLog;
+
+//copy of one thread log, and the buffers its logged range is copied to
+struct MicroProfileDumpLogCopy
+{
+	MicroProfileThreadLog* pLog;
+	MicroProfileLogWord* pBuffer;
+	uint32_t nBufferSize;
+	char* pLabelBuffer;
+};
+
+//a file dump in progress. flip copies the state the dump reads, the writer thread formats and writes it.
+//kept until exit or shutdown, so the buffers of the copy are reused by every later dump
+struct MicroProfileDumpWriter
+{
+	MicroProfile* pState; //copy of the state the dump reads, its pool pointing at the log copies
+	MicroProfileDumpLogCopy Logs[MICROPROFILE_MAX_THREADS];
+	MicroProfileContextSwitch* ContextSwitch;
+	MicroProfileDumpType eType;
+	uint32_t nFrames;
+	char Path[512];
+	MicroProfileThread Thread;
+	uint32_t bThread; //started and not yet joined
+	std::atomic<uint32_t> nDone;
+};
+
+#if MICROPROFILE_AGGREGATE_ONLY
+struct MicroProfileShadowScope
+{
+	MicroProfileToken		nToken;
+	uint64_t				nTickStart;
+	int64_t					nChildTicks;
+};
+#endif
+
+constexpr uint32_t MicroProfilePow2Ceil(uint32_t nValue, uint32_t nPow2 = 1)
+{
+	return nPow2 >= nValue ? nPow2 : MicroProfilePow2Ceil(nValue, nPow2 * 2);
+}
+
+struct MicroProfileThreadLog
+{
+	MicroProfileLogWord*	Log;
+	uint32_t				nLogSize; //words in Log. only varies in per cpu mode, see MicroProfileLogSize
+	std::atomic<uint32_t>	nPut;
+	uint32_t				nGetCached; //nGet as last seen by the owning thread, reloaded only when the log looks full
+	uint32_t				nCapture; //thread is selected for capture. read by every timer, written by flip when the selection changes
+	uint32_t				nFiber; //log of a fiber, sized MICROPROFILE_FIBER_BUFFER_SIZE. read with the log size by every timer
+#if MICROPROFILE_LOG_COMPACT
+	int64_t					nCompactTick; //tick of the last entry written, only touched by the owning thread
+#endif
+#if MICROPROFILE_PER_CPU_LOG
+	uint32_t				nCpuLog; //entries go to the per cpu buffers, and flip writes Log
+	uint32_t				nCpuLogSeqPut; //sequence number of the next record, only touched by the owning thread
+#endif
+
+	//fields written by flip every frame, kept off the cache lines the owning thread writes
+	char					PadFlipBegin[MICROPROFILE_CACHE_LINE_SIZE];
+	std::atomic<uint32_t>	nGet;
+	std::atomic<uint32_t>	nLabelGet; //start of the oldest frame in history
+#if MICROPROFILE_LOG_COMPACT
+	uint32_t				nCompactGet; //position flip has decoded up to
+	int64_t					nCompactGetTick;
+#endif
+#if MICROPROFILE_PER_CPU_LOG
+	uint32_t				nCpuLogSeqGet; //sequence number of the next record flip moves into Log
+#endif
+	char					PadFlipEnd[MICROPROFILE_CACHE_LINE_SIZE];
+
+	char*					LabelBuffer;
+	std::atomic<uint32_t>	nLabelPut; //only written by the owning thread
+
+	MicroProfileLogEntry*	LogGpu;
+	std::atomic<uint32_t>	nPutGpu;
+	uint32_t				nStartGpu;
+	uint32_t				bActiveGpu;
+	void*					pContextGpu;
+
+	uint32_t 				nActive;
+	uint32_t 				nGpu;
+	MicroProfileThreadIdType nThreadId;
+	uint32_t 				nLogIndex;
+	uint32_t				nFiberHost; //log index of the thread the fiber last ran on
+
+	uint64_t				nRequestId; //last request logged by the thread
+	uint64_t				nRequestFlip; //request active at the flip position
+	int64_t					nRequestFlipTick;
+	uint64_t				nRequestScan; //request active at the frame the exemplars were last read up to
+
+	uint32_t				nSampleCountdown[MICROPROFILE_MAX_TIMERS];
+
+#if MICROPROFILE_LABEL_INTERN
+	uint32_t				nLabelInternCache[MICROPROFILE_LABEL_INTERN_CACHE]; //id + 1, indexed by hash
+#endif
+
+#if MICROPROFILE_COUNTER_SHARDED
+	std::atomic<int64_t>	nCounterShard[MICROPROFILE_MAX_COUNTERS]; //only written by the owning thread
+	std::atomic<uint32_t>	nCounterShardEpoch[MICROPROFILE_MAX_COUNTERS]; //shards from before the last MicroProfileCounterSet are ignored
+#endif
+
+#if MICROPROFILE_AGGREGATE_ONLY
+	//aggregate only mode. scopes are matched on a shadow stack and added to running totals, all written by the owning thread
+	MicroProfileShadowScope	ShadowStack[MICROPROFILE_STACK_MAX];
+	uint32_t				nShadowStackPos;
+	uint8_t					nShadowGroupDepth[MICROPROFILE_MAX_GROUPS];
+	std::atomic<uint32_t>	nTotalEvents; //bumped after each scope is added, so flip can skip idle threads
+	std::atomic<int64_t>	nTotalTicks[MICROPROFILE_MAX_TIMERS];
+	std::atomic<int64_t>	nTotalExclusive[MICROPROFILE_MAX_TIMERS];
+	std::atomic<uint32_t>	nTotalCount[MICROPROFILE_MAX_TIMERS];
+	std::atomic<int64_t>	nTotalGroupTicks[MICROPROFILE_MAX_GROUPS];
+	char					PadTotal[MICROPROFILE_CACHE_LINE_SIZE];
+	//totals as of the last flip, only touched by flip
+	uint32_t				nTotalEventsSeen;
+	int64_t					nTotalTicksSeen[MICROPROFILE_MAX_TIMERS];
+	int64_t					nTotalExclusiveSeen[MICROPROFILE_MAX_TIMERS];
+	uint32_t				nTotalCountSeen[MICROPROFILE_MAX_TIMERS];
+	int64_t					nTotalGroupTicksSeen[MICROPROFILE_MAX_GROUPS];
+#endif
+
+	MicroProfileLogEntry	Stack[MICROPROFILE_STACK_MAX];
+	int64_t					nChildTickStack[MICROPROFILE_STACK_MAX];
+	uint32_t				nChildCountStack[MICROPROFILE_STACK_MAX];
+	uint32_t				nDescendantCountStack[MICROPROFILE_STACK_MAX];
+	uint32_t				nStackPos;
+	uint32_t				nAsyncSuspend; //flip read an async suspend, the leave after it ends a segment and is not counted as a call
 
 
 	uint8_t					nGroupStackPos[MICROPROFILE_MAX_GROUPS];
@@ -754,6 +1627,32 @@ struct MicroProfileThreadLog
 	int 					nFreeListNext;
 };
 
+#if MICROPROFILE_PER_CPU_LOG
+struct MicroProfileCpuLogRecord
+{
+	uint64_t				nValue; //tick, label, meta count or extended payload
+	uint32_t				nIndex; //token or extended sub type
+	uint32_t				nSeq; //position in the stream of the thread log, restores the order of threads that moved between cpus
+	uint16_t				nLogIndex;
+#if MICROPROFILE_LOG_WIDE
+	uint16_t				nCpu; //buffers are shared by cpus beyond their count
+#endif
+	uint8_t					nType;
+	std::atomic<uint32_t>	nCommit; //low bits of the position + 1, stored once the record is written
+};
+
+//ring written by every thread running on one cpu. records are reserved with a cas on nPut, which is rarely contended
+//as only threads preempted on the same cpu meet there
+struct MicroProfileCpuLog
+{
+	std::atomic<uint64_t>	nPut;
+	char					PadPut[MICROPROFILE_CACHE_LINE_SIZE];
+	std::atomic<uint64_t>	nGet; //written by flip
+	char					PadGet[MICROPROFILE_CACHE_LINE_SIZE];
+	MicroProfileCpuLogRecord* Records; //S.nCpuLogRecords of them
+};
+#endif
+
 struct MicroProfileGpu
 {
 	void (*Shutdown)();
@@ -764,8 +1663,28 @@ struct MicroProfileGpu
 	bool (*GetTickReference)(int64_t* pOutCpu, int64_t* pOutGpu);
 };
 
+typedef void MicroProfileAccumulateFunc(uint64_t* pSum, uint64_t* pMax, uint64_t* pMin, const uint64_t* pValue, uint32_t nCount);
+typedef void MicroProfileTicksToMsFunc(float* pOut, const uint64_t* pTicks, const float* pToMs, float fScale, uint32_t nCount);
+
 struct MicroProfile
 {
+	//read by every timer. only written when groups are toggled or registered, so they stay shared in every core's cache
+	MicroProfileGroupMask nActiveGroup;
+	MicroProfileGroupMask nGroupMaskGpu;
+	MicroProfileGroupMask nGroupMaskSampled; //groups containing timers with a sample rate
+#if MICROPROFILE_AGGREGATE_ONLY
+	uint32_t nAggregateOnly; //timers only update the per thread totals. only written by flip
+#endif
+#if MICROPROFILE_PER_CPU_LOG
+	uint32_t nNumCpuLogs;
+	uint32_t nCpuLogRecords; //power of two
+	MicroProfileCpuLog* CpuLogs[MICROPROFILE_MAX_CPUS];
+#endif
+	char PadHot[MICROPROFILE_CACHE_LINE_SIZE];
+
+	uint32_t nOverflow; //set by any thread dropping entries
+	char PadOverflow[MICROPROFILE_CACHE_LINE_SIZE];
+
 	uint32_t nTotalTimers;
 	uint32_t nGroupCount;
 	uint32_t nCategoryCount;
@@ -778,22 +1697,18 @@ struct MicroProfile
 	
 	uint32_t nDisplay;
 	uint32_t nBars;
-	uint64_t nActiveGroup;
 	uint32_t nActiveBars;
 
-	uint64_t nForceGroup;
+	MicroProfileGroupMask nForceGroup;
 	uint32_t nForceEnable;
 	uint32_t nForceMetaCounters;
 
-	uint64_t nForceGroupUI;
-	uint64_t nActiveGroupWanted;
+	MicroProfileGroupMask nForceGroupUI;
+	MicroProfileGroupMask nActiveGroupWanted;
 	uint32_t nAllGroupsWanted;
 	uint32_t nAllThreadsWanted;
 
-	uint32_t nOverflow;
-
-	uint64_t nGroupMask;
-	uint64_t nGroupMaskGpu;
+	MicroProfileGroupMask nGroupMask;
 	uint32_t nRunning;
 	uint32_t nToggleRunning;
 	uint32_t nMaxGroupSize;
@@ -802,6 +1717,7 @@ struct MicroProfile
 	MicroProfileDumpType eDumpType;
 	uint32_t nDumpFrames;
 	char DumpPath[512];
+	MicroProfileDumpWriter* pDumpWriter;
 
 	int64_t nPauseTicks;
 
@@ -811,22 +1727,34 @@ struct MicroProfile
 	MicroProfileCategory	CategoryInfo[MICROPROFILE_MAX_CATEGORIES];
 	MicroProfileGroupInfo 	GroupInfo[MICROPROFILE_MAX_GROUPS];
 	MicroProfileTimerInfo 	TimerInfo[MICROPROFILE_MAX_TIMERS];
-	uint8_t					TimerToGroup[MICROPROFILE_MAX_TIMERS];
+	uint16_t				TimerToGroup[MICROPROFILE_MAX_TIMERS];
+	uint32_t				TimerHash[2 * MICROPROFILE_MAX_TIMERS]; //timer index + 1, hashed by group index and name
+	uint32_t				GroupHash[2 * MICROPROFILE_MAX_GROUPS]; //group index + 1, hashed by name
+	uint32_t				TimerSampleRate[MICROPROFILE_MAX_TIMERS]; //0 or 1 when every call is recorded. max of the user and governor rates
+	uint32_t				TimerSampleRatePrev[MICROPROFILE_MAX_TIMERS]; //rate for scopes entered before TimerSampleRateTick
+	int64_t					TimerSampleRateTick[MICROPROFILE_MAX_TIMERS];
+	uint32_t				TimerSampleRateUser[MICROPROFILE_MAX_TIMERS];
+	uint32_t				TimerSampleRateGovernor[MICROPROFILE_MAX_TIMERS];
+	uint32_t				TimerGovernorCalls[MICROPROFILE_MAX_TIMERS]; //calls per frame when the governor disabled the timer
 	
-	MicroProfileTimer 		AccumTimers[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AccumMaxTimers[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AccumMinTimers[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AccumTimersExclusive[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AccumMaxTimersExclusive[MICROPROFILE_MAX_TIMERS];
-
-	MicroProfileTimer 		Frame[MICROPROFILE_MAX_TIMERS];
-	uint64_t				FrameExclusive[MICROPROFILE_MAX_TIMERS];
-
-	MicroProfileTimer 		Aggregate[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AggregateMax[MICROPROFILE_MAX_TIMERS];	
-	uint64_t				AggregateMin[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AggregateExclusive[MICROPROFILE_MAX_TIMERS];
-	uint64_t				AggregateMaxExclusive[MICROPROFILE_MAX_TIMERS];
+	//per timer statistics, one aligned array per field so flip can run simd kernels over them
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AccumTicks[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AccumCount[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AccumMaxTimers[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AccumMinTimers[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AccumTimersExclusive[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AccumMaxTimersExclusive[MICROPROFILE_MAX_TIMERS];
+
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t FrameTicks[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t FrameCount[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t FrameExclusive[MICROPROFILE_MAX_TIMERS];
+
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AggregateTicks[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AggregateCount[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AggregateMax[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AggregateMin[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AggregateExclusive[MICROPROFILE_MAX_TIMERS];
+	alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t AggregateMaxExclusive[MICROPROFILE_MAX_TIMERS];
 
 
 	uint64_t 				FrameGroup[MICROPROFILE_MAX_GROUPS];
@@ -839,13 +1767,13 @@ struct MicroProfile
 
 	struct 
 	{
-		uint64_t nCounters[MICROPROFILE_MAX_TIMERS];
+		alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t nCounters[MICROPROFILE_MAX_TIMERS];
 
-		uint64_t nAccum[MICROPROFILE_MAX_TIMERS];
-		uint64_t nAccumMax[MICROPROFILE_MAX_TIMERS];
+		alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t nAccum[MICROPROFILE_MAX_TIMERS];
+		alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t nAccumMax[MICROPROFILE_MAX_TIMERS];
 
-		uint64_t nAggregate[MICROPROFILE_MAX_TIMERS];
-		uint64_t nAggregateMax[MICROPROFILE_MAX_TIMERS];
+		alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t nAggregate[MICROPROFILE_MAX_TIMERS];
+		alignas(MICROPROFILE_CACHE_LINE_SIZE) uint64_t nAggregateMax[MICROPROFILE_MAX_TIMERS];
 
 		uint64_t nSum;
 		uint64_t nSumAccum;
@@ -860,6 +1788,8 @@ struct MicroProfile
 	uint32_t				nGraphPut;
 
 	uint32_t				nThreadActive[MICROPROFILE_MAX_THREADS];
+	char					ThreadWanted[MICROPROFILE_MAX_THREADS][64]; //names enabled with MicroProfileEnableThread, applied to threads created later
+	uint32_t				nNumThreadWanted;
 	MicroProfileThreadLog* 	Pool[MICROPROFILE_MAX_THREADS];
 	uint32_t				nNumLogs;
 	uint32_t 				nMemUsage;
@@ -878,6 +1808,12 @@ struct MicroProfile
 	uint64_t				nFlipAggregateDisplay;
 	uint64_t				nFlipMaxDisplay;
 
+	MicroProfileFlowEvent		FlowEvents[MICROPROFILE_FLOW_MAX];
+	uint32_t					nNumFlowEvents;
+	MicroProfileFlowSegment		FlowCriticalPath[MICROPROFILE_FLOW_CRITICAL_PATH_MAX];
+	uint32_t					nFlowCriticalPathSegments;
+	int64_t						nFlowCriticalPathTicks;
+
 	MicroProfileThread 			ContextSwitchThread;
 	bool  						bContextSwitchRunning;
 	bool						bContextSwitchStart;
@@ -896,7 +1832,7 @@ struct MicroProfile
 	uint8_t						nContextSwitchHoverCpuNext;
 
 	uint32_t					nContextSwitchPut;	
-	MicroProfileContextSwitch 	ContextSwitch[MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE];
+	MicroProfileContextSwitch* 	ContextSwitch; //MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE entries, allocated when the trace starts
 
 	MicroProfileThread			WebServerThread;
 
@@ -907,14 +1843,48 @@ struct MicroProfile
 	uint32_t					nWebServerPut;
 	uint64_t 					nWebServerDataSent;
 
-	std::atomic<char*>			LabelBuffer;
-	std::atomic<uint64_t>		nLabelPut;
+	std::atomic<uint32_t>		nAsyncIdNext;
+
+	MicroProfileRequestState*	pRequests;
+#if MICROPROFILE_FLIGHT_RECORDER
+	MicroProfileFlightRecorder*	pFlightRecorder;
+#endif
+#if MICROPROFILE_CRASH_DUMP && (defined(__APPLE__) || defined(__linux__))
+	MicroProfileCrashDump*		pCrashDump;
+#endif
+
+	float						fOverheadBudget;
+	float						fOverhead; //estimated instrumentation cost of the last frame, as a fraction of frame time
+	int64_t						nGovernorEventTicks;
+	uint32_t					nGovernorCalmFrames;
+	uint32_t					nGovernorThrottled;
+
+	float						fCalibratedPairTicks; //measured cost of one enter/leave pair
+
+	MicroProfileAccumulateFunc*	pAccumulate; //statistics kernels, picked for the cpu at init
+	MicroProfileTicksToMsFunc*	pTicksToMs;
+	uint32_t					nOverheadSubtract;
+	uint32_t					nAggregateOnlyWanted;
+	uint32_t					nAggregateOnlyHold; //frames left with detailed logging forced on
+
+#if MICROPROFILE_LABEL_INTERN
+	std::atomic<uint32_t>		LabelInternTable[2 * MICROPROFILE_LABEL_INTERN_MAX]; //id + 1, open addressed by hash
+	std::atomic<const char*>	LabelInternStrings[MICROPROFILE_LABEL_INTERN_MAX];
+	uint32_t					LabelInternHash[MICROPROFILE_LABEL_INTERN_MAX];
+	std::atomic<uint32_t>		nLabelInternCount;
+	std::atomic<uint32_t>		nLabelInternPut;
+	char						LabelInternBuffer[MICROPROFILE_LABEL_INTERN_BUFFER_SIZE];
+#endif
 
 	char 						CounterNames[MICROPROFILE_MAX_COUNTER_NAME_CHARS];
 	MicroProfileCounterInfo 	CounterInfo[MICROPROFILE_MAX_COUNTERS];
+	uint32_t					CounterHash[2 * MICROPROFILE_MAX_COUNTERS]; //counter index + 1, hashed by parent and name
 	uint32_t					nNumCounters;
 	uint32_t					nCounterNamePos;
 	std::atomic<int64_t> 		Counters[MICROPROFILE_MAX_COUNTERS];
+#if MICROPROFILE_COUNTER_SHARDED
+	std::atomic<uint32_t>		CounterEpoch[MICROPROFILE_MAX_COUNTERS]; //bumped by MicroProfileCounterSet
+#endif
 
 #if MICROPROFILE_COUNTER_HISTORY // uses 1kb per allocated counter. 512kb for default counter count
 	uint32_t					nCounterHistoryPut;
@@ -927,16 +1897,80 @@ struct MicroProfile
 	MicroProfileGpu				GPU;
 };
 
+#if MICROPROFILE_LOG_WIDE
+#define MP_LOG_TICK_MASK  0xffffffffffffffff
+#define MP_LOG_MAX_TIMERS 0x10000 //bounded by the 16 bit timer index of tokens
+#else
 #define MP_LOG_TICK_MASK  0x0000ffffffffffff
 #define MP_LOG_INDEX_MASK 0x1fff000000000000
 #define MP_LOG_BEGIN_MASK 0xe000000000000000
+#define MP_LOG_MAX_TIMERS ((MP_LOG_INDEX_MASK >> 48) + 1)
+#endif
+#define MP_LOG_EXTENDED 0x5
 #define MP_LOG_GPU_EXTRA 0x4
 #define MP_LOG_LABEL 0x3
 #define MP_LOG_META 0x2
 #define MP_LOG_ENTER 0x1
 #define MP_LOG_LEAVE 0x0
 
+//extended entries store their subtype in the timer index bits and are followed by a payload entry carrying 48 bits of data (64 with MICROPROFILE_LOG_WIDE)
+#define MP_LOG_EXTENDED_PAYLOAD 0x0
+#define MP_LOG_EXTENDED_FLOW_BEGIN 0x1
+#define MP_LOG_EXTENDED_FLOW_END 0x2
+#define MP_LOG_EXTENDED_ASYNC_BEGIN 0x3
+#define MP_LOG_EXTENDED_ASYNC_SUSPEND 0x4
+#define MP_LOG_EXTENDED_ASYNC_RESUME 0x5
+#define MP_LOG_EXTENDED_ASYNC_END 0x6
+#define MP_LOG_EXTENDED_FIBER_SWITCH 0x7
+#define MP_LOG_EXTENDED_REQUEST 0x8
+
+#define MICROPROFILE_SAMPLE_DISABLED ((uint32_t)-1)
+#define MICROPROFILE_INVALID_LABEL ((uint64_t)-1)
+#define MICROPROFILE_LABEL_INTERNED (1ull << 47) //label ids with this bit set index the global intern table
+
+
+#if MICROPROFILE_LOG_WIDE
+inline uint64_t MicroProfileLogType(MicroProfileLogEntry Index)
+{
+	return Index.nType;
+}
+
+inline uint64_t MicroProfileLogTimerIndex(MicroProfileLogEntry Index)
+{
+	return Index.nTimerIndex;
+}
+
+inline MicroProfileLogEntry MicroProfileMakeLogIndex(uint64_t nBegin, MicroProfileToken nToken, int64_t nTick)
+{
+	MicroProfileLogEntry LE;
+	LE.nTick = nTick;
+	LE.nTimerIndex = (uint32_t)(nToken & 0xffff);
+	LE.nCpu = 0;
+	LE.nType = (uint16_t)nBegin;
+	return LE;
+}
+
+inline int64_t MicroProfileLogTickDifference(int64_t nStart, int64_t nEnd)
+{
+	return nEnd - nStart;
+}
+
+inline int64_t MicroProfileLogGetTick(MicroProfileLogEntry e)
+{
+	return e.nTick;
+}
+
+inline MicroProfileLogEntry MicroProfileLogSetTick(MicroProfileLogEntry e, int64_t nTick)
+{
+	e.nTick = nTick;
+	return e;
+}
 
+inline uint32_t MicroProfileLogCpu(MicroProfileLogEntry e)
+{
+	return e.nCpu;
+}
+#else
 inline uint64_t MicroProfileLogType(MicroProfileLogEntry Index)
 {
 	return ((MP_LOG_BEGIN_MASK & Index)>>61) & 0x7;
@@ -965,11 +1999,185 @@ inline int64_t MicroProfileLogGetTick(MicroProfileLogEntry e)
 	return MP_LOG_TICK_MASK & e;
 }
 
-inline int64_t MicroProfileLogSetTick(MicroProfileLogEntry e, int64_t nTick)
+inline MicroProfileLogEntry MicroProfileLogSetTick(MicroProfileLogEntry e, int64_t nTick)
 {
 	return (MP_LOG_TICK_MASK & nTick) | (e & ~MP_LOG_TICK_MASK);
 }
 
+inline uint32_t MicroProfileLogCpu(MicroProfileLogEntry e)
+{
+	(void)e;
+	return (uint32_t)-1;
+}
+#endif
+
+#if MICROPROFILE_LOG_COMPACT
+//compact entries are 3 type bits, 13 timer index bits and a 16 bit value. ticks are stored as the delta to the previous tick of the thread.
+//larger values are escaped and followed by one word holding 32 bits, or two words holding 48 bits. 48 bit ticks are absolute
+#define MP_LOG_COMPACT_ESCAPE32 0xfffe
+#define MP_LOG_COMPACT_ESCAPE48 0xffff
+#define MP_LOG_ENTRY_MAX_WORDS 3
+
+inline bool MicroProfileLogCompactIsTick(uint32_t nGpu, uint64_t nType, uint64_t nIndex)
+{
+	//gpu logs store query indices that flip patches into ticks, so they are never delta encoded
+	return !nGpu && (nType == MP_LOG_ENTER || nType == MP_LOG_LEAVE || (nType == MP_LOG_EXTENDED && nIndex != MP_LOG_EXTENDED_PAYLOAD));
+}
+
+//returns the number of words needed to store the entry, and the value to write
+inline uint32_t MicroProfileLogCompactEncode(uint32_t nGpu, int64_t nPrevTick, uint64_t nType, uint64_t nIndex, uint64_t nValue, uint64_t* pField)
+{
+	nValue &= MP_LOG_TICK_MASK;
+	uint64_t nField = MicroProfileLogCompactIsTick(nGpu, nType, nIndex) ? MP_LOG_TICK_MASK & (nValue - nPrevTick) : nValue;
+	bool bPatched = nGpu && (nType == MP_LOG_ENTER || nType == MP_LOG_LEAVE);
+	if(bPatched || nField > 0xffffffff)
+	{
+		*pField = nValue;
+		return 3;
+	}
+	*pField = nField;
+	return nField < MP_LOG_COMPACT_ESCAPE32 ? 1 : 2;
+}
+
+inline void MicroProfileLogCompactWrite(MicroProfileLogWord* pWords, uint32_t nSize, uint32_t nPos, uint64_t nType, uint64_t nIndex, uint64_t nField, uint32_t nWords)
+{
+	uint32_t nHeader = (uint32_t)((nType << 29) | ((nIndex & 0x1fff) << 16));
+	if(nWords == 1)
+	{
+		pWords[nPos] = nHeader | (uint32_t)nField;
+		return;
+	}
+	pWords[nPos] = nHeader | (nWords == 2 ? MP_LOG_COMPACT_ESCAPE32 : MP_LOG_COMPACT_ESCAPE48);
+	pWords[(nPos + 1) % nSize] = (uint32_t)nField;
+	if(nWords == 3)
+		pWords[(nPos + 2) % nSize] = (uint32_t)(nField >> 32);
+}
+
+//decodes the entry at nPos into the regular layout, and returns the position of the next entry.
+//*pTick is the tick of the previous entry, and is only needed for entries carrying ticks
+inline uint32_t MicroProfileLogCompactRead(const MicroProfileLogWord* pWords, uint32_t nSize, uint32_t nPos, uint32_t nGpu, int64_t* pTick, MicroProfileLogEntry* pEntry)
+{
+	uint32_t nHeader = pWords[nPos];
+	uint64_t nType = nHeader >> 29;
+	uint64_t nIndex = (nHeader >> 16) & 0x1fff;
+	uint64_t nValue = nHeader & 0xffff;
+	uint32_t nNext = (nPos + 1) % nSize;
+	bool bAbsolute = false;
+	if(nValue >= MP_LOG_COMPACT_ESCAPE32)
+	{
+		bAbsolute = nValue == MP_LOG_COMPACT_ESCAPE48;
+		nValue = pWords[nNext];
+		nNext = (nNext + 1) % nSize;
+		if(bAbsolute)
+		{
+			nValue |= (uint64_t)pWords[nNext] << 32;
+			nNext = (nNext + 1) % nSize;
+		}
+	}
+	if(MicroProfileLogCompactIsTick(nGpu, nType, nIndex))
+	{
+		if(!bAbsolute)
+			nValue = MP_LOG_TICK_MASK & (*pTick + nValue);
+		*pTick = nValue;
+	}
+	*pEntry = MicroProfileMakeLogIndex(nType, nIndex, nValue);
+	return nNext;
+}
+#else
+#define MP_LOG_ENTRY_MAX_WORDS 1
+#endif
+
+//largest log of a thread, fibers get smaller logs
+inline uint32_t MicroProfileLogSizeMax(const MicroProfileThreadLog* pLog)
+{
+	return pLog->nFiber ? MICROPROFILE_FIBER_BUFFER_SIZE : MICROPROFILE_BUFFER_SIZE;
+}
+
+//words in the log of a thread. fixed unless thread logs are grown by the per cpu mode
+inline uint32_t MicroProfileLogSize(const MicroProfileThreadLog* pLog)
+{
+#if MICROPROFILE_PER_CPU_LOG
+	return pLog->nLogSize ? pLog->nLogSize : MicroProfileLogSizeMax(pLog); //logs allocated on first use get the default size
+#else
+	return MicroProfileLogSizeMax(pLog);
+#endif
+}
+
+//walks the entries of a thread log from nStart up to nEnd. compact logs must start at a frame start, see MicroProfileLogIterateFrame
+struct MicroProfileLogIterator
+{
+	const MicroProfileThreadLog* pLog;
+	uint32_t nPos; //position of the current entry
+	uint32_t nNext;
+	uint32_t nEnd;
+	int64_t nTick; //tick of the previous entry
+	MicroProfileLogEntry LE;
+};
+
+inline MicroProfileLogIterator MicroProfileLogIterate(const MicroProfileThreadLog* pLog, uint32_t nStart, uint32_t nEnd, int64_t nStartTick)
+{
+	MicroProfileLogIterator It;
+	It.pLog = pLog;
+	It.nPos = It.nNext = nStart;
+	It.nEnd = nEnd;
+	It.nTick = nStartTick;
+	It.LE = MicroProfileLogEntry();
+	return It;
+}
+
+//reads the entry at nPos. compact entries carrying ticks are only correct when read through an iterator
+inline MicroProfileLogEntry MicroProfileLogRead(const MicroProfileThreadLog* pLog, uint32_t nPos, uint32_t* pNext)
+{
+#if MICROPROFILE_LOG_COMPACT
+	MicroProfileLogEntry LE;
+	int64_t nTick = 0;
+	uint32_t nNext = MicroProfileLogCompactRead(pLog->Log, MicroProfileLogSize(pLog), nPos, pLog->nGpu, &nTick, &LE);
+#else
+	MicroProfileLogEntry LE = pLog->Log[nPos];
+	uint32_t nNext = (nPos + 1) % MicroProfileLogSize(pLog);
+#endif
+	if(pNext)
+		*pNext = nNext;
+	return LE;
+}
+
+inline bool MicroProfileLogNext(MicroProfileLogIterator& It)
+{
+	if(It.nNext == It.nEnd)
+		return false;
+	It.nPos = It.nNext;
+#if MICROPROFILE_LOG_COMPACT
+	It.nNext = MicroProfileLogCompactRead(It.pLog->Log, MicroProfileLogSize(It.pLog), It.nPos, It.pLog->nGpu, &It.nTick, &It.LE);
+#else
+	It.LE = It.pLog->Log[It.nPos];
+	It.nNext = (It.nPos + 1) % MicroProfileLogSize(It.pLog);
+#endif
+	return true;
+}
+
+//replaces the tick of the entry at nPos. gpu entries are logged with their query index, and patched by flip
+inline void MicroProfileLogPatchTick(MicroProfileThreadLog* pLog, uint32_t nPos, int64_t nTick)
+{
+#if MICROPROFILE_LOG_COMPACT
+	MP_ASSERT((pLog->Log[nPos] & 0xffff) == MP_LOG_COMPACT_ESCAPE48);
+	uint64_t nValue = MP_LOG_TICK_MASK & nTick;
+	pLog->Log[(nPos + 1) % MicroProfileLogSize(pLog)] = (uint32_t)nValue;
+	pLog->Log[(nPos + 2) % MicroProfileLogSize(pLog)] = (uint32_t)(nValue >> 32);
+#else
+	pLog->Log[nPos] = MicroProfileLogSetTick(pLog->Log[nPos], nTick);
+#endif
+}
+
+//extended entries are followed by a payload entry
+inline bool MicroProfileLogGetPayload(const MicroProfileLogIterator& It, uint64_t* pPayload)
+{
+	MicroProfileLogEntry LE = MicroProfileLogRead(It.pLog, It.nNext, 0);
+	if(MicroProfileLogType(LE) != MP_LOG_EXTENDED || MicroProfileLogTimerIndex(LE) != MP_LOG_EXTENDED_PAYLOAD)
+		return false;
+	*pPayload = MicroProfileLogGetTick(LE);
+	return true;
+}
+
 template<typename T>
 T MicroProfileMin(T a, T b)
 { return a < b ? a : b; }
@@ -991,10 +2199,6 @@ inline float MicroProfileTickToMsMultiplier(int64_t nTicksPerSecond)
 	return 1000.f / nTicksPerSecond;
 }
 
-inline uint16_t MicroProfileGetGroupIndex(MicroProfileToken t)
-{
-	return (uint16_t)MicroProfileGet()->TimerToGroup[MicroProfileGetTimerIndex(t)];
-}
 
 
 
@@ -1004,6 +2208,9 @@ inline uint16_t MicroProfileGetGroupIndex(MicroProfileToken t)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #define snprintf _snprintf
+#ifndef MP_GETCURRENTCPU
+#define MP_GETCURRENTCPU() GetCurrentProcessorNumber()
+#endif
 
 #pragma warning(push)
 #pragma warning(disable: 4244)
@@ -1025,7 +2232,102 @@ int64_t MicroProfileGetTick()
 
 #endif
 
-#if MICROPROFILE_WEBSERVER || MICROPROFILE_CONTEXT_SWITCH_TRACE
+#ifndef MP_GETCURRENTCPU
+#define MP_GETCURRENTCPU() 0
+#endif
+
+#if defined(__APPLE__) || defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define MP_PAGE_SIZE (4<<10)
+#define MP_HUGE_PAGE_SIZE (2<<20)
+
+//writes every page, so the page faults are taken here rather than on the profiled thread
+void MicroProfilePrefaultPages(void* p, size_t nSize)
+{
+	volatile char* pBytes = (volatile char*)p;
+	for(size_t i = 0; i < nSize; i += MP_PAGE_SIZE)
+		pBytes[i] = 0;
+}
+
+void* MicroProfileAllocPages(size_t nSize)
+{
+	void* p = 0;
+#if defined(__linux__)
+#if MICROPROFILE_HUGE_PAGES
+	if(0 == nSize % MP_HUGE_PAGE_SIZE)
+	{
+#ifdef MAP_HUGETLB
+		//explicit huge pages only succeed when the system has reserved some
+		p = mmap(0, nSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_POPULATE|MAP_HUGETLB, -1, 0);
+		p = p == MAP_FAILED ? 0 : p;
+#endif
+#ifdef MADV_HUGEPAGE
+		if(!p)
+		{
+			//transparent huge pages need the range to be aligned, so overallocate and trim
+			char* pBase = (char*)mmap(0, nSize + MP_HUGE_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+			if(pBase != MAP_FAILED)
+			{
+				char* pAligned = (char*)(((uintptr_t)pBase + MP_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(MP_HUGE_PAGE_SIZE - 1));
+				if(pAligned != pBase)
+					munmap(pBase, pAligned - pBase);
+				if(pBase + MP_HUGE_PAGE_SIZE != pAligned)
+					munmap(pAligned + nSize, pBase + MP_HUGE_PAGE_SIZE - pAligned);
+				madvise(pAligned, nSize, MADV_HUGEPAGE);
+				MicroProfilePrefaultPages(pAligned, nSize);
+				p = pAligned;
+			}
+		}
+#endif
+	}
+#endif
+	if(!p)
+	{
+		p = mmap(0, nSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_POPULATE, -1, 0);
+		p = p == MAP_FAILED ? 0 : p;
+	}
+#elif defined(__APPLE__)
+	p = mmap(0, nSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+	if(p == MAP_FAILED)
+		p = 0;
+	else
+		MicroProfilePrefaultPages(p, nSize);
+#elif defined(_WIN32)
+#if MICROPROFILE_HUGE_PAGES
+	//large pages need SeLockMemoryPrivilege, and are always resident
+	SIZE_T nLargePage = GetLargePageMinimum();
+	if(nLargePage && 0 == nSize % nLargePage)
+		p = VirtualAlloc(0, nSize, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+#endif
+	if(!p)
+	{
+		p = VirtualAlloc(0, nSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+		if(p)
+			MicroProfilePrefaultPages(p, nSize);
+	}
+#else
+	p = new char[nSize];
+	memset(p, 0, nSize);
+#endif
+	MP_ASSERT(p);
+	return p;
+}
+
+void MicroProfileFreePages(void* p, size_t nSize)
+{
+#if defined(__APPLE__) || defined(__linux__)
+	munmap(p, nSize);
+#elif defined(_WIN32)
+	(void)nSize;
+	VirtualFree(p, 0, MEM_RELEASE);
+#else
+	(void)nSize;
+	delete[] (char*)p;
+#endif
+}
+
 typedef void* (*MicroProfileThreadFunc)(void*);
 
 inline void MicroProfileThreadStart(MicroProfileThread* pThread, MicroProfileThreadFunc Func)
@@ -1038,7 +2340,6 @@ inline void MicroProfileThreadJoin(MicroProfileThread* pThread)
 	delete *pThread;
 	*pThread = nullptr;
 }
-#endif
 
 #if MICROPROFILE_WEBSERVER
 
@@ -1067,6 +2368,12 @@ inline void MicroProfileThreadJoin(MicroProfileThread* pThread)
 #include <stdarg.h>
 #include <math.h>
 #include <algorithm>
+#if MICROPROFILE_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
 
 #ifndef MICROPROFILE_DEBUG
@@ -1076,7 +2383,7 @@ inline void MicroProfileThreadJoin(MicroProfileThread* pThread)
 
 #define S g_MicroProfile
 
-MicroProfile g_MicroProfile;
+alignas(MICROPROFILE_CACHE_LINE_SIZE) MicroProfile g_MicroProfile;
 MicroProfileThreadLog*			g_MicroProfileGpuLog = 0;
 
 #ifndef MP_THREAD_LOCAL
@@ -1090,22 +2397,91 @@ static void MicroProfileCreateThreadLogKey()
 MP_THREAD_LOCAL MicroProfileThreadLog* g_MicroProfileThreadLog = 0;
 #endif
 
-static bool g_bUseLock = false; /// This is used because windows does not support using mutexes under dll init(which is where global initialization is handled)
-
-
-MICROPROFILE_DEFINE(g_MicroProfileFlip, "MicroProfile", "MicroProfileFlip", 0x3355ee);
-MICROPROFILE_DEFINE(g_MicroProfileThreadLoop, "MicroProfile", "ThreadLoop", 0x3355ee);
-MICROPROFILE_DEFINE(g_MicroProfileClear, "MicroProfile", "Clear", 0x3355ee);
-MICROPROFILE_DEFINE(g_MicroProfileAccumulate, "MicroProfile", "Accumulate", 0x3355ee);
-MICROPROFILE_DEFINE(g_MicroProfileContextSwitchSearch,"MicroProfile", "ContextSwitchSearch", 0xDD7300);
-MICROPROFILE_DEFINE(g_MicroProfileWebServerUpdate,"MicroProfile", "WebServerUpdate", 0xDD7300);
-
-inline std::recursive_mutex& MicroProfileMutex()
+//functions reading the state a dump shows are compiled with S as MP_DUMP_STATE, which the dump writer thread points at its snapshot
+#ifndef MP_THREAD_LOCAL
+static pthread_key_t g_MicroProfileDumpStateKey;
+static pthread_once_t g_MicroProfileDumpStateKeyOnce = PTHREAD_ONCE_INIT;
+static void MicroProfileCreateDumpStateKey()
 {
-	static std::recursive_mutex Mutex;
-	return Mutex;
+	pthread_key_create(&g_MicroProfileDumpStateKey, NULL);
 }
-std::recursive_mutex& MicroProfileGetMutex()
+inline MicroProfile& MicroProfileDumpState()
+{
+	pthread_once(&g_MicroProfileDumpStateKeyOnce, MicroProfileCreateDumpStateKey);
+	MicroProfile* pState = (MicroProfile*)pthread_getspecific(g_MicroProfileDumpStateKey);
+	return pState ? *pState : g_MicroProfile;
+}
+inline void MicroProfileSetDumpState(MicroProfile* pState)
+{
+	pthread_once(&g_MicroProfileDumpStateKeyOnce, MicroProfileCreateDumpStateKey);
+	pthread_setspecific(g_MicroProfileDumpStateKey, pState);
+}
+#else
+MP_THREAD_LOCAL MicroProfile* g_MicroProfileDumpState = 0;
+inline MicroProfile& MicroProfileDumpState()
+{
+	return g_MicroProfileDumpState ? *g_MicroProfileDumpState : g_MicroProfile;
+}
+inline void MicroProfileSetDumpState(MicroProfile* pState)
+{
+	g_MicroProfileDumpState = pState;
+}
+#endif
+#define MP_DUMP_STATE MicroProfileDumpState()
+
+#if MICROPROFILE_LABEL_DEFERRED
+//deferred labels are formatted on demand into a per thread buffer
+#ifndef MP_THREAD_LOCAL
+static pthread_key_t g_MicroProfileLabelFormatKey;
+static pthread_once_t g_MicroProfileLabelFormatKeyOnce = PTHREAD_ONCE_INIT;
+static void MicroProfileFreeLabelFormatBuffer(void* pBuffer)
+{
+	delete[] (char*)pBuffer;
+}
+static void MicroProfileCreateLabelFormatKey()
+{
+	pthread_key_create(&g_MicroProfileLabelFormatKey, MicroProfileFreeLabelFormatBuffer);
+}
+inline char* MicroProfileLabelFormatBuffer()
+{
+	pthread_once(&g_MicroProfileLabelFormatKeyOnce, MicroProfileCreateLabelFormatKey);
+	char* pBuffer = (char*)pthread_getspecific(g_MicroProfileLabelFormatKey);
+	if(!pBuffer)
+	{
+		pBuffer = new char[MICROPROFILE_LABEL_MAX_LEN];
+		pthread_setspecific(g_MicroProfileLabelFormatKey, pBuffer);
+	}
+	return pBuffer;
+}
+#else
+MP_THREAD_LOCAL char g_MicroProfileLabelFormatBuffer[MICROPROFILE_LABEL_MAX_LEN];
+inline char* MicroProfileLabelFormatBuffer()
+{
+	return g_MicroProfileLabelFormatBuffer;
+}
+#endif
+#endif
+
+static bool g_bUseLock = false; /// This is used because windows does not support using mutexes under dll init(which is where global initialization is handled)
+
+
+MICROPROFILE_DEFINE(g_MicroProfileFlip, "MicroProfile", "MicroProfileFlip", 0x3355ee);
+MICROPROFILE_DEFINE(g_MicroProfileThreadLoop, "MicroProfile", "ThreadLoop", 0x3355ee);
+MICROPROFILE_DEFINE(g_MicroProfileClear, "MicroProfile", "Clear", 0x3355ee);
+MICROPROFILE_DEFINE(g_MicroProfileAccumulate, "MicroProfile", "Accumulate", 0x3355ee);
+MICROPROFILE_DEFINE(g_MicroProfileContextSwitchSearch,"MicroProfile", "ContextSwitchSearch", 0xDD7300);
+MICROPROFILE_DEFINE(g_MicroProfileWebServerUpdate,"MicroProfile", "WebServerUpdate", 0xDD7300);
+MICROPROFILE_DEFINE(g_MicroProfileDumpSnapshot,"MicroProfile", "DumpSnapshot", 0xDD7300);
+#if MICROPROFILE_FLIGHT_RECORDER
+MICROPROFILE_DEFINE(g_MicroProfileFlightRecorder,"MicroProfile", "FlightRecorder", 0xDD7300);
+#endif
+
+inline std::recursive_mutex& MicroProfileMutex()
+{
+	static std::recursive_mutex Mutex;
+	return Mutex;
+}
+std::recursive_mutex& MicroProfileGetMutex()
 {
 	return MicroProfileMutex();
 }
@@ -1117,6 +2493,8 @@ MICROPROFILE_API MicroProfile* MicroProfileGet()
 
 
 MicroProfileThreadLog* MicroProfileCreateThreadLog(const char* pName);
+void MicroProfileStatsKernelsInit();
+void MicroProfileDumpFileDrain();
 
 
 void MicroProfileInit()
@@ -1138,7 +2516,7 @@ void MicroProfileInit()
 		for(int i = 0; i < MICROPROFILE_MAX_CATEGORIES; ++i)
 		{
 			S.CategoryInfo[i].pName[0] = '\0';
-			S.CategoryInfo[i].nGroupMask = 0;
+			S.CategoryInfo[i].nGroupMask.Reset();
 		}
 		strcpy(&S.CategoryInfo[0].pName[0], "default");
 		S.nCategoryCount = 1;
@@ -1149,11 +2527,11 @@ void MicroProfileInit()
 		S.nGroupCount = 0;
 		S.nAggregateFlipTick = MP_TICK();
 		S.nBars = MP_DRAW_AVERAGE | MP_DRAW_MAX | MP_DRAW_CALL_COUNT;
-		S.nActiveGroup = 0;
+		S.nActiveGroup.Reset();
 		S.nActiveBars = 0;
-		S.nForceGroup = 0;
+		S.nForceGroup.Reset();
 		S.nAllGroupsWanted = 0;
-		S.nActiveGroupWanted = 0;
+		S.nActiveGroupWanted.Reset();
 		S.nAllThreadsWanted = 1;
 		S.nAggregateFlip = 60;
 		S.nTotalTimers = 0;
@@ -1165,6 +2543,13 @@ void MicroProfileInit()
 		S.fReferenceTime = 33.33f;
 		S.fRcpReferenceTime = 1.f / S.fReferenceTime;
 		S.nFreeListHead = -1;
+		S.fOverheadBudget = MICROPROFILE_OVERHEAD_BUDGET;
+		S.nGovernorEventTicks = MicroProfileMax<int64_t>(1, MicroProfileTicksPerSecondCpu() * MICROPROFILE_GOVERNOR_EVENT_NS / 1000000000);
+		S.nOverheadSubtract = MICROPROFILE_OVERHEAD_SUBTRACT;
+		MicroProfileStatsKernelsInit();
+#if MICROPROFILE_CALIBRATE
+		MicroProfileCalibrate();
+#endif
 		int64_t nTick = MP_TICK();
 		for(int i = 0; i < MICROPROFILE_MAX_FRAME_HISTORY; ++i)
 		{
@@ -1183,12 +2568,28 @@ void MicroProfileInit()
 #endif
 
 		S.nGpuFrameTimer = (uint32_t)-1;
+		atexit(MicroProfileDumpFileDrain); //registered after the mutex is constructed, so it runs before the mutex is destroyed
 
 		MicroProfileThreadLog* pGpu = MicroProfileCreateThreadLog("GPU");
 		g_MicroProfileGpuLog = pGpu;
 		MP_ASSERT(S.Pool[0] == pGpu);
 		pGpu->nGpu = 1;
 		pGpu->nThreadId = 0;
+		pGpu->nCapture = 1;
+#if MICROPROFILE_PER_CPU_LOG
+		pGpu->nCpuLog = 0;
+		//cpus beyond the count share buffers, which stays correct as records are reserved atomically
+		S.nNumCpuLogs = MicroProfileClamp<uint32_t>(std::thread::hardware_concurrency(), 1, MICROPROFILE_MAX_CPUS);
+		S.nCpuLogRecords = 1;
+		while(S.nCpuLogRecords < 2 * (uint64_t)MICROPROFILE_PER_CPU_LOG_EVENTS_PER_FLIP)
+			S.nCpuLogRecords <<= 1;
+		for(uint32_t i = 0; i < S.nNumCpuLogs; ++i)
+		{
+			S.CpuLogs[i] = (MicroProfileCpuLog*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileCpuLog));
+			S.CpuLogs[i]->Records = (MicroProfileCpuLogRecord*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileCpuLogRecord) * S.nCpuLogRecords);
+			S.nMemUsage += sizeof(MicroProfileCpuLog) + sizeof(MicroProfileCpuLogRecord) * S.nCpuLogRecords;
+		}
+#endif
 	}
 	if(bUseLock)
 		mutex.unlock();
@@ -1196,9 +2597,12 @@ void MicroProfileInit()
 
 void MicroProfileShutdown()
 {
+	MicroProfileDumpFileDrain(); //before locking, the writer thread takes the lock when it exits
 	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
 	MicroProfileWebServerStop();
 	MicroProfileContextSwitchTraceStop();
+	MicroProfileFlightRecorderStop();
+	MicroProfileCrashDumpStop();
 	MicroProfileGpuShutdown();
 }
 
@@ -1226,14 +2630,61 @@ inline void MicroProfileSetThreadLog(MicroProfileThreadLog* pLog)
 #endif
 
 
+void MicroProfileAllocLogBuffer(MicroProfileThreadLog* pLog)
+{
+	if(!pLog->Log)
+	{
+		uint32_t nSize = MicroProfileLogSizeMax(pLog);
+		pLog->Log = (MicroProfileLogWord*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileLogWord) * nSize);
+		pLog->nLogSize = nSize;
+		S.nMemUsage += sizeof(MicroProfileLogWord) * nSize;
+	}
+}
+
+void MicroProfileAllocLabelBuffer(MicroProfileThreadLog* pLog)
+{
+	if(!pLog->LabelBuffer)
+	{
+		pLog->LabelBuffer = (char*)MICROPROFILE_ALLOC_PAGES(MICROPROFILE_LABEL_BUFFER_SIZE);
+		S.nMemUsage += MICROPROFILE_LABEL_BUFFER_SIZE;
+	}
+}
+
+//label buffers are not allocated here. most threads never log a label, and each buffer holds the labels of the whole frame history
+void MicroProfileAllocThreadBuffers(MicroProfileThreadLog* pLog)
+{
+#if MICROPROFILE_PREALLOCATE_THREAD_BUFFERS && !MICROPROFILE_PER_CPU_LOG //otherwise only flip writes the log, and allocates it when the thread first logs
+	MicroProfileAllocLogBuffer(pLog);
+#else
+	(void)pLog;
+#endif
+}
+
+int MicroProfileThreadWanted(const char* pName)
+{
+	for(uint32_t i = 0; i < S.nNumThreadWanted; ++i)
+	{
+		if(!MP_STRCASECMP(pName, S.ThreadWanted[i]))
+			return (int)i;
+	}
+	return -1;
+}
+
 MicroProfileThreadLog* MicroProfileCreateThreadLog(const char* pName)
 {
 	MicroProfileThreadLog* pLog = 0;
 	uint32_t nLogIndex = 0;
+#if MICROPROFILE_PER_CPU_LOG
+	uint32_t nCpuLogSeq = 0;
+#endif
 	if(S.nFreeListHead != -1)
 	{
 		nLogIndex = S.nFreeListHead;
 		pLog = S.Pool[nLogIndex];
+#if MICROPROFILE_PER_CPU_LOG
+		//records of the previous owner can still be queued. continuing the sequence lets flip skip them
+		nCpuLogSeq = pLog->nCpuLogSeqPut;
+#endif
 		MP_ASSERT(pLog->nPut.load() == 0);
 		MP_ASSERT(pLog->nGet.load() == 0);
 		S.nFreeListHead = S.Pool[S.nFreeListHead]->nFreeListNext;
@@ -1251,11 +2702,17 @@ MicroProfileThreadLog* MicroProfileCreateThreadLog(const char* pName)
 	}
 	memset(pLog, 0, sizeof(*pLog));
 	pLog->nLogIndex = nLogIndex;
+#if MICROPROFILE_PER_CPU_LOG
+	pLog->nCpuLog = 1;
+	pLog->nCpuLogSeqPut = pLog->nCpuLogSeqGet = nCpuLogSeq;
+#endif
 	int len = (int)strlen(pName);
 	int maxlen = sizeof(pLog->ThreadName)-1;
 	len = len < maxlen ? len : maxlen;
 	memcpy(&pLog->ThreadName[0], pName, len);
 	pLog->ThreadName[len] = '\0';
+	S.nThreadActive[nLogIndex] = MicroProfileThreadWanted(pLog->ThreadName) >= 0 ? 1 : 0;
+	pLog->nCapture = S.nAllThreadsWanted || S.nThreadActive[nLogIndex] ? 1 : 0;
 	pLog->nThreadId = MP_GETCURRENTTHREADID();
 	pLog->nFreeListNext = -1;
 	pLog->nActive = 1;
@@ -1271,55 +2728,126 @@ void MicroProfileOnThreadCreate(const char* pThreadName)
 	{
 		MicroProfileThreadLog* pLog = MicroProfileCreateThreadLog(pThreadName ? pThreadName : MicroProfileGetThreadName());
 		MP_ASSERT(pLog);
+		if(pLog->nCapture)
+			MicroProfileAllocThreadBuffers(pLog);
 		MicroProfileSetThreadLog(pLog);
 	}
 }
 
+void MicroProfileFreeThreadLog(MicroProfileThreadLog* pLog)
+{
+	int32_t nLogIndex = -1;
+	for(int i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+	{
+		if(pLog == S.Pool[i])
+		{
+			nLogIndex = i;
+			break;
+		}
+	}
+	MP_ASSERT(nLogIndex < MICROPROFILE_MAX_THREADS && nLogIndex > 0);
+	pLog->nFreeListNext = S.nFreeListHead;
+	pLog->nActive = 0;
+	pLog->nPut.store(0);
+	pLog->nGet.store(0);
+	pLog->nGetCached = 0;
+#if MICROPROFILE_PER_CPU_LOG
+	pLog->nCpuLogSeqGet = pLog->nCpuLogSeqPut; //drops records flip has not moved yet, like the entries in the log
+#endif
+	pLog->nPutGpu.store(0);
+	S.nFreeListHead = nLogIndex;
+	S.nThreadActive[nLogIndex] = 0; //the selection belongs to the thread, not the slot
+	pLog->nLabelPut.store(0);
+	pLog->nLabelGet.store(0);
+	for(int i = 0; i < MICROPROFILE_MAX_FRAME_HISTORY; ++i)
+	{
+		S.Frames[i].nLogStart[nLogIndex] = 0;
+		S.Frames[i].nLabelStart[nLogIndex] = 0;
+#if MICROPROFILE_LOG_COMPACT
+		S.Frames[i].nLogStartTick[nLogIndex] = 0;
+#endif
+	}
+#if MICROPROFILE_LOG_COMPACT
+	pLog->nCompactTick = pLog->nCompactGetTick = 0;
+	pLog->nCompactGet = 0;
+#endif
+	memset(pLog->nGroupStackPos, 0, sizeof(pLog->nGroupStackPos));
+	memset(pLog->nGroupTicks, 0, sizeof(pLog->nGroupTicks));
+	pLog->nRequestId = pLog->nRequestFlip = pLog->nRequestScan = 0;
+#if MICROPROFILE_COUNTER_SHARDED
+	//fold the shards of the exiting thread into the shared value, so the log can be reused
+	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+	{
+		if(pLog->nCounterShardEpoch[i].load() == S.CounterEpoch[i].load())
+			S.Counters[i].fetch_add(pLog->nCounterShard[i].exchange(0));
+		pLog->nCounterShard[i].store(0);
+	}
+#endif
+
+	if(pLog->Log)
+	{
+		MICROPROFILE_FREE_PAGES(pLog->Log, sizeof(MicroProfileLogWord) * pLog->nLogSize);
+		S.nMemUsage -= sizeof(MicroProfileLogWord) * pLog->nLogSize;
+		pLog->Log = 0;
+		pLog->nLogSize = 0;
+	}
+
+	if(pLog->LabelBuffer)
+	{
+		MICROPROFILE_FREE_PAGES(pLog->LabelBuffer, MICROPROFILE_LABEL_BUFFER_SIZE);
+		pLog->LabelBuffer = 0;
+		S.nMemUsage -= MICROPROFILE_LABEL_BUFFER_SIZE;
+	}
+
+	if(pLog->LogGpu)
+	{
+		MICROPROFILE_FREE_PAGES(pLog->LogGpu, sizeof(MicroProfileLogEntry) * MICROPROFILE_GPU_BUFFER_SIZE);
+		pLog->LogGpu = 0;
+		S.nMemUsage -= sizeof(MicroProfileLogEntry) * MICROPROFILE_GPU_BUFFER_SIZE;
+	}
+}
+
 void MicroProfileOnThreadExit()
 {
 	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
 	MicroProfileThreadLog* pLog = MicroProfileGetThreadLog();
 	if(pLog)
 	{
-		int32_t nLogIndex = -1;
-		for(int i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
-		{
-			if(pLog == S.Pool[i])
-			{
-				nLogIndex = i;
-				break;
-			}
-		}
-		MP_ASSERT(nLogIndex < MICROPROFILE_MAX_THREADS && nLogIndex > 0);
-		pLog->nFreeListNext = S.nFreeListHead;
-		pLog->nActive = 0;
-		pLog->nPut.store(0);
-		pLog->nGet.store(0);
-		pLog->nPutGpu.store(0);
-		S.nFreeListHead = nLogIndex;
-		for(int i = 0; i < MICROPROFILE_MAX_FRAME_HISTORY; ++i)
-		{
-			S.Frames[i].nLogStart[nLogIndex] = 0;
-		}
-		memset(pLog->nGroupStackPos, 0, sizeof(pLog->nGroupStackPos));
-		memset(pLog->nGroupTicks, 0, sizeof(pLog->nGroupTicks));
-
-		if(pLog->Log)
-		{
-			delete[] pLog->Log;
-			pLog->Log = 0;
-			S.nMemUsage -= sizeof(MicroProfileLogEntry) * MICROPROFILE_BUFFER_SIZE;
-		}
+		MP_ASSERT(!pLog->nFiber); //switch back to MICROPROFILE_FIBER_THREAD before exiting
+		MicroProfileFreeThreadLog(pLog);
+		MicroProfileSetThreadLog(0);
+	}
+}
 
-		if(pLog->LogGpu)
+uint32_t MicroProfileFiberRegister(const char* pFiberName)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	MicroProfileThreadLog* pLog = MicroProfileCreateThreadLog(pFiberName);
+	if(!pLog)
+	{
+		//timers on the fiber then go to the log of the thread running it
+		static bool bReported = false;
+		if(!bReported)
 		{
-			delete[] pLog->LogGpu;
-			pLog->LogGpu = 0;
-			S.nMemUsage -= sizeof(MicroProfileLogEntry) * MICROPROFILE_GPU_BUFFER_SIZE;
+			bReported = true;
+			MICROPROFILE_PRINTF("MicroProfile: no free log for fiber '%s', all %d are in use. fibers are logged as part of their thread\n", pFiberName, MICROPROFILE_MAX_THREADS);
 		}
-
-		MicroProfileSetThreadLog(0);
+		return MICROPROFILE_FIBER_THREAD;
 	}
+	pLog->nFiber = 1; //before allocating, fibers get smaller logs
+	if(pLog->nCapture)
+		MicroProfileAllocThreadBuffers(pLog);
+	pLog->nFiberHost = (uint32_t)-1;
+	pLog->nThreadId = 0; //fibers migrate between threads, so they don't own context switches
+	return pLog->nLogIndex;
+}
+
+void MicroProfileFiberUnregister(uint32_t nFiber)
+{
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	MP_ASSERT(nFiber < MICROPROFILE_MAX_THREADS && S.Pool[nFiber] && S.Pool[nFiber]->nFiber);
+	MicroProfileFreeThreadLog(S.Pool[nFiber]);
 }
 
 MicroProfileThreadLog* MicroProfileGetOrCreateThreadLog()
@@ -1351,28 +2879,64 @@ struct MicroProfileScopeLock
 	}
 };
 
+//case insensitive, to match MP_STRCASECMP
+uint32_t MicroProfileNameHash(const char* pName, uint32_t nSeed)
+{
+	uint32_t nHash = (2166136261u ^ nSeed) * 16777619u;
+	for(; *pName; ++pName)
+	{
+		char c = *pName;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		nHash = (nHash ^ (uint8_t)c) * 16777619u;
+	}
+	return nHash;
+}
+
+//name lookup tables hold index + 1 and have twice as many slots as entries, so probing always ends.
+//returns the slot holding the match, or the empty slot to insert it in
+template<typename T>
+uint32_t* MicroProfileHashFind(uint32_t* pTable, uint32_t nTableSize, uint32_t nHash, T Match)
+{
+	uint32_t nSlot = nHash % nTableSize;
+	while(pTable[nSlot] && !Match(pTable[nSlot] - 1))
+		nSlot = (nSlot + 1) % nTableSize;
+	return &pTable[nSlot];
+}
+
+uint32_t* MicroProfileFindTimerSlot(uint32_t nGroupIndex, const char* pName)
+{
+	return MicroProfileHashFind(S.TimerHash, 2 * MICROPROFILE_MAX_TIMERS, MicroProfileNameHash(pName, nGroupIndex), [&](uint32_t nTimer)
+	{
+		return S.TimerToGroup[nTimer] == nGroupIndex && !MP_STRCASECMP(pName, S.TimerInfo[nTimer].pName);
+	});
+}
+
+uint32_t* MicroProfileFindGroupSlot(const char* pGroup)
+{
+	return MicroProfileHashFind(S.GroupHash, 2 * MICROPROFILE_MAX_GROUPS, MicroProfileNameHash(pGroup, 0), [&](uint32_t nGroup)
+	{
+		return !MP_STRCASECMP(pGroup, S.GroupInfo[nGroup].pName);
+	});
+}
+
 MicroProfileToken MicroProfileFindToken(const char* pGroup, const char* pName)
 {
 	MicroProfileInit();
 	MicroProfileScopeLock L(MicroProfileMutex());
-	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
-	{
-		if(!MP_STRCASECMP(pName, S.TimerInfo[i].pName) && !MP_STRCASECMP(pGroup, S.GroupInfo[S.TimerToGroup[i]].pName))
-		{
-			return S.TimerInfo[i].nToken;
-		}
-	}
-	return MICROPROFILE_INVALID_TOKEN;
+	uint32_t nGroup = *MicroProfileFindGroupSlot(pGroup);
+	if(!nGroup)
+		return MICROPROFILE_INVALID_TOKEN;
+	uint32_t nTimer = *MicroProfileFindTimerSlot(nGroup - 1, pName);
+	return nTimer ? S.TimerInfo[nTimer - 1].nToken : MICROPROFILE_INVALID_TOKEN;
 }
 
 uint16_t MicroProfileGetGroup(const char* pGroup, MicroProfileTokenType Type)
 {
-	for(uint32_t i = 0; i < S.nGroupCount; ++i)
+	uint32_t* pSlot = MicroProfileFindGroupSlot(pGroup);
+	if(*pSlot)
 	{
-		if(!MP_STRCASECMP(pGroup, S.GroupInfo[i].pName))
-		{
-			return i;
-		}
+		return (uint16_t)(*pSlot - 1);
 	}
 
 	uint16_t nGroupIndex = S.nGroupCount++;
@@ -1391,19 +2955,23 @@ uint16_t MicroProfileGetGroup(const char* pGroup, MicroProfileTokenType Type)
 	S.GroupInfo[nGroupIndex].nMaxTimerNameLen = 0;
 	S.GroupInfo[nGroupIndex].nColor = 0x88888888;
 	S.GroupInfo[nGroupIndex].nCategory = 0;
+	S.GroupInfo[nGroupIndex].nSampleRate = 0;
+	*pSlot = nGroupIndex + 1;
 
-	S.CategoryInfo[0].nGroupMask |= 1ll << nGroupIndex;
-	S.nGroupMask |= 1ll << nGroupIndex;
-	S.nGroupMaskGpu |= uint64_t(Type == MicroProfileTokenTypeGpu) << nGroupIndex;
+	S.CategoryInfo[0].nGroupMask.Set(nGroupIndex);
+	S.nGroupMask.Set(nGroupIndex);
+	if(Type == MicroProfileTokenTypeGpu)
+		S.nGroupMaskGpu.Set(nGroupIndex);
 
 	if ((S.nRunning || S.nForceEnable) && S.nAllGroupsWanted)
-		S.nActiveGroup |= 1ll << nGroupIndex;
+		S.nActiveGroup.Set(nGroupIndex);
 
 	return nGroupIndex;
 }
 
 MicroProfileToken MicroProfileGetToken(const char* pGroup, const char* pName, uint32_t nColor, MicroProfileTokenType Type)
 {
+	static_assert(MICROPROFILE_MAX_TIMERS <= MP_LOG_MAX_TIMERS, "MICROPROFILE_MAX_TIMERS does not fit in the log entry timer index");
 	MicroProfileInit();
 	MicroProfileScopeLock L(MicroProfileMutex());
 	MicroProfileToken ret = MicroProfileFindToken(pGroup, pName);
@@ -1413,8 +2981,7 @@ MicroProfileToken MicroProfileGetToken(const char* pGroup, const char* pName, ui
 		return MICROPROFILE_INVALID_TOKEN;
 	uint16_t nGroupIndex = MicroProfileGetGroup(pGroup, Type);
 	uint16_t nTimerIndex = (uint16_t)(S.nTotalTimers++);
-	uint64_t nGroupMask = 1ll << nGroupIndex;
-	MicroProfileToken nToken = MicroProfileMakeToken(nGroupMask, nTimerIndex);
+	MicroProfileToken nToken = MicroProfileMakeToken(nGroupIndex, nTimerIndex);
 	S.GroupInfo[nGroupIndex].nNumTimers++;
 	S.GroupInfo[nGroupIndex].nMaxTimerNameLen = MicroProfileMax(S.GroupInfo[nGroupIndex].nMaxTimerNameLen, (uint32_t)strlen(pName));
 	MP_ASSERT(S.GroupInfo[nGroupIndex].Type == Type); //dont mix cpu & gpu timers in the same group
@@ -1454,6 +3021,11 @@ MicroProfileToken MicroProfileGetToken(const char* pGroup, const char* pName, ui
 	S.TimerInfo[nTimerIndex].nGroupIndex = nGroupIndex;
 	S.TimerInfo[nTimerIndex].nTimerIndex = nTimerIndex;
 	S.TimerToGroup[nTimerIndex] = nGroupIndex;
+	*MicroProfileFindTimerSlot(nGroupIndex, S.TimerInfo[nTimerIndex].pName) = nTimerIndex + 1;
+	if(S.GroupInfo[nGroupIndex].nSampleRate)
+	{
+		MicroProfileSetSampleRate(nToken, S.GroupInfo[nGroupIndex].nSampleRate);
+	}
 	return nToken;
 }
 
@@ -1463,8 +3035,7 @@ MicroProfileToken MicroProfileGetLabelToken(const char* pGroup, MicroProfileToke
 	MicroProfileScopeLock L(MicroProfileMutex());
 
 	uint16_t nGroupIndex = MicroProfileGetGroup(pGroup, Type);
-	uint64_t nGroupMask = 1ll << nGroupIndex;
-	MicroProfileToken nToken = MicroProfileMakeToken(nGroupMask, 0);
+	MicroProfileToken nToken = MicroProfileMakeToken(nGroupIndex, 0);
 
 	return nToken;
 }
@@ -1551,13 +3122,15 @@ const char* MicroProfileCounterFullName(int nCounter)
 
 int MicroProfileGetCounterTokenByParent(int nParent, const char* pName)
 {
-	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+	uint32_t* pSlot = MicroProfileHashFind(S.CounterHash, 2 * MICROPROFILE_MAX_COUNTERS, MicroProfileNameHash(pName, nParent + 1), [&](uint32_t nCounter)
 	{
-		if(nParent == S.CounterInfo[i].nParent && !MP_STRCASECMP(S.CounterInfo[i].pName, pName))
-		{
-			return i;
-		}
+		return nParent == S.CounterInfo[nCounter].nParent && !MP_STRCASECMP(S.CounterInfo[nCounter].pName, pName);
+	});
+	if(*pSlot)
+	{
+		return *pSlot - 1;
 	}
+	MP_ASSERT(S.nNumCounters < MICROPROFILE_MAX_COUNTERS); //out of counters, increase MICROPROFILE_MAX_COUNTERS
 	MicroProfileToken nResult = S.nNumCounters++;
 	S.CounterInfo[nResult].nParent = nParent;
 	S.CounterInfo[nResult].nSibling = -1;
@@ -1573,6 +3146,7 @@ int MicroProfileGetCounterTokenByParent(int nParent, const char* pName)
 	memcpy(&S.CounterNames[nPos], pName, nLen);
 	S.CounterInfo[nResult].nNameLen = nLen-1;
 	S.CounterInfo[nResult].pName = &S.CounterNames[nPos];
+	*pSlot = (uint32_t)nResult + 1;
 	if(nParent >= 0)
 	{
 		S.CounterInfo[nResult].nSibling = S.CounterInfo[nParent].nFirstChild;
@@ -1610,13 +3184,68 @@ MicroProfileToken MicroProfileGetCounterToken(const char* pName)
 	return nResult;
 }
 
-inline void MicroProfileLogPut(MicroProfileToken nToken_, uint64_t nTick, uint64_t nBegin, MicroProfileThreadLog* pLog)
+//words that can be written before reaching nGet. the cached copy is only reloaded when the log looks full,
+//so the owning thread does not pull in the cache line flip writes every frame
+inline uint32_t MicroProfileLogFree(MicroProfileThreadLog* pLog, uint32_t nPos, uint32_t nWords)
 {
-	MP_ASSERT(pLog != 0); //this assert is hit if MicroProfileOnCreateThread is not called
-	MP_ASSERT(pLog->nActive);
+	uint32_t nSize = MicroProfileLogSize(pLog);
+	uint32_t nFree = (pLog->nGetCached + nSize - nPos - 1) % nSize;
+	if(nFree < nWords)
+	{
+		pLog->nGetCached = pLog->nGet.load(std::memory_order_relaxed);
+		nFree = (pLog->nGetCached + nSize - nPos - 1) % nSize;
+	}
+	return nFree;
+}
+
+#if MICROPROFILE_PER_CPU_LOG
+//queues nCount records in the buffer of the current cpu. two records are used for extended entries and their payload
+inline void MicroProfileCpuLogPut(MicroProfileThreadLog* pLog, uint64_t nType, uint32_t nIndex, uint64_t nValue, uint64_t nPayload, uint32_t nCount)
+{
+	uint32_t nCpu = (uint32_t)MP_GETCURRENTCPU();
+	MicroProfileCpuLog& CpuLog = *S.CpuLogs[nCpu % S.nNumCpuLogs];
+	uint64_t nPos = CpuLog.nPut.load(std::memory_order_relaxed);
+	do
+	{
+		if(nPos + nCount - CpuLog.nGet.load(std::memory_order_acquire) > S.nCpuLogRecords)
+		{
+			S.nOverflow = 100;
+			return;
+		}
+	}while(!CpuLog.nPut.compare_exchange_weak(nPos, nPos + nCount, std::memory_order_relaxed));
+	uint32_t nSeq = pLog->nCpuLogSeqPut;
+	pLog->nCpuLogSeqPut = nSeq + nCount;
+	for(uint32_t i = 0; i < nCount; ++i)
+	{
+		MicroProfileCpuLogRecord& R = CpuLog.Records[(nPos + i) & (S.nCpuLogRecords - 1)];
+		R.nValue = i ? nPayload : nValue;
+		R.nIndex = i ? (uint32_t)MP_LOG_EXTENDED_PAYLOAD : nIndex;
+		R.nSeq = nSeq + i;
+		R.nLogIndex = (uint16_t)pLog->nLogIndex;
+#if MICROPROFILE_LOG_WIDE
+		R.nCpu = (uint16_t)nCpu;
+#endif
+		R.nType = (uint8_t)nType;
+		R.nCommit.store((uint32_t)(nPos + i + 1), std::memory_order_release);
+	}
+}
+#endif
+
+//writes directly to the thread log. nCpu is only stored by wide entries, -1 for the current cpu
+inline void MicroProfileLogPutInternal(MicroProfileToken nToken_, uint64_t nTick, uint64_t nBegin, MicroProfileThreadLog* pLog, uint32_t nCpu)
+{
+	(void)nCpu;
 	uint32_t nPos = pLog->nPut.load(std::memory_order_relaxed);
-	uint32_t nNextPos = (nPos+1) % MICROPROFILE_BUFFER_SIZE;
-	if(nNextPos == pLog->nGet.load(std::memory_order_relaxed))
+#if MICROPROFILE_LOG_COMPACT
+	uint64_t nIndex = nToken_ & 0x1fff;
+	uint64_t nField;
+	uint32_t nWords = MicroProfileLogCompactEncode(pLog->nGpu, pLog->nCompactTick, nBegin, nIndex, nTick, &nField);
+	uint32_t nNextPos = (nPos+nWords) % MicroProfileLogSize(pLog);
+	if(MicroProfileLogFree(pLog, nPos, nWords) < nWords)
+#else
+	uint32_t nNextPos = (nPos+1) % MicroProfileLogSize(pLog);
+	if(MicroProfileLogFree(pLog, nPos, 1) < 1)
+#endif
 	{
 		S.nOverflow = 100;
 	}
@@ -1624,15 +3253,105 @@ inline void MicroProfileLogPut(MicroProfileToken nToken_, uint64_t nTick, uint64
 	{
 		if(!pLog->Log)
 		{
-			pLog->Log = new MicroProfileLogEntry[MICROPROFILE_BUFFER_SIZE];
-			memset(pLog->Log, 0, sizeof(MicroProfileLogEntry) * MICROPROFILE_BUFFER_SIZE);
-			S.nMemUsage += sizeof(MicroProfileLogEntry) * MICROPROFILE_BUFFER_SIZE;
+			MicroProfileAllocLogBuffer(pLog);
 		}
+#if MICROPROFILE_LOG_COMPACT
+		MicroProfileLogCompactWrite(pLog->Log, MicroProfileLogSize(pLog), nPos, nBegin, nIndex, nField, nWords);
+		if(MicroProfileLogCompactIsTick(pLog->nGpu, nBegin, nIndex))
+			pLog->nCompactTick = MP_LOG_TICK_MASK & nTick;
+#else
 		pLog->Log[nPos] = MicroProfileMakeLogIndex(nBegin, nToken_, nTick);
+#if MICROPROFILE_LOG_WIDE
+		pLog->Log[nPos].nCpu = (uint16_t)(nCpu == (uint32_t)-1 ? MP_GETCURRENTCPU() : nCpu);
+#endif
+#endif
 		pLog->nPut.store(nNextPos, std::memory_order_release);
 	}
 }
 
+inline void MicroProfileLogPutMode(MicroProfileToken nToken_, uint64_t nTick, uint64_t nBegin, MicroProfileThreadLog* pLog, uint32_t nAggregateOnly)
+{
+	MP_ASSERT(pLog != 0); //this assert is hit if MicroProfileOnCreateThread is not called
+	MP_ASSERT(pLog->nActive);
+	//leaves are still logged, to close scopes entered before the thread was deselected or the mode changed
+	if(!pLog->nCapture && nBegin != MP_LOG_LEAVE)
+		return;
+#if MICROPROFILE_AGGREGATE_ONLY
+	if(nAggregateOnly && !pLog->nGpu && nBegin != MP_LOG_LEAVE)
+		return;
+#else
+	(void)nAggregateOnly;
+#endif
+#if MICROPROFILE_PER_CPU_LOG
+	if(pLog->nCpuLog)
+	{
+		MicroProfileCpuLogPut(pLog, nBegin, (uint32_t)nToken_, nTick, 0, 1);
+		return;
+	}
+#endif
+	MicroProfileLogPutInternal(nToken_, nTick, nBegin, pLog, (uint32_t)-1);
+}
+
+inline void MicroProfileLogPut(MicroProfileToken nToken_, uint64_t nTick, uint64_t nBegin, MicroProfileThreadLog* pLog)
+{
+#if MICROPROFILE_AGGREGATE_ONLY
+	MicroProfileLogPutMode(nToken_, nTick, nBegin, pLog, S.nAggregateOnly);
+#else
+	MicroProfileLogPutMode(nToken_, nTick, nBegin, pLog, 0);
+#endif
+}
+
+float MicroProfileCalibrate()
+{
+	//time the work of an enter/leave pair (tls lookup, tick, log put) against a scratch log, keeping the fastest batch
+	enum
+	{
+		CALIBRATE_PAIRS = 512,
+		CALIBRATE_BATCHES = 16,
+	};
+	MicroProfileThreadLog* pThreadLog = MicroProfileGetThreadLog();
+	const uint32_t nScratchSize = MP_LOG_ENTRY_MAX_WORDS * 2 * CALIBRATE_PAIRS + 1;
+	MicroProfileThreadLog* pScratch = new MicroProfileThreadLog();
+	pScratch->nActive = 1;
+	pScratch->nCapture = 1;
+	pScratch->Log = new MicroProfileLogWord[nScratchSize];
+	pScratch->nLogSize = nScratchSize;
+	MicroProfileSetThreadLog(pScratch);
+	int64_t nBest = -1;
+	for(uint32_t i = 0; i < CALIBRATE_BATCHES; ++i)
+	{
+		pScratch->nPut.store(0);
+		int64_t nStart = MP_TICK();
+		for(uint32_t j = 0; j < CALIBRATE_PAIRS; ++j)
+		{
+			//aggregate only mode is ignored, so the logging path is timed even when calibrating in that mode
+			MicroProfileLogPutMode(0, MP_TICK(), MP_LOG_ENTER, MicroProfileGetThreadLog(), 0);
+			MicroProfileLogPutMode(0, MP_TICK(), MP_LOG_LEAVE, MicroProfileGetThreadLog(), 0);
+		}
+		int64_t nTicks = MP_TICK() - nStart;
+		if(nBest < 0 || nTicks < nBest)
+			nBest = nTicks;
+	}
+	MicroProfileSetThreadLog(pThreadLog);
+	delete[] pScratch->Log;
+	delete pScratch;
+
+	S.fCalibratedPairTicks = (float)nBest / CALIBRATE_PAIRS;
+	S.nGovernorEventTicks = MicroProfileMax<int64_t>(1, (int64_t)(S.fCalibratedPairTicks * 0.5f + 0.5f));
+	return S.fCalibratedPairTicks * MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
+}
+
+void MicroProfileSetOverheadSubtract(bool bSubtract)
+{
+	S.nOverheadSubtract = bSubtract ? 1 : 0;
+}
+
+void MicroProfileSetAggregateOnly(bool bAggregateOnly)
+{
+	//applied at the next flip
+	S.nAggregateOnlyWanted = bAggregateOnly ? 1 : 0;
+}
+
 inline void MicroProfileLogPutGpu(MicroProfileToken nToken_, uint64_t nTick, uint64_t nBegin, MicroProfileThreadLog* pLog)
 {
 #if MICROPROFILE_GPU_TIMERS_MULTITHREADED
@@ -1647,8 +3366,7 @@ inline void MicroProfileLogPutGpu(MicroProfileToken nToken_, uint64_t nTick, uin
 	{
 		if(!pLog->LogGpu)
 		{
-			pLog->LogGpu = new MicroProfileLogEntry[MICROPROFILE_GPU_BUFFER_SIZE];
-			memset(pLog->LogGpu, 0, sizeof(MicroProfileLogEntry) * MICROPROFILE_GPU_BUFFER_SIZE);
+			pLog->LogGpu = (MicroProfileLogEntry*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileLogEntry) * MICROPROFILE_GPU_BUFFER_SIZE);
 			S.nMemUsage += sizeof(MicroProfileLogEntry) * MICROPROFILE_GPU_BUFFER_SIZE;
 		}
 		pLog->LogGpu[nPos] = MicroProfileMakeLogIndex(nBegin, nToken_, nTick);
@@ -1663,12 +3381,13 @@ inline void MicroProfileLogPutGpu(MicroProfileToken nToken_, uint64_t nTick, uin
 
 uint64_t MicroProfileEnter(MicroProfileToken nToken_)
 {
-	uint64_t nGroupMask = MicroProfileGetGroupMask(nToken_);
-	if(nGroupMask & S.nActiveGroup)
+	uint32_t nGroup = MicroProfileGetGroupIndex(nToken_);
+	if(S.nActiveGroup.Test(nGroup))
 	{
-		if (MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+		MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog();
+		if(pLog && pLog->nCapture)
 		{
-			if (nGroupMask & S.nGroupMaskGpu)
+			if (S.nGroupMaskGpu.Test(nGroup))
 			{
 				uint32_t nTimer = MicroProfileGpuInsertTimer(pLog->pContextGpu);
 				if (nTimer != (uint32_t)-1)
@@ -1680,7 +3399,44 @@ uint64_t MicroProfileEnter(MicroProfileToken nToken_)
 			}
 			else
 			{
+				if(S.nGroupMaskSampled.Test(nGroup))
+				{
+					uint16_t nTimerIndex = MicroProfileGetTimerIndex(nToken_);
+					uint32_t nRate = S.TimerSampleRate[nTimerIndex];
+					uint32_t& nCountdown = pLog->nSampleCountdown[nTimerIndex];
+					if(nRate > 1)
+					{
+						//skipped calls return an invalid tick, so the matching leave is skipped as well
+						if(nRate == MICROPROFILE_SAMPLE_DISABLED)
+							return MICROPROFILE_INVALID_TICK;
+						//the countdown is per thread, so a lowered rate is applied here rather than when it is set
+						nCountdown = MicroProfileMin(nCountdown, nRate);
+						if(nCountdown > 1)
+						{
+							nCountdown--;
+							return MICROPROFILE_INVALID_TICK;
+						}
+						nCountdown = nRate;
+					}
+				}
 				uint64_t nTick = MP_TICK();
+#if MICROPROFILE_AGGREGATE_ONLY
+				if(S.nAggregateOnly)
+				{
+					//scopes deeper than the shadow stack are not counted, their leave falls through to the log
+					uint32_t nPos = pLog->nShadowStackPos;
+					if(nPos < MICROPROFILE_STACK_MAX)
+					{
+						MicroProfileShadowScope& Scope = pLog->ShadowStack[nPos];
+						Scope.nToken = nToken_;
+						Scope.nTickStart = nTick;
+						Scope.nChildTicks = 0;
+						pLog->nShadowStackPos = nPos + 1;
+						pLog->nShadowGroupDepth[nGroup]++;
+					}
+					return nTick;
+				}
+#endif
 				MicroProfileLogPut(nToken_, nTick, MP_LOG_ENTER, pLog);
 				return nTick;
 			}
@@ -1689,65 +3445,203 @@ uint64_t MicroProfileEnter(MicroProfileToken nToken_)
 	return MICROPROFILE_INVALID_TICK;
 }
 
-uint64_t MicroProfileAllocateLabel(const char* pName)
+//labels live in a ring owned by the thread. the label id is the log index and the position in the ring
+uint64_t MicroProfileAllocateLabel(const void* pData, uint32_t nLen, MicroProfileThreadLog* pLog)
 {
-	char* pLabelBuffer = S.LabelBuffer.load(std::memory_order_consume);
-	if(!pLabelBuffer)
+	static_assert(0 == (MICROPROFILE_LABEL_BUFFER_SIZE & (MICROPROFILE_LABEL_BUFFER_SIZE - 1)), "MICROPROFILE_LABEL_BUFFER_SIZE must be a power of two");
+	static_assert(MICROPROFILE_MAX_THREADS <= 256, "label ids keep the log index in 8 bits");
+	if(!pLog->LabelBuffer)
 	{
-		MicroProfileScopeLock L(MicroProfileMutex());
-
-		pLabelBuffer = S.LabelBuffer.load(std::memory_order_consume);
-		if(!pLabelBuffer)
-		{
-			pLabelBuffer = new char[MICROPROFILE_LABEL_BUFFER_SIZE + MICROPROFILE_LABEL_MAX_LEN];
-			memset(pLabelBuffer, 0, MICROPROFILE_LABEL_BUFFER_SIZE + MICROPROFILE_LABEL_MAX_LEN);
-			S.nMemUsage += MICROPROFILE_LABEL_BUFFER_SIZE + MICROPROFILE_LABEL_MAX_LEN;
-
-			S.LabelBuffer.store(pLabelBuffer, std::memory_order_release);
-		}
+		MicroProfileAllocLabelBuffer(pLog);
 	}
 
-	size_t nLen = strlen(pName);
-
 	if(nLen > MICROPROFILE_LABEL_MAX_LEN - 1)
 		nLen = MICROPROFILE_LABEL_MAX_LEN - 1;
 
-	uint64_t nLabel = S.nLabelPut.fetch_add(nLen + 1, std::memory_order_relaxed);
-	char* pLabel = &pLabelBuffer[nLabel % MICROPROFILE_LABEL_BUFFER_SIZE];
-
-	memcpy(pLabel, pName, nLen);
+	uint32_t nPut = pLog->nLabelPut.load(std::memory_order_relaxed);
+	uint32_t nOffset = nPut % MICROPROFILE_LABEL_BUFFER_SIZE;
+	//labels are never split across the end of the ring
+	uint32_t nSkip = nOffset + nLen + 1 > MICROPROFILE_LABEL_BUFFER_SIZE ? MICROPROFILE_LABEL_BUFFER_SIZE - nOffset : 0;
+	if(nPut + nSkip + nLen + 1 - pLog->nLabelGet.load(std::memory_order_acquire) > MICROPROFILE_LABEL_BUFFER_SIZE)
+	{
+		S.nOverflow = 100;
+		return MICROPROFILE_INVALID_LABEL;
+	}
+	nPut += nSkip;
+	char* pLabel = &pLog->LabelBuffer[nPut % MICROPROFILE_LABEL_BUFFER_SIZE];
+	memcpy(pLabel, pData, nLen);
 	pLabel[nLen] = 0;
+	pLog->nLabelPut.store(nPut + nLen + 1, std::memory_order_release);
 
-	return nLabel;
+	return ((uint64_t)pLog->nLogIndex << 32) | nPut;
 }
 
-void MicroProfilePutLabel(MicroProfileToken nToken_, const char* pName)
+#if MICROPROFILE_LABEL_INTERN
+uint32_t MicroProfileLabelInternHash(const char* pName, uint32_t nLen)
 {
-	if (MicroProfileThreadLog* pLog = MicroProfileGetThreadLog())
-	{
-		uint64_t nLabel = MicroProfileAllocateLabel(pName);
-		uint64_t nGroupMask = MicroProfileGetGroupMask(nToken_);
-
-		if (nGroupMask & S.nGroupMaskGpu)
-			MicroProfileLogPutGpu(nToken_, nLabel, MP_LOG_LABEL, pLog);
-		else
-			MicroProfileLogPut(nToken_, nLabel, MP_LOG_LABEL, pLog);
-	}
+	uint32_t nHash = 2166136261u;
+	for(uint32_t i = 0; i < nLen; ++i)
+		nHash = (nHash ^ (uint8_t)pName[i]) * 16777619u;
+	return nHash;
 }
 
-void MicroProfileCounterAdd(MicroProfileToken nToken, int64_t nCount)
+bool MicroProfileLabelInternMatch(uint32_t nId, const char* pName, uint32_t nLen, uint32_t nHash)
 {
-	MP_ASSERT(nToken < S.nNumCounters);
-	S.Counters[nToken].fetch_add(nCount);
+	const char* pString = S.LabelInternStrings[nId].load(std::memory_order_acquire);
+	return S.LabelInternHash[nId] == nHash && 0 == memcmp(pString, pName, nLen) && 0 == pString[nLen];
 }
-void MicroProfileCounterSet(MicroProfileToken nToken, int64_t nCount)
+
+uint32_t MicroProfileLabelInternAdd(const char* pName, uint32_t nLen, uint32_t nHash)
 {
-	MP_ASSERT(nToken < S.nNumCounters);
-	S.Counters[nToken].store(nCount);
+	uint32_t nPut = S.nLabelInternPut.load(std::memory_order_relaxed);
+	do
+	{
+		if(nPut + nLen + 1 > MICROPROFILE_LABEL_INTERN_BUFFER_SIZE)
+			return (uint32_t)-1;
+	}while(!S.nLabelInternPut.compare_exchange_weak(nPut, nPut + nLen + 1));
+
+	uint32_t nId = S.nLabelInternCount.load(std::memory_order_relaxed);
+	do
+	{
+		if(nId >= MICROPROFILE_LABEL_INTERN_MAX)
+			return (uint32_t)-1;
+	}while(!S.nLabelInternCount.compare_exchange_weak(nId, nId + 1));
+
+	char* pString = &S.LabelInternBuffer[nPut];
+	memcpy(pString, pName, nLen);
+	pString[nLen] = 0;
+	S.LabelInternHash[nId] = nHash;
+	S.LabelInternStrings[nId].store(pString, std::memory_order_release);
+	return nId;
 }
-void MicroProfileCounterSetLimit(MicroProfileToken nToken, int64_t nCount)
+
+//interned strings are never freed, so ids stay valid for the lifetime of the process.
+//lookups hit the thread's cache first, then probe the global table without locking.
+uint64_t MicroProfileLabelIntern(const char* pName, uint32_t nLen, MicroProfileThreadLog* pLog)
 {
-	MP_ASSERT(nToken < S.nNumCounters);
+	static_assert(0 == (MICROPROFILE_LABEL_INTERN_MAX & (MICROPROFILE_LABEL_INTERN_MAX - 1)), "MICROPROFILE_LABEL_INTERN_MAX must be a power of two");
+	if(nLen > MICROPROFILE_LABEL_MAX_LEN - 1)
+		nLen = MICROPROFILE_LABEL_MAX_LEN - 1;
+	uint32_t nHash = MicroProfileLabelInternHash(pName, nLen);
+	uint32_t& nCached = pLog->nLabelInternCache[nHash % MICROPROFILE_LABEL_INTERN_CACHE];
+	if(nCached && MicroProfileLabelInternMatch(nCached - 1, pName, nLen, nHash))
+		return MICROPROFILE_LABEL_INTERNED | (nCached - 1);
+
+	//the table has twice as many slots as ids, so probing always ends on a free slot
+	const uint32_t nMask = 2 * MICROPROFILE_LABEL_INTERN_MAX - 1;
+	uint32_t nNewId = (uint32_t)-1;
+	for(uint32_t i = 0; i <= nMask; ++i)
+	{
+		std::atomic<uint32_t>& Slot = S.LabelInternTable[(nHash + i) & nMask];
+		uint32_t nSlot = Slot.load(std::memory_order_acquire);
+		if(!nSlot)
+		{
+			if(nNewId == (uint32_t)-1)
+			{
+				nNewId = MicroProfileLabelInternAdd(pName, nLen, nHash);
+				if(nNewId == (uint32_t)-1)
+					return MICROPROFILE_INVALID_LABEL;
+			}
+			if(Slot.compare_exchange_strong(nSlot, nNewId + 1, std::memory_order_acq_rel))
+			{
+				nCached = nNewId + 1;
+				return MICROPROFILE_LABEL_INTERNED | nNewId;
+			}
+			//another thread claimed the slot first, its id is compared below. if it holds the same string our id is left unreferenced
+		}
+		if(MicroProfileLabelInternMatch(nSlot - 1, pName, nLen, nHash))
+		{
+			nCached = nSlot;
+			return MICROPROFILE_LABEL_INTERNED | (nSlot - 1);
+		}
+	}
+	return MICROPROFILE_INVALID_LABEL;
+}
+#endif
+
+void MicroProfilePutLabel(MicroProfileToken nToken_, const void* pData, uint32_t nSize, bool bIntern)
+{
+	MicroProfileThreadLog* pLog = MicroProfileGetThreadLog();
+	if(pLog && pLog->nCapture)
+	{
+		uint64_t nLabel = MICROPROFILE_INVALID_LABEL;
+#if MICROPROFILE_LABEL_INTERN
+		if(bIntern)
+			nLabel = MicroProfileLabelIntern((const char*)pData, nSize, pLog);
+#else
+		(void)bIntern;
+#endif
+		//strings that can't be interned fall back to the thread's label buffer
+		if(nLabel == MICROPROFILE_INVALID_LABEL)
+			nLabel = MicroProfileAllocateLabel(pData, nSize, pLog);
+		if(nLabel == MICROPROFILE_INVALID_LABEL)
+			return;
+		if (S.nGroupMaskGpu.Test(MicroProfileGetGroupIndex(nToken_)))
+			MicroProfileLogPutGpu(nToken_, nLabel, MP_LOG_LABEL, pLog);
+		else
+			MicroProfileLogPut(nToken_, nLabel, MP_LOG_LABEL, pLog);
+	}
+}
+
+void MicroProfileCounterAdd(MicroProfileToken nToken, int64_t nCount)
+{
+	MP_ASSERT(nToken < S.nNumCounters);
+#if MICROPROFILE_COUNTER_SHARDED
+	//the owning thread is the only writer of its shard, so no atomic read-modify-write is needed
+	if(MicroProfileThreadLog* pLog = MicroProfileGetThreadLog())
+	{
+		uint32_t nEpoch = S.CounterEpoch[nToken].load(std::memory_order_acquire);
+		if(pLog->nCounterShardEpoch[nToken].load(std::memory_order_relaxed) != nEpoch)
+		{
+			pLog->nCounterShard[nToken].store(nCount, std::memory_order_relaxed);
+			pLog->nCounterShardEpoch[nToken].store(nEpoch, std::memory_order_release);
+		}
+		else
+		{
+			pLog->nCounterShard[nToken].store(pLog->nCounterShard[nToken].load(std::memory_order_relaxed) + nCount, std::memory_order_relaxed);
+		}
+		return;
+	}
+#endif
+	S.Counters[nToken].fetch_add(nCount);
+}
+void MicroProfileCounterSet(MicroProfileToken nToken, int64_t nCount)
+{
+	MP_ASSERT(nToken < S.nNumCounters);
+	S.Counters[nToken].store(nCount);
+#if MICROPROFILE_COUNTER_SHARDED
+	S.CounterEpoch[nToken].fetch_add(1, std::memory_order_release);
+#endif
+}
+
+//value of a counter is the last value set plus the shards added to since
+int64_t MicroProfileCounterValue(const MicroProfile& State, uint32_t nIndex)
+{
+#if MICROPROFILE_COUNTER_SHARDED
+	uint32_t nEpoch = State.CounterEpoch[nIndex].load(std::memory_order_acquire);
+	int64_t nValue = State.Counters[nIndex].load();
+	for(uint32_t i = 0; i < State.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = State.Pool[i];
+		if(pLog && pLog->nCounterShardEpoch[nIndex].load(std::memory_order_acquire) == nEpoch)
+			nValue += pLog->nCounterShard[nIndex].load(std::memory_order_relaxed);
+	}
+	return nValue;
+#else
+	return State.Counters[nIndex].load();
+#endif
+}
+#undef S
+#define S MP_DUMP_STATE
+int64_t MicroProfileCounterValue(uint32_t nIndex)
+{
+	return MicroProfileCounterValue(S, nIndex);
+}
+#undef S
+#define S g_MicroProfile
+void MicroProfileCounterSetLimit(MicroProfileToken nToken, int64_t nCount)
+{
+	MP_ASSERT(nToken < S.nNumCounters);
 	S.CounterInfo[nToken].nLimit = nCount;
 }
 
@@ -1759,24 +3653,164 @@ void MicroProfileCounterConfig(const char* pName, uint32_t eFormat, int64_t nLim
 	S.CounterInfo[nToken].nFlags |= (nFlags & ~MICROPROFILE_COUNTER_FLAG_INTERNAL_MASK);
 }
 
-const char* MicroProfileGetLabel(uint64_t nLabel)
+//replays the format string of a deferred label against its packed arguments, one conversion at a time
+void MicroProfileFormatDeferredLabel(const char* pLabel, char* pOut, uint32_t nOutSize)
 {
-	char* pLabelBuffer = S.LabelBuffer.load(std::memory_order_relaxed);
-	uint64_t nLabelPut = S.nLabelPut.load(std::memory_order_relaxed);
-
-	MP_ASSERT(pLabelBuffer && nLabel < nLabelPut);
+	const char* pFormat;
+	memcpy(&pFormat, pLabel + 1, sizeof(pFormat));
+	const char* pArg = pLabel + 1 + sizeof(pFormat);
+	uint32_t nPos = 0;
+	while(*pFormat && nPos + 1 < nOutSize)
+	{
+		if(*pFormat != '%')
+		{
+			pOut[nPos++] = *pFormat++;
+			continue;
+		}
+		if(pFormat[1] == '%')
+		{
+			pOut[nPos++] = '%';
+			pFormat += 2;
+			continue;
+		}
+		const char* pSpec = pFormat++;
+		while(*pFormat && strchr("-+ #0", *pFormat))
+			pFormat++;
+		while((*pFormat >= '0' && *pFormat <= '9') || *pFormat == '.')
+			pFormat++;
+		const char* pSpecEnd = pFormat;
+		//length modifiers are dropped; integers are always packed as 64 bit and floats as double
+		while(*pFormat && strchr("hlLqjzt", *pFormat))
+			pFormat++;
+		char cConversion = *pFormat;
+		if(!cConversion)
+			break;
+		pFormat++;
+
+		char Spec[32];
+		uint32_t nSpecLen = MicroProfileMin<uint32_t>((uint32_t)(pSpecEnd - pSpec), sizeof(Spec) - 4);
+		memcpy(Spec, pSpec, nSpecLen);
+		char nType = *pArg;
+		uint32_t nLeft = nOutSize - nPos;
+		int nWritten = -1;
+		if(nType == MicroProfileLabelArgInt && strchr("diouxXc", cConversion))
+		{
+			int64_t nValue;
+			memcpy(&nValue, pArg + 1, sizeof(nValue));
+			if(cConversion == 'c')
+			{
+				Spec[nSpecLen++] = 'c';
+				Spec[nSpecLen] = 0;
+				nWritten = snprintf(pOut + nPos, nLeft, Spec, (int)nValue);
+			}
+			else
+			{
+				Spec[nSpecLen++] = 'l';
+				Spec[nSpecLen++] = 'l';
+				Spec[nSpecLen++] = cConversion;
+				Spec[nSpecLen] = 0;
+				nWritten = snprintf(pOut + nPos, nLeft, Spec, (long long)nValue);
+			}
+			pArg += 1 + sizeof(nValue);
+		}
+		else if(nType == MicroProfileLabelArgDouble && strchr("fFeEgGaA", cConversion))
+		{
+			double fValue;
+			memcpy(&fValue, pArg + 1, sizeof(fValue));
+			Spec[nSpecLen++] = cConversion;
+			Spec[nSpecLen] = 0;
+			nWritten = snprintf(pOut + nPos, nLeft, Spec, fValue);
+			pArg += 1 + sizeof(fValue);
+		}
+		else if(nType == MicroProfileLabelArgPointer && cConversion == 'p')
+		{
+			const void* pValue;
+			memcpy(&pValue, pArg + 1, sizeof(pValue));
+			Spec[nSpecLen++] = 'p';
+			Spec[nSpecLen] = 0;
+			nWritten = snprintf(pOut + nPos, nLeft, Spec, pValue);
+			pArg += 1 + sizeof(pValue);
+		}
+		else if(nType == MicroProfileLabelArgString && cConversion == 's')
+		{
+			char String[MICROPROFILE_LABEL_DEFERRED_STRING_MAX + 1];
+			uint32_t nStringLen = (uint8_t)pArg[1];
+			memcpy(String, pArg + 2, nStringLen);
+			String[nStringLen] = 0;
+			Spec[nSpecLen++] = 's';
+			Spec[nSpecLen] = 0;
+			nWritten = snprintf(pOut + nPos, nLeft, Spec, String);
+			pArg += 2 + nStringLen;
+		}
+		else
+		{
+			//missing or mismatched argument. stop consuming, since the remaining arguments can no longer be matched
+			nWritten = snprintf(pOut + nPos, nLeft, "?");
+			pArg = "";
+		}
+		if(nWritten > 0)
+			nPos += MicroProfileMin<uint32_t>((uint32_t)nWritten, nLeft - 1);
+	}
+	pOut[nPos] = 0;
+}
 
-	if (nLabelPut - nLabel > MICROPROFILE_LABEL_BUFFER_SIZE)
+//label as stored, deferred labels still hold their format and arguments. does not lock or allocate
+const char* MicroProfileGetLabelRaw(const MicroProfile& State, uint64_t nLabel)
+{
+#if MICROPROFILE_LABEL_INTERN
+	if(nLabel & MICROPROFILE_LABEL_INTERNED)
+	{
+		uint32_t nId = (uint32_t)nLabel;
+		return nId < MICROPROFILE_LABEL_INTERN_MAX ? State.LabelInternStrings[nId].load(std::memory_order_acquire) : 0;
+	}
+#endif
+	uint32_t nLogIndex = (uint32_t)(nLabel >> 32) & 0xff;
+	uint32_t nPos = (uint32_t)nLabel;
+	MicroProfileThreadLog* pLog = nLogIndex < MICROPROFILE_MAX_THREADS ? State.Pool[nLogIndex] : 0;
+	if(!pLog || !pLog->LabelBuffer)
 		return 0;
-	else
-		return &pLabelBuffer[nLabel % MICROPROFILE_LABEL_BUFFER_SIZE];
+	//flip keeps labels of every frame in history alive, so this only fails for labels of exited threads
+	if(pLog->nLabelPut.load(std::memory_order_relaxed) - nPos > MICROPROFILE_LABEL_BUFFER_SIZE)
+		return 0;
+	return &pLog->LabelBuffer[nPos % MICROPROFILE_LABEL_BUFFER_SIZE];
+}
+#undef S
+#define S MP_DUMP_STATE
+const char* MicroProfileGetLabelRaw(uint64_t nLabel)
+{
+	return MicroProfileGetLabelRaw(S, nLabel);
+}
+#undef S
+#define S g_MicroProfile
+
+const char* MicroProfileGetLabel(uint64_t nLabel)
+{
+	const char* pLabel = MicroProfileGetLabelRaw(nLabel);
+#if MICROPROFILE_LABEL_DEFERRED
+	if(pLabel && *pLabel == MICROPROFILE_LABEL_DEFERRED_MARKER)
+	{
+		//formatted on demand, the result is only valid until the next call on this thread
+		char* pFormatted = MicroProfileLabelFormatBuffer();
+		MicroProfileFormatDeferredLabel(pLabel, pFormatted, MICROPROFILE_LABEL_MAX_LEN);
+		return pFormatted;
+	}
+#endif
+	return pLabel;
 }
 
 void MicroProfileLabel(MicroProfileToken nToken_, const char* pName)
 {
-	if(MicroProfileGetGroupMask(nToken_) & S.nActiveGroup)
+	if(S.nActiveGroup.Test(MicroProfileGetGroupIndex(nToken_)))
+	{
+		MicroProfilePutLabel(nToken_, pName, (uint32_t)strlen(pName), true);
+	}
+}
+
+void MicroProfileLabelDeferred(MicroProfileToken nToken_, const void* pData, uint32_t nSize)
+{
+	if(S.nActiveGroup.Test(MicroProfileGetGroupIndex(nToken_)))
 	{
-		MicroProfilePutLabel(nToken_, pName);
+		MicroProfilePutLabel(nToken_, pData, nSize, false);
 	}
 }
 
@@ -1790,14 +3824,14 @@ void MicroProfileLabelFormat(MicroProfileToken nToken_, const char* pName, ...)
 
 void MicroProfileLabelFormatV(MicroProfileToken nToken_, const char* pName, va_list args)
 {
-	if(MicroProfileGetGroupMask(nToken_) & S.nActiveGroup)
+	if(S.nActiveGroup.Test(MicroProfileGetGroupIndex(nToken_)))
 	{
 		char buffer[MICROPROFILE_LABEL_MAX_LEN];
 		vsnprintf(buffer, sizeof(buffer)-1, pName, args);
 
 		buffer[sizeof(buffer)-1] = 0;
 
-		MicroProfilePutLabel(nToken_, buffer);
+		MicroProfilePutLabel(nToken_, buffer, (uint32_t)strlen(buffer), false);
 	}
 }
 
@@ -1817,15 +3851,41 @@ void MicroProfileMetaUpdate(MicroProfileToken nToken, int nCount, MicroProfileTo
 	}
 }
 
-void MicroProfileLeave(MicroProfileToken nToken_, uint64_t nTickStart)
+#if MICROPROFILE_AGGREGATE_ONLY
+inline uint32_t MicroProfileSampleScale(uint32_t nTimer, int64_t nTickEnter);
+
+//pops the shadow stack and adds the scope to the running totals of the thread
+inline void MicroProfileShadowLeave(MicroProfileThreadLog* pLog, MicroProfileToken nToken_, uint64_t nTickStart, uint64_t nTick, uint32_t nCalls)
+{
+	uint32_t nPos = --pLog->nShadowStackPos;
+	int64_t nTicks = (int64_t)(nTick - nTickStart);
+	int64_t nExclusive = nTicks - pLog->ShadowStack[nPos].nChildTicks;
+	if(nPos)
+		pLog->ShadowStack[nPos-1].nChildTicks += nTicks;
+	uint32_t nTimer = MicroProfileGetTimerIndex(nToken_);
+	uint32_t nGroup = MicroProfileGetGroupIndex(nToken_);
+	int64_t nScale = S.nGroupMaskSampled.Test(nGroup) ? MicroProfileSampleScale(nTimer, MP_LOG_TICK_MASK & nTickStart) : 1;
+	//only the owning thread writes the totals, flip reads them after the acquire of nTotalEvents
+	pLog->nTotalTicks[nTimer].store(pLog->nTotalTicks[nTimer].load(std::memory_order_relaxed) + nTicks * nScale, std::memory_order_relaxed);
+	pLog->nTotalExclusive[nTimer].store(pLog->nTotalExclusive[nTimer].load(std::memory_order_relaxed) + nExclusive * nScale, std::memory_order_relaxed);
+	pLog->nTotalCount[nTimer].store(pLog->nTotalCount[nTimer].load(std::memory_order_relaxed) + nCalls * (uint32_t)nScale, std::memory_order_relaxed);
+	if(0 == --pLog->nShadowGroupDepth[nGroup])
+	{
+		pLog->nTotalGroupTicks[nGroup].store(pLog->nTotalGroupTicks[nGroup].load(std::memory_order_relaxed) + nTicks * nScale, std::memory_order_relaxed);
+	}
+	pLog->nTotalEvents.store(pLog->nTotalEvents.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+#endif
+
+//nCalls is 0 when leaving a suspended async scope, whose call is counted when it ends. logged scopes are marked by the suspend entry instead
+inline void MicroProfileLeaveInternal(MicroProfileToken nToken_, uint64_t nTickStart, uint32_t nCalls)
 {
+	(void)nCalls;
 	if(MICROPROFILE_INVALID_TICK != nTickStart)
 	{
 		if (MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
 		{
-			uint64_t nGroupMask = MicroProfileGetGroupMask(nToken_);
-
-			if (nGroupMask & S.nGroupMaskGpu)
+			if (S.nGroupMaskGpu.Test(MicroProfileGetGroupIndex(nToken_)))
 			{
 				uint32_t nTimer = MicroProfileGpuInsertTimer(pLog->pContextGpu);
 				MicroProfileLogPutGpu(nToken_, nTimer, MP_LOG_LEAVE, pLog);
@@ -1834,1542 +3894,4484 @@ void MicroProfileLeave(MicroProfileToken nToken_, uint64_t nTickStart)
 			else
 			{
 				uint64_t nTick = MP_TICK();
+#if MICROPROFILE_AGGREGATE_ONLY
+				uint32_t nPos = pLog->nShadowStackPos;
+				if(nPos && pLog->ShadowStack[nPos-1].nToken == nToken_ && pLog->ShadowStack[nPos-1].nTickStart == nTickStart)
+				{
+					MicroProfileShadowLeave(pLog, nToken_, nTickStart, nTick, nCalls);
+					return;
+				}
+#endif
 				MicroProfileLogPut(nToken_, nTick, MP_LOG_LEAVE, pLog);
 			}
 		}
 	}
 }
 
-void MicroProfileContextSwitchPut(MicroProfileContextSwitch* pContextSwitch)
+void MicroProfileLeave(MicroProfileToken nToken_, uint64_t nTickStart)
 {
-	if(S.nRunning || pContextSwitch->nTicks <= S.nPauseTicks)
-	{
-		uint32_t nPut = S.nContextSwitchPut;
-		S.ContextSwitch[nPut] = *pContextSwitch;
-		S.nContextSwitchPut = (S.nContextSwitchPut+1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE;
-	}
+	MicroProfileLeaveInternal(nToken_, nTickStart, 1);
 }
 
-
-void MicroProfileGetRange(uint32_t nPut, uint32_t nGet, uint32_t nRange[2][2])
+inline void MicroProfileLogPutExtendedInternal(uint32_t nSubType, uint64_t nPayload, uint64_t nTick, MicroProfileThreadLog* pLog)
 {
-	if(nPut > nGet)
+	uint32_t nPos = pLog->nPut.load(std::memory_order_relaxed);
+#if MICROPROFILE_LOG_COMPACT
+	uint64_t nField, nPayloadField;
+	uint32_t nWords = MicroProfileLogCompactEncode(pLog->nGpu, pLog->nCompactTick, MP_LOG_EXTENDED, nSubType, nTick, &nField);
+	uint32_t nPayloadWords = MicroProfileLogCompactEncode(pLog->nGpu, pLog->nCompactTick, MP_LOG_EXTENDED, MP_LOG_EXTENDED_PAYLOAD, nPayload, &nPayloadField);
+	uint32_t nNextPos = (nPos+nWords) % MicroProfileLogSize(pLog);
+	uint32_t nNextPos2 = (nNextPos+nPayloadWords) % MicroProfileLogSize(pLog);
+	if(MicroProfileLogFree(pLog, nPos, nWords + nPayloadWords) < nWords + nPayloadWords)
+#else
+	uint32_t nNextPos = (nPos+1) % MicroProfileLogSize(pLog);
+	uint32_t nNextPos2 = (nPos+2) % MicroProfileLogSize(pLog);
+	if(MicroProfileLogFree(pLog, nPos, 2) < 2)
+#endif
 	{
-		nRange[0][0] = nGet;
-		nRange[0][1] = nPut;
-		nRange[1][0] = nRange[1][1] = 0;
+		S.nOverflow = 100;
 	}
-	else if(nPut != nGet)
+	else
 	{
-		MP_ASSERT(nGet != MICROPROFILE_BUFFER_SIZE);
-		uint32_t nCountEnd = MICROPROFILE_BUFFER_SIZE - nGet;
-		nRange[0][0] = nGet;
-		nRange[0][1] = nGet + nCountEnd;
-		nRange[1][0] = 0;
-		nRange[1][1] = nPut;
+		if(!pLog->Log)
+		{
+			MicroProfileAllocLogBuffer(pLog);
+		}
+		//event and payload are published together, so readers always see both
+#if MICROPROFILE_LOG_COMPACT
+		MicroProfileLogCompactWrite(pLog->Log, MicroProfileLogSize(pLog), nPos, MP_LOG_EXTENDED, nSubType, nField, nWords);
+		MicroProfileLogCompactWrite(pLog->Log, MicroProfileLogSize(pLog), nNextPos, MP_LOG_EXTENDED, MP_LOG_EXTENDED_PAYLOAD, nPayloadField, nPayloadWords);
+		if(MicroProfileLogCompactIsTick(pLog->nGpu, MP_LOG_EXTENDED, nSubType))
+			pLog->nCompactTick = MP_LOG_TICK_MASK & nTick;
+#else
+		pLog->Log[nPos] = MicroProfileMakeLogIndex(MP_LOG_EXTENDED, nSubType, nTick);
+		pLog->Log[nNextPos] = MicroProfileMakeLogIndex(MP_LOG_EXTENDED, MP_LOG_EXTENDED_PAYLOAD, nPayload);
+#endif
+		pLog->nPut.store(nNextPos2, std::memory_order_release);
 	}
 }
 
-void MicroProfileDumpToFile();
-
-void MicroProfileFlipGpu()
+inline void MicroProfileLogPutExtended(uint32_t nSubType, uint64_t nPayload, MicroProfileThreadLog* pLog)
 {
-	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
-
-	for (uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+	MP_ASSERT(pLog != 0);
+	MP_ASSERT(pLog->nActive);
+	if(!pLog->nCapture)
+		return;
+#if MICROPROFILE_AGGREGATE_ONLY
+	if(S.nAggregateOnly && !pLog->nGpu)
+		return;
+#endif
+#if MICROPROFILE_PER_CPU_LOG
+	if(pLog->nCpuLog)
 	{
-		if (S.Pool[i])
+		MicroProfileCpuLogPut(pLog, MP_LOG_EXTENDED, nSubType, MP_TICK(), nPayload, 2);
+		return;
+	}
+#endif
+	MicroProfileLogPutExtendedInternal(nSubType, nPayload, MP_TICK(), pLog);
+}
+
+#if MICROPROFILE_PER_CPU_LOG
+//thread logs are only written by flip in per cpu mode, so they start small and grow to hold the frame history of what is
+//moved into them. growing moves the history to the start of the new buffer and rebases the frame positions. the logs
+//are read without the lock while dumping, which pauses the capture, so they don't grow while paused
+void MicroProfileCpuLogReserve(MicroProfileThreadLog* pLog, uint32_t nWords)
+{
+	uint32_t nSize = pLog->nLogSize;
+	uint32_t nLogIndex = pLog->nLogIndex;
+	uint32_t nPut = pLog->nPut.load(std::memory_order_relaxed);
+	uint32_t nOldest = pLog->Log ? S.Frames[(S.nFramePut + 1) % MICROPROFILE_MAX_FRAME_HISTORY].nLogStart[nLogIndex] : nPut;
+	uint32_t nUsed = pLog->Log ? (nPut + nSize - nOldest) % nSize : 0;
+	uint32_t nSizeMax = MicroProfileLogSizeMax(pLog);
+	if(pLog->Log && (nUsed + nWords < nSize || nSize >= nSizeMax || !S.nRunning))
+		return;
+	uint32_t nNewSize = pLog->Log ? 2 * nSize : (uint32_t)(MICROPROFILE_PER_CPU_LOG_THREAD_BUFFER_MIN / sizeof(MicroProfileLogWord));
+	while(nNewSize <= nUsed + nWords)
+		nNewSize *= 2;
+	nNewSize = MicroProfileMin<uint32_t>(nNewSize, nSizeMax);
+	MicroProfileLogWord* pNew = (MicroProfileLogWord*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileLogWord) * nNewSize);
+	S.nMemUsage += sizeof(MicroProfileLogWord) * nNewSize;
+	if(pLog->Log)
+	{
+		uint32_t nFirst = MicroProfileMin(nUsed, nSize - nOldest);
+		memcpy(pNew, pLog->Log + nOldest, nFirst * sizeof(MicroProfileLogWord));
+		memcpy(pNew + nFirst, pLog->Log, (nUsed - nFirst) * sizeof(MicroProfileLogWord));
+		for(uint32_t i = 0; i < MICROPROFILE_MAX_FRAME_HISTORY; ++i)
 		{
-			MP_ASSERT(!S.Pool[i]->bActiveGpu);
-
-			S.Pool[i]->nPutGpu.store(0);
+			uint32_t& nStart = S.Frames[i].nLogStart[nLogIndex];
+			nStart = (nStart + nSize - nOldest) % nSize;
 		}
+		pLog->nGet.store((pLog->nGet.load(std::memory_order_relaxed) + nSize - nOldest) % nSize);
+		pLog->nGetCached = (pLog->nGetCached + nSize - nOldest) % nSize;
+#if MICROPROFILE_LOG_COMPACT
+		pLog->nCompactGet = (pLog->nCompactGet + nSize - nOldest) % nSize;
+#endif
+		MICROPROFILE_FREE_PAGES(pLog->Log, sizeof(MicroProfileLogWord) * nSize);
+		S.nMemUsage -= sizeof(MicroProfileLogWord) * nSize;
 	}
-
-	S.nGpuFrameTimer = MicroProfileGpuFlip();
+	pLog->Log = pNew;
+	pLog->nLogSize = nNewSize;
+	pLog->nPut.store(nUsed, std::memory_order_release);
 }
 
-void MicroProfileFlipCpu()
+//moves the committed records of the cpu buffers into the thread logs. a thread that moved between cpus has records in
+//several buffers, so each buffer is drained only while its oldest record is the next one of its thread. reservations are
+//ordered in time, so some buffer can always make progress. records behind one that is not committed yet wait for the next flip
+void MicroProfileCpuLogDemux()
 {
-	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
-
-
-	if(S.nToggleRunning)
+	const uint32_t nMask = S.nCpuLogRecords - 1;
+	bool bProgress = true;
+	while(bProgress)
 	{
-		S.nRunning = !S.nRunning;
-		if(!S.nRunning)
-			S.nPauseTicks = MP_TICK();
-		S.nToggleRunning = 0;
-		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+		bProgress = false;
+		for(uint32_t i = 0; i < S.nNumCpuLogs; ++i)
 		{
-			MicroProfileThreadLog* pLog = S.Pool[i];
-			if(pLog)
+			MicroProfileCpuLog& CpuLog = *S.CpuLogs[i];
+			uint64_t nGet = CpuLog.nGet.load(std::memory_order_relaxed);
+			for(;;)
 			{
-				pLog->nStackPos = 0;
+				MicroProfileCpuLogRecord& R = CpuLog.Records[nGet & nMask];
+				if(R.nCommit.load(std::memory_order_acquire) != (uint32_t)(nGet + 1))
+					break;
+				uint32_t nCount = 1;
+				if(R.nType == MP_LOG_EXTENDED && R.nIndex != MP_LOG_EXTENDED_PAYLOAD)
+				{
+					nCount = 2;
+					if(CpuLog.Records[(nGet + 1) & nMask].nCommit.load(std::memory_order_acquire) != (uint32_t)(nGet + 2))
+						break;
+				}
+				MicroProfileThreadLog* pLog = S.Pool[R.nLogIndex];
+				int32_t nOrder = (int32_t)(R.nSeq - pLog->nCpuLogSeqGet);
+				if(nOrder > 0)
+					break;
+				if(nOrder == 0 && pLog->nActive) //earlier records belonged to a thread that exited
+				{
+					MicroProfileCpuLogReserve(pLog, 2 * MP_LOG_ENTRY_MAX_WORDS);
+					if(nCount == 2)
+					{
+						uint64_t nPayload = CpuLog.Records[(nGet + 1) & nMask].nValue;
+						MicroProfileLogPutExtendedInternal(R.nIndex, nPayload, R.nValue, pLog);
+					}
+					else
+					{
+#if MICROPROFILE_LOG_WIDE
+						MicroProfileLogPutInternal(R.nIndex, R.nValue, R.nType, pLog, R.nCpu);
+#else
+						MicroProfileLogPutInternal(R.nIndex, R.nValue, R.nType, pLog, i);
+#endif
+					}
+					pLog->nCpuLogSeqGet += nCount;
+				}
+				nGet += nCount;
+				bProgress = true;
 			}
+			CpuLog.nGet.store(nGet, std::memory_order_release);
 		}
 	}
-	uint32_t nAggregateClear = S.nAggregateClear || S.nAutoClearFrames, nAggregateFlip = 0;
-	if(S.nDumpFileNextFrame)
+}
+#endif
+
+void MicroProfileFlowBegin(uint64_t nFlowId)
+{
+	if(S.nActiveGroup.Any())
 	{
-		MicroProfileDumpToFile();
-		S.nDumpFileNextFrame = 0;
-		S.nAutoClearFrames = MICROPROFILE_GPU_FRAME_DELAY + 3; //hide spike from dumping webpage
+		if(MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+		{
+			MicroProfileLogPutExtended(MP_LOG_EXTENDED_FLOW_BEGIN, nFlowId, pLog);
+		}
 	}
+}
 
-	if(S.nAutoClearFrames)
+void MicroProfileFlowEnd(uint64_t nFlowId)
+{
+	if(S.nActiveGroup.Any())
 	{
-		nAggregateClear = 1;
-		nAggregateFlip = 1;
-		S.nAutoClearFrames -= 1;
+		if(MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+		{
+			MicroProfileLogPutExtended(MP_LOG_EXTENDED_FLOW_END, nFlowId, pLog);
+		}
 	}
+}
 
+void MicroProfileFiberSwitch(uint32_t nFrom, uint32_t nTo)
+{
+	MicroProfileThreadLog* pHost = 0;
+	if(nFrom == MICROPROFILE_FIBER_THREAD)
+	{
+		pHost = MicroProfileGetOrCreateThreadLog();
+	}
+	else
+	{
+		MP_ASSERT(nFrom < MICROPROFILE_MAX_THREADS && S.Pool[nFrom]->nFiber);
+		uint32_t nHost = S.Pool[nFrom]->nFiberHost;
+		pHost = nHost < MICROPROFILE_MAX_THREADS ? S.Pool[nHost] : 0;
+	}
+	if(!pHost)
+		return;
+	MP_ASSERT(!pHost->nFiber);
 
-	if(S.nRunning || S.nForceEnable)
+	MicroProfileThreadLog* pTo = pHost;
+	if(nTo != MICROPROFILE_FIBER_THREAD)
 	{
-		S.nFramePutIndex++;
-		S.nFramePut = (S.nFramePut+1) % MICROPROFILE_MAX_FRAME_HISTORY;
-		MP_ASSERT((S.nFramePutIndex % MICROPROFILE_MAX_FRAME_HISTORY) == S.nFramePut);
-		S.nFrameCurrent = (S.nFramePut + MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 1) % MICROPROFILE_MAX_FRAME_HISTORY;
-		S.nFrameCurrentIndex++;
-		uint32_t nFrameNext = (S.nFrameCurrent+1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		MP_ASSERT(nTo < MICROPROFILE_MAX_THREADS && S.Pool[nTo]->nFiber);
+		pTo = S.Pool[nTo];
+		pTo->nFiberHost = pHost->nLogIndex;
+	}
+	if(S.nActiveGroup.Any())
+	{
+		MicroProfileLogPutExtended(MP_LOG_EXTENDED_FIBER_SWITCH, nTo & MP_LOG_TICK_MASK, pHost);
+	}
+	MicroProfileSetThreadLog(pTo);
+}
 
-		uint32_t nContextSwitchPut = S.nContextSwitchPut;
-		if(S.nContextSwitchLastPut < nContextSwitchPut)
-		{
-			S.nContextSwitchUsage = (nContextSwitchPut - S.nContextSwitchLastPut);
-		}
-		else
+void MicroProfileSetRequest(uint64_t nRequestId)
+{
+	nRequestId &= MP_LOG_TICK_MASK;
+	if(S.nActiveGroup.Any())
+	{
+		MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog();
+		if(pLog && pLog->nRequestId != nRequestId)
 		{
-			S.nContextSwitchUsage = MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE - S.nContextSwitchLastPut + nContextSwitchPut;
+			MicroProfileLogPutExtended(MP_LOG_EXTENDED_REQUEST, nRequestId, pLog);
+			pLog->nRequestId = nRequestId;
 		}
-		S.nContextSwitchLastPut = nContextSwitchPut;
+	}
+}
 
-		MicroProfileFrameState* pFramePut = &S.Frames[S.nFramePut];
-		MicroProfileFrameState* pFrameCurrent = &S.Frames[S.nFrameCurrent];
-		MicroProfileFrameState* pFrameNext = &S.Frames[nFrameNext];
-		
-		pFramePut->nFrameStartCpu = MP_TICK();
-		pFramePut->nFrameStartGpuTimer = S.nGpuFrameTimer;
+uint32_t MicroProfileAsyncId()
+{
+	return S.nAsyncIdNext.fetch_add(1, std::memory_order_relaxed);
+}
 
-		if(pFrameCurrent->nFrameStartGpuTimer != (uint32_t)-1)
-		{
-			uint64_t nTick = MicroProfileGpuGetTimeStamp(pFrameCurrent->nFrameStartGpuTimer);
+//async payload is the timer index in the upper 16 bits and the async id in the lower 32 bits
+uint64_t MicroProfileAsyncEnter(MicroProfileToken nToken, uint32_t nAsyncId, bool bResume)
+{
+	uint64_t nTick = MicroProfileEnter(nToken);
+	if(MICROPROFILE_INVALID_TICK != nTick)
+	{
+		MP_ASSERT(!S.nGroupMaskGpu.Test(MicroProfileGetGroupIndex(nToken)));
+		uint64_t nPayload = ((uint64_t)MicroProfileGetTimerIndex(nToken) << 32) | nAsyncId;
+		MicroProfileLogPutExtended(bResume ? MP_LOG_EXTENDED_ASYNC_RESUME : MP_LOG_EXTENDED_ASYNC_BEGIN, nPayload, MicroProfileGetThreadLog());
+	}
+	return nTick;
+}
 
-			pFrameCurrent->nFrameStartGpu = (nTick == MICROPROFILE_INVALID_TICK) ? 0 : nTick;
-		}
+void MicroProfileAsyncLeave(MicroProfileToken nToken, uint64_t nTickStart, uint32_t nAsyncId, bool bSuspend)
+{
+	if(MICROPROFILE_INVALID_TICK != nTickStart)
+	{
+		uint64_t nPayload = ((uint64_t)MicroProfileGetTimerIndex(nToken) << 32) | nAsyncId;
+		MicroProfileLogPutExtended(bSuspend ? MP_LOG_EXTENDED_ASYNC_SUSPEND : MP_LOG_EXTENDED_ASYNC_END, nPayload, MicroProfileGetOrCreateThreadLog());
+		MicroProfileLeaveInternal(nToken, nTickStart, bSuspend ? 0 : 1);
+	}
+}
 
-		uint64_t nFrameStartCpu = pFrameCurrent->nFrameStartCpu;
-		uint64_t nFrameEndCpu = pFrameNext->nFrameStartCpu;
+void MicroProfileContextSwitchPut(MicroProfileContextSwitch* pContextSwitch)
+{
+	if(S.nRunning || pContextSwitch->nTicks <= S.nPauseTicks)
+	{
+		uint32_t nPut = S.nContextSwitchPut;
+		S.ContextSwitch[nPut] = *pContextSwitch;
+		S.nContextSwitchPut = (S.nContextSwitchPut+1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE;
+	}
+}
+
+
+MicroProfileLogIterator MicroProfileLogIterateFrame(const MicroProfile& State, MicroProfileThreadLog* pLog, uint32_t nFrame, uint32_t nEnd)
+{
+	const MicroProfileFrameState& F = State.Frames[nFrame];
+	uint32_t nLogIndex = pLog->nLogIndex;
+#if MICROPROFILE_LOG_COMPACT
+	return MicroProfileLogIterate(pLog, F.nLogStart[nLogIndex], nEnd, F.nLogStartTick[nLogIndex]);
+#else
+	return MicroProfileLogIterate(pLog, F.nLogStart[nLogIndex], nEnd, 0);
+#endif
+}
+#undef S
+#define S MP_DUMP_STATE
+MicroProfileLogIterator MicroProfileLogIterateFrame(MicroProfileThreadLog* pLog, uint32_t nFrame, uint32_t nEnd)
+{
+	return MicroProfileLogIterateFrame(S, pLog, nFrame, nEnd);
+}
+#undef S
+#define S g_MicroProfile
+
+#if MICROPROFILE_LOG_COMPACT
+//decodes the entries written since the last flip, to find the tick the entry at nPut is relative to
+int64_t MicroProfileLogCompactAdvance(MicroProfileThreadLog* pLog, uint32_t nPut)
+{
+	MicroProfileLogIterator It = MicroProfileLogIterate(pLog, pLog->nCompactGet, nPut, pLog->nCompactGetTick);
+	while(MicroProfileLogNext(It))
+	{
+	}
+	pLog->nCompactGet = nPut;
+	pLog->nCompactGetTick = It.nTick;
+	return It.nTick;
+}
+#endif
+
+void MicroProfileGetRange(uint32_t nPut, uint32_t nGet, uint32_t nRange[2][2])
+{
+	if(nPut > nGet)
+	{
+		nRange[0][0] = nGet;
+		nRange[0][1] = nPut;
+		nRange[1][0] = nRange[1][1] = 0;
+	}
+	else if(nPut != nGet)
+	{
+		MP_ASSERT(nGet != MICROPROFILE_BUFFER_SIZE);
+		uint32_t nCountEnd = MICROPROFILE_BUFFER_SIZE - nGet;
+		nRange[0][0] = nGet;
+		nRange[0][1] = nGet + nCountEnd;
+		nRange[1][0] = 0;
+		nRange[1][1] = nPut;
+	}
+}
+
+bool MicroProfileDumpFileStart();
+#if MICROPROFILE_FLIGHT_RECORDER
+void MicroProfileFlightRecorderFrame(uint32_t nFrame, uint32_t nFrameNext);
+#endif
 
+//walks backwards from the thread that finished last: at each flow end on the current thread the path continues on the thread that began the flow.
+uint32_t MicroProfileFlowCalcCriticalPath(const MicroProfileFlowEvent* pEvents, uint32_t nNumEvents, const int64_t* pThreadEnd, uint32_t nNumThreads, int64_t nTickStart, MicroProfileFlowSegment* pSegments, uint32_t nMaxSegments, int64_t* pTicksActive)
+{
+	uint32_t nLog = (uint32_t)-1;
+	int64_t nTick = nTickStart;
+	for(uint32_t i = 0; i < nNumThreads; ++i)
+	{
+		if(pThreadEnd[i] && MicroProfileLogTickDifference(nTick, pThreadEnd[i]) > 0)
 		{
-			uint64_t nTick = nFrameEndCpu - nFrameStartCpu;
-			S.nFlipTicks = nTick;
-			S.nFlipAggregate += nTick;
-			S.nFlipMax = MicroProfileMax(S.nFlipMax, nTick);
+			nTick = pThreadEnd[i];
+			nLog = i;
 		}
+	}
+	*pTicksActive = 0;
+	if(nLog == (uint32_t)-1 || !nNumEvents)
+		return 0;
 
-		uint8_t* pTimerToGroup = &S.TimerToGroup[0];
-		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+	uint32_t nSegments = 0;
+	while(nSegments < nMaxSegments)
+	{
+		int nEnd = -1;
+		for(uint32_t i = 0; i < nNumEvents; ++i)
 		{
-			MicroProfileThreadLog* pLog = S.Pool[i];
-			if(!pLog)
-			{
-				pFramePut->nLogStart[i] = 0;
-			}
-			else
+			const MicroProfileFlowEvent& E = pEvents[i];
+			if(!E.nBegin && E.nLogIndex == nLog && MicroProfileLogTickDifference(E.nTick, nTick) >= 0 && MicroProfileLogTickDifference(nTickStart, E.nTick) >= 0)
 			{
-				uint32_t nPut = pLog->nPut.load(std::memory_order_acquire);
-				pFramePut->nLogStart[i] = nPut;
-				MP_ASSERT(nPut< MICROPROFILE_BUFFER_SIZE);
-				//need to keep last frame around to close timers. timers more than 1 frame old is ditched.
-				pLog->nGet.store(nPut, std::memory_order_relaxed);
+				if(nEnd < 0 || MicroProfileLogTickDifference(pEvents[nEnd].nTick, E.nTick) > 0)
+					nEnd = i;
 			}
 		}
-
-		if(S.nRunning)
+		int nBegin = -1;
+		if(nEnd >= 0)
 		{
-			uint64_t* pFrameGroup = &S.FrameGroup[0];
+			for(uint32_t i = 0; i < nNumEvents; ++i)
 			{
-				MICROPROFILE_SCOPE(g_MicroProfileClear);
-				for(uint32_t i = 0; i < S.nTotalTimers; ++i)
-				{
-					S.Frame[i].nTicks = 0;
-					S.Frame[i].nCount = 0;
-					S.FrameExclusive[i] = 0;
-				}
-				for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
-				{
-					pFrameGroup[i] = 0;
-				}
-				for(uint32_t j = 0; j < MICROPROFILE_META_MAX; ++j)
+				const MicroProfileFlowEvent& E = pEvents[i];
+				if(E.nBegin && E.nFlowId == pEvents[nEnd].nFlowId && MicroProfileLogTickDifference(E.nTick, pEvents[nEnd].nTick) >= 0)
 				{
-					if(S.MetaCounters[j].pName && 0 != (S.nActiveBars & (MP_DRAW_META_FIRST<<j)))
-					{
-						auto& Meta = S.MetaCounters[j];
-						for(uint32_t i = 0; i < S.nTotalTimers; ++i)
-						{
-							Meta.nCounters[i] = 0;
-						}
-					}
+					if(nBegin < 0 || MicroProfileLogTickDifference(pEvents[nBegin].nTick, E.nTick) > 0)
+						nBegin = i;
 				}
-
 			}
-			{
-				MICROPROFILE_SCOPE(g_MicroProfileThreadLoop);
-				for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
-				{
-					MicroProfileThreadLog* pLog = S.Pool[i];
-					if(!pLog) 
-						continue;
-
-					uint8_t* pGroupStackPos = &pLog->nGroupStackPos[0];
-					int64_t nGroupTicks[MICROPROFILE_MAX_GROUPS] = {0};
-
-
-					uint32_t nPut = pFrameNext->nLogStart[i];
-					uint32_t nGet = pFrameCurrent->nLogStart[i];
-					uint32_t nRange[2][2] = { {0, 0}, {0, 0}, };
-					MicroProfileGetRange(nPut, nGet, nRange);
-
-
-					//fetch gpu results.
-					if(pLog->nGpu)
-					{
-						uint64_t nLastTick = pFrameCurrent->nFrameStartGpu;
-
-						for(uint32_t j = 0; j < 2; ++j)
-						{
-							uint32_t nStart = nRange[j][0];
-							uint32_t nEnd = nRange[j][1];
-							for(uint32_t k = nStart; k < nEnd; ++k)
-							{
-								MicroProfileLogEntry L = pLog->Log[k];
+		}
+		MicroProfileFlowSegment& Segment = pSegments[nSegments++];
+		Segment.nLogIndex = nLog;
+		Segment.nTickStart = nBegin >= 0 ? pEvents[nEnd].nTick : nTickStart;
+		Segment.nTickEnd = nTick;
+		*pTicksActive += MicroProfileLogTickDifference(Segment.nTickStart, Segment.nTickEnd);
+		if(nBegin < 0)
+			break;
+		nLog = pEvents[nBegin].nLogIndex;
+		nTick = pEvents[nBegin].nTick;
+	}
+	return nSegments;
+}
 
-								int Type = MicroProfileLogType(L);
+uint32_t MicroProfileFlowCriticalPath(MicroProfileFlowSegment* pSegments, uint32_t nMaxSegments, int64_t* pTicksActive)
+{
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	uint32_t nSegments = MicroProfileMin(nMaxSegments, S.nFlowCriticalPathSegments);
+	memcpy(pSegments, &S.FlowCriticalPath[0], nSegments * sizeof(MicroProfileFlowSegment));
+	if(pTicksActive)
+		*pTicksActive = S.nFlowCriticalPathTicks;
+	return nSegments;
+}
 
-								if(Type == MP_LOG_ENTER || Type == MP_LOG_LEAVE)
-								{
-									uint32_t nTimer = MicroProfileLogGetTick(L);
-									uint64_t nTick = MicroProfileGpuGetTimeStamp(nTimer);
+MicroProfileRequest* MicroProfileRequestFind(uint64_t nRequestId)
+{
+	if(!S.pRequests)
+	{
+		S.pRequests = new MicroProfileRequestState;
+		memset(S.pRequests, 0, sizeof(*S.pRequests));
+		S.nMemUsage += sizeof(*S.pRequests);
+	}
+	MicroProfileRequestState* pState = S.pRequests;
+	uint32_t nMask = MICROPROFILE_REQUEST_MAX - 1;
+	static_assert(0 == (MICROPROFILE_REQUEST_MAX & (MICROPROFILE_REQUEST_MAX - 1)), "MICROPROFILE_REQUEST_MAX must be a power of two");
+	uint32_t nIndex = (uint32_t)((nRequestId * 0x9E3779B97F4A7C15ull) >> 32) & nMask;
+	for(uint32_t i = 0; i < MICROPROFILE_REQUEST_MAX; ++i, nIndex = (nIndex + 1) & nMask)
+	{
+		MicroProfileRequest& R = pState->Requests[nIndex];
+		if(R.nRequestId == nRequestId)
+			return &R;
+		if(0 == R.nRequestId)
+		{
+			//keep the table at most 3/4 full so probing stays short
+			if(4 * (pState->nNumRequests + 1) > 3 * MICROPROFILE_REQUEST_MAX)
+				break;
+			pState->nNumRequests++;
+			R.nRequestId = nRequestId;
+			R.nTickStart = R.nTickEnd = -1;
+			return &R;
+		}
+	}
+	pState->nDropped++;
+	return 0;
+}
 
-									if(nTick != MICROPROFILE_INVALID_TICK)
-										nLastTick = nTick;
+void MicroProfileRequestAddTicks(MicroProfileRequest* pRequest, int64_t nTickStart, int64_t nTickEnd)
+{
+	if(pRequest->nTickStart == -1 || MicroProfileLogTickDifference(nTickStart, pRequest->nTickStart) > 0)
+		pRequest->nTickStart = nTickStart;
+	if(pRequest->nTickEnd == -1 || MicroProfileLogTickDifference(pRequest->nTickEnd, nTickEnd) > 0)
+		pRequest->nTickEnd = nTickEnd;
+	pRequest->nTicksActive += MicroProfileLogTickDifference(nTickStart, nTickEnd);
+}
 
-									pLog->Log[k] = MicroProfileLogSetTick(L, nLastTick);
-								}
-							}
-						}
-					}
-					
-					
-					uint32_t* pStack = &pLog->nStack[0];
-					int64_t* pChildTickStack = &pLog->nChildTickStack[0];
-					uint32_t nStackPos = pLog->nStackPos;
+void MicroProfileRequestAddTimer(MicroProfileRequest* pRequest, uint32_t nTimer, int64_t nTicks)
+{
+	for(uint32_t i = 0; i < pRequest->nNumTimers; ++i)
+	{
+		if(pRequest->Timers[i].nTimer == nTimer)
+		{
+			pRequest->Timers[i].nTicks += nTicks;
+			return;
+		}
+	}
+	if(pRequest->nNumTimers < MICROPROFILE_REQUEST_TIMERS_MAX)
+	{
+		MicroProfileRequestTimer& T = pRequest->Timers[pRequest->nNumTimers++];
+		T.nTimer = nTimer;
+		T.nTicks = nTicks;
+	}
+}
 
-					for(uint32_t j = 0; j < 2; ++j)
-					{
-						uint32_t nStart = nRange[j][0];
-						uint32_t nEnd = nRange[j][1];
-						for(uint32_t k = nStart; k < nEnd; ++k)
-						{
-							MicroProfileLogEntry LE = pLog->Log[k];
-							uint64_t nType = MicroProfileLogType(LE);
+//slot of the exemplar of nRequestId, -1 when the request is not one of the first nNumExemplars
+uint32_t MicroProfileRequestExemplarFind(MicroProfileRequestState* pState, uint32_t nNumExemplars, uint64_t nRequestId)
+{
+	for(uint32_t i = 0; nRequestId && i < nNumExemplars; ++i)
+	{
+		if(pState->Exemplars[i].Request.nRequestId == nRequestId)
+			return i;
+	}
+	return (uint32_t)-1;
+}
 
-							if(MP_LOG_ENTER == nType)
-							{
-								int nTimer = MicroProfileLogTimerIndex(LE);
-								uint8_t nGroup = pTimerToGroup[nTimer];
-								MP_ASSERT(nStackPos < MICROPROFILE_STACK_MAX);
-								MP_ASSERT(nGroup < MICROPROFILE_MAX_GROUPS);
-								pGroupStackPos[nGroup]++;
-								pStack[nStackPos++] = k;
-								pChildTickStack[nStackPos] = 0;
+//keep the slowest requests of the window and copy their timers out of the thread logs before they are overwritten.
+//exemplars that stay among the slowest keep what was copied before, so only the frames added since the last call are read,
+//plus the frames since the start of requests that just became one of the slowest
+void MicroProfileRequestFlipWindow(uint32_t nFrameEnd, bool bClear)
+{
+	MicroProfileRequestState* pState = S.pRequests;
+	if(!pState)
+		return;
 
-							}
-							else if(MP_LOG_META == nType)
-							{
-								if(nStackPos)
-								{
-									int64_t nMetaIndex = MicroProfileLogTimerIndex(LE);
-									int64_t nMetaCount = MicroProfileLogGetTick(LE);
-									MP_ASSERT(nMetaIndex < MICROPROFILE_META_MAX);
-									int64_t nCounter = MicroProfileLogTimerIndex(pLog->Log[pStack[nStackPos-1]]);
-									S.MetaCounters[nMetaIndex].nCounters[nCounter] += nMetaCount;
-								}
-							}
-							else if(MP_LOG_LEAVE == nType)
-							{
-								int nTimer = MicroProfileLogTimerIndex(LE);
-								uint8_t nGroup = pTimerToGroup[nTimer];
-								MP_ASSERT(nGroup < MICROPROFILE_MAX_GROUPS);
-								if(nStackPos)
-								{									
-									int64_t nTickStart = pLog->Log[pStack[nStackPos-1]];
-									int64_t nTicks = MicroProfileLogTickDifference(nTickStart, LE);
-									int64_t nChildTicks = pChildTickStack[nStackPos];
-									nStackPos--;
-									pChildTickStack[nStackPos] += nTicks;
-
-									uint32_t nTimerIndex = MicroProfileLogTimerIndex(LE);
-									S.Frame[nTimerIndex].nTicks += nTicks;
-									S.FrameExclusive[nTimerIndex] += (nTicks-nChildTicks);
-									S.Frame[nTimerIndex].nCount += 1;
-
-									MP_ASSERT(nGroup < MICROPROFILE_MAX_GROUPS);
-									uint8_t nGroupStackPos = pGroupStackPos[nGroup];
-									if(nGroupStackPos)
-									{
-										nGroupStackPos--;
-										if(0 == nGroupStackPos)
-										{
-											nGroupTicks[nGroup] += nTicks;
-										}
-										pGroupStackPos[nGroup] = nGroupStackPos;
-									}
-								}
-							}
-						}
-					}
-					for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
-					{
-						pLog->nGroupTicks[i] += nGroupTicks[i];
-						pFrameGroup[i] += nGroupTicks[i];
-					}
-					pLog->nStackPos = nStackPos;
-				}
+	MicroProfileRequest* pSlowest[MICROPROFILE_REQUEST_EXEMPLARS];
+	uint32_t nNumSlowest = 0;
+	for(uint32_t i = 0; i < MICROPROFILE_REQUEST_MAX; ++i)
+	{
+		MicroProfileRequest* pRequest = &pState->Requests[i];
+		if(!pRequest->nRequestId || pRequest->nTickStart == -1)
+			continue;
+		int64_t nLatency = MicroProfileLogTickDifference(pRequest->nTickStart, pRequest->nTickEnd);
+		uint32_t nPos = nNumSlowest;
+		while(nPos > 0 && MicroProfileLogTickDifference(pSlowest[nPos-1]->nTickStart, pSlowest[nPos-1]->nTickEnd) < nLatency)
+			nPos--;
+		if(nPos == MICROPROFILE_REQUEST_EXEMPLARS)
+			continue;
+		uint32_t nLast = MicroProfileMin<uint32_t>(nNumSlowest, MICROPROFILE_REQUEST_EXEMPLARS - 1);
+		for(uint32_t j = nLast; j > nPos; --j)
+			pSlowest[j] = pSlowest[j-1];
+		pSlowest[nPos] = pRequest;
+		nNumSlowest = MicroProfileMin<uint32_t>(nNumSlowest + 1, MICROPROFILE_REQUEST_EXEMPLARS);
+	}
+
+	//move the exemplars that are still among the slowest to their new slot, the others start over
+	bool bKept[MICROPROFILE_REQUEST_EXEMPLARS];
+	bool bNew[MICROPROFILE_REQUEST_EXEMPLARS];
+	for(uint32_t i = 0; i < MICROPROFILE_REQUEST_EXEMPLARS; ++i)
+	{
+		bKept[i] = false;
+		for(uint32_t j = 0; j < nNumSlowest && i < pState->nScanExemplars; ++j)
+			bKept[i] = bKept[i] || pState->Exemplars[i].Request.nRequestId == pSlowest[j]->nRequestId;
+	}
+	int64_t nNewTickStart = 0;
+	uint32_t nNumNew = 0;
+	for(uint32_t i = 0; i < nNumSlowest; ++i)
+	{
+		uint32_t j = i;
+		while(j < MICROPROFILE_REQUEST_EXEMPLARS && !(bKept[j] && pState->Exemplars[j].Request.nRequestId == pSlowest[i]->nRequestId))
+			j++;
+		if(j == MICROPROFILE_REQUEST_EXEMPLARS)
+		{
+			j = i;
+			while(bKept[j])
+				j++;
+			MP_ASSERT(j < MICROPROFILE_REQUEST_EXEMPLARS);
+			pState->Exemplars[j].nNumEntries = 0;
+			if(!nNumNew++ || MicroProfileLogTickDifference(pSlowest[i]->nTickStart, nNewTickStart) > 0)
+				nNewTickStart = pSlowest[i]->nTickStart;
+		}
+		if(j != i)
+		{
+			std::swap(pState->Exemplars[i], pState->Exemplars[j]);
+			std::swap(bKept[i], bKept[j]);
+		}
+		bNew[i] = !bKept[i];
+		bKept[i] = false;
+		pState->Exemplars[i].Request = *pSlowest[i];
+	}
+	pState->nNumExemplars = nNumSlowest;
+	pState->nExemplarRequests = pState->nNumRequests;
+	pState->nExemplarDropped = pState->nDropped;
+
+	//only frames still in the history can be extracted. the frames before the new ones are only read for the new exemplars,
+	//as far back as the earliest of them started
+	uint32_t nMaxFrames = MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 2;
+	bool bTruncated = pState->nScanFrames > nMaxFrames;
+	uint32_t nNumFrames = bTruncated ? nMaxFrames : pState->nScanFrames;
+	uint32_t nFrameStart = (nFrameEnd + MICROPROFILE_MAX_FRAME_HISTORY - nNumFrames) % MICROPROFILE_MAX_FRAME_HISTORY;
+	uint32_t nMaxRescan = MicroProfileMin(pState->nWindowFrames, nMaxFrames) - nNumFrames;
+	uint32_t nRescanFrames = 0;
+	while(nNumNew && nRescanFrames < nMaxRescan && MicroProfileLogTickDifference(MP_LOG_TICK_MASK & S.Frames[nFrameStart].nFrameStartCpu, nNewTickStart) < 0)
+	{
+		nFrameStart = (nFrameStart + MICROPROFILE_MAX_FRAME_HISTORY - 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		nRescanFrames++;
+	}
+	for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS && nNumSlowest; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		if(!pLog || pLog->nGpu || !pLog->Log)
+			continue;
+		uint64_t nRequest = 0; //requests of the new exemplars are logged within the frames read for them
+		uint32_t nExemplar = (uint32_t)-1; //slot of nRequest, looked up when the request changes
+		uint32_t nFrame = 0;
+		for(uint32_t f = nFrameStart; f != nFrameEnd; f = (f+1) % MICROPROFILE_MAX_FRAME_HISTORY, ++nFrame)
+		{
+			if(nFrame == nRescanFrames && !bTruncated)
+			{
+				nRequest = pLog->nRequestScan;
+				nExemplar = MicroProfileRequestExemplarFind(pState, nNumSlowest, nRequest);
 			}
+			uint32_t nLogEnd = S.Frames[(f+1) % MICROPROFILE_MAX_FRAME_HISTORY].nLogStart[i];
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, f, nLogEnd); MicroProfileLogNext(It);)
 			{
-				MICROPROFILE_SCOPE(g_MicroProfileAccumulate);
-				for(uint32_t i = 0; i < S.nTotalTimers; ++i)
-				{
-					S.AccumTimers[i].nTicks += S.Frame[i].nTicks;				
-					S.AccumTimers[i].nCount += S.Frame[i].nCount;
-					S.AccumMaxTimers[i] = MicroProfileMax(S.AccumMaxTimers[i], S.Frame[i].nTicks);
-					S.AccumMinTimers[i] = MicroProfileMin(S.AccumMinTimers[i], S.Frame[i].nTicks);
-					S.AccumTimersExclusive[i] += S.FrameExclusive[i];				
-					S.AccumMaxTimersExclusive[i] = MicroProfileMax(S.AccumMaxTimersExclusive[i], S.FrameExclusive[i]);
-				}
-
-				for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
+				MicroProfileLogEntry LE = It.LE;
+				uint64_t nType = MicroProfileLogType(LE);
+				if(MP_LOG_EXTENDED == nType && MP_LOG_EXTENDED_REQUEST == MicroProfileLogTimerIndex(LE))
 				{
-					S.AccumGroup[i] += pFrameGroup[i];
-					S.AccumGroupMax[i] = MicroProfileMax(S.AccumGroupMax[i], pFrameGroup[i]);
+					MicroProfileLogGetPayload(It, &nRequest);
+					nExemplar = MicroProfileRequestExemplarFind(pState, nNumSlowest, nRequest);
 				}
-
-				for(uint32_t j = 0; j < MICROPROFILE_META_MAX; ++j)
+				else if(nExemplar != (uint32_t)-1 && (MP_LOG_ENTER == nType || MP_LOG_LEAVE == nType))
 				{
-					if(S.MetaCounters[j].pName && 0 != (S.nActiveBars & (MP_DRAW_META_FIRST<<j)))
+					MicroProfileRequestExemplar& E = pState->Exemplars[nExemplar];
+					if(E.nNumEntries < MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES && (bNew[nExemplar] || nFrame >= nRescanFrames))
 					{
-						auto& Meta = S.MetaCounters[j];
-						uint64_t nSum = 0;;
-						for(uint32_t i = 0; i < S.nTotalTimers; ++i)
-						{
-							uint64_t nCounter = Meta.nCounters[i];
-							Meta.nAccumMax[i] = MicroProfileMax(Meta.nAccumMax[i], nCounter);
-							Meta.nAccum[i] += nCounter;
-							nSum += nCounter;
-						}
-						Meta.nSumAccum += nSum;
-						Meta.nSumAccumMax = MicroProfileMax(Meta.nSumAccumMax, nSum);
+						E.Entries[E.nNumEntries].nLogIndex = i;
+						E.Entries[E.nNumEntries].LE = LE;
+						E.nNumEntries++;
 					}
-				}			
-			}
-			for(uint32_t i = 0; i < MICROPROFILE_MAX_GRAPHS; ++i)
-			{
-				if(S.Graph[i].nToken != MICROPROFILE_INVALID_TOKEN)
-				{
-					MicroProfileToken nToken = S.Graph[i].nToken;
-					S.Graph[i].nHistory[S.nGraphPut] = S.Frame[MicroProfileGetTimerIndex(nToken)].nTicks;
 				}
 			}
-			S.nGraphPut = (S.nGraphPut+1) % MICROPROFILE_GRAPH_HISTORY;
-
 		}
+	}
 
+	pState->nScanFrames = 0;
+	pState->nScanExemplars = nNumSlowest;
+	for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+	{
+		if(S.Pool[i])
+			S.Pool[i]->nRequestScan = S.Pool[i]->nRequestFlip;
+	}
+	if(bClear)
+	{
+		memset(&pState->Requests[0], 0, sizeof(pState->Requests));
+		pState->nNumRequests = 0;
+		pState->nDropped = 0;
+		pState->nWindowFrames = 0;
+		pState->nScanExemplars = 0;
+	}
+}
 
-		if(S.nRunning && S.nAggregateFlip <= ++S.nAggregateFlipCount)
+void MicroProfileUpdateSampleRates()
+{
+	MicroProfileGroupMask nGroupMaskSampled;
+	nGroupMaskSampled.Reset();
+	int64_t nTick = MP_TICK();
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		uint32_t nRate = MicroProfileMax(S.TimerSampleRateUser[i], S.TimerSampleRateGovernor[i]);
+		if(nRate != S.TimerSampleRate[i])
 		{
-			nAggregateFlip = 1;
-			if(S.nAggregateFlip) // if 0 accumulate indefinitely
-			{
-				nAggregateClear = 1;
-			}
+			//flip runs a few frames behind, so keep the old rate for the scopes already in the log
+			S.TimerSampleRatePrev[i] = S.TimerSampleRate[i];
+			S.TimerSampleRateTick[i] = nTick;
+			S.TimerSampleRate[i] = nRate;
 		}
+		if(S.TimerSampleRate[i])
+			nGroupMaskSampled.Set(S.TimerToGroup[i]);
 	}
-	if(nAggregateFlip)
-	{
-		memcpy(&S.Aggregate[0], &S.AccumTimers[0], sizeof(S.Aggregate[0]) * S.nTotalTimers);
-		memcpy(&S.AggregateMax[0], &S.AccumMaxTimers[0], sizeof(S.AggregateMax[0]) * S.nTotalTimers);
-		memcpy(&S.AggregateMin[0], &S.AccumMinTimers[0], sizeof(S.AggregateMin[0]) * S.nTotalTimers);
-		memcpy(&S.AggregateExclusive[0], &S.AccumTimersExclusive[0], sizeof(S.AggregateExclusive[0]) * S.nTotalTimers);
-		memcpy(&S.AggregateMaxExclusive[0], &S.AccumMaxTimersExclusive[0], sizeof(S.AggregateMaxExclusive[0]) * S.nTotalTimers);
-
-		memcpy(&S.AggregateGroup[0], &S.AccumGroup[0], sizeof(S.AggregateGroup));
-		memcpy(&S.AggregateGroupMax[0], &S.AccumGroupMax[0], sizeof(S.AggregateGroup));		
-
-		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
-		{
-			MicroProfileThreadLog* pLog = S.Pool[i];
-			if(!pLog) 
-				continue;
-			
-			memcpy(&pLog->nAggregateGroupTicks[0], &pLog->nGroupTicks[0], sizeof(pLog->nAggregateGroupTicks));
-			
-			if(nAggregateClear)
-			{
-				memset(&pLog->nGroupTicks[0], 0, sizeof(pLog->nGroupTicks));
-			}
-		}
-
-		for(uint32_t j = 0; j < MICROPROFILE_META_MAX; ++j)
-		{
-			if(S.MetaCounters[j].pName && 0 != (S.nActiveBars & (MP_DRAW_META_FIRST<<j)))
-			{
-				auto& Meta = S.MetaCounters[j];
-				memcpy(&Meta.nAggregateMax[0], &Meta.nAccumMax[0], sizeof(Meta.nAggregateMax[0]) * S.nTotalTimers);
-				memcpy(&Meta.nAggregate[0], &Meta.nAccum[0], sizeof(Meta.nAggregate[0]) * S.nTotalTimers);
-				Meta.nSumAggregate = Meta.nSumAccum;
-				Meta.nSumAggregateMax = Meta.nSumAccumMax;
-				if(nAggregateClear)
-				{
-					memset(&Meta.nAccumMax[0], 0, sizeof(Meta.nAccumMax[0]) * S.nTotalTimers);
-					memset(&Meta.nAccum[0], 0, sizeof(Meta.nAccum[0]) * S.nTotalTimers);
-					Meta.nSumAccum = 0;
-					Meta.nSumAccumMax = 0;
-				}
-			}
-		}
-
+	if(S.nGroupMaskSampled != nGroupMaskSampled)
+		S.nGroupMaskSampled = nGroupMaskSampled;
+}
 
+//factor a recorded scope is scaled by, using the rate that was active when it was entered
+inline uint32_t MicroProfileSampleScale(uint32_t nTimer, int64_t nTickEnter)
+{
+	uint32_t nRate = MicroProfileLogTickDifference(S.TimerSampleRateTick[nTimer], nTickEnter) < 0 ? S.TimerSampleRatePrev[nTimer] : S.TimerSampleRate[nTimer];
+	return nRate == MICROPROFILE_SAMPLE_DISABLED ? 1 : MicroProfileMax(nRate, 1u);
+}
 
+//estimated cost of recording nCalls calls of a timer at its current sample rate
+inline int64_t MicroProfileGovernorCost(uint32_t nTimer, uint64_t nCalls)
+{
+	uint32_t nRate = S.TimerSampleRate[nTimer];
+	if(nRate == MICROPROFILE_SAMPLE_DISABLED)
+		return 0;
+	return 2 * S.nGovernorEventTicks * (int64_t)(nCalls / MicroProfileMax(nRate, 1u));
+}
 
+//frames logged before the last rate change of a timer dont show its effect yet
+inline bool MicroProfileGovernorSettled(uint32_t nTimer, int64_t nFrameStart)
+{
+	return !S.TimerSampleRateTick[nTimer] || MicroProfileLogTickDifference(S.TimerSampleRateTick[nTimer], nFrameStart) >= 0;
+}
 
-		S.nAggregateFrames = S.nAggregateFlipCount;
-		S.nFlipAggregateDisplay = S.nFlipAggregate;
-		S.nFlipMaxDisplay = S.nFlipMax;
-		if(nAggregateClear)
+//throttle the noisiest timers while the estimated instrumentation cost is over budget, and release them again once there is headroom
+void MicroProfileGovernorUpdate(int64_t nFrameStart, int64_t nFrameTicks)
+{
+	if(S.fOverheadBudget <= 0.f || nFrameTicks <= 0)
+	{
+		if(S.nGovernorThrottled)
 		{
-			memset(&S.AccumTimers[0], 0, sizeof(S.Aggregate[0]) * S.nTotalTimers);
-			memset(&S.AccumMaxTimers[0], 0, sizeof(S.AccumMaxTimers[0]) * S.nTotalTimers);
-			memset(&S.AccumMinTimers[0], 0xFF, sizeof(S.AccumMinTimers[0]) * S.nTotalTimers);
-			memset(&S.AccumTimersExclusive[0], 0, sizeof(S.AggregateExclusive[0]) * S.nTotalTimers);
-			memset(&S.AccumMaxTimersExclusive[0], 0, sizeof(S.AccumMaxTimersExclusive[0]) * S.nTotalTimers);
-			memset(&S.AccumGroup[0], 0, sizeof(S.AggregateGroup));
-			memset(&S.AccumGroupMax[0], 0, sizeof(S.AggregateGroup));		
-
-			S.nAggregateFlipCount = 0;
-			S.nFlipAggregate = 0;
-			S.nFlipMax = 0;
-
-			S.nAggregateFlipTick = MP_TICK();
+			memset(&S.TimerSampleRateGovernor[0], 0, sizeof(S.TimerSampleRateGovernor));
+			S.nGovernorThrottled = 0;
+			MicroProfileUpdateSampleRates();
 		}
+		S.fOverhead = 0.f;
+		return;
+	}
+	int64_t nBudget = (int64_t)(S.fOverheadBudget * nFrameTicks);
+	int64_t nCost = 0;
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		nCost += MicroProfileGovernorCost(i, S.FrameCount[i]);
+	}
 
-		#if MICROPROFILE_COUNTER_HISTORY
-		int64_t* pDest = &S.nCounterHistory[S.nCounterHistoryPut][0];
-		S.nCounterHistoryPut = (S.nCounterHistoryPut+1) % MICROPROFILE_GRAPH_HISTORY;
-		for(uint32_t i = 0; i < S.nNumCounters; ++i)
+	for(uint32_t nIter = 0; nCost > nBudget && nIter < 16; ++nIter)
+	{
+		int64_t nMaxCost = 0;
+		uint32_t nNoisiest = (uint32_t)-1;
+		for(uint32_t i = 0; i < S.nTotalTimers; ++i)
 		{
-			if(0 != (S.CounterInfo[i].nFlags & MICROPROFILE_COUNTER_FLAG_DETAILED))
+			int64_t nTimerCost = MicroProfileGovernorCost(i, S.FrameCount[i]);
+			if(nTimerCost > nMaxCost)
 			{
-				uint64_t nValue = S.Counters[i].load(std::memory_order_relaxed);
-				pDest[i] = nValue;
-				S.nCounterMin[i] = MicroProfileMin(S.nCounterMin[i], (int64_t)nValue);
-				S.nCounterMax[i] = MicroProfileMax(S.nCounterMax[i], (int64_t)nValue);
+				nMaxCost = nTimerCost;
+				nNoisiest = i;
 			}
 		}
-		#endif
+		//wait for the last change to show up rather than throttling quieter timers
+		if(nNoisiest == (uint32_t)-1 || !MicroProfileGovernorSettled(nNoisiest, nFrameStart))
+			break;
+		uint32_t nRate = S.TimerSampleRate[nNoisiest];
+		nRate = nRate < 2 ? 4 : nRate * 4;
+		if(nRate > MICROPROFILE_GOVERNOR_MAX_RATE)
+		{
+			nRate = MICROPROFILE_SAMPLE_DISABLED;
+			S.TimerGovernorCalls[nNoisiest] = S.FrameCount[nNoisiest];
+		}
+		S.nGovernorThrottled += S.TimerSampleRateGovernor[nNoisiest] ? 0 : 1;
+		S.TimerSampleRateGovernor[nNoisiest] = nRate;
+		MicroProfileUpdateSampleRates();
+		nCost += MicroProfileGovernorCost(nNoisiest, S.FrameCount[nNoisiest]) - nMaxCost;
+		S.nGovernorCalmFrames = 0;
 	}
-	S.nAggregateClear = 0;
-
-	uint64_t nNewActiveGroup = 0;
-	if (S.nRunning || S.nForceEnable)
-		nNewActiveGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
-	nNewActiveGroup |= S.nForceGroup;
-	nNewActiveGroup |= S.nForceGroupUI;
-	if(S.nActiveGroup != nNewActiveGroup)
-		S.nActiveGroup = nNewActiveGroup;
 
-	uint32_t nNewActiveBars = 0;
-	if (S.nRunning || S.nForceEnable)
-		nNewActiveBars = S.nBars;
-	if(S.nForceMetaCounters)
+	if(2 * nCost >= nBudget)
 	{
-		for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
+		S.nGovernorCalmFrames = 0;
+	}
+	else if(S.nGovernorThrottled && ++S.nGovernorCalmFrames >= MICROPROFILE_GOVERNOR_BACKOFF_FRAMES)
+	{
+		//release throttled timers one step, as long as the projected cost stays below half the budget
+		S.nGovernorCalmFrames = 0;
+		for(uint32_t i = 0; i < S.nTotalTimers; ++i)
 		{
-			if(S.MetaCounters[i].pName)
+			uint32_t nRate = S.TimerSampleRateGovernor[i];
+			if(!nRate || !MicroProfileGovernorSettled(i, nFrameStart))
+				continue;
+			bool bDisabled = nRate == MICROPROFILE_SAMPLE_DISABLED;
+			uint64_t nCalls = bDisabled ? S.TimerGovernorCalls[i] : S.FrameCount[i];
+			uint32_t nNewRate = bDisabled ? MICROPROFILE_GOVERNOR_MAX_RATE : (nRate / 4 < 2 ? 0 : nRate / 4);
+			int64_t nIncrease = 2 * S.nGovernorEventTicks * (int64_t)(nCalls / MicroProfileMax(MicroProfileMax(nNewRate, S.TimerSampleRateUser[i]), 1u)) - MicroProfileGovernorCost(i, nCalls);
+			if(2 * (nCost + nIncrease) < nBudget)
 			{
-				nNewActiveBars |= (MP_DRAW_META_FIRST<<i);
+				nCost += nIncrease;
+				S.TimerSampleRateGovernor[i] = nNewRate;
+				S.nGovernorThrottled -= nNewRate ? 0 : 1;
 			}
 		}
+		MicroProfileUpdateSampleRates();
 	}
-	if(nNewActiveBars != S.nActiveBars)
-		S.nActiveBars = nNewActiveBars;
-}
-
-void MicroProfileFlip()
-{
-	MICROPROFILE_SCOPE(g_MicroProfileFlip);
-
-	MicroProfileFlipGpu();
-	MicroProfileFlipCpu();
+	S.fOverhead = (float)nCost / nFrameTicks;
 }
 
-void MicroProfileGpuSetContext(void* pContext)
+//statistics kernels. pSum += pValue, and pMax and pMin, when given, keep the largest and smallest value seen
+void MicroProfileAccumulateScalar(uint64_t* pSum, uint64_t* pMax, uint64_t* pMin, const uint64_t* pValue, uint32_t nCount)
 {
-	if(MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+	for(uint32_t i = 0; i < nCount; ++i)
 	{
-		pLog->pContextGpu = pContext;
+		uint64_t nValue = pValue[i];
+		pSum[i] += nValue;
+		if(pMax)
+			pMax[i] = MicroProfileMax(pMax[i], nValue);
+		if(pMin)
+			pMin[i] = MicroProfileMin(pMin[i], nValue);
 	}
 }
 
-void MicroProfileGpuBegin(void* pContext)
+//pOut = pTicks * pToMs * fScale, converted through double so large tick counts keep their precision
+void MicroProfileTicksToMsScalar(float* pOut, const uint64_t* pTicks, const float* pToMs, float fScale, uint32_t nCount)
 {
-	if(MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+	for(uint32_t i = 0; i < nCount; ++i)
 	{
-		MP_ASSERT(!pLog->bActiveGpu);
-
-		pLog->pContextGpu = pContext;
-		pLog->nStartGpu = pLog->nPutGpu.load();
-		pLog->bActiveGpu = 1;
+		pOut[i] = (float)((double)pTicks[i] * ((double)pToMs[i] * (double)fScale));
 	}
 }
 
-uint64_t MicroProfileGpuEnd()
-{
-	if(MicroProfileThreadLog* pLog = MicroProfileGetThreadLog())
-	{
-		MP_ASSERT(pLog->bActiveGpu);
-
-		uint32_t nStartGpu = pLog->nStartGpu;
-		uint32_t nPutGpu = pLog->nPutGpu.load();
-		MP_ASSERT(nPutGpu >= nStartGpu);
-
-		pLog->pContextGpu = 0;
-		pLog->nStartGpu = nPutGpu;
-		pLog->bActiveGpu = 0;
-
-		MP_ASSERT(MICROPROFILE_GPU_BUFFER_SIZE <= 1 << 24);
+#if MICROPROFILE_SIMD
+#if defined(__GNUC__) || defined(__clang__)
+#define MP_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define MP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MP_TARGET_SSE42
+#define MP_TARGET_AVX2
+#endif
 
-		return (uint64_t(pLog->nLogIndex) << 48) | (uint64_t(nStartGpu) << 24) | uint64_t(nPutGpu);
-	}
-	return 0;
-}
+//there is no unsigned 64 bit compare before avx512, so both sides get their sign bit flipped and are compared signed.
+//the uint64 to double conversion places the high and low 32 bits in the mantissas of 2^84 and 2^52, and subtracts both.
+#define MP_SIGN64 ((long long)0x8000000000000000ull)
+#define MP_DOUBLE_2P52 0x4330000000000000ll
+#define MP_DOUBLE_2P84 0x4530000000000000ll
+#define MP_DOUBLE_2P84_2P52 19342813118337666422669312.
 
-void MicroProfileGpuSubmit(uint64_t nWork)
+MP_TARGET_SSE42 void MicroProfileAccumulateSse42(uint64_t* pSum, uint64_t* pMax, uint64_t* pMin, const uint64_t* pValue, uint32_t nCount)
 {
-	if (!nWork)
-		return;
-
-	uint32_t nLogIndex = (nWork >> 48) & 0xffff;
-	uint32_t nStart = (nWork >> 24) & 0xffffff;
-	uint32_t nEnd = nWork & 0xffffff;
-
-	MP_ASSERT(nLogIndex < MICROPROFILE_MAX_THREADS);
-	MP_ASSERT(nStart <= nEnd);
-
-	MicroProfileThreadLog* pLog = S.Pool[nLogIndex];
-	if (!pLog)
-		return;
-
-	MP_ASSERT(nEnd <= pLog->nStartGpu);
-
-	for (uint32_t i = nStart; i < nEnd; ++i)
+	const __m128i Sign = _mm_set1_epi64x(MP_SIGN64);
+	uint32_t i = 0;
+	for(; i + 2 <= nCount; i += 2)
 	{
-		MicroProfileLogEntry LE = pLog->LogGpu[i];
-
-		MicroProfileLogPut(MicroProfileLogTimerIndex(LE), MicroProfileLogGetTick(LE), MicroProfileLogType(LE), g_MicroProfileGpuLog);
+		__m128i Value = _mm_loadu_si128((const __m128i*)(pValue + i));
+		__m128i ValueSigned = _mm_xor_si128(Value, Sign);
+		_mm_storeu_si128((__m128i*)(pSum + i), _mm_add_epi64(_mm_loadu_si128((const __m128i*)(pSum + i)), Value));
+		if(pMax)
+		{
+			__m128i Max = _mm_loadu_si128((const __m128i*)(pMax + i));
+			__m128i Greater = _mm_cmpgt_epi64(ValueSigned, _mm_xor_si128(Max, Sign));
+			_mm_storeu_si128((__m128i*)(pMax + i), _mm_blendv_epi8(Max, Value, Greater));
+		}
+		if(pMin)
+		{
+			__m128i Min = _mm_loadu_si128((const __m128i*)(pMin + i));
+			__m128i Less = _mm_cmpgt_epi64(_mm_xor_si128(Min, Sign), ValueSigned);
+			_mm_storeu_si128((__m128i*)(pMin + i), _mm_blendv_epi8(Min, Value, Less));
+		}
 	}
+	MicroProfileAccumulateScalar(pSum + i, pMax ? pMax + i : 0, pMin ? pMin + i : 0, pValue + i, nCount - i);
 }
 
-void MicroProfileSetForceEnable(bool bEnable)
-{
-	S.nForceEnable = bEnable ? 1 : 0;
-}
-bool MicroProfileGetForceEnable()
-{
-	return S.nForceEnable != 0;
-}
-
-void MicroProfileSetEnableAllGroups(bool bEnableAllGroups)
+MP_TARGET_SSE42 void MicroProfileTicksToMsSse42(float* pOut, const uint64_t* pTicks, const float* pToMs, float fScale, uint32_t nCount)
 {
-	S.nAllGroupsWanted = bEnableAllGroups ? 1 : 0;
+	const __m128i Low = _mm_set1_epi64x(MP_DOUBLE_2P52);
+	const __m128i High = _mm_set1_epi64x(MP_DOUBLE_2P84);
+	const __m128d Bias = _mm_set1_pd(MP_DOUBLE_2P84_2P52);
+	const __m128d Scale = _mm_set1_pd(fScale);
+	uint32_t i = 0;
+	for(; i + 2 <= nCount; i += 2)
+	{
+		__m128i Ticks = _mm_loadu_si128((const __m128i*)(pTicks + i));
+		__m128d TicksLow = _mm_castsi128_pd(_mm_blend_epi16(Ticks, Low, 0xcc));
+		__m128d TicksHigh = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(Ticks, 32), High));
+		__m128d Value = _mm_add_pd(_mm_sub_pd(TicksHigh, Bias), TicksLow);
+		__m128d ToMs = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double*)(pToMs + i))));
+		__m128 Ms = _mm_cvtpd_ps(_mm_mul_pd(Value, _mm_mul_pd(ToMs, Scale)));
+		_mm_storel_pd((double*)(pOut + i), _mm_castps_pd(Ms));
+	}
+	MicroProfileTicksToMsScalar(pOut + i, pTicks + i, pToMs + i, fScale, nCount - i);
 }
 
-void MicroProfileEnableCategory(const char* pCategory, bool bEnabled)
+MP_TARGET_AVX2 void MicroProfileAccumulateAvx2(uint64_t* pSum, uint64_t* pMax, uint64_t* pMin, const uint64_t* pValue, uint32_t nCount)
 {
-	int nCategoryIndex = -1;
-	for(uint32_t i = 0; i < S.nCategoryCount; ++i)
-	{
-		if(!MP_STRCASECMP(pCategory, S.CategoryInfo[i].pName))
-		{
-			nCategoryIndex = (int)i;
-			break;
-		}
-	}
-	if(nCategoryIndex >= 0)
+	const __m256i Sign = _mm256_set1_epi64x(MP_SIGN64);
+	uint32_t i = 0;
+	for(; i + 4 <= nCount; i += 4)
 	{
-		if(bEnabled)
+		__m256i Value = _mm256_loadu_si256((const __m256i*)(pValue + i));
+		__m256i ValueSigned = _mm256_xor_si256(Value, Sign);
+		_mm256_storeu_si256((__m256i*)(pSum + i), _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(pSum + i)), Value));
+		if(pMax)
 		{
-			S.nActiveGroupWanted |= S.CategoryInfo[nCategoryIndex].nGroupMask;
+			__m256i Max = _mm256_loadu_si256((const __m256i*)(pMax + i));
+			__m256i Greater = _mm256_cmpgt_epi64(ValueSigned, _mm256_xor_si256(Max, Sign));
+			_mm256_storeu_si256((__m256i*)(pMax + i), _mm256_blendv_epi8(Max, Value, Greater));
 		}
-		else
+		if(pMin)
 		{
-			S.nActiveGroupWanted &= ~S.CategoryInfo[nCategoryIndex].nGroupMask;
+			__m256i Min = _mm256_loadu_si256((const __m256i*)(pMin + i));
+			__m256i Less = _mm256_cmpgt_epi64(_mm256_xor_si256(Min, Sign), ValueSigned);
+			_mm256_storeu_si256((__m256i*)(pMin + i), _mm256_blendv_epi8(Min, Value, Less));
 		}
 	}
+	MicroProfileAccumulateScalar(pSum + i, pMax ? pMax + i : 0, pMin ? pMin + i : 0, pValue + i, nCount - i);
 }
 
-
-void MicroProfileEnableCategory(const char* pCategory)
-{
-	MicroProfileEnableCategory(pCategory, true);
-}
-void MicroProfileDisableCategory(const char* pCategory)
-{
-	MicroProfileEnableCategory(pCategory, false);
-}
-
-bool MicroProfileGetEnableAllGroups()
+MP_TARGET_AVX2 void MicroProfileTicksToMsAvx2(float* pOut, const uint64_t* pTicks, const float* pToMs, float fScale, uint32_t nCount)
 {
-	return 0 != S.nAllGroupsWanted;
+	const __m256i Low = _mm256_set1_epi64x(MP_DOUBLE_2P52);
+	const __m256i High = _mm256_set1_epi64x(MP_DOUBLE_2P84);
+	const __m256d Bias = _mm256_set1_pd(MP_DOUBLE_2P84_2P52);
+	const __m256d Scale = _mm256_set1_pd(fScale);
+	uint32_t i = 0;
+	for(; i + 4 <= nCount; i += 4)
+	{
+		__m256i Ticks = _mm256_loadu_si256((const __m256i*)(pTicks + i));
+		__m256d TicksLow = _mm256_castsi256_pd(_mm256_blend_epi32(Low, Ticks, 0x55));
+		__m256d TicksHigh = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(Ticks, 32), High));
+		__m256d Value = _mm256_add_pd(_mm256_sub_pd(TicksHigh, Bias), TicksLow);
+		__m256d ToMs = _mm256_cvtps_pd(_mm_loadu_ps(pToMs + i));
+		_mm_storeu_ps(pOut + i, _mm256_cvtpd_ps(_mm256_mul_pd(Value, _mm256_mul_pd(ToMs, Scale))));
+	}
+	MicroProfileTicksToMsScalar(pOut + i, pTicks + i, pToMs + i, fScale, nCount - i);
 }
 
-void MicroProfileSetForceMetaCounters(bool bForce)
+//0 for none, 1 for sse4.2, 2 for avx2
+uint32_t MicroProfileSimdLevel()
 {
-	S.nForceMetaCounters = bForce ? 1 : 0;
+#ifdef _MSC_VER
+	int Info[4];
+	__cpuid(Info, 0);
+	int nMaxLeaf = Info[0];
+	__cpuid(Info, 1);
+	bool bSse42 = 0 != (Info[2] & (1 << 20));
+	bool bAvx = 0 != (Info[2] & (1 << 27)) && 0 != (Info[2] & (1 << 28)) && 6 == (_xgetbv(0) & 6); //cpu support and os saving the ymm registers
+	bool bAvx2 = false;
+	if(bAvx && nMaxLeaf >= 7)
+	{
+		__cpuidex(Info, 7, 0);
+		bAvx2 = 0 != (Info[1] & (1 << 5));
+	}
+#else
+	__builtin_cpu_init();
+	bool bSse42 = 0 != __builtin_cpu_supports("sse4.2");
+	bool bAvx2 = 0 != __builtin_cpu_supports("avx2");
+#endif
+	return bAvx2 ? 2 : bSse42 ? 1 : 0;
 }
+#endif
 
-bool MicroProfileGetForceMetaCounters()
+void MicroProfileStatsKernelsInit()
 {
-	return 0 != S.nForceMetaCounters;
+	S.pAccumulate = MicroProfileAccumulateScalar;
+	S.pTicksToMs = MicroProfileTicksToMsScalar;
+#if MICROPROFILE_SIMD
+	switch(MicroProfileSimdLevel())
+	{
+	case 2:
+		S.pAccumulate = MicroProfileAccumulateAvx2;
+		S.pTicksToMs = MicroProfileTicksToMsAvx2;
+		break;
+	case 1:
+		S.pAccumulate = MicroProfileAccumulateSse42;
+		S.pTicksToMs = MicroProfileTicksToMsSse42;
+		break;
+	}
+#endif
 }
 
-void MicroProfileEnableMetaCounter(const char* pMeta)
+#if MICROPROFILE_AGGREGATE_ONLY
+//adds what the thread accumulated since the last flip to the current frame. O(timers), independent of the number of scopes
+void MicroProfileShadowMerge(MicroProfileThreadLog* pLog, int64_t* pGroupTicks)
 {
-	for(uint32_t i = 0; i < MICROPROFILE_META_MAX; ++i)
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
 	{
-		if(S.MetaCounters[i].pName && 0 == MP_STRCASECMP(S.MetaCounters[i].pName, pMeta))
-		{
-			S.nBars |= (MP_DRAW_META_FIRST<<i);
-			return;
-		}
+		int64_t nTicks = pLog->nTotalTicks[i].load(std::memory_order_relaxed);
+		int64_t nExclusive = pLog->nTotalExclusive[i].load(std::memory_order_relaxed);
+		uint32_t nCount = pLog->nTotalCount[i].load(std::memory_order_relaxed);
+		S.FrameTicks[i] += nTicks - pLog->nTotalTicksSeen[i];
+		S.FrameExclusive[i] += nExclusive - pLog->nTotalExclusiveSeen[i];
+		S.FrameCount[i] += nCount - pLog->nTotalCountSeen[i];
+		pLog->nTotalTicksSeen[i] = nTicks;
+		pLog->nTotalExclusiveSeen[i] = nExclusive;
+		pLog->nTotalCountSeen[i] = nCount;
 	}
-}
-void MicroProfileDisableMetaCounter(const char* pMeta)
-{
-	for(uint32_t i = 0; i < MICROPROFILE_META_MAX; ++i)
+	for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
 	{
-		if(S.MetaCounters[i].pName && 0 == MP_STRCASECMP(S.MetaCounters[i].pName, pMeta))
-		{
-			S.nBars &= ~(MP_DRAW_META_FIRST<<i);
-			return;
-		}
+		int64_t nTicks = pLog->nTotalGroupTicks[i].load(std::memory_order_relaxed);
+		pGroupTicks[i] += nTicks - pLog->nTotalGroupTicksSeen[i];
+		pLog->nTotalGroupTicksSeen[i] = nTicks;
 	}
 }
+#endif
 
-
-void MicroProfileSetAggregateFrames(int nFrames)
+void MicroProfileFlipGpu()
 {
-	S.nAggregateFlip = (uint32_t)nFrames;
-	if(0 == nFrames)
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+
+	for (uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
 	{
-		S.nAggregateClear = 1;
+		if (S.Pool[i])
+		{
+			MP_ASSERT(!S.Pool[i]->bActiveGpu);
+
+			S.Pool[i]->nPutGpu.store(0);
+		}
 	}
-}
 
-int MicroProfileGetAggregateFrames()
-{
-	return S.nAggregateFlip;
+	S.nGpuFrameTimer = MicroProfileGpuFlip();
 }
 
-int MicroProfileGetCurrentAggregateFrames()
+void MicroProfileFlipCpu()
 {
-	return int(S.nAggregateFlip ? S.nAggregateFlip : S.nAggregateFlipCount);
-}
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
 
 
-void MicroProfileForceEnableGroup(const char* pGroup, MicroProfileTokenType Type)
-{
-	MicroProfileInit();
-	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	if(S.nToggleRunning)
+	{
+		S.nRunning = !S.nRunning;
+		if(!S.nRunning)
+			S.nPauseTicks = MP_TICK();
+		S.nToggleRunning = 0;
+		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[i];
+			if(pLog)
+			{
+				pLog->nStackPos = 0;
+				pLog->nAsyncSuspend = 0;
+			}
+		}
+	}
+	uint32_t nAggregateClear = S.nAggregateClear || S.nAutoClearFrames, nAggregateFlip = 0;
+#if MICROPROFILE_AGGREGATE_ONLY
+	if(S.nDumpFileNextFrame == 1 && S.nAggregateOnly)
+	{
+		//nothing is logged, record the frames to dump first
+		S.nDumpFileNextFrame = 2 + MICROPROFILE_GPU_FRAME_DELAY + MicroProfileMin(S.nDumpFrames, (uint32_t)MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 2);
+		S.nAggregateOnlyHold = MicroProfileMax(S.nAggregateOnlyHold, S.nDumpFileNextFrame);
+	}
+	if(S.nDumpFileNextFrame > 1)
+	{
+		S.nDumpFileNextFrame--;
+	}
+	else
+#endif
+	if(S.nDumpFileNextFrame && MicroProfileDumpFileStart())
+	{
+		S.nDumpFileNextFrame = 0;
+	}
+
+	if(S.nAutoClearFrames)
+	{
+		nAggregateClear = 1;
+		nAggregateFlip = 1;
+		S.nAutoClearFrames -= 1;
+	}
+
+
+	if(S.nRunning || S.nForceEnable)
+	{
+		S.nFramePutIndex++;
+		S.nFramePut = (S.nFramePut+1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		MP_ASSERT((S.nFramePutIndex % MICROPROFILE_MAX_FRAME_HISTORY) == S.nFramePut);
+		S.nFrameCurrent = (S.nFramePut + MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		S.nFrameCurrentIndex++;
+		uint32_t nFrameNext = (S.nFrameCurrent+1) % MICROPROFILE_MAX_FRAME_HISTORY;
+
+		uint32_t nContextSwitchPut = S.nContextSwitchPut;
+		if(S.nContextSwitchLastPut < nContextSwitchPut)
+		{
+			S.nContextSwitchUsage = (nContextSwitchPut - S.nContextSwitchLastPut);
+		}
+		else
+		{
+			S.nContextSwitchUsage = MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE - S.nContextSwitchLastPut + nContextSwitchPut;
+		}
+		S.nContextSwitchLastPut = nContextSwitchPut;
+
+		MicroProfileFrameState* pFramePut = &S.Frames[S.nFramePut];
+		MicroProfileFrameState* pFrameCurrent = &S.Frames[S.nFrameCurrent];
+		MicroProfileFrameState* pFrameNext = &S.Frames[nFrameNext];
+		
+		pFramePut->nFrameStartCpu = MP_TICK();
+		pFramePut->nFrameStartGpuTimer = S.nGpuFrameTimer;
+
+		if(pFrameCurrent->nFrameStartGpuTimer != (uint32_t)-1)
+		{
+			uint64_t nTick = MicroProfileGpuGetTimeStamp(pFrameCurrent->nFrameStartGpuTimer);
+
+			pFrameCurrent->nFrameStartGpu = (nTick == MICROPROFILE_INVALID_TICK) ? 0 : nTick;
+		}
+
+		uint64_t nFrameStartCpu = pFrameCurrent->nFrameStartCpu;
+		uint64_t nFrameEndCpu = pFrameNext->nFrameStartCpu;
+
+		{
+			uint64_t nTick = nFrameEndCpu - nFrameStartCpu;
+			S.nFlipTicks = nTick;
+			S.nFlipAggregate += nTick;
+			S.nFlipMax = MicroProfileMax(S.nFlipMax, nTick);
+		}
+
+#if MICROPROFILE_PER_CPU_LOG
+		MicroProfileCpuLogDemux();
+#endif
+		uint16_t* pTimerToGroup = &S.TimerToGroup[0];
+		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[i];
+			if(!pLog)
+			{
+				pFramePut->nLogStart[i] = 0;
+			}
+			else
+			{
+				uint32_t nPut = pLog->nPut.load(std::memory_order_acquire);
+				pFramePut->nLogStart[i] = nPut;
+				MP_ASSERT(nPut < MicroProfileLogSize(pLog));
+#if MICROPROFILE_LOG_COMPACT
+				pFramePut->nLogStartTick[i] = MicroProfileLogCompactAdvance(pLog, nPut);
+#endif
+				//need to keep last frame around to close timers. timers more than 1 frame old is ditched.
+				pLog->nGet.store(nPut, std::memory_order_relaxed);
+				//labels are kept for the whole history, released when the oldest frame is about to be reused
+				pFramePut->nLabelStart[i] = pLog->nLabelPut.load(std::memory_order_acquire);
+				pLog->nLabelGet.store(S.Frames[(S.nFramePut + 1) % MICROPROFILE_MAX_FRAME_HISTORY].nLabelStart[i], std::memory_order_release);
+			}
+		}
+
+		if(S.nRunning)
+		{
+			uint64_t* pFrameGroup = &S.FrameGroup[0];
+			{
+				MICROPROFILE_SCOPE(g_MicroProfileClear);
+				memset(&S.FrameTicks[0], 0, sizeof(S.FrameTicks[0]) * S.nTotalTimers);
+				memset(&S.FrameCount[0], 0, sizeof(S.FrameCount[0]) * S.nTotalTimers);
+				memset(&S.FrameExclusive[0], 0, sizeof(S.FrameExclusive[0]) * S.nTotalTimers);
+				for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
+				{
+					pFrameGroup[i] = 0;
+				}
+				for(uint32_t j = 0; j < MICROPROFILE_META_MAX; ++j)
+				{
+					if(S.MetaCounters[j].pName && 0 != (S.nActiveBars & (MP_DRAW_META_FIRST<<j)))
+					{
+						auto& Meta = S.MetaCounters[j];
+						memset(&Meta.nCounters[0], 0, sizeof(Meta.nCounters[0]) * S.nTotalTimers);
+					}
+				}
+
+			}
+			{
+				MICROPROFILE_SCOPE(g_MicroProfileThreadLoop);
+				int64_t nThreadEnd[MICROPROFILE_MAX_THREADS] = {0};
+				S.nNumFlowEvents = 0;
+				for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+				{
+					MicroProfileThreadLog* pLog = S.Pool[i];
+					if(!pLog) 
+						continue;
+
+					uint8_t* pGroupStackPos = &pLog->nGroupStackPos[0];
+					int64_t nGroupTicks[MICROPROFILE_MAX_GROUPS] = {0};
+
+
+					uint32_t nPut = pFrameNext->nLogStart[i];
+
+
+					//fetch gpu results.
+					if(pLog->nGpu)
+					{
+						uint64_t nLastTick = pFrameCurrent->nFrameStartGpu;
+
+						for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, S.nFrameCurrent, nPut); MicroProfileLogNext(It);)
+						{
+							MicroProfileLogEntry L = It.LE;
+
+							int Type = MicroProfileLogType(L);
+
+							if(Type == MP_LOG_ENTER || Type == MP_LOG_LEAVE)
+							{
+								uint32_t nTimer = MicroProfileLogGetTick(L);
+								uint64_t nTick = MicroProfileGpuGetTimeStamp(nTimer);
+
+								if(nTick != MICROPROFILE_INVALID_TICK)
+									nLastTick = nTick;
+
+								MicroProfileLogPatchTick(pLog, It.nPos, nLastTick);
+							}
+						}
+					}
+					
+					
+					MicroProfileLogEntry* pStack = &pLog->Stack[0];
+					int64_t* pChildTickStack = &pLog->nChildTickStack[0];
+					uint32_t* pChildCountStack = &pLog->nChildCountStack[0];
+					uint32_t* pDescendantCountStack = &pLog->nDescendantCountStack[0];
+					uint32_t nStackPos = pLog->nStackPos;
+					uint32_t nAsyncSuspend = pLog->nAsyncSuspend;
+					float fPairTicks = S.nOverheadSubtract && !pLog->nGpu ? S.fCalibratedPairTicks : 0.f;
+					MicroProfileRequest* pRequest = pLog->nRequestFlip ? MicroProfileRequestFind(pLog->nRequestFlip) : 0;
+
+					for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, S.nFrameCurrent, nPut); MicroProfileLogNext(It);)
+					{
+						MicroProfileLogEntry LE = It.LE;
+						uint64_t nType = MicroProfileLogType(LE);
+
+						if(MP_LOG_ENTER == nType)
+						{
+							int nTimer = MicroProfileLogTimerIndex(LE);
+							uint16_t nGroup = pTimerToGroup[nTimer];
+							MP_ASSERT(nStackPos < MICROPROFILE_STACK_MAX);
+							MP_ASSERT(nGroup < MICROPROFILE_MAX_GROUPS);
+							pGroupStackPos[nGroup]++;
+							pStack[nStackPos++] = LE;
+							pChildTickStack[nStackPos] = 0;
+							pChildCountStack[nStackPos] = 0;
+							pDescendantCountStack[nStackPos] = 0;
+
+						}
+						else if(MP_LOG_META == nType)
+						{
+							if(nStackPos)
+							{
+								int64_t nMetaIndex = MicroProfileLogTimerIndex(LE);
+								int64_t nMetaCount = MicroProfileLogGetTick(LE);
+								MP_ASSERT(nMetaIndex < MICROPROFILE_META_MAX);
+								int64_t nCounter = MicroProfileLogTimerIndex(pStack[nStackPos-1]);
+								S.MetaCounters[nMetaIndex].nCounters[nCounter] += nMetaCount;
+							}
+						}
+						else if(MP_LOG_LEAVE == nType)
+						{
+							int nTimer = MicroProfileLogTimerIndex(LE);
+							uint16_t nGroup = pTimerToGroup[nTimer];
+							MP_ASSERT(nGroup < MICROPROFILE_MAX_GROUPS);
+							if(nStackPos)
+							{									
+								int64_t nTickStart = MicroProfileLogGetTick(pStack[nStackPos-1]);
+								int64_t nTicks = MicroProfileLogTickDifference(nTickStart, MicroProfileLogGetTick(LE));
+								int64_t nChildTicks = pChildTickStack[nStackPos];
+								uint32_t nChildren = pChildCountStack[nStackPos];
+								uint32_t nDescendants = pDescendantCountStack[nStackPos];
+								nStackPos--;
+								pChildTickStack[nStackPos] += nTicks;
+								pChildCountStack[nStackPos] += 1;
+								pDescendantCountStack[nStackPos] += nDescendants + 1;
+								if(fPairTicks > 0.f)
+								{
+									//inclusive time contains the instrumentation of every nested scope, exclusive time that of the direct children
+									int64_t nExclusive = nTicks - nChildTicks - (int64_t)(nChildren * fPairTicks);
+									nTicks = MicroProfileMax<int64_t>(0, nTicks - (int64_t)(nDescendants * fPairTicks));
+									nChildTicks = MicroProfileMax<int64_t>(0, nTicks - MicroProfileMax<int64_t>(0, nExclusive));
+								}
+
+								uint32_t nTimerIndex = MicroProfileLogTimerIndex(LE);
+								uint32_t nSampleRate = MicroProfileSampleScale(nTimerIndex, nTickStart);
+								//sampled timers are scaled back up to an estimate of all calls. the parent exclusive time only subtracts what was recorded
+								S.FrameTicks[nTimerIndex] += nTicks * nSampleRate;
+								S.FrameExclusive[nTimerIndex] += (nTicks-nChildTicks) * nSampleRate;
+								S.FrameCount[nTimerIndex] += nAsyncSuspend ? 0 : nSampleRate; //resumed async scopes are counted once, at their end
+								nAsyncSuspend = 0;
+								nThreadEnd[i] = MicroProfileLogGetTick(LE);
+								if(pRequest)
+								{
+									MicroProfileRequestAddTimer(pRequest, nTimerIndex, nTicks);
+								}
+
+								MP_ASSERT(nGroup < MICROPROFILE_MAX_GROUPS);
+								uint8_t nGroupStackPos = pGroupStackPos[nGroup];
+								if(nGroupStackPos)
+								{
+									nGroupStackPos--;
+									if(0 == nGroupStackPos)
+									{
+										nGroupTicks[nGroup] += nTicks * nSampleRate;
+									}
+									pGroupStackPos[nGroup] = nGroupStackPos;
+								}
+							}
+						}
+						else if(MP_LOG_EXTENDED == nType && !pLog->nGpu)
+						{
+							uint64_t nSubType = MicroProfileLogTimerIndex(LE);
+							if(MP_LOG_EXTENDED_ASYNC_SUSPEND == nSubType)
+							{
+								nAsyncSuspend = 1;
+							}
+							uint64_t nFlowId;
+							if((MP_LOG_EXTENDED_FLOW_BEGIN == nSubType || MP_LOG_EXTENDED_FLOW_END == nSubType) && S.nNumFlowEvents < MICROPROFILE_FLOW_MAX && MicroProfileLogGetPayload(It, &nFlowId))
+							{
+								MicroProfileFlowEvent& E = S.FlowEvents[S.nNumFlowEvents++];
+								E.nFlowId = nFlowId;
+								E.nTick = MicroProfileLogGetTick(LE);
+								E.nLogIndex = i;
+								E.nBegin = MP_LOG_EXTENDED_FLOW_BEGIN == nSubType ? 1 : 0;
+							}
+							uint64_t nRequest;
+							if(MP_LOG_EXTENDED_REQUEST == nSubType && MicroProfileLogGetPayload(It, &nRequest))
+							{
+								int64_t nTick = MicroProfileLogGetTick(LE);
+								if(pRequest)
+								{
+									MicroProfileRequestAddTicks(pRequest, pLog->nRequestFlipTick, nTick);
+								}
+								pLog->nRequestFlip = nRequest;
+								pLog->nRequestFlipTick = nTick;
+								pRequest = nRequest ? MicroProfileRequestFind(nRequest) : 0;
+							}
+						}
+					}
+					if(pRequest)
+					{
+						//request still running on this thread, attribute time up to the end of the frame
+						int64_t nTick = MP_LOG_TICK_MASK & nFrameEndCpu;
+						MicroProfileRequestAddTicks(pRequest, pLog->nRequestFlipTick, nTick);
+						pLog->nRequestFlipTick = nTick;
+					}
+#if MICROPROFILE_AGGREGATE_ONLY
+					//the totals are current, while the log above is replayed a few frames behind
+					uint32_t nTotalEvents = pLog->nTotalEvents.load(std::memory_order_acquire);
+					if(nTotalEvents != pLog->nTotalEventsSeen)
+					{
+						pLog->nTotalEventsSeen = nTotalEvents;
+						MicroProfileShadowMerge(pLog, nGroupTicks);
+					}
+#endif
+					for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
+					{
+						pLog->nGroupTicks[i] += nGroupTicks[i];
+						pFrameGroup[i] += nGroupTicks[i];
+					}
+					pLog->nStackPos = nStackPos;
+					pLog->nAsyncSuspend = nAsyncSuspend;
+				}
+				if(S.pRequests)
+				{
+					S.pRequests->nWindowFrames++;
+					S.pRequests->nScanFrames++;
+				}
+				S.nFlowCriticalPathSegments = MicroProfileFlowCalcCriticalPath(S.FlowEvents, S.nNumFlowEvents, nThreadEnd, MICROPROFILE_MAX_THREADS, MP_LOG_TICK_MASK & nFrameStartCpu, S.FlowCriticalPath, MICROPROFILE_FLOW_CRITICAL_PATH_MAX, &S.nFlowCriticalPathTicks);
+			}
+			{
+				MICROPROFILE_SCOPE(g_MicroProfileAccumulate);
+				S.pAccumulate(&S.AccumTicks[0], &S.AccumMaxTimers[0], &S.AccumMinTimers[0], &S.FrameTicks[0], S.nTotalTimers);
+				S.pAccumulate(&S.AccumCount[0], 0, 0, &S.FrameCount[0], S.nTotalTimers);
+				S.pAccumulate(&S.AccumTimersExclusive[0], &S.AccumMaxTimersExclusive[0], 0, &S.FrameExclusive[0], S.nTotalTimers);
+
+				for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
+				{
+					S.AccumGroup[i] += pFrameGroup[i];
+					S.AccumGroupMax[i] = MicroProfileMax(S.AccumGroupMax[i], pFrameGroup[i]);
+				}
+
+				for(uint32_t j = 0; j < MICROPROFILE_META_MAX; ++j)
+				{
+					if(S.MetaCounters[j].pName && 0 != (S.nActiveBars & (MP_DRAW_META_FIRST<<j)))
+					{
+						auto& Meta = S.MetaCounters[j];
+						S.pAccumulate(&Meta.nAccum[0], &Meta.nAccumMax[0], 0, &Meta.nCounters[0], S.nTotalTimers);
+						uint64_t nSum = 0;
+						for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+						{
+							nSum += Meta.nCounters[i];
+						}
+						Meta.nSumAccum += nSum;
+						Meta.nSumAccumMax = MicroProfileMax(Meta.nSumAccumMax, nSum);
+					}
+				}			
+			}
+			for(uint32_t i = 0; i < MICROPROFILE_MAX_GRAPHS; ++i)
+			{
+				if(S.Graph[i].nToken != MICROPROFILE_INVALID_TOKEN)
+				{
+					MicroProfileToken nToken = S.Graph[i].nToken;
+					S.Graph[i].nHistory[S.nGraphPut] = S.FrameTicks[MicroProfileGetTimerIndex(nToken)];
+				}
+			}
+			S.nGraphPut = (S.nGraphPut+1) % MICROPROFILE_GRAPH_HISTORY;
+
+			MicroProfileGovernorUpdate(nFrameStartCpu, nFrameEndCpu - nFrameStartCpu);
+#if MICROPROFILE_FLIGHT_RECORDER
+			if(S.pFlightRecorder)
+			{
+				MicroProfileFlightRecorderFrame(S.nFrameCurrent, nFrameNext);
+			}
+#endif
+
+		}
+
+
+		if(S.nRunning && S.nAggregateFlip <= ++S.nAggregateFlipCount)
+		{
+			nAggregateFlip = 1;
+			if(S.nAggregateFlip) // if 0 accumulate indefinitely
+			{
+				nAggregateClear = 1;
+			}
+		}
+	}
+	if(nAggregateFlip)
+	{
+		memcpy(&S.AggregateTicks[0], &S.AccumTicks[0], sizeof(S.AggregateTicks[0]) * S.nTotalTimers);
+		memcpy(&S.AggregateCount[0], &S.AccumCount[0], sizeof(S.AggregateCount[0]) * S.nTotalTimers);
+		memcpy(&S.AggregateMax[0], &S.AccumMaxTimers[0], sizeof(S.AggregateMax[0]) * S.nTotalTimers);
+		memcpy(&S.AggregateMin[0], &S.AccumMinTimers[0], sizeof(S.AggregateMin[0]) * S.nTotalTimers);
+		memcpy(&S.AggregateExclusive[0], &S.AccumTimersExclusive[0], sizeof(S.AggregateExclusive[0]) * S.nTotalTimers);
+		memcpy(&S.AggregateMaxExclusive[0], &S.AccumMaxTimersExclusive[0], sizeof(S.AggregateMaxExclusive[0]) * S.nTotalTimers);
+
+		memcpy(&S.AggregateGroup[0], &S.AccumGroup[0], sizeof(S.AggregateGroup));
+		memcpy(&S.AggregateGroupMax[0], &S.AccumGroupMax[0], sizeof(S.AggregateGroup));		
+
+		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[i];
+			if(!pLog) 
+				continue;
+			
+			memcpy(&pLog->nAggregateGroupTicks[0], &pLog->nGroupTicks[0], sizeof(pLog->nAggregateGroupTicks));
+			
+			if(nAggregateClear)
+			{
+				memset(&pLog->nGroupTicks[0], 0, sizeof(pLog->nGroupTicks));
+			}
+		}
+
+		for(uint32_t j = 0; j < MICROPROFILE_META_MAX; ++j)
+		{
+			if(S.MetaCounters[j].pName && 0 != (S.nActiveBars & (MP_DRAW_META_FIRST<<j)))
+			{
+				auto& Meta = S.MetaCounters[j];
+				memcpy(&Meta.nAggregateMax[0], &Meta.nAccumMax[0], sizeof(Meta.nAggregateMax[0]) * S.nTotalTimers);
+				memcpy(&Meta.nAggregate[0], &Meta.nAccum[0], sizeof(Meta.nAggregate[0]) * S.nTotalTimers);
+				Meta.nSumAggregate = Meta.nSumAccum;
+				Meta.nSumAggregateMax = Meta.nSumAccumMax;
+				if(nAggregateClear)
+				{
+					memset(&Meta.nAccumMax[0], 0, sizeof(Meta.nAccumMax[0]) * S.nTotalTimers);
+					memset(&Meta.nAccum[0], 0, sizeof(Meta.nAccum[0]) * S.nTotalTimers);
+					Meta.nSumAccum = 0;
+					Meta.nSumAccumMax = 0;
+				}
+			}
+		}
+
+
+
+
+
+		MicroProfileRequestFlipWindow((S.nFrameCurrent + 1) % MICROPROFILE_MAX_FRAME_HISTORY, nAggregateClear != 0);
+
+		S.nAggregateFrames = S.nAggregateFlipCount;
+		S.nFlipAggregateDisplay = S.nFlipAggregate;
+		S.nFlipMaxDisplay = S.nFlipMax;
+		if(nAggregateClear)
+		{
+			memset(&S.AccumTicks[0], 0, sizeof(S.AccumTicks[0]) * S.nTotalTimers);
+			memset(&S.AccumCount[0], 0, sizeof(S.AccumCount[0]) * S.nTotalTimers);
+			memset(&S.AccumMaxTimers[0], 0, sizeof(S.AccumMaxTimers[0]) * S.nTotalTimers);
+			memset(&S.AccumMinTimers[0], 0xFF, sizeof(S.AccumMinTimers[0]) * S.nTotalTimers);
+			memset(&S.AccumTimersExclusive[0], 0, sizeof(S.AccumTimersExclusive[0]) * S.nTotalTimers);
+			memset(&S.AccumMaxTimersExclusive[0], 0, sizeof(S.AccumMaxTimersExclusive[0]) * S.nTotalTimers);
+			memset(&S.AccumGroup[0], 0, sizeof(S.AggregateGroup));
+			memset(&S.AccumGroupMax[0], 0, sizeof(S.AggregateGroup));		
+
+			S.nAggregateFlipCount = 0;
+			S.nFlipAggregate = 0;
+			S.nFlipMax = 0;
+
+			S.nAggregateFlipTick = MP_TICK();
+		}
+
+		#if MICROPROFILE_COUNTER_HISTORY
+		int64_t* pDest = &S.nCounterHistory[S.nCounterHistoryPut][0];
+		S.nCounterHistoryPut = (S.nCounterHistoryPut+1) % MICROPROFILE_GRAPH_HISTORY;
+		for(uint32_t i = 0; i < S.nNumCounters; ++i)
+		{
+			if(0 != (S.CounterInfo[i].nFlags & MICROPROFILE_COUNTER_FLAG_DETAILED))
+			{
+				uint64_t nValue = MicroProfileCounterValue(i);
+				pDest[i] = nValue;
+				S.nCounterMin[i] = MicroProfileMin(S.nCounterMin[i], (int64_t)nValue);
+				S.nCounterMax[i] = MicroProfileMax(S.nCounterMax[i], (int64_t)nValue);
+			}
+		}
+		#endif
+	}
+	S.nAggregateClear = 0;
+
+	MicroProfileGroupMask nNewActiveGroup;
+	nNewActiveGroup.Reset();
+	if (S.nRunning || S.nForceEnable)
+		nNewActiveGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
+	nNewActiveGroup.Add(S.nForceGroup);
+	nNewActiveGroup.Add(S.nForceGroupUI);
+	if(S.nActiveGroup != nNewActiveGroup)
+		S.nActiveGroup = nNewActiveGroup;
+
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		uint32_t nCapture = pLog->nGpu || S.nAllThreadsWanted || S.nThreadActive[i] ? 1 : 0;
+		if(pLog->nCapture != nCapture)
+			pLog->nCapture = nCapture;
+	}
+
+	uint32_t nNewActiveBars = 0;
+	if (S.nRunning || S.nForceEnable)
+		nNewActiveBars = S.nBars;
+	if(S.nForceMetaCounters)
+	{
+		for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
+		{
+			if(S.MetaCounters[i].pName)
+			{
+				nNewActiveBars |= (MP_DRAW_META_FIRST<<i);
+			}
+		}
+	}
+	if(nNewActiveBars != S.nActiveBars)
+		S.nActiveBars = nNewActiveBars;
+
+#if MICROPROFILE_AGGREGATE_ONLY
+	//detailed logging is on while the viewer is open, and for a while after a web request or dump
+	if(S.nAggregateOnlyHold)
+		S.nAggregateOnlyHold--;
+	uint32_t nAggregateOnly = S.nAggregateOnlyWanted && !S.nAggregateOnlyHold && (S.nDisplay == MP_DRAW_OFF || S.nDisplay == MP_DRAW_HIDDEN) ? 1 : 0;
+	if(nAggregateOnly != S.nAggregateOnly)
+	{
+		S.nAggregateOnly = nAggregateOnly;
+		S.nAutoClearFrames = MICROPROFILE_GPU_FRAME_DELAY + 3; //the totals are current while the log is replayed frames behind, hide the overlap
+	}
+#endif
+}
+
+void MicroProfileFlip()
+{
+	MICROPROFILE_SCOPE(g_MicroProfileFlip);
+
+	MicroProfileFlipGpu();
+	MicroProfileFlipCpu();
+}
+
+void MicroProfileGpuSetContext(void* pContext)
+{
+	if(MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+	{
+		pLog->pContextGpu = pContext;
+	}
+}
+
+void MicroProfileGpuBegin(void* pContext)
+{
+	if(MicroProfileThreadLog* pLog = MicroProfileGetOrCreateThreadLog())
+	{
+		MP_ASSERT(!pLog->bActiveGpu);
+
+		pLog->pContextGpu = pContext;
+		pLog->nStartGpu = pLog->nPutGpu.load();
+		pLog->bActiveGpu = 1;
+	}
+}
+
+uint64_t MicroProfileGpuEnd()
+{
+	if(MicroProfileThreadLog* pLog = MicroProfileGetThreadLog())
+	{
+		MP_ASSERT(pLog->bActiveGpu);
+
+		uint32_t nStartGpu = pLog->nStartGpu;
+		uint32_t nPutGpu = pLog->nPutGpu.load();
+		MP_ASSERT(nPutGpu >= nStartGpu);
+
+		pLog->pContextGpu = 0;
+		pLog->nStartGpu = nPutGpu;
+		pLog->bActiveGpu = 0;
+
+		MP_ASSERT(MICROPROFILE_GPU_BUFFER_SIZE <= 1 << 24);
+
+		return (uint64_t(pLog->nLogIndex) << 48) | (uint64_t(nStartGpu) << 24) | uint64_t(nPutGpu);
+	}
+	return 0;
+}
+
+void MicroProfileGpuSubmit(uint64_t nWork)
+{
+	if (!nWork)
+		return;
+
+	uint32_t nLogIndex = (nWork >> 48) & 0xffff;
+	uint32_t nStart = (nWork >> 24) & 0xffffff;
+	uint32_t nEnd = nWork & 0xffffff;
+
+	MP_ASSERT(nLogIndex < MICROPROFILE_MAX_THREADS);
+	MP_ASSERT(nStart <= nEnd);
+
+	MicroProfileThreadLog* pLog = S.Pool[nLogIndex];
+	if (!pLog)
+		return;
+
+	MP_ASSERT(nEnd <= pLog->nStartGpu);
+
+	for (uint32_t i = nStart; i < nEnd; ++i)
+	{
+		MicroProfileLogEntry LE = pLog->LogGpu[i];
+
+		MicroProfileLogPut(MicroProfileLogTimerIndex(LE), MicroProfileLogGetTick(LE), MicroProfileLogType(LE), g_MicroProfileGpuLog);
+	}
+}
+
+void MicroProfileSetForceEnable(bool bEnable)
+{
+	S.nForceEnable = bEnable ? 1 : 0;
+}
+bool MicroProfileGetForceEnable()
+{
+	return S.nForceEnable != 0;
+}
+
+void MicroProfileSetEnableAllGroups(bool bEnableAllGroups)
+{
+	S.nAllGroupsWanted = bEnableAllGroups ? 1 : 0;
+}
+
+void MicroProfileEnableCategory(const char* pCategory, bool bEnabled)
+{
+	int nCategoryIndex = -1;
+	for(uint32_t i = 0; i < S.nCategoryCount; ++i)
+	{
+		if(!MP_STRCASECMP(pCategory, S.CategoryInfo[i].pName))
+		{
+			nCategoryIndex = (int)i;
+			break;
+		}
+	}
+	if(nCategoryIndex >= 0)
+	{
+		if(bEnabled)
+		{
+			S.nActiveGroupWanted.Add(S.CategoryInfo[nCategoryIndex].nGroupMask);
+		}
+		else
+		{
+			S.nActiveGroupWanted.Remove(S.CategoryInfo[nCategoryIndex].nGroupMask);
+		}
+	}
+}
+
+
+void MicroProfileEnableCategory(const char* pCategory)
+{
+	MicroProfileEnableCategory(pCategory, true);
+}
+void MicroProfileDisableCategory(const char* pCategory)
+{
+	MicroProfileEnableCategory(pCategory, false);
+}
+
+bool MicroProfileGetEnableAllGroups()
+{
+	return 0 != S.nAllGroupsWanted;
+}
+
+void MicroProfileSetEnableAllThreads(bool bEnableAllThreads)
+{
+	S.nAllThreadsWanted = bEnableAllThreads ? 1 : 0;
+}
+
+bool MicroProfileGetEnableAllThreads()
+{
+	return 0 != S.nAllThreadsWanted;
+}
+
+void MicroProfileEnableThread(const char* pThreadName, bool bEnabled)
+{
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	//the name is kept, so threads started or restarted later with it are selected when their log is created
+	int nWanted = MicroProfileThreadWanted(pThreadName);
+	if(bEnabled && nWanted < 0 && S.nNumThreadWanted < MICROPROFILE_MAX_THREADS)
+	{
+		char* pWanted = S.ThreadWanted[S.nNumThreadWanted++];
+		uint32_t nLen = MicroProfileMin((uint32_t)strlen(pThreadName), (uint32_t)sizeof(S.ThreadWanted[0]) - 1);
+		memcpy(pWanted, pThreadName, nLen);
+		pWanted[nLen] = '\0';
+	}
+	else if(!bEnabled && nWanted >= 0)
+	{
+		S.nNumThreadWanted--;
+		memcpy(S.ThreadWanted[nWanted], S.ThreadWanted[S.nNumThreadWanted], sizeof(S.ThreadWanted[0]));
+	}
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		if(pLog->nActive && !MP_STRCASECMP(pThreadName, pLog->ThreadName))
+		{
+			S.nThreadActive[i] = bEnabled ? 1 : 0;
+		}
+	}
+}
+
+void MicroProfileEnableThread(const char* pThreadName)
+{
+	MicroProfileEnableThread(pThreadName, true);
+}
+
+void MicroProfileDisableThread(const char* pThreadName)
+{
+	MicroProfileEnableThread(pThreadName, false);
+}
+
+void MicroProfileSetForceMetaCounters(bool bForce)
+{
+	S.nForceMetaCounters = bForce ? 1 : 0;
+}
+
+bool MicroProfileGetForceMetaCounters()
+{
+	return 0 != S.nForceMetaCounters;
+}
+
+void MicroProfileEnableMetaCounter(const char* pMeta)
+{
+	for(uint32_t i = 0; i < MICROPROFILE_META_MAX; ++i)
+	{
+		if(S.MetaCounters[i].pName && 0 == MP_STRCASECMP(S.MetaCounters[i].pName, pMeta))
+		{
+			S.nBars |= (MP_DRAW_META_FIRST<<i);
+			return;
+		}
+	}
+}
+void MicroProfileDisableMetaCounter(const char* pMeta)
+{
+	for(uint32_t i = 0; i < MICROPROFILE_META_MAX; ++i)
+	{
+		if(S.MetaCounters[i].pName && 0 == MP_STRCASECMP(S.MetaCounters[i].pName, pMeta))
+		{
+			S.nBars &= ~(MP_DRAW_META_FIRST<<i);
+			return;
+		}
+	}
+}
+
+
+void MicroProfileSetAggregateFrames(int nFrames)
+{
+	S.nAggregateFlip = (uint32_t)nFrames;
+	if(0 == nFrames)
+	{
+		S.nAggregateClear = 1;
+	}
+}
+
+int MicroProfileGetAggregateFrames()
+{
+	return S.nAggregateFlip;
+}
+
+int MicroProfileGetCurrentAggregateFrames()
+{
+	return int(S.nAggregateFlip ? S.nAggregateFlip : S.nAggregateFlipCount);
+}
+
+
+void MicroProfileForceEnableGroup(const char* pGroup, MicroProfileTokenType Type)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	uint16_t nGroup = MicroProfileGetGroup(pGroup, Type);
+	S.nForceGroup.Set(nGroup);
+}
+
+void MicroProfileForceDisableGroup(const char* pGroup, MicroProfileTokenType Type)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
 	uint16_t nGroup = MicroProfileGetGroup(pGroup, Type);
-	S.nForceGroup |= (1ll << nGroup);
+	S.nForceGroup.Clear(nGroup);
+}
+
+
+void MicroProfileSetSampleRate(MicroProfileToken nToken, uint32_t nRate)
+{
+	if(nToken == MICROPROFILE_INVALID_TOKEN)
+		return;
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	uint16_t nTimerIndex = MicroProfileGetTimerIndex(nToken);
+	MP_ASSERT(nTimerIndex < S.nTotalTimers);
+	S.TimerSampleRateUser[nTimerIndex] = nRate > 1 && !S.nGroupMaskGpu.Test(MicroProfileGetGroupIndex(nToken)) ? nRate : 0;
+	MicroProfileUpdateSampleRates();
+}
+
+void MicroProfileSetGroupSampleRate(const char* pGroup, uint32_t nRate)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	uint16_t nGroup = MicroProfileGetGroup(pGroup, MicroProfileTokenTypeCpu);
+	S.GroupInfo[nGroup].nSampleRate = nRate;
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		if(S.TimerToGroup[i] == nGroup)
+			MicroProfileSetSampleRate(S.TimerInfo[i].nToken, nRate);
+	}
+}
+
+void MicroProfileSetOverheadBudget(float fFraction)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	S.fOverheadBudget = fFraction;
+}
+
+//turns the first n values of p into interleaved ms and fraction of the reference time
+static void MicroProfileExpandTimes(float* p, uint32_t nCount, float fToPrc)
+{
+	for(uint32_t i = nCount; i-- > 0;)
+	{
+		float fMs = p[i];
+		p[2*i] = fMs;
+		p[2*i+1] = MicroProfileMin(fMs * fToPrc, 1.f);
+	}
+}
+
+#undef S
+#define S MP_DUMP_STATE
+void MicroProfileCalcAllTimers(float* pTimers, float* pAverage, float* pMax, float* pMin, float* pCallAverage, float* pExclusive, float* pAverageExclusive, float* pMaxExclusive, float* pTotal, uint32_t nSize)
+{
+	uint32_t nCount = MicroProfileMin(S.nTotalTimers, nSize);
+	float fToMsCpu = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
+	float fToMsGpu = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondGpu());
+	float fRcpAggregateFrames = 1.f / (S.nAggregateFrames ? S.nAggregateFrames : 1);
+	float fToPrc = S.fRcpReferenceTime;
+
+	//the upper half of pTotal holds the per timer tick to ms factor until the totals are expanded
+	float* pToMs = pTotal + nCount;
+	for(uint32_t i = 0; i < nCount; ++i)
+	{
+		pToMs[i] = S.GroupInfo[S.TimerInfo[i].nGroupIndex].Type == MicroProfileTokenTypeGpu ? fToMsGpu : fToMsCpu;
+	}
+	S.pTicksToMs(pTimers, &S.FrameTicks[0], pToMs, 1.f, nCount);
+	S.pTicksToMs(pAverage, &S.AggregateTicks[0], pToMs, fRcpAggregateFrames, nCount);
+	S.pTicksToMs(pMax, &S.AggregateMax[0], pToMs, 1.f, nCount);
+	S.pTicksToMs(pMin, &S.AggregateMin[0], pToMs, 1.f, nCount);
+	S.pTicksToMs(pCallAverage, &S.AggregateTicks[0], pToMs, 1.f, nCount);
+	S.pTicksToMs(pExclusive, &S.FrameExclusive[0], pToMs, 1.f, nCount);
+	S.pTicksToMs(pAverageExclusive, &S.AggregateExclusive[0], pToMs, fRcpAggregateFrames, nCount);
+	S.pTicksToMs(pMaxExclusive, &S.AggregateMaxExclusive[0], pToMs, 1.f, nCount);
+	for(uint32_t i = 0; i < nCount; ++i)
+	{
+		pTotal[i] = pCallAverage[i];
+		pCallAverage[i] /= S.AggregateCount[i] ? (float)S.AggregateCount[i] : 1.f;
+		if(S.AggregateMin[i] == uint64_t(-1))
+			pMin[i] = 0.f;
+	}
+
+	MicroProfileExpandTimes(pTimers, nCount, fToPrc);
+	MicroProfileExpandTimes(pAverage, nCount, fToPrc);
+	MicroProfileExpandTimes(pMax, nCount, fToPrc);
+	MicroProfileExpandTimes(pMin, nCount, fToPrc);
+	MicroProfileExpandTimes(pCallAverage, nCount, fToPrc);
+	MicroProfileExpandTimes(pExclusive, nCount, fToPrc);
+	MicroProfileExpandTimes(pAverageExclusive, nCount, fToPrc);
+	MicroProfileExpandTimes(pMaxExclusive, nCount, fToPrc);
+	for(uint32_t i = nCount; i-- > 0;)
+	{
+		pTotal[2*i] = pTotal[i];
+		pTotal[2*i+1] = 0.f;
+	}
+}
+#undef S
+#define S g_MicroProfile
+
+void MicroProfileTogglePause()
+{
+	S.nToggleRunning = 1;
+}
+
+float MicroProfileGetTime(const char* pGroup, const char* pName)
+{
+	MicroProfileToken nToken = MicroProfileFindToken(pGroup, pName);
+	if(nToken == MICROPROFILE_INVALID_TOKEN)
+	{
+		return 0.f;
+	}
+	uint32_t nTimerIndex = MicroProfileGetTimerIndex(nToken);
+	uint32_t nGroupIndex = MicroProfileGetGroupIndex(nToken);
+	float fToMs = MicroProfileTickToMsMultiplier(S.GroupInfo[nGroupIndex].Type == MicroProfileTokenTypeGpu ? MicroProfileTicksPerSecondGpu() : MicroProfileTicksPerSecondCpu());
+	return S.FrameTicks[nTimerIndex] * fToMs;
+}
+
+
+int MicroProfileFormatCounter(int eFormat, int64_t nCounter, char* pOut, uint32_t nBufferSize)
+{
+	if (!nCounter)
+	{
+		pOut[0] = '0';
+		pOut[1] = '\0';
+		return 1;
+	}
+	int nLen = 0;
+	char* pBase = pOut;
+	char* pTmp = pOut;
+	char* pEnd = pOut + nBufferSize;
+
+	switch (eFormat)
+	{
+	case MICROPROFILE_COUNTER_FORMAT_DEFAULT:
+	{
+		int nNegative = 0;
+		if(nCounter < 0)
+		{
+			nCounter = -nCounter;
+			nNegative = 1;
+		}
+		int nSeperate = 0;
+		while (nCounter)
+		{
+			if (nSeperate)
+			{
+				*pTmp++ = ' ';
+			}
+			nSeperate = 1;
+			for (uint32_t i = 0; nCounter && i < 3; ++i)
+			{
+				int nDigit = nCounter % 10;
+				nCounter /= 10;
+				*pTmp++ = '0' + nDigit;
+			}
+		}
+		if(nNegative)
+		{
+			*pTmp++ = '-';
+		}
+		nLen = pTmp - pOut;
+		--pTmp;
+		MP_ASSERT(pTmp <= pEnd);
+		while (pTmp > pOut) //reverse string
+		{
+			char c = *pTmp;
+			*pTmp = *pOut;
+			*pOut = c;
+			pTmp--;
+			pOut++;
+		}
+	}
+	break;
+	case MICROPROFILE_COUNTER_FORMAT_BYTES:
+	{
+		const char* pExt[] = { "b","kb","mb","gb","tb","pb", "eb","zb", "yb" };
+		size_t nNumExt = sizeof(pExt) / sizeof(pExt[0]);
+		int64_t nShift = 0;
+		int64_t nDivisor = 1;
+		int64_t nCountShifted = nCounter >> 10;
+		while (nCountShifted)
+		{
+			nDivisor <<= 10;
+			nCountShifted >>= 10;
+			nShift++;
+		}
+		MP_ASSERT(nShift < (int64_t)nNumExt);
+		if (nShift)
+		{
+			nLen = snprintf(pOut, nBufferSize - 1, "%3.2f%s", (double)nCounter / nDivisor, pExt[nShift]);
+		}
+		else
+		{
+			nLen = snprintf(pOut, nBufferSize - 1, "%lld%s", (long long)nCounter, pExt[nShift]);
+		}
+	}
+	break;
+	}
+	pBase[nLen] = '\0';
+
+	return nLen;
+}
+
+typedef void MicroProfileWriteCallback(void* Handle, size_t size, const char* pData);
+
+void MicroProfileDumpFile(const char* pPath, MicroProfileDumpType eType, uint32_t nFrames)
+{
+	size_t nLen = strlen(pPath);
+	if(nLen > sizeof(S.DumpPath)-1)
+	{
+		return;
+	}
+	memcpy(S.DumpPath, pPath, nLen+1);
+	S.nDumpFileNextFrame = 1;
+	S.eDumpType = eType;
+	S.nDumpFrames = nFrames;
+}
+
+MICROPROFILE_FORMAT(3, 4) void MicroProfilePrintf(MicroProfileWriteCallback CB, void* Handle, const char* pFmt, ...)
+{
+	char buffer[4096];
+	va_list args;
+	va_start (args, pFmt);
+#ifdef _WIN32
+	size_t size = vsprintf_s(buffer, pFmt, args);
+#else
+	size_t size = vsnprintf(buffer, sizeof(buffer)-1,  pFmt, args);
+#endif
+	CB(Handle, size, &buffer[0]);
+	va_end (args);
+}
+
+void MicroProfilePrintUIntComma(MicroProfileWriteCallback CB, void* Handle, uint64_t nData)
+{
+	char Buffer[32];
+
+	uint32_t nOffset = sizeof(Buffer);
+	Buffer[--nOffset] = ',';
+
+	if(nData < 10)
+	{
+		Buffer[--nOffset] = '0' + nData;
+	}
+	else
+	{
+		do
+		{
+			Buffer[--nOffset] = "0123456789abcdef"[nData & 0xf];
+			nData >>= 4;
+		}
+		while(nData);
+
+		Buffer[--nOffset] = 'x';
+		Buffer[--nOffset] = '0';
+	}
+
+	CB(Handle, sizeof(Buffer) - nOffset, &Buffer[nOffset]);
+}
+
+void MicroProfilePrintString(MicroProfileWriteCallback CB, void* Handle, const char* pData)
+{
+	CB(Handle, strlen(pData), pData);
+}
+
+#undef S
+#define S MP_DUMP_STATE
+void MicroProfileDumpCsv(MicroProfileWriteCallback CB, void* Handle, int nMaxFrames)
+{
+	(void)nMaxFrames;
+
+	uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
+	float fToMsCPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
+	float fToMsGPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondGpu());
+
+	MicroProfilePrintf(CB, Handle, "frames,%d\n", nAggregateFrames);
+	MicroProfilePrintf(CB, Handle, "calibratedpairms,%g,subtracted,%d\n", fToMsCPU * S.fCalibratedPairTicks, S.nOverheadSubtract);
+	MicroProfilePrintf(CB, Handle, "group,name,average,max,callaverage\n");
+
+	uint32_t nNumTimers = S.nTotalTimers;
+	uint32_t nBlockSize = 2 * nNumTimers;
+	float* pTimers = (float*)alloca(nBlockSize * 9 * sizeof(float));
+	float* pAverage = pTimers + nBlockSize;
+	float* pMax = pTimers + 2 * nBlockSize;
+	float* pMin = pTimers + 3 * nBlockSize;
+	float* pCallAverage = pTimers + 4 * nBlockSize;
+	float* pTimersExclusive = pTimers + 5 * nBlockSize;
+	float* pAverageExclusive = pTimers + 6 * nBlockSize;
+	float* pMaxExclusive = pTimers + 7 * nBlockSize;
+	float* pTotal = pTimers + 8 * nBlockSize;
+
+	MicroProfileCalcAllTimers(pTimers, pAverage, pMax, pMin, pCallAverage, pTimersExclusive, pAverageExclusive, pMaxExclusive, pTotal, nNumTimers);
+
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		uint32_t nIdx = i * 2;
+		MicroProfilePrintf(CB, Handle, "\"%s\",\"%s\",%f,%f,%f\n", S.TimerInfo[i].pName, S.GroupInfo[S.TimerInfo[i].nGroupIndex].pName, pAverage[nIdx], pMax[nIdx], pCallAverage[nIdx]);
+	}
+
+	MicroProfilePrintf(CB, Handle, "\n\n");
+
+	MicroProfilePrintf(CB, Handle, "group,average,max,total\n");
+	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
+	{
+		const char* pGroupName = S.GroupInfo[j].pName;
+		float fToMs =  S.GroupInfo[j].Type == MicroProfileTokenTypeGpu ? fToMsGPU : fToMsCPU;
+		if(pGroupName[0] != '\0')
+		{
+			MicroProfilePrintf(CB, Handle, "\"%s\",%.3f,%.3f,%.3f\n", pGroupName, fToMs * S.AggregateGroup[j] / nAggregateFrames, fToMs * S.AggregateGroup[j] / nAggregateFrames, fToMs * S.AggregateGroup[j]);
+		}
+	}
+
+	MicroProfilePrintf(CB, Handle, "\n\n");
+	MicroProfilePrintf(CB, Handle, "group,thread,average,total\n");
+	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
+	{
+		for(uint32_t i = 0; i < S.nNumLogs; ++i)
+		{
+			if(S.Pool[i])
+			{
+				const char* pThreadName = &S.Pool[i]->ThreadName[0];
+				// MicroProfilePrintf(CB, Handle, "var ThreadGroupTime%d = [", i);
+				float fToMs = S.Pool[i]->nGpu ? fToMsGPU : fToMsCPU;
+				{
+					uint64_t nTicks = S.Pool[i]->nAggregateGroupTicks[j];
+					float fTime = nTicks / nAggregateFrames * fToMs;
+					float fTimeTotal = nTicks * fToMs;
+					if(fTimeTotal > 0.01f)
+					{
+						const char* pGroupName = S.GroupInfo[j].pName;
+						MicroProfilePrintf(CB, Handle, "\"%s\",\"%s\",%.3f,%.3f\n", pGroupName, pThreadName, fTime, fTimeTotal);
+					}
+				}
+			}
+		}
+	}
+
+	MicroProfilePrintf(CB, Handle, "\n\n");
+	MicroProfilePrintf(CB, Handle, "frametimecpu\n");
+
+	const uint32_t nCount = MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 3;
+	const uint32_t nStart = S.nFrameCurrent;
+	for(uint32_t i = nCount; i > 0; i--)
+	{
+		uint32_t nFrame = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i) % MICROPROFILE_MAX_FRAME_HISTORY;
+		uint32_t nFrameNext = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		uint64_t nTicks = S.Frames[nFrameNext].nFrameStartCpu - S.Frames[nFrame].nFrameStartCpu;
+		MicroProfilePrintf(CB, Handle, "%f,", nTicks * fToMsCPU);
+	}
+	MicroProfilePrintf(CB, Handle, "\n");
+
+	MicroProfilePrintf(CB, Handle, "\n\n");
+	MicroProfilePrintf(CB, Handle, "frametimegpu\n");
+
+	for(uint32_t i = nCount; i > 0; i--)
+	{
+		uint32_t nFrame = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i) % MICROPROFILE_MAX_FRAME_HISTORY;
+		uint32_t nFrameNext = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		uint64_t nTicks = S.Frames[nFrameNext].nFrameStartGpu - S.Frames[nFrame].nFrameStartGpu;
+		MicroProfilePrintf(CB, Handle, "%f,", nTicks * fToMsGPU);
+	}
+	MicroProfilePrintf(CB, Handle, "\n\n");
+	MicroProfilePrintf(CB, Handle, "Meta\n");//only single frame snapshot
+	MicroProfilePrintf(CB, Handle, "name,average,max,total\n");
+	for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+	{
+		if(S.MetaCounters[j].pName)
+		{
+			MicroProfilePrintf(CB, Handle, "\"%s\",%f,%lld,%lld\n",S.MetaCounters[j].pName, S.MetaCounters[j].nSumAggregate / (float)nAggregateFrames, (long long)S.MetaCounters[j].nSumAggregateMax, (long long)S.MetaCounters[j].nSumAggregate);
+		}
+	}
 }
 
-void MicroProfileForceDisableGroup(const char* pGroup, MicroProfileTokenType Type)
-{
-	MicroProfileInit();
-	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
-	uint16_t nGroup = MicroProfileGetGroup(pGroup, Type);
-	S.nForceGroup &= ~(1ll << nGroup);
-}
+#if MICROPROFILE_EMBED_HTML
+extern const char* g_MicroProfileHtml_begin[];
+extern size_t g_MicroProfileHtml_begin_sizes[];
+extern size_t g_MicroProfileHtml_begin_count;
+extern const char* g_MicroProfileHtml_end[];
+extern size_t g_MicroProfileHtml_end_sizes[];
+extern size_t g_MicroProfileHtml_end_count;
+
+
+void MicroProfileDumpHtml(MicroProfileWriteCallback CB, void* Handle, int nMaxFrames, const char* pHost)
+{
+	uint32_t nRunning = S.nRunning;
+	S.nRunning = 0;
+	//stall pushing of timers
+	MicroProfileGroupMask nActiveGroup = S.nActiveGroup;
+	S.nActiveGroup.Reset();
+	S.nPauseTicks = MP_TICK();
+
+
+	for(size_t i = 0; i < g_MicroProfileHtml_begin_count; ++i)
+	{
+		CB(Handle, g_MicroProfileHtml_begin_sizes[i]-1, g_MicroProfileHtml_begin[i]);
+	}
+	//dump info
+	uint64_t nTicks = MP_TICK();
+
+	float fToMsCPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
+	float fToMsGPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondGpu());
+	float fAggregateMs = fToMsCPU * (nTicks - S.nAggregateFlipTick);
+	MicroProfilePrintf(CB, Handle, "var DumpHost = '%s';\n", pHost ? pHost : "");
+	time_t CaptureTime;
+	time(&CaptureTime);
+	MicroProfilePrintf(CB, Handle, "var DumpUtcCaptureTime = %ld;\n", CaptureTime);
+	MicroProfilePrintf(CB, Handle, "var AggregateInfo = {'Frames':%d, 'Time':%f};\n", S.nAggregateFrames, fAggregateMs);
+
+	//categories
+	MicroProfilePrintf(CB, Handle, "var CategoryInfo = Array(%d);\n",S.nCategoryCount);
+	for(uint32_t i = 0; i < S.nCategoryCount; ++i)
+	{
+		MicroProfilePrintf(CB, Handle, "CategoryInfo[%d] = \"%s\";\n", i, S.CategoryInfo[i].pName);
+	}
+
+	//groups
+	MicroProfilePrintf(CB, Handle, "var GroupInfo = Array(%d);\n\n",S.nGroupCount);
+	uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
+
+	for(uint32_t i = 0; i < S.nGroupCount; ++i)
+	{
+		MP_ASSERT(i == S.GroupInfo[i].nGroupIndex);
+		float fToMs = S.GroupInfo[i].Type == MicroProfileTokenTypeCpu ? fToMsCPU : fToMsGPU;
+		uint32_t nColor = S.TimerInfo[i].nColor;
+		MicroProfilePrintf(CB, Handle, "GroupInfo[%d] = MakeGroup(%d, \"%s\", %d, %d, %d, %f, %f, %f, '#%06x');\n", 
+			S.GroupInfo[i].nGroupIndex, 
+			S.GroupInfo[i].nGroupIndex, 
+			S.GroupInfo[i].pName, 
+			S.GroupInfo[i].nCategory, 
+			S.GroupInfo[i].nNumTimers, 
+			S.GroupInfo[i].Type == MicroProfileTokenTypeGpu?1:0, 
+			fToMs * S.AggregateGroup[i], 
+			fToMs * S.AggregateGroup[i] / nAggregateFrames, 
+			fToMs * S.AggregateGroupMax[i],
+			((MICROPROFILE_UNPACK_RED(nColor) & 0xff) << 16) | ((MICROPROFILE_UNPACK_GREEN(nColor) & 0xff) << 8) | (MICROPROFILE_UNPACK_BLUE(nColor) & 0xff));
+	}
+	//timers
+
+	uint32_t nNumTimers = S.nTotalTimers;
+	uint32_t nBlockSize = 2 * nNumTimers;
+	float* pTimers = (float*)alloca(nBlockSize * 9 * sizeof(float));
+	float* pAverage = pTimers + nBlockSize;
+	float* pMax = pTimers + 2 * nBlockSize;
+	float* pMin = pTimers + 3 * nBlockSize;
+	float* pCallAverage = pTimers + 4 * nBlockSize;
+	float* pTimersExclusive = pTimers + 5 * nBlockSize;
+	float* pAverageExclusive = pTimers + 6 * nBlockSize;
+	float* pMaxExclusive = pTimers + 7 * nBlockSize;
+	float* pTotal = pTimers + 8 * nBlockSize;
+
+	MicroProfileCalcAllTimers(pTimers, pAverage, pMax, pMin, pCallAverage, pTimersExclusive, pAverageExclusive, pMaxExclusive, pTotal, nNumTimers);
+
+	MicroProfilePrintf(CB, Handle, "\nvar TimerInfo = Array(%d);\n\n", S.nTotalTimers);
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		uint32_t nIdx = i * 2;
+		MP_ASSERT(i == S.TimerInfo[i].nTimerIndex);
+
+		uint32_t nColor = S.TimerInfo[i].nColor;
+		uint32_t nColorDark = (nColor >> 1) & ~0x80808080;
+		MicroProfilePrintf(CB, Handle, "TimerInfo[%d] = MakeTimer(%d, \"%s\", %d, '#%06x','#%06x', %f, %f, %f, %f, %f, %f, %llu, %f,\n",
+			S.TimerInfo[i].nTimerIndex, S.TimerInfo[i].nTimerIndex, S.TimerInfo[i].pName, S.TimerInfo[i].nGroupIndex, 
+			((MICROPROFILE_UNPACK_RED(nColor) & 0xff) << 16) | ((MICROPROFILE_UNPACK_GREEN(nColor) & 0xff) << 8) | (MICROPROFILE_UNPACK_BLUE(nColor) & 0xff),
+			((MICROPROFILE_UNPACK_RED(nColorDark) & 0xff) << 16) | ((MICROPROFILE_UNPACK_GREEN(nColorDark) & 0xff) << 8) | (MICROPROFILE_UNPACK_BLUE(nColorDark) & 0xff),
+			pAverage[nIdx],
+			pMax[nIdx],
+			pMin[nIdx],
+			pAverageExclusive[nIdx],
+			pMaxExclusive[nIdx],
+			pCallAverage[nIdx],
+			(unsigned long long)S.AggregateCount[i],
+			pTotal[nIdx]);
+
+		MicroProfilePrintString(CB, Handle, "\t[");
+		for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+		{
+			if(S.MetaCounters[j].pName)
+			{
+				MicroProfilePrintUIntComma(CB, Handle, S.MetaCounters[j].nCounters[i]);
+			}
+		}
+		MicroProfilePrintString(CB, Handle, "],[");
+		for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+		{
+			if(S.MetaCounters[j].pName)
+			{
+				MicroProfilePrintUIntComma(CB, Handle, S.MetaCounters[j].nAggregate[i]);
+			}
+		}
+		MicroProfilePrintString(CB, Handle, "],[");
+		for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+		{
+			if(S.MetaCounters[j].pName)
+			{
+				MicroProfilePrintUIntComma(CB, Handle, S.MetaCounters[j].nAggregateMax[i]);
+			}
+		}
+		MicroProfilePrintString(CB, Handle, "]);\n");
+		if(S.TimerSampleRate[i] == MICROPROFILE_SAMPLE_DISABLED)
+		{
+			MicroProfilePrintf(CB, Handle, "TimerInfo[%d].throttled = 2;\n", i);
+		}
+		else if(S.TimerSampleRate[i] > 1)
+		{
+			MicroProfilePrintf(CB, Handle, "TimerInfo[%d].samplerate = %d;\n", i, S.TimerSampleRate[i]);
+			if(S.TimerSampleRateGovernor[i])
+				MicroProfilePrintf(CB, Handle, "TimerInfo[%d].throttled = 1;\n", i);
+		}
+	}
+
+	MicroProfilePrintf(CB, Handle, "\nvar OverheadBudget = %f;\nvar Overhead = %f;\n", S.fOverheadBudget, S.fOverhead);
+	MicroProfilePrintf(CB, Handle, "var CalibratedPairMs = %g;\nvar OverheadSubtract = %d;\n", fToMsCPU * S.fCalibratedPairTicks, S.nOverheadSubtract);
+
+	MicroProfilePrintString(CB, Handle, "\nvar ThreadNames = [");
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		if(S.Pool[i])
+		{
+			MicroProfilePrintf(CB, Handle, "'%s',", S.Pool[i]->ThreadName);
+		}
+		else
+		{
+			MicroProfilePrintf(CB, Handle, "'Thread %d',", i);
+		}
+	}
+	MicroProfilePrintString(CB, Handle, "];\n\n");
+
+
+	MicroProfilePrintString(CB, Handle, "\nvar ThreadIds = [");
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadIdType nThreadId = S.Pool[i] ? S.Pool[i]->nThreadId : 0;
+		MicroProfilePrintUIntComma(CB, Handle, nThreadId);
+	}
+	MicroProfilePrintString(CB, Handle, "];\n\n");
+
+
+	MicroProfilePrintString(CB, Handle, "\nvar ThreadGpu = [");
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		uint32_t nGpu = S.Pool[i] ? S.Pool[i]->nGpu : 0;
+		MicroProfilePrintUIntComma(CB, Handle, nGpu);
+	}
+	MicroProfilePrintString(CB, Handle, "];\n\n");
+
+	MicroProfilePrintString(CB, Handle, "\nvar ThreadFiber = [");
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		uint32_t nFiber = S.Pool[i] ? S.Pool[i]->nFiber : 0;
+		MicroProfilePrintUIntComma(CB, Handle, nFiber);
+	}
+	MicroProfilePrintString(CB, Handle, "];\n\n");
+
+
+	MicroProfilePrintString(CB, Handle, "\nvar ThreadGroupTimeArray = [\n");
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		if(S.Pool[i])
+		{
+			float fToMs = S.Pool[i]->nGpu ? fToMsGPU : fToMsCPU;
+			MicroProfilePrintf(CB, Handle, "MakeTimes(%e,[", fToMs);
+			for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
+			{
+				MicroProfilePrintUIntComma(CB, Handle, S.Pool[i]->nAggregateGroupTicks[j]);
+			}
+			MicroProfilePrintString(CB, Handle, "]),\n");
+		}
+	}
+	MicroProfilePrintString(CB, Handle, "];");
+
+
+	MicroProfilePrintString(CB, Handle, "\nvar MetaNames = [");
+	for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
+	{
+		if(S.MetaCounters[i].pName)
+		{
+			MicroProfilePrintf(CB, Handle, "'%s',", S.MetaCounters[i].pName);
+		}
+	}
+	MicroProfilePrintString(CB, Handle, "];\n\n");
+
+	MicroProfilePrintString(CB, Handle, "\nvar CounterInfo = [");
+	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+	{
+		int64_t nCounter = MicroProfileCounterValue(i);
+		int64_t nLimit = S.CounterInfo[i].nLimit;
+		float fCounterPrc = 0.f;
+		float fBoxPrc = 1.f;
+		if(nLimit)
+		{
+			fCounterPrc = (float)nCounter / nLimit;
+			if(fCounterPrc>1.f)
+			{
+				fBoxPrc = 1.f / fCounterPrc;
+				fCounterPrc = 1.f;
+			}
+		}
+
+		int64_t nCounterMin = 0, nCounterMax = 0;
+
+	#if MICROPROFILE_COUNTER_HISTORY
+		nCounterMin = S.nCounterMin[i];
+		nCounterMax = S.nCounterMax[i];
+	#endif
+
+		char Formatted[64];
+		char FormattedLimit[64];
+		MicroProfileFormatCounter(S.CounterInfo[i].eFormat, nCounter, Formatted, sizeof(Formatted)-1);
+		MicroProfileFormatCounter(S.CounterInfo[i].eFormat, S.CounterInfo[i].nLimit, FormattedLimit, sizeof(FormattedLimit)-1);
+		MicroProfilePrintf(CB, Handle, "MakeCounter(%d, %d, %d, %d, %d, '%s', %lld, %lld, %lld, '%s', %lld, '%s', %d, %f, %f, [",
+			i,
+			S.CounterInfo[i].nParent,
+			S.CounterInfo[i].nSibling,
+ 	 		S.CounterInfo[i].nFirstChild,
+ 	 		S.CounterInfo[i].nLevel,
+			S.CounterInfo[i].pName,
+			(long long)nCounter,
+			(long long)nCounterMin,
+			(long long)nCounterMax,
+			Formatted,
+			(long long)nLimit,
+			FormattedLimit,
+			S.CounterInfo[i].eFormat == MICROPROFILE_COUNTER_FORMAT_BYTES ? 1 : 0, 
+			fCounterPrc,
+			fBoxPrc
+			);
+
+	#if MICROPROFILE_COUNTER_HISTORY
+		if(0 != (S.CounterInfo[i].nFlags & MICROPROFILE_COUNTER_FLAG_DETAILED))
+		{
+			uint32_t nBaseIndex = S.nCounterHistoryPut;
+			for(uint32_t j = 0; j < MICROPROFILE_GRAPH_HISTORY; ++j)
+			{
+				uint32_t nHistoryIndex = (nBaseIndex + j) % MICROPROFILE_GRAPH_HISTORY;
+				int64_t nValue = MicroProfileClamp(S.nCounterHistory[nHistoryIndex][i], nCounterMin, nCounterMax);
+				MicroProfilePrintUIntComma(CB, Handle, nValue - nCounterMin);
+			}
+		}
+	#endif
+
+		MicroProfilePrintString(CB, Handle, "]),\n");
+	}
+	MicroProfilePrintString(CB, Handle, "];\n\n");
+
+
+	uint32_t nNumFrames = (MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 3); //leave a few to not overwrite
+	nNumFrames = MicroProfileMin(nNumFrames, (uint32_t)nMaxFrames);
+
+
+	uint32_t nFirstFrame = (S.nFrameCurrent + MICROPROFILE_MAX_FRAME_HISTORY - nNumFrames) % MICROPROFILE_MAX_FRAME_HISTORY;
+	uint32_t nLastFrame = (nFirstFrame + nNumFrames) % MICROPROFILE_MAX_FRAME_HISTORY;
+	MP_ASSERT(nLastFrame == (S.nFrameCurrent % MICROPROFILE_MAX_FRAME_HISTORY));
+	MP_ASSERT(nFirstFrame < MICROPROFILE_MAX_FRAME_HISTORY);
+	MP_ASSERT(nLastFrame  < MICROPROFILE_MAX_FRAME_HISTORY);
+	const int64_t nTickStart = S.Frames[nFirstFrame].nFrameStartCpu;
+	const int64_t nTickEnd = S.Frames[nLastFrame].nFrameStartCpu;
+	int64_t nTickStartGpu = S.Frames[nFirstFrame].nFrameStartGpu;
+
+	int64_t nTicksPerSecondCpu = MicroProfileTicksPerSecondCpu();
+	int64_t nTicksPerSecondGpu = MicroProfileTicksPerSecondGpu();
+
+	int64_t nTickReferenceCpu = 0, nTickReferenceGpu = 0;
+	// Can't just call GetGpuTickReference off main thread...
+	if(0 && MicroProfileGetGpuTickReference(&nTickReferenceCpu, &nTickReferenceGpu))
+	{
+		nTickStartGpu = (nTickStart - nTickReferenceCpu) * (double(nTicksPerSecondGpu) / double(nTicksPerSecondCpu)) + nTickReferenceGpu;
+	}
+
+#if MICROPROFILE_DEBUG
+	printf("dumping %d frames\n", nNumFrames);
+	printf("dumping frame %d to %d\n", nFirstFrame, nLastFrame);
+#endif
+
+
+	uint32_t* nTimerCounter = (uint32_t*)alloca(sizeof(uint32_t)* S.nTotalTimers);
+	memset(nTimerCounter, 0, sizeof(uint32_t) * S.nTotalTimers);
+
+#if MICROPROFILE_LABEL_INTERN
+	//interned labels are written once and referenced from the per frame label arrays
+	uint32_t nLabelInternCount = MicroProfileMin<uint32_t>(S.nLabelInternCount.load(), MICROPROFILE_LABEL_INTERN_MAX);
+	MicroProfilePrintString(CB, Handle, "var LabelIntern = [");
+	for(uint32_t i = 0; i < nLabelInternCount; ++i)
+	{
+		const char* pString = S.LabelInternStrings[i].load(std::memory_order_acquire);
+		if(pString)
+		{
+			MicroProfilePrintString(CB, Handle, "\"");
+			MicroProfilePrintString(CB, Handle, pString);
+			MicroProfilePrintString(CB, Handle, "\",");
+		}
+		else
+			MicroProfilePrintString(CB, Handle, "null,");
+	}
+	MicroProfilePrintString(CB, Handle, "];\n");
+#endif
+
+	MicroProfilePrintf(CB, Handle, "var Frames = Array(%d);\n", nNumFrames);
+	for(uint32_t i = 0; i < nNumFrames; ++i)
+	{
+		uint32_t nFrameIndex = (nFirstFrame + i) % MICROPROFILE_MAX_FRAME_HISTORY;
+		uint32_t nFrameIndexNext = (nFrameIndex + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+
+		MicroProfilePrintf(CB, Handle, "var tt%d = [\n", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+
+			MicroProfilePrintString(CB, Handle, "[");
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				uint32_t nLogType = MicroProfileLogType(It.LE);
+				if(nLogType == MP_LOG_META)
+				{
+					//for meta, store the count + 8, which is the tick part
+					nLogType = 8 + MicroProfileLogGetTick(It.LE);
+				}
+				MicroProfilePrintUIntComma(CB, Handle, nLogType);
+			}
+			MicroProfilePrintString(CB, Handle, "],\n");
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		MicroProfilePrintf(CB, Handle, "var ts%d = [\n", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+
+			int64_t nStartTick = pLog->nGpu ? nTickStartGpu : nTickStart;
+			float fToMs = pLog->nGpu ? fToMsGPU : fToMsCPU;
+
+			if(pLog->nGpu)
+				MicroProfilePrintf(CB, Handle, "MakeTimesExtra(%e,%e,tt%d[%d],[", fToMs, fToMsCPU, i, j);
+			else
+				MicroProfilePrintf(CB, Handle, "MakeTimes(%e,[", fToMs);
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				uint32_t nLogType = MicroProfileLogType(It.LE);
+				uint64_t nTick =
+					(nLogType == MP_LOG_ENTER || nLogType == MP_LOG_LEAVE)
+					? MicroProfileLogTickDifference(nStartTick, MicroProfileLogGetTick(It.LE))
+					: (nLogType == MP_LOG_GPU_EXTRA)
+					? MicroProfileLogTickDifference(nTickStart, MicroProfileLogGetTick(It.LE))
+					: 0;
+				MicroProfilePrintUIntComma(CB, Handle, nTick);
+			}
+			MicroProfilePrintString(CB, Handle, "]),\n");
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		MicroProfilePrintf(CB, Handle, "var ti%d = [\n", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+
+			uint32_t nLabelIndex = 0;
+			MicroProfilePrintString(CB, Handle, "[");
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				uint32_t nLogType = MicroProfileLogType(It.LE);
+				uint32_t nTimerIndex = (uint32_t)MicroProfileLogTimerIndex(It.LE);
+				uint32_t nIndex = (nLogType == MP_LOG_LABEL) ? nLabelIndex++ : nTimerIndex;
+				MicroProfilePrintUIntComma(CB, Handle, nIndex);
+
+				if(nLogType == MP_LOG_ENTER)
+					nTimerCounter[nTimerIndex]++;
+			}
+			MicroProfilePrintString(CB, Handle, "],\n");
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		MicroProfilePrintf(CB, Handle, "var tl%d = [\n", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+
+			MicroProfilePrintString(CB, Handle, "[");
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				uint32_t nLogType = MicroProfileLogType(It.LE);
+				if(nLogType == MP_LOG_LABEL)
+				{
+					uint64_t nLabel = MicroProfileLogGetTick(It.LE);
+					const char* pLabelName = MicroProfileGetLabel(nLabel);
+
+#if MICROPROFILE_LABEL_INTERN
+					if(pLabelName && (nLabel & MICROPROFILE_LABEL_INTERNED))
+						MicroProfilePrintf(CB, Handle, "LabelIntern[%d],", (uint32_t)nLabel);
+					else
+#endif
+					if(pLabelName)
+					{
+						MicroProfilePrintString(CB, Handle, "\"");
+						MicroProfilePrintString(CB, Handle, pLabelName);
+						MicroProfilePrintString(CB, Handle, "\",");
+					}
+					else
+						MicroProfilePrintString(CB, Handle, "null,");
+				}
+			}
+			MicroProfilePrintString(CB, Handle, "],\n");
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		int64_t nFrameStart = S.Frames[nFrameIndex].nFrameStartCpu;
+		int64_t nFrameEnd = S.Frames[nFrameIndexNext].nFrameStartCpu;
+		int64_t nFrameStartGpu = S.Frames[nFrameIndex].nFrameStartGpu;
+		int64_t nFrameEndGpu = S.Frames[nFrameIndexNext].nFrameStartGpu;
+
+		float fToMs = MicroProfileTickToMsMultiplier(nTicksPerSecondCpu);
+		float fFrameMs = MicroProfileLogTickDifference(nTickStart, nFrameStart) * fToMs;
+		float fFrameEndMs = MicroProfileLogTickDifference(nTickStart, nFrameEnd) * fToMs;
+		float fFrameGpuMs = MicroProfileLogTickDifference(nTickStartGpu, nFrameStartGpu) * fToMsGPU;
+		float fFrameGpuEndMs = MicroProfileLogTickDifference(nTickStartGpu, nFrameEndGpu) * fToMsGPU;
+
+		MicroProfilePrintf(CB, Handle, "Frames[%d] = MakeFrame(%d, %f, %f, %f, %f, ts%d, tt%d, ti%d, tl%d);\n", i, 0, fFrameMs, fFrameEndMs, fFrameGpuMs, fFrameGpuEndMs, i, i, i, i);
+	}
+
+	MicroProfileFlowEvent* pFlowEvents = new MicroProfileFlowEvent[MICROPROFILE_FLOW_MAX];
+	MicroProfilePrintf(CB, Handle, "var FlowEvents = Array(%d);\n", nNumFrames);
+	MicroProfilePrintf(CB, Handle, "var FlowCriticalPath = Array(%d);\n", nNumFrames);
+	MicroProfilePrintf(CB, Handle, "var AsyncEvents = Array(%d);\n", nNumFrames);
+	MicroProfilePrintf(CB, Handle, "var FiberEvents = Array(%d);\n", nNumFrames);
+	for(uint32_t i = 0; i < nNumFrames; ++i)
+	{
+		uint32_t nFrameIndex = (nFirstFrame + i) % MICROPROFILE_MAX_FRAME_HISTORY;
+		uint32_t nFrameIndexNext = (nFrameIndex + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+		int64_t nThreadEnd[MICROPROFILE_MAX_THREADS] = {0};
+		uint32_t nNumFlowEvents = 0;
+
+		//flow events are stored as [log, begin, id, time] tuples
+		MicroProfilePrintf(CB, Handle, "FlowEvents[%d] = [", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			if(pLog->nGpu)
+				continue;
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				MicroProfileLogEntry LE = It.LE;
+				uint64_t nLogType = MicroProfileLogType(LE);
+				uint64_t nSubType = MicroProfileLogTimerIndex(LE);
+				uint64_t nFlowId;
+				if(nLogType == MP_LOG_LEAVE)
+				{
+					nThreadEnd[j] = MicroProfileLogGetTick(LE);
+				}
+				else if(nLogType == MP_LOG_EXTENDED && (nSubType == MP_LOG_EXTENDED_FLOW_BEGIN || nSubType == MP_LOG_EXTENDED_FLOW_END) && MicroProfileLogGetPayload(It, &nFlowId))
+				{
+					uint32_t nBegin = nSubType == MP_LOG_EXTENDED_FLOW_BEGIN ? 1 : 0;
+					MicroProfilePrintf(CB, Handle, "%d,%d,%lld,%f,", j, nBegin, (long long)nFlowId, MicroProfileLogTickDifference(nTickStart, MicroProfileLogGetTick(LE)) * fToMsCPU);
+					if(nNumFlowEvents < MICROPROFILE_FLOW_MAX)
+					{
+						MicroProfileFlowEvent& E = pFlowEvents[nNumFlowEvents++];
+						E.nFlowId = nFlowId;
+						E.nTick = MicroProfileLogGetTick(LE);
+						E.nLogIndex = j;
+						E.nBegin = nBegin;
+					}
+				}
+			}
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		//async events are stored as [log, subtype, id, timer, time] tuples and stitched per coroutine by the viewer
+		MicroProfilePrintf(CB, Handle, "AsyncEvents[%d] = [", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			if(pLog->nGpu)
+				continue;
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				MicroProfileLogEntry LE = It.LE;
+				uint64_t nSubType = MicroProfileLogTimerIndex(LE);
+				uint64_t nPayload;
+				if(MicroProfileLogType(LE) == MP_LOG_EXTENDED && nSubType >= MP_LOG_EXTENDED_ASYNC_BEGIN && nSubType <= MP_LOG_EXTENDED_ASYNC_END && MicroProfileLogGetPayload(It, &nPayload))
+				{
+					MicroProfilePrintf(CB, Handle, "%d,%d,%u,%d,%f,", j, (int)nSubType, (uint32_t)nPayload, (int)(nPayload >> 32), MicroProfileLogTickDifference(nTickStart, MicroProfileLogGetTick(LE)) * fToMsCPU);
+				}
+			}
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		//fiber switches are stored as [host log, fiber log or -1, time] tuples
+		MicroProfilePrintf(CB, Handle, "FiberEvents[%d] = [", i);
+		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[j];
+			if(pLog->nGpu)
+				continue;
+			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+			for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrameIndex, nLogEnd); MicroProfileLogNext(It);)
+			{
+				MicroProfileLogEntry LE = It.LE;
+				uint64_t nFiber;
+				if(MicroProfileLogType(LE) == MP_LOG_EXTENDED && MicroProfileLogTimerIndex(LE) == MP_LOG_EXTENDED_FIBER_SWITCH && MicroProfileLogGetPayload(It, &nFiber))
+				{
+					MicroProfilePrintf(CB, Handle, "%d,%d,%f,", j, nFiber < MICROPROFILE_MAX_THREADS ? (int)nFiber : -1, MicroProfileLogTickDifference(nTickStart, MicroProfileLogGetTick(LE)) * fToMsCPU);
+				}
+			}
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+
+		//critical path is stored as [log, start, end] tuples
+		MicroProfileFlowSegment Segments[MICROPROFILE_FLOW_CRITICAL_PATH_MAX];
+		int64_t nTicksActive;
+		uint32_t nSegments = MicroProfileFlowCalcCriticalPath(pFlowEvents, nNumFlowEvents, nThreadEnd, S.nNumLogs, MP_LOG_TICK_MASK & S.Frames[nFrameIndex].nFrameStartCpu, Segments, MICROPROFILE_FLOW_CRITICAL_PATH_MAX, &nTicksActive);
+		MicroProfilePrintf(CB, Handle, "FlowCriticalPath[%d] = [", i);
+		for(uint32_t j = 0; j < nSegments; ++j)
+		{
+			MicroProfilePrintf(CB, Handle, "%d,%f,%f,", Segments[j].nLogIndex, MicroProfileLogTickDifference(nTickStart, Segments[j].nTickStart) * fToMsCPU, MicroProfileLogTickDifference(nTickStart, Segments[j].nTickEnd) * fToMsCPU);
+		}
+		MicroProfilePrintString(CB, Handle, "];\n");
+	}
+	delete[] pFlowEvents;
+
+
+	uint32_t nContextSwitchStart = 0;
+	uint32_t nContextSwitchEnd = 0;
+	MicroProfileContextSwitchSearch(&nContextSwitchStart, &nContextSwitchEnd, nTickStart, nTickEnd);
+
+	MicroProfilePrintString(CB, Handle, "var CSwitchThreadInOutCpu = [\n");
+	for(uint32_t j = nContextSwitchStart; j != nContextSwitchEnd; j = (j+1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE)
+	{
+		MicroProfileContextSwitch CS = S.ContextSwitch[j];
+		int nCpu = CS.nCpu;
+		MicroProfilePrintUIntComma(CB, Handle, CS.nThreadIn);
+		MicroProfilePrintUIntComma(CB, Handle, CS.nThreadOut);
+		MicroProfilePrintUIntComma(CB, Handle, nCpu);
+	}
+	MicroProfilePrintString(CB, Handle, "];\n");
+
+	MicroProfilePrintString(CB, Handle, "var CSwitchTime = [\n");
+	float fToMsCpu = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
+	for(uint32_t j = nContextSwitchStart; j != nContextSwitchEnd; j = (j+1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE)
+	{
+		MicroProfileContextSwitch CS = S.ContextSwitch[j];
+		float fTime = MicroProfileLogTickDifference(nTickStart, CS.nTicks) * fToMsCpu;
+		MicroProfilePrintf(CB, Handle, "%f,", fTime);
+	}
+	MicroProfilePrintString(CB, Handle, "];\n");
+
+	MicroProfileThreadInfo Threads[MICROPROFILE_MAX_CONTEXT_SWITCH_THREADS];
+	uint32_t nNumThreadsBase = 0;
+	uint32_t nNumThreads = MicroProfileContextSwitchGatherThreads(nContextSwitchStart, nContextSwitchEnd, Threads, &nNumThreadsBase);
+
+	MicroProfilePrintString(CB, Handle, "var CSwitchThreads = {");
+
+	for (uint32_t i = 0; i < nNumThreads; ++i)
+	{
+		char Name[256];
+		const char* pProcessName = MicroProfileGetProcessName(Threads[i].nProcessId, Name, sizeof(Name));
+
+		const char* p1 = i < nNumThreadsBase ? S.Pool[i]->ThreadName : "?";
+		const char* p2 = pProcessName ? pProcessName : "?";
+
+		MicroProfilePrintf(CB, Handle, "%lld:{\'tid\':%lld,\'pid\':%lld,\'t\':\'%s\',\'p\':\'%s\'},",
+			(long long)Threads[i].nThreadId,
+			(long long)Threads[i].nThreadId,
+			(long long)Threads[i].nProcessId,
+			p1, p2
+			);
+	}
+
+	MicroProfilePrintString(CB, Handle, "};\n");
+
+	for(size_t i = 0; i < g_MicroProfileHtml_end_count; ++i)
+	{
+		CB(Handle, g_MicroProfileHtml_end_sizes[i]-1, g_MicroProfileHtml_end[i]);
+	}
+
+	uint32_t* nGroupCounter = (uint32_t*)alloca(sizeof(uint32_t)* S.nGroupCount);
+
+	memset(nGroupCounter, 0, sizeof(uint32_t) * S.nGroupCount);
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		uint32_t nGroupIndex = S.TimerInfo[i].nGroupIndex;
+		nGroupCounter[nGroupIndex] += nTimerCounter[i];
+	}
+
+	uint32_t* nGroupCounterSort = (uint32_t*)alloca(sizeof(uint32_t)* S.nGroupCount);
+	uint32_t* nTimerCounterSort = (uint32_t*)alloca(sizeof(uint32_t)* S.nTotalTimers);
+	for(uint32_t i = 0; i < S.nGroupCount; ++i)
+	{
+		nGroupCounterSort[i] = i;
+	}
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		nTimerCounterSort[i] = i;
+	}
+	std::sort(nGroupCounterSort, nGroupCounterSort + S.nGroupCount, 
+		[nGroupCounter](const uint32_t l, const uint32_t r)
+		{
+			return nGroupCounter[l] > nGroupCounter[r];
+		}
+	);
 
+	std::sort(nTimerCounterSort, nTimerCounterSort + S.nTotalTimers, 
+		[nTimerCounter](const uint32_t l, const uint32_t r)
+		{
+			return nTimerCounter[l] > nTimerCounter[r];
+		}
+	);
 
-void MicroProfileCalcAllTimers(float* pTimers, float* pAverage, float* pMax, float* pMin, float* pCallAverage, float* pExclusive, float* pAverageExclusive, float* pMaxExclusive, float* pTotal, uint32_t nSize)
-{
-	for(uint32_t i = 0; i < S.nTotalTimers && i < nSize; ++i)
+	MicroProfilePrintf(CB, Handle, "\n<!--\nMarker Per Group\n");
+	for(uint32_t i = 0; i < S.nGroupCount; ++i)
 	{
-		const uint32_t nGroupId = S.TimerInfo[i].nGroupIndex;
-		const float fToMs = MicroProfileTickToMsMultiplier(S.GroupInfo[nGroupId].Type == MicroProfileTokenTypeGpu ? MicroProfileTicksPerSecondGpu() : MicroProfileTicksPerSecondCpu());
-		uint32_t nTimer = i;
-		uint32_t nIdx = i * 2;
-		uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
-		uint32_t nAggregateCount = S.Aggregate[nTimer].nCount ? S.Aggregate[nTimer].nCount : 1;
-		float fToPrc = S.fRcpReferenceTime;
-		float fMs = fToMs * (S.Frame[nTimer].nTicks);
-		float fPrc = MicroProfileMin(fMs * fToPrc, 1.f);
-		float fAverageMs = fToMs * (S.Aggregate[nTimer].nTicks / nAggregateFrames);
-		float fAveragePrc = MicroProfileMin(fAverageMs * fToPrc, 1.f);
-		float fMaxMs = fToMs * (S.AggregateMax[nTimer]);
-		float fMaxPrc = MicroProfileMin(fMaxMs * fToPrc, 1.f);
-		float fMinMs = fToMs * (S.AggregateMin[nTimer] != uint64_t(-1) ? S.AggregateMin[nTimer] : 0);
-		float fMinPrc = MicroProfileMin(fMinMs * fToPrc, 1.f);
-		float fCallAverageMs = fToMs * (S.Aggregate[nTimer].nTicks / nAggregateCount);
-		float fCallAveragePrc = MicroProfileMin(fCallAverageMs * fToPrc, 1.f);
-		float fMsExclusive = fToMs * (S.FrameExclusive[nTimer]);
-		float fPrcExclusive = MicroProfileMin(fMsExclusive * fToPrc, 1.f);
-		float fAverageMsExclusive = fToMs * (S.AggregateExclusive[nTimer] / nAggregateFrames);
-		float fAveragePrcExclusive = MicroProfileMin(fAverageMsExclusive * fToPrc, 1.f);
-		float fMaxMsExclusive = fToMs * (S.AggregateMaxExclusive[nTimer]);
-		float fMaxPrcExclusive = MicroProfileMin(fMaxMsExclusive * fToPrc, 1.f);
-		float fTotalMs = fToMs * S.Aggregate[nTimer].nTicks;
-		pTimers[nIdx] = fMs;
-		pTimers[nIdx+1] = fPrc;
-		pAverage[nIdx] = fAverageMs;
-		pAverage[nIdx+1] = fAveragePrc;
-		pMax[nIdx] = fMaxMs;
-		pMax[nIdx+1] = fMaxPrc;
-		pMin[nIdx] = fMinMs;
-		pMin[nIdx + 1] = fMinPrc;
-		pCallAverage[nIdx] = fCallAverageMs;
-		pCallAverage[nIdx+1] = fCallAveragePrc;
-		pExclusive[nIdx] = fMsExclusive;
-		pExclusive[nIdx+1] = fPrcExclusive;
-		pAverageExclusive[nIdx] = fAverageMsExclusive;
-		pAverageExclusive[nIdx+1] = fAveragePrcExclusive;
-		pMaxExclusive[nIdx] = fMaxMsExclusive;
-		pMaxExclusive[nIdx+1] = fMaxPrcExclusive;
-		pTotal[nIdx] = fTotalMs;
-		pTotal[nIdx+1] = 0.f;
+		uint32_t idx = nGroupCounterSort[i];
+		MicroProfilePrintf(CB, Handle, "%8d:%s\n", nGroupCounter[idx], S.GroupInfo[idx].pName);
 	}
-}
+	MicroProfilePrintf(CB, Handle, "Marker Per Timer\n");
+	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	{
+		uint32_t idx = nTimerCounterSort[i];
+		MicroProfilePrintf(CB, Handle, "%8d:%s(%s)\n", nTimerCounter[idx], S.TimerInfo[idx].pName, S.GroupInfo[S.TimerInfo[idx].nGroupIndex].pName);
+	}
+	MicroProfilePrintf(CB, Handle, "\n-->\n");
 
-void MicroProfileTogglePause()
+	S.nActiveGroup = nActiveGroup;
+	S.nRunning = nRunning;
+
+#if MICROPROFILE_DEBUG
+	int64_t nTicksEnd = MP_TICK();
+	float fMs = fToMsCpu * (nTicksEnd - S.nPauseTicks);
+	printf("html dump took %6.2fms\n", fMs);
+#endif
+}
+#else
+void MicroProfileDumpHtml(MicroProfileWriteCallback CB, void* Handle, int nMaxFrames, const char* pHost)
 {
-	S.nToggleRunning = 1;
+	MicroProfilePrintString("HTML output is disabled because MICROPROFILE_EMBED_HTML is 0\n");
 }
+#endif
+#undef S
+#define S g_MicroProfile
 
-float MicroProfileGetTime(const char* pGroup, const char* pName)
+//writes at most nMaxLen characters of pStr, escaping the ones html reads as markup, padded with spaces to nPad
+void MicroProfilePrintHtmlEscaped(MicroProfileWriteCallback CB, void* Handle, const char* pStr, uint32_t nMaxLen = (uint32_t)-1, uint32_t nPad = 0)
 {
-	MicroProfileToken nToken = MicroProfileFindToken(pGroup, pName);
-	if(nToken == MICROPROFILE_INVALID_TOKEN)
+	uint32_t nLen = 0;
+	const char* pRun = pStr;
+	for(; *pStr && nLen < nMaxLen; ++pStr, ++nLen)
 	{
-		return 0.f;
+		const char* pEscape = *pStr == '<' ? "&lt;" : *pStr == '>' ? "&gt;" : *pStr == '&' ? "&amp;" : 0;
+		if(pEscape)
+		{
+			CB(Handle, pStr - pRun, pRun);
+			CB(Handle, strlen(pEscape), pEscape);
+			pRun = pStr + 1;
+		}
 	}
-	uint32_t nTimerIndex = MicroProfileGetTimerIndex(nToken);
-	uint32_t nGroupIndex = MicroProfileGetGroupIndex(nToken);
-	float fToMs = MicroProfileTickToMsMultiplier(S.GroupInfo[nGroupIndex].Type == MicroProfileTokenTypeGpu ? MicroProfileTicksPerSecondGpu() : MicroProfileTicksPerSecondCpu());
-	return S.Frame[nTimerIndex].nTicks * fToMs;
+	CB(Handle, pStr - pRun, pRun);
+	for(; nLen < nPad; ++nLen)
+		CB(Handle, 1, " ");
 }
 
-
-int MicroProfileFormatCounter(int eFormat, int64_t nCounter, char* pOut, uint32_t nBufferSize)
+void MicroProfileDumpRequests(MicroProfileWriteCallback CB, void* Handle)
 {
-	if (!nCounter)
+	float fToMs = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
+	MicroProfileRequestState* pState = S.pRequests;
+	MicroProfilePrintf(CB, Handle, "<!DOCTYPE HTML>\n<html><head><title>MicroProfile Requests</title></head>\n<body style=\"font-family:monospace\">\n");
+	if(!pState || !pState->nNumExemplars)
 	{
-		pOut[0] = '0';
-		pOut[1] = '\0';
-		return 1;
+		MicroProfilePrintf(CB, Handle, "<p>No requests recorded. Use MICROPROFILE_REQUEST(id) to attribute work to requests.</p>\n</body></html>\n");
+		return;
 	}
-	int nLen = 0;
-	char* pBase = pOut;
-	char* pTmp = pOut;
-	char* pEnd = pOut + nBufferSize;
+	MicroProfilePrintf(CB, Handle, "<h2>Slowest %d requests of the last aggregation window (%d requests, %d dropped)</h2>\n", pState->nNumExemplars, pState->nExemplarRequests, pState->nExemplarDropped);
+	uint32_t nLink[MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES];
+	int nIndent[MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES];
+	uint32_t nTop[MICROPROFILE_MAX_THREADS];
+	int nOpen[MICROPROFILE_MAX_THREADS];
+	for(uint32_t i = 0; i < pState->nNumExemplars; ++i)
+	{
+		MicroProfileRequestExemplar& E = pState->Exemplars[i];
+		MicroProfileRequest& R = E.Request;
+		float fLatency = fToMs * MicroProfileLogTickDifference(R.nTickStart, R.nTickEnd);
+		MicroProfilePrintf(CB, Handle, "<h3>request %llu: latency %.3fms, active %.3fms</h3>\n<table>\n", (unsigned long long)R.nRequestId, fLatency, fToMs * R.nTicksActive);
+
+		MicroProfileRequestTimer Timers[MICROPROFILE_REQUEST_TIMERS_MAX];
+		memcpy(&Timers[0], &R.Timers[0], R.nNumTimers * sizeof(Timers[0]));
+		std::sort(&Timers[0], &Timers[R.nNumTimers], [](const MicroProfileRequestTimer& l, const MicroProfileRequestTimer& r){ return l.nTicks > r.nTicks; });
+		for(uint32_t j = 0; j < R.nNumTimers; ++j)
+		{
+			MicroProfileTimerInfo& TI = S.TimerInfo[Timers[j].nTimer];
+			MicroProfilePrintf(CB, Handle, "<tr><td>");
+			MicroProfilePrintHtmlEscaped(CB, Handle, S.GroupInfo[TI.nGroupIndex].pName);
+			MicroProfilePrintf(CB, Handle, "</td><td>");
+			MicroProfilePrintHtmlEscaped(CB, Handle, TI.pName);
+			MicroProfilePrintf(CB, Handle, "</td><td align=\"right\">%.3fms</td></tr>\n", fToMs * Timers[j].nTicks);
+		}
+		MicroProfilePrintf(CB, Handle, "</table>\n<pre>\n");
 
-	switch (eFormat)
-	{
-	case MICROPROFILE_COUNTER_FORMAT_DEFAULT:
-	{
-		int nNegative = 0;
-		if(nCounter < 0)
+		//entries of a thread log are in order, so enters are matched to their leave with a stack per thread in one pass.
+		//the stacks are linked through nLink, which holds the leave once the enter is matched
+		for(uint32_t j = 0; j < MICROPROFILE_MAX_THREADS; ++j)
 		{
-			nCounter = -nCounter;
-			nNegative = 1;
+			nTop[j] = (uint32_t)-1;
+			nOpen[j] = 0;
 		}
-		int nSeperate = 0;
-		while (nCounter)
+		for(uint32_t j = 0; j < E.nNumEntries; ++j)
 		{
-			if (nSeperate)
+			uint32_t nLogIndex = E.Entries[j].nLogIndex;
+			nIndent[j] = MicroProfileMax(0, nOpen[nLogIndex]);
+			if(MP_LOG_ENTER == MicroProfileLogType(E.Entries[j].LE))
 			{
-				*pTmp++ = ' ';
+				nLink[j] = nTop[nLogIndex];
+				nTop[nLogIndex] = j;
+				nOpen[nLogIndex]++;
 			}
-			nSeperate = 1;
-			for (uint32_t i = 0; nCounter && i < 3; ++i)
+			else
 			{
-				int nDigit = nCounter % 10;
-				nCounter /= 10;
-				*pTmp++ = '0' + nDigit;
+				uint32_t nEnter = nTop[nLogIndex];
+				if(nEnter != (uint32_t)-1)
+				{
+					nTop[nLogIndex] = nLink[nEnter];
+					nLink[nEnter] = j;
+				}
+				nOpen[nLogIndex]--;
 			}
 		}
-		if(nNegative)
-		{
-			*pTmp++ = '-';
-		}
-		nLen = pTmp - pOut;
-		--pTmp;
-		MP_ASSERT(pTmp <= pEnd);
-		while (pTmp > pOut) //reverse string
-		{
-			char c = *pTmp;
-			*pTmp = *pOut;
-			*pOut = c;
-			pTmp--;
-			pOut++;
-		}
-	}
-	break;
-	case MICROPROFILE_COUNTER_FORMAT_BYTES:
-	{
-		const char* pExt[] = { "b","kb","mb","gb","tb","pb", "eb","zb", "yb" };
-		size_t nNumExt = sizeof(pExt) / sizeof(pExt[0]);
-		int64_t nShift = 0;
-		int64_t nDivisor = 1;
-		int64_t nCountShifted = nCounter >> 10;
-		while (nCountShifted)
+		for(uint32_t j = 0; j < MICROPROFILE_MAX_THREADS; ++j)
 		{
-			nDivisor <<= 10;
-			nCountShifted >>= 10;
-			nShift++;
+			//enters still open when the exemplar ends
+			for(uint32_t k = nTop[j]; k != (uint32_t)-1;)
+			{
+				uint32_t nParent = nLink[k];
+				nLink[k] = (uint32_t)-1;
+				k = nParent;
+			}
 		}
-		MP_ASSERT(nShift < (int64_t)nNumExt);
-		if (nShift)
+		for(uint32_t j = 0; j < E.nNumEntries; ++j)
 		{
-			nLen = snprintf(pOut, nBufferSize - 1, "%3.2f%s", (double)nCounter / nDivisor, pExt[nShift]);
+			MicroProfileLogEntry LE = E.Entries[j].LE;
+			if(MP_LOG_ENTER != MicroProfileLogType(LE) || nLink[j] == (uint32_t)-1)
+				continue;
+			MicroProfileLogEntry LE2 = E.Entries[nLink[j]].LE;
+			uint64_t nTimerIndex = MicroProfileLogTimerIndex(LE);
+			if(MicroProfileLogTimerIndex(LE2) != nTimerIndex)
+				continue;
+			MicroProfileThreadLog* pLog = S.Pool[E.Entries[j].nLogIndex];
+			float fStart = fToMs * MicroProfileLogTickDifference(R.nTickStart, MicroProfileLogGetTick(LE));
+			float fDuration = fToMs * MicroProfileLogTickDifference(MicroProfileLogGetTick(LE), MicroProfileLogGetTick(LE2));
+			MicroProfilePrintHtmlEscaped(CB, Handle, pLog ? pLog->ThreadName : "", 20, 20);
+			MicroProfilePrintf(CB, Handle, " %9.3f %9.3f %*s", fStart, fDuration, 2 * nIndent[j], "");
+			MicroProfilePrintHtmlEscaped(CB, Handle, S.TimerInfo[nTimerIndex].pName);
+			MicroProfilePrintf(CB, Handle, "\n");
 		}
-		else
+		if(E.nNumEntries == MICROPROFILE_REQUEST_EXEMPLAR_ENTRIES)
 		{
-			nLen = snprintf(pOut, nBufferSize - 1, "%lld%s", (long long)nCounter, pExt[nShift]);
+			MicroProfilePrintf(CB, Handle, "(truncated)\n");
 		}
+		MicroProfilePrintf(CB, Handle, "</pre>\n");
 	}
-	break;
-	}
-	pBase[nLen] = '\0';
-
-	return nLen;
+	MicroProfilePrintf(CB, Handle, "</body></html>\n");
 }
 
-typedef void MicroProfileWriteCallback(void* Handle, size_t size, const char* pData);
-
-void MicroProfileDumpFile(const char* pPath, MicroProfileDumpType eType, uint32_t nFrames)
+void MicroProfileWriteFile(void* Handle, size_t nSize, const char* pData)
 {
-	size_t nLen = strlen(pPath);
-	if(nLen > sizeof(S.DumpPath)-1)
+	fwrite(pData, nSize, 1, (FILE*)Handle);
+}
+
+//copies nCount entries of a ring buffer from nStart, to the same positions in pDest
+void MicroProfileDumpCopyRing(void* pDest, const void* pSource, uint32_t nElementSize, uint32_t nStart, uint32_t nCount, uint32_t nRingSize)
+{
+	uint32_t nFirst = MicroProfileMin(nCount, nRingSize - nStart);
+	memcpy((char*)pDest + (size_t)nStart * nElementSize, (const char*)pSource + (size_t)nStart * nElementSize, (size_t)nFirst * nElementSize);
+	memcpy(pDest, pSource, (size_t)(nCount - nFirst) * nElementSize);
+}
+
+template<typename T, size_t N>
+void MicroProfileDumpCopy(T (&Dest)[N], const T (&Source)[N], uint32_t nCount)
+{
+	MP_ASSERT(nCount <= N);
+	memcpy(&Dest[0], &Source[0], sizeof(T) * nCount);
+}
+
+//copies the frame, timer, group and counter state a dump of nFrames reads, and the range of each log the frames cover.
+//everything is copied into buffers kept by the writer. log copies have the size of the live log, so positions stay valid
+void MicroProfileDumpSnapshot(MicroProfileDumpWriter& W, uint32_t nFrames, bool bLogs)
+{
+	if(!W.pState)
+		W.pState = (MicroProfile*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfile));
+	MicroProfile& D = *W.pState;
+	D.nActiveGroup = S.nActiveGroup;
+	D.nTotalTimers = S.nTotalTimers;
+	D.nGroupCount = S.nGroupCount;
+	D.nCategoryCount = S.nCategoryCount;
+	D.nAggregateFrames = S.nAggregateFrames;
+	D.nAggregateFlipTick = S.nAggregateFlipTick;
+	D.nRunning = S.nRunning;
+	D.nPauseTicks = S.nPauseTicks;
+	D.fReferenceTime = S.fReferenceTime;
+	D.fRcpReferenceTime = S.fRcpReferenceTime;
+	D.nNumLogs = S.nNumLogs;
+	D.nFrameCurrent = S.nFrameCurrent;
+	D.fOverheadBudget = S.fOverheadBudget;
+	D.fOverhead = S.fOverhead;
+	D.fCalibratedPairTicks = S.fCalibratedPairTicks;
+	D.pAccumulate = S.pAccumulate;
+	D.pTicksToMs = S.pTicksToMs;
+	D.nOverheadSubtract = S.nOverheadSubtract;
+
+	MicroProfileDumpCopy(D.CategoryInfo, S.CategoryInfo, S.nCategoryCount);
+	MicroProfileDumpCopy(D.GroupInfo, S.GroupInfo, S.nGroupCount);
+	MicroProfileDumpCopy(D.AggregateGroup, S.AggregateGroup, S.nGroupCount);
+	MicroProfileDumpCopy(D.AggregateGroupMax, S.AggregateGroupMax, S.nGroupCount);
+	uint32_t nTimers = S.nTotalTimers;
+	MicroProfileDumpCopy(D.TimerInfo, S.TimerInfo, nTimers);
+	MicroProfileDumpCopy(D.TimerSampleRate, S.TimerSampleRate, nTimers);
+	MicroProfileDumpCopy(D.TimerSampleRateGovernor, S.TimerSampleRateGovernor, nTimers);
+	MicroProfileDumpCopy(D.FrameTicks, S.FrameTicks, nTimers);
+	MicroProfileDumpCopy(D.FrameExclusive, S.FrameExclusive, nTimers);
+	MicroProfileDumpCopy(D.AggregateTicks, S.AggregateTicks, nTimers);
+	MicroProfileDumpCopy(D.AggregateCount, S.AggregateCount, nTimers);
+	MicroProfileDumpCopy(D.AggregateMax, S.AggregateMax, nTimers);
+	MicroProfileDumpCopy(D.AggregateMin, S.AggregateMin, nTimers);
+	MicroProfileDumpCopy(D.AggregateExclusive, S.AggregateExclusive, nTimers);
+	MicroProfileDumpCopy(D.AggregateMaxExclusive, S.AggregateMaxExclusive, nTimers);
+	for(uint32_t i = 0; i < MICROPROFILE_META_MAX; ++i)
 	{
-		return;
+		D.MetaCounters[i].pName = S.MetaCounters[i].pName;
+		D.MetaCounters[i].nSumAggregate = S.MetaCounters[i].nSumAggregate;
+		D.MetaCounters[i].nSumAggregateMax = S.MetaCounters[i].nSumAggregateMax;
+		MicroProfileDumpCopy(D.MetaCounters[i].nCounters, S.MetaCounters[i].nCounters, nTimers);
+		MicroProfileDumpCopy(D.MetaCounters[i].nAggregate, S.MetaCounters[i].nAggregate, nTimers);
+		MicroProfileDumpCopy(D.MetaCounters[i].nAggregateMax, S.MetaCounters[i].nAggregateMax, nTimers);
 	}
-	memcpy(S.DumpPath, pPath, nLen+1);
-	S.nDumpFileNextFrame = 1;
-	S.eDumpType = eType;
-	S.nDumpFrames = nFrames;
-}
 
-MICROPROFILE_FORMAT(3, 4) void MicroProfilePrintf(MicroProfileWriteCallback CB, void* Handle, const char* pFmt, ...)
-{
-	char buffer[4096];
-	va_list args;
-	va_start (args, pFmt);
-#ifdef _WIN32
-	size_t size = vsprintf_s(buffer, pFmt, args);
-#else
-	size_t size = vsnprintf(buffer, sizeof(buffer)-1,  pFmt, args);
+	uint32_t nCounters = S.nNumCounters;
+	D.nNumCounters = nCounters;
+	MicroProfileDumpCopy(D.CounterInfo, S.CounterInfo, nCounters);
+	for(uint32_t i = 0; i < nCounters; ++i)
+	{
+		D.Counters[i].store(MicroProfileCounterValue(S, i)); //shards are folded in, the log copies carry none
+	}
+#if MICROPROFILE_COUNTER_HISTORY
+	D.nCounterHistoryPut = S.nCounterHistoryPut;
+	for(uint32_t i = 0; i < MICROPROFILE_GRAPH_HISTORY; ++i)
+	{
+		MicroProfileDumpCopy(D.nCounterHistory[i], S.nCounterHistory[i], nCounters);
+	}
+	MicroProfileDumpCopy(D.nCounterMax, S.nCounterMax, nCounters);
+	MicroProfileDumpCopy(D.nCounterMin, S.nCounterMin, nCounters);
 #endif
-	CB(Handle, size, &buffer[0]);
-	va_end (args);
-}
-
-void MicroProfilePrintUIntComma(MicroProfileWriteCallback CB, void* Handle, uint64_t nData)
-{
-	char Buffer[32];
-
-	uint32_t nOffset = sizeof(Buffer);
-	Buffer[--nOffset] = ',';
-
-	if(nData < 10)
+#if MICROPROFILE_LABEL_INTERN
+	uint32_t nLabelInternCount = MicroProfileMin<uint32_t>(S.nLabelInternCount.load(), MICROPROFILE_LABEL_INTERN_MAX);
+	for(uint32_t i = 0; i < nLabelInternCount; ++i)
 	{
-		Buffer[--nOffset] = '0' + nData;
+		D.LabelInternStrings[i].store(S.LabelInternStrings[i].load(std::memory_order_acquire), std::memory_order_relaxed);
 	}
-	else
+	D.nLabelInternCount.store(nLabelInternCount);
+#endif
+
+	//html reads the dumped frames, csv prints the frame times of the whole history
+	const uint32_t nHistory = MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 3;
+	uint32_t nNumFrames = MicroProfileMin(nFrames, nHistory);
+	uint32_t nFirstFrame = (S.nFrameCurrent + MICROPROFILE_MAX_FRAME_HISTORY - nNumFrames) % MICROPROFILE_MAX_FRAME_HISTORY;
+	uint32_t nCopyFrames = (bLogs ? nNumFrames : nHistory) + 1;
+	MicroProfileDumpCopyRing(D.Frames, S.Frames, sizeof(MicroProfileFrameState), (S.nFrameCurrent + MICROPROFILE_MAX_FRAME_HISTORY + 1 - nCopyFrames) % MICROPROFILE_MAX_FRAME_HISTORY,
+		nCopyFrames, MICROPROFILE_MAX_FRAME_HISTORY);
+
+	for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
 	{
-		do
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		D.Pool[i] = 0;
+		if(!pLog)
+			continue;
+		MicroProfileDumpLogCopy& C = W.Logs[i];
+		if(!C.pLog)
+			C.pLog = new MicroProfileThreadLog();
+		MicroProfileThreadLog* pCopy = C.pLog;
+		D.Pool[i] = pCopy;
+		pCopy->nLogIndex = pLog->nLogIndex;
+		pCopy->nGpu = pLog->nGpu;
+		pCopy->nFiber = pLog->nFiber;
+		pCopy->nThreadId = pLog->nThreadId;
+		memcpy(pCopy->ThreadName, pLog->ThreadName, sizeof(pCopy->ThreadName));
+		MicroProfileDumpCopy(pCopy->nAggregateGroupTicks, pLog->nAggregateGroupTicks, S.nGroupCount);
+#if MICROPROFILE_LOG_COMPACT
+		pCopy->nCompactGet = pLog->nCompactGet;
+		pCopy->nCompactGetTick = pLog->nCompactGetTick;
+#endif
+		uint32_t nSize = MicroProfileLogSize(pLog);
+		pCopy->nLogSize = nSize;
+		pCopy->Log = 0;
+		uint32_t nStart = S.Frames[nFirstFrame].nLogStart[i];
+		uint32_t nEnd = S.Frames[S.nFrameCurrent].nLogStart[i];
+		if(bLogs && pLog->Log && nStart != nEnd)
 		{
-			Buffer[--nOffset] = "0123456789abcdef"[nData & 0xf];
-			nData >>= 4;
+			if(C.nBufferSize != nSize)
+			{
+				delete[] C.pBuffer;
+				C.pBuffer = new MicroProfileLogWord[nSize];
+				C.nBufferSize = nSize;
+			}
+			pCopy->Log = C.pBuffer;
+			MicroProfileDumpCopyRing(pCopy->Log, pLog->Log, sizeof(MicroProfileLogWord), nStart, (nEnd + nSize - nStart) % nSize, nSize);
+		}
+		uint32_t nLabelStart = S.Frames[nFirstFrame].nLabelStart[i];
+		uint32_t nLabelEnd = pLog->nLabelPut.load(std::memory_order_acquire);
+		pCopy->nLabelPut.store(nLabelEnd, std::memory_order_relaxed);
+		pCopy->LabelBuffer = 0;
+		if(bLogs && pLog->LabelBuffer && nLabelStart != nLabelEnd)
+		{
+			if(!C.pLabelBuffer)
+				C.pLabelBuffer = new char[MICROPROFILE_LABEL_BUFFER_SIZE];
+			pCopy->LabelBuffer = C.pLabelBuffer;
+			uint32_t nCount = MicroProfileMin(nLabelEnd - nLabelStart, (uint32_t)MICROPROFILE_LABEL_BUFFER_SIZE);
+			MicroProfileDumpCopyRing(pCopy->LabelBuffer, pLog->LabelBuffer, 1, (nLabelEnd - nCount) % MICROPROFILE_LABEL_BUFFER_SIZE, nCount, MICROPROFILE_LABEL_BUFFER_SIZE);
 		}
-		while(nData);
-
-		Buffer[--nOffset] = 'x';
-		Buffer[--nOffset] = '0';
 	}
-
-	CB(Handle, sizeof(Buffer) - nOffset, &Buffer[nOffset]);
+	//the trace thread keeps writing the live ring, so the switches the dump searches are copied up to the put position of the copy
+	D.ContextSwitch = 0;
+	D.nContextSwitchPut = S.nContextSwitchPut;
+#if MICROPROFILE_CONTEXT_SWITCH_TRACE
+	if(bLogs && S.ContextSwitch)
+	{
+		uint32_t nContextSwitchStart, nContextSwitchEnd;
+		MicroProfileContextSwitchSearch(&nContextSwitchStart, &nContextSwitchEnd, S.Frames[nFirstFrame].nFrameStartCpu, S.Frames[S.nFrameCurrent].nFrameStartCpu);
+		uint32_t nContextSwitchPut = D.nContextSwitchPut;
+		if(!W.ContextSwitch)
+			W.ContextSwitch = (MicroProfileContextSwitch*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileContextSwitch) * MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE);
+		D.ContextSwitch = W.ContextSwitch;
+		MicroProfileDumpCopyRing(D.ContextSwitch, S.ContextSwitch, sizeof(MicroProfileContextSwitch), nContextSwitchStart,
+			(nContextSwitchPut + MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE - nContextSwitchStart) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE, MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE);
+	}
+#endif
 }
 
-void MicroProfilePrintString(MicroProfileWriteCallback CB, void* Handle, const char* pData)
-{
-	CB(Handle, strlen(pData), pData);
-}
 
-void MicroProfileDumpCsv(MicroProfileWriteCallback CB, void* Handle, int nMaxFrames)
+//buffers the many small writes of a dump into large blocks. paths ending in .gz are written as gzip when miniz is available
+struct MicroProfileDumpFileOutput
 {
-	(void)nMaxFrames;
-
-	uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
-	float fToMsCPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
-	float fToMsGPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondGpu());
-
-	MicroProfilePrintf(CB, Handle, "frames,%d\n", nAggregateFrames);
-	MicroProfilePrintf(CB, Handle, "group,name,average,max,callaverage\n");
-
-	uint32_t nNumTimers = S.nTotalTimers;
-	uint32_t nBlockSize = 2 * nNumTimers;
-	float* pTimers = (float*)alloca(nBlockSize * 9 * sizeof(float));
-	float* pAverage = pTimers + nBlockSize;
-	float* pMax = pTimers + 2 * nBlockSize;
-	float* pMin = pTimers + 3 * nBlockSize;
-	float* pCallAverage = pTimers + 4 * nBlockSize;
-	float* pTimersExclusive = pTimers + 5 * nBlockSize;
-	float* pAverageExclusive = pTimers + 6 * nBlockSize;
-	float* pMaxExclusive = pTimers + 7 * nBlockSize;
-	float* pTotal = pTimers + 8 * nBlockSize;
+	FILE* F;
+	char* pBuffer;
+	uint32_t nBuffered;
+#if MICROPROFILE_MINIZ
+	bool bCompress;
+	mz_stream Stream;
+	mz_ulong nCrc;
+	uint32_t nSize;
+#endif
+};
 
-	MicroProfileCalcAllTimers(pTimers, pAverage, pMax, pMin, pCallAverage, pTimersExclusive, pAverageExclusive, pMaxExclusive, pTotal, nNumTimers);
+void MicroProfileDumpFileFlush(MicroProfileDumpFileOutput& O, bool bFinish)
+{
+#if MICROPROFILE_MINIZ
+	if(O.bCompress)
+	{
+		mz_stream& Stream = O.Stream;
+		unsigned char* pOut = (unsigned char*)O.pBuffer + MICROPROFILE_DUMP_FILE_BUFFER_SIZE;
+		O.nCrc = mz_crc32(O.nCrc, (const unsigned char*)O.pBuffer, O.nBuffered);
+		O.nSize += O.nBuffered;
+		Stream.next_in = (const unsigned char*)O.pBuffer;
+		Stream.avail_in = O.nBuffered;
+		do
+		{
+			Stream.next_out = pOut;
+			Stream.avail_out = MICROPROFILE_DUMP_FILE_BUFFER_SIZE;
+			int r = mz_deflate(&Stream, bFinish ? MZ_FINISH : MZ_NO_FLUSH);
+			MP_ASSERT(r == MZ_OK || r == MZ_STREAM_END || r == MZ_BUF_ERROR);
+			(void)r;
+			fwrite(pOut, MICROPROFILE_DUMP_FILE_BUFFER_SIZE - Stream.avail_out, 1, O.F);
+		}while(Stream.avail_out == 0);
+		O.nBuffered = 0;
+		return;
+	}
+#endif
+	(void)bFinish;
+	fwrite(O.pBuffer, O.nBuffered, 1, O.F);
+	O.nBuffered = 0;
+}
 
-	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+void MicroProfileDumpFileWrite(void* Handle, size_t nSize, const char* pData)
+{
+	MicroProfileDumpFileOutput& O = *(MicroProfileDumpFileOutput*)Handle;
+	while(nSize)
 	{
-		uint32_t nIdx = i * 2;
-		MicroProfilePrintf(CB, Handle, "\"%s\",\"%s\",%f,%f,%f\n", S.TimerInfo[i].pName, S.GroupInfo[S.TimerInfo[i].nGroupIndex].pName, pAverage[nIdx], pMax[nIdx], pCallAverage[nIdx]);
+		uint32_t nCopy = (uint32_t)MicroProfileMin(nSize, (size_t)(MICROPROFILE_DUMP_FILE_BUFFER_SIZE - O.nBuffered));
+		memcpy(O.pBuffer + O.nBuffered, pData, nCopy);
+		O.nBuffered += nCopy;
+		pData += nCopy;
+		nSize -= nCopy;
+		if(O.nBuffered == MICROPROFILE_DUMP_FILE_BUFFER_SIZE)
+			MicroProfileDumpFileFlush(O, false);
 	}
+}
 
-	MicroProfilePrintf(CB, Handle, "\n\n");
+void MicroProfileDumpFileOpen(MicroProfileDumpFileOutput& O, FILE* F, const char* pPath)
+{
+	O.F = F;
+	O.nBuffered = 0;
+	setvbuf(F, 0, _IONBF, 0); //blocks go straight to the file
+#if MICROPROFILE_MINIZ
+	size_t nLen = strlen(pPath);
+	O.bCompress = nLen > 3 && 0 == strcmp(pPath + nLen - 3, ".gz");
+	O.pBuffer = new char[O.bCompress ? 2 * MICROPROFILE_DUMP_FILE_BUFFER_SIZE : MICROPROFILE_DUMP_FILE_BUFFER_SIZE];
+	if(O.bCompress)
+	{
+		//raw deflate between a gzip header and trailer
+		static const unsigned char Header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+		fwrite(Header, sizeof(Header), 1, F);
+		memset(&O.Stream, 0, sizeof(O.Stream));
+		int r = mz_deflateInit2(&O.Stream, MZ_DEFAULT_COMPRESSION, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY);
+		MP_ASSERT(r == MZ_OK);
+		(void)r;
+		O.nCrc = MZ_CRC32_INIT;
+		O.nSize = 0;
+	}
+#else
+	(void)pPath;
+	O.pBuffer = new char[MICROPROFILE_DUMP_FILE_BUFFER_SIZE];
+#endif
+}
 
-	MicroProfilePrintf(CB, Handle, "group,average,max,total\n");
-	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
+void MicroProfileDumpFileClose(MicroProfileDumpFileOutput& O)
+{
+	MicroProfileDumpFileFlush(O, true);
+#if MICROPROFILE_MINIZ
+	if(O.bCompress)
 	{
-		const char* pGroupName = S.GroupInfo[j].pName;
-		float fToMs =  S.GroupInfo[j].Type == MicroProfileTokenTypeGpu ? fToMsGPU : fToMsCPU;
-		if(pGroupName[0] != '\0')
+		mz_deflateEnd(&O.Stream);
+		unsigned char Trailer[8];
+		for(uint32_t i = 0; i < 4; ++i)
 		{
-			MicroProfilePrintf(CB, Handle, "\"%s\",%.3f,%.3f,%.3f\n", pGroupName, fToMs * S.AggregateGroup[j] / nAggregateFrames, fToMs * S.AggregateGroup[j] / nAggregateFrames, fToMs * S.AggregateGroup[j]);
+			Trailer[i] = (unsigned char)(O.nCrc >> (8 * i));
+			Trailer[4 + i] = (unsigned char)(O.nSize >> (8 * i));
 		}
+		fwrite(Trailer, sizeof(Trailer), 1, O.F);
 	}
+#endif
+	delete[] O.pBuffer;
+}
 
-	MicroProfilePrintf(CB, Handle, "\n\n");
-	MicroProfilePrintf(CB, Handle, "group,thread,average,total\n");
-	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
+void* MicroProfileDumpFileThread(void*)
+{
+	MicroProfileDumpWriter& W = *S.pDumpWriter;
+	MicroProfileSetDumpState(W.pState);
+	FILE* F = fopen(W.Path, "wb");
+	if(F)
 	{
-		for(uint32_t i = 0; i < S.nNumLogs; ++i)
-		{
-			if(S.Pool[i])
-			{
-				const char* pThreadName = &S.Pool[i]->ThreadName[0];
-				// MicroProfilePrintf(CB, Handle, "var ThreadGroupTime%d = [", i);
-				float fToMs = S.Pool[i]->nGpu ? fToMsGPU : fToMsCPU;
-				{
-					uint64_t nTicks = S.Pool[i]->nAggregateGroupTicks[j];
-					float fTime = nTicks / nAggregateFrames * fToMs;
-					float fTimeTotal = nTicks * fToMs;
-					if(fTimeTotal > 0.01f)
-					{
-						const char* pGroupName = S.GroupInfo[j].pName;
-						MicroProfilePrintf(CB, Handle, "\"%s\",\"%s\",%.3f,%.3f\n", pGroupName, pThreadName, fTime, fTimeTotal);
-					}
-				}
-			}
-		}
+		MicroProfileDumpFileOutput O;
+		MicroProfileDumpFileOpen(O, F, W.Path);
+		if(W.eType == MicroProfileDumpTypeHtml)
+			MicroProfileDumpHtml(MicroProfileDumpFileWrite, &O, W.nFrames, 0);
+		else if(W.eType == MicroProfileDumpTypeCsv)
+			MicroProfileDumpCsv(MicroProfileDumpFileWrite, &O, W.nFrames);
+		MicroProfileDumpFileClose(O);
+		fclose(F);
 	}
+	MicroProfileSetDumpState(0);
+	if(MicroProfileGetThreadLog())
+		MicroProfileOnThreadExit(); //timers entered by the dump gave this thread a log
+	W.nDone.store(1, std::memory_order_release);
+	return 0;
+}
 
-	MicroProfilePrintf(CB, Handle, "\n\n");
-	MicroProfilePrintf(CB, Handle, "frametimecpu\n");
+//waits for the dump being written to finish
+void MicroProfileDumpFileEnd()
+{
+	MicroProfileDumpWriter* pWriter = S.pDumpWriter;
+	if(!pWriter || !pWriter->bThread)
+		return;
+	MicroProfileThreadJoin(&pWriter->Thread);
+	pWriter->bThread = 0;
+}
 
-	const uint32_t nCount = MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 3;
-	const uint32_t nStart = S.nFrameCurrent;
-	for(uint32_t i = nCount; i > 0; i--)
+//called by flip. copies what the requested dump reads and starts a thread writing it, false while the previous dump is still being written
+bool MicroProfileDumpFileStart()
+{
+	MicroProfileDumpWriter* pWriter = S.pDumpWriter;
+	if(pWriter && pWriter->bThread && !pWriter->nDone.load(std::memory_order_acquire))
+		return false;
+	MicroProfileDumpFileEnd();
+	MICROPROFILE_SCOPE(g_MicroProfileDumpSnapshot);
+	if(!pWriter)
+	{
+		pWriter = new MicroProfileDumpWriter();
+		S.pDumpWriter = pWriter;
+	}
+	pWriter->eType = S.eDumpType;
+	pWriter->nFrames = S.nDumpFrames;
+	memcpy(pWriter->Path, S.DumpPath, sizeof(pWriter->Path));
+	MicroProfileDumpSnapshot(*pWriter, S.nDumpFrames, S.eDumpType == MicroProfileDumpTypeHtml);
+	pWriter->nDone.store(0);
+	pWriter->bThread = 1;
+	MicroProfileThreadStart(&pWriter->Thread, MicroProfileDumpFileThread);
+	return true;
+}
+
+//writes a dump that is requested or still being written, then frees the writer. registered with atexit by init,
+//as threads still writing at exit are killed with the process
+void MicroProfileDumpFileDrain()
+{
+	MicroProfileDumpFileEnd(); //not locked, the writer thread takes the lock when it exits
+	if(S.nDumpFileNextFrame)
 	{
-		uint32_t nFrame = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i) % MICROPROFILE_MAX_FRAME_HISTORY;
-		uint32_t nFrameNext = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
-		uint64_t nTicks = S.Frames[nFrameNext].nFrameStartCpu - S.Frames[nFrame].nFrameStartCpu;
-		MicroProfilePrintf(CB, Handle, "%f,", nTicks * fToMsCPU);
+		std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+		if(MicroProfileDumpFileStart())
+			S.nDumpFileNextFrame = 0;
 	}
-	MicroProfilePrintf(CB, Handle, "\n");
+	MicroProfileDumpFileEnd();
+	MicroProfileDumpWriter* pWriter = S.pDumpWriter;
+	if(!pWriter)
+		return;
+	S.pDumpWriter = 0;
+	for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
+	{
+		MicroProfileDumpLogCopy& C = pWriter->Logs[i];
+		delete[] C.pBuffer;
+		delete[] C.pLabelBuffer;
+		delete C.pLog;
+	}
+	if(pWriter->ContextSwitch)
+		MICROPROFILE_FREE_PAGES(pWriter->ContextSwitch, sizeof(MicroProfileContextSwitch) * MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE);
+	if(pWriter->pState)
+		MICROPROFILE_FREE_PAGES(pWriter->pState, sizeof(MicroProfile));
+	delete pWriter;
+}
 
-	MicroProfilePrintf(CB, Handle, "\n\n");
-	MicroProfilePrintf(CB, Handle, "frametimegpu\n");
+#if MICROPROFILE_FLIGHT_RECORDER || MICROPROFILE_CRASH_DUMP
+#if defined(__APPLE__) || defined(__linux__)
+#include <fcntl.h>
+#endif
 
-	for(uint32_t i = nCount; i > 0; i--)
+//fnv-1a over the payload, lets a reader reject chunks torn by a crash
+uint32_t MicroProfileFlightHash(const void* pData, uint32_t nSize, uint32_t nHash = MP_FLIGHT_HASH_SEED)
+{
+	const uint8_t* p = (const uint8_t*)pData;
+	for(uint32_t i = 0; i < nSize; ++i)
 	{
-		uint32_t nFrame = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i) % MICROPROFILE_MAX_FRAME_HISTORY;
-		uint32_t nFrameNext = (nStart + MICROPROFILE_MAX_FRAME_HISTORY - i + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
-		uint64_t nTicks = S.Frames[nFrameNext].nFrameStartGpu - S.Frames[nFrame].nFrameStartGpu;
-		MicroProfilePrintf(CB, Handle, "%f,", nTicks * fToMsGPU);
+		nHash = (nHash ^ p[i]) * 16777619u;
 	}
-	MicroProfilePrintf(CB, Handle, "\n\n");
-	MicroProfilePrintf(CB, Handle, "Meta\n");//only single frame snapshot
-	MicroProfilePrintf(CB, Handle, "name,average,max,total\n");
-	for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+	return nHash;
+}
+
+inline uint32_t MicroProfileFlightChunkBytes(uint32_t nSize)
+{
+	return (uint32_t)((sizeof(MicroProfileFlightChunk) + nSize + 7) & ~7);
+}
+
+//converts a log entry to a recorded event, false for entries that are not recorded. signal safe lookups keep the format of deferred labels
+bool MicroProfileFlightEventFromLog(MicroProfileLogEntry LE, int64_t nTickStart, bool bSignalSafe, MicroProfileFlightEvent* pEvent, const char** ppLabel)
+{
+	uint64_t nType = MicroProfileLogType(LE);
+	uint64_t nIndex = MicroProfileLogTimerIndex(LE);
+	int64_t nValue = MicroProfileLogGetTick(LE);
+	*ppLabel = 0;
+	if(nType == MP_LOG_META || nType == MP_LOG_GPU_EXTRA)
 	{
-		if(S.MetaCounters[j].pName)
-		{
-			MicroProfilePrintf(CB, Handle, "\"%s\",%f,%lld,%lld\n",S.MetaCounters[j].pName, S.MetaCounters[j].nSumAggregate / (float)nAggregateFrames, (long long)S.MetaCounters[j].nSumAggregateMax, (long long)S.MetaCounters[j].nSumAggregate);
-		}
+		return false;
+	}
+	else if(nType == MP_LOG_LABEL)
+	{
+		const char* pLabel = bSignalSafe ? MicroProfileGetLabelRaw(g_MicroProfile, nValue) : MicroProfileGetLabel(nValue);
+		if(pLabel && *pLabel == MICROPROFILE_LABEL_DEFERRED_MARKER)
+			memcpy(&pLabel, pLabel + 1, sizeof(pLabel));
+		*ppLabel = pLabel;
+		nValue = pLabel ? (int64_t)strlen(pLabel) : 0;
 	}
+	else if(nType != MP_LOG_EXTENDED || nIndex != MP_LOG_EXTENDED_PAYLOAD)
+	{
+		nValue = nTickStart + MicroProfileLogTickDifference(nTickStart, nValue);
+	}
+	pEvent->nValue = nValue;
+	pEvent->nIndex = (uint32_t)nIndex;
+	pEvent->nType = (uint16_t)nType;
+	pEvent->nCpu = (uint16_t)MicroProfileLogCpu(LE);
+	return true;
 }
+#endif
 
-#if MICROPROFILE_EMBED_HTML
-extern const char* g_MicroProfileHtml_begin[];
-extern size_t g_MicroProfileHtml_begin_sizes[];
-extern size_t g_MicroProfileHtml_begin_count;
-extern const char* g_MicroProfileHtml_end[];
-extern size_t g_MicroProfileHtml_end_sizes[];
-extern size_t g_MicroProfileHtml_end_count;
+#if MICROPROFILE_FLIGHT_RECORDER
 
+//staging ring positions count bytes and never wrap, the ring offset is the position modulo the size
+void MicroProfileFlightStageCopyIn(MicroProfileFlightRecorder& R, uint64_t nPos, const void* pData, uint32_t nSize)
+{
+	uint32_t nOffset = (uint32_t)(nPos % R.nStageSize);
+	uint32_t nFirst = MicroProfileMin(nSize, R.nStageSize - nOffset);
+	memcpy(R.pStage + nOffset, pData, nFirst);
+	memcpy(R.pStage, (const char*)pData + nFirst, nSize - nFirst);
+}
 
-void MicroProfileDumpHtml(MicroProfileWriteCallback CB, void* Handle, int nMaxFrames, const char* pHost)
+void MicroProfileFlightStageCopyOut(const MicroProfileFlightRecorder& R, uint64_t nPos, void* pData, uint32_t nSize)
 {
-	uint32_t nRunning = S.nRunning;
-	S.nRunning = 0;
-	//stall pushing of timers
-	uint64_t nActiveGroup = S.nActiveGroup;
-	S.nActiveGroup = 0;
-	S.nPauseTicks = MP_TICK();
+	uint32_t nOffset = (uint32_t)(nPos % R.nStageSize);
+	uint32_t nFirst = MicroProfileMin(nSize, R.nStageSize - nOffset);
+	memcpy(pData, R.pStage + nOffset, nFirst);
+	memcpy((char*)pData + nFirst, R.pStage, nSize - nFirst);
+}
 
+//builds one chunk in the staging ring. when it runs into the recorder thread the chunk is abandoned, flip never waits
+struct MicroProfileFlightStageWriter
+{
+	MicroProfileFlightRecorder* pRecorder;
+	uint64_t nChunk;
+	uint64_t nPos;
+	uint64_t nLimit;
+	bool bFull;
+};
 
-	for(size_t i = 0; i < g_MicroProfileHtml_begin_count; ++i)
+void MicroProfileFlightStagePut(MicroProfileFlightStageWriter& W, const void* pData, uint32_t nSize)
+{
+	if(W.bFull || W.nPos + nSize > W.nLimit)
 	{
-		CB(Handle, g_MicroProfileHtml_begin_sizes[i]-1, g_MicroProfileHtml_begin[i]);
+		W.bFull = true;
+		return;
 	}
-	//dump info
-	uint64_t nTicks = MP_TICK();
+	MicroProfileFlightStageCopyIn(*W.pRecorder, W.nPos, pData, nSize);
+	W.nPos += nSize;
+}
 
-	float fToMsCPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
-	float fToMsGPU = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondGpu());
-	float fAggregateMs = fToMsCPU * (nTicks - S.nAggregateFlipTick);
-	MicroProfilePrintf(CB, Handle, "var DumpHost = '%s';\n", pHost ? pHost : "");
-	time_t CaptureTime;
-	time(&CaptureTime);
-	MicroProfilePrintf(CB, Handle, "var DumpUtcCaptureTime = %ld;\n", CaptureTime);
-	MicroProfilePrintf(CB, Handle, "var AggregateInfo = {'Frames':%d, 'Time':%f};\n", S.nAggregateFrames, fAggregateMs);
+MicroProfileFlightStageWriter MicroProfileFlightStageBegin(MicroProfileFlightRecorder& R)
+{
+	MicroProfileFlightStageWriter W;
+	W.pRecorder = &R;
+	W.nChunk = R.nStagePut.load(std::memory_order_relaxed);
+	W.nPos = W.nChunk + sizeof(MicroProfileFlightChunk);
+	W.nLimit = R.nStageGet.load(std::memory_order_acquire) + R.nStageSize;
+	W.bFull = W.nPos > W.nLimit;
+	return W;
+}
 
-	//categories
-	MicroProfilePrintf(CB, Handle, "var CategoryInfo = Array(%d);\n",S.nCategoryCount);
-	for(uint32_t i = 0; i < S.nCategoryCount; ++i)
-	{
-		MicroProfilePrintf(CB, Handle, "CategoryInfo[%d] = \"%s\";\n", i, S.CategoryInfo[i].pName);
-	}
+bool MicroProfileFlightStageEnd(MicroProfileFlightStageWriter& W, uint32_t nType)
+{
+	if(W.bFull)
+		return false;
+	MicroProfileFlightChunk C;
+	C.nMagic = MP_FLIGHT_CHUNK_MAGIC;
+	C.nType = nType;
+	C.nSize = (uint32_t)(W.nPos - W.nChunk - sizeof(C));
+	C.nHash = 0; //hash and sequence are filled in by the recorder thread
+	C.nSeq = 0;
+	MicroProfileFlightStageCopyIn(*W.pRecorder, W.nChunk, &C, sizeof(C));
+	W.pRecorder->nStagePut.store(W.nPos, std::memory_order_release);
+	return true;
+}
 
-	//groups
-	MicroProfilePrintf(CB, Handle, "var GroupInfo = Array(%d);\n\n",S.nGroupCount);
-	uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
+void MicroProfileFlightStageString(MicroProfileFlightStageWriter& W, const char* pString)
+{
+	MicroProfileFlightStagePut(W, pString, (uint32_t)strlen(pString));
+}
 
-	for(uint32_t i = 0; i < S.nGroupCount; ++i)
+//groups and timers are append only and queued once. counters are queued again when their configuration changes
+void MicroProfileFlightRecorderStageMeta(MicroProfileFlightRecorder& R)
+{
+	while(R.nGroups < S.nGroupCount)
 	{
-		MP_ASSERT(i == S.GroupInfo[i].nGroupIndex);
-		float fToMs = S.GroupInfo[i].Type == MicroProfileTokenTypeCpu ? fToMsCPU : fToMsGPU;
-		uint32_t nColor = S.TimerInfo[i].nColor;
-		MicroProfilePrintf(CB, Handle, "GroupInfo[%d] = MakeGroup(%d, \"%s\", %d, %d, %d, %f, %f, %f, '#%06x');\n", 
-			S.GroupInfo[i].nGroupIndex, 
-			S.GroupInfo[i].nGroupIndex, 
-			S.GroupInfo[i].pName, 
-			S.GroupInfo[i].nCategory, 
-			S.GroupInfo[i].nNumTimers, 
-			S.GroupInfo[i].Type == MicroProfileTokenTypeGpu?1:0, 
-			fToMs * S.AggregateGroup[i], 
-			fToMs * S.AggregateGroup[i] / nAggregateFrames, 
-			fToMs * S.AggregateGroupMax[i],
-			((MICROPROFILE_UNPACK_RED(nColor) & 0xff) << 16) | ((MICROPROFILE_UNPACK_GREEN(nColor) & 0xff) << 8) | (MICROPROFILE_UNPACK_BLUE(nColor) & 0xff));
+		const MicroProfileGroupInfo& G = S.GroupInfo[R.nGroups];
+		MicroProfileFlightGroup Group = { R.nGroups, (uint32_t)G.Type, G.nColor, 0 };
+		MicroProfileFlightStageWriter W = MicroProfileFlightStageBegin(R);
+		MicroProfileFlightStagePut(W, &Group, sizeof(Group));
+		MicroProfileFlightStageString(W, G.pName);
+		if(!MicroProfileFlightStageEnd(W, MP_FLIGHT_CHUNK_GROUP))
+			return;
+		R.nGroups++;
 	}
-	//timers
+	while(R.nTimers < S.nTotalTimers)
+	{
+		const MicroProfileTimerInfo& T = S.TimerInfo[R.nTimers];
+		MicroProfileFlightTimer Timer = { R.nTimers, T.nGroupIndex, T.nColor, 0 };
+		MicroProfileFlightStageWriter W = MicroProfileFlightStageBegin(R);
+		MicroProfileFlightStagePut(W, &Timer, sizeof(Timer));
+		MicroProfileFlightStageString(W, T.pName);
+		if(!MicroProfileFlightStageEnd(W, MP_FLIGHT_CHUNK_TIMER))
+			return;
+		R.nTimers++;
+	}
+	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+	{
+		const MicroProfileCounterInfo& CI = S.CounterInfo[i];
+		if(i < R.nCounters && R.nCounterFormat[i] == (uint32_t)CI.eFormat && R.nCounterFlags[i] == CI.nFlags && R.nCounterLimit[i] == CI.nLimit)
+			continue;
+		MicroProfileFlightCounter Counter = { i, CI.nParent, (uint32_t)CI.eFormat, CI.nFlags, CI.nLimit };
+		MicroProfileFlightStageWriter W = MicroProfileFlightStageBegin(R);
+		MicroProfileFlightStagePut(W, &Counter, sizeof(Counter));
+		MicroProfileFlightStageString(W, CI.pName);
+		if(!MicroProfileFlightStageEnd(W, MP_FLIGHT_CHUNK_COUNTER))
+			return;
+		R.nCounterFormat[i] = (uint32_t)CI.eFormat;
+		R.nCounterFlags[i] = CI.nFlags;
+		R.nCounterLimit[i] = CI.nLimit;
+		R.nCounters = MicroProfileMax(R.nCounters, i + 1);
+	}
+}
 
-	uint32_t nNumTimers = S.nTotalTimers;
-	uint32_t nBlockSize = 2 * nNumTimers;
-	float* pTimers = (float*)alloca(nBlockSize * 9 * sizeof(float));
-	float* pAverage = pTimers + nBlockSize;
-	float* pMax = pTimers + 2 * nBlockSize;
-	float* pMin = pTimers + 3 * nBlockSize;
-	float* pCallAverage = pTimers + 4 * nBlockSize;
-	float* pTimersExclusive = pTimers + 5 * nBlockSize;
-	float* pAverageExclusive = pTimers + 6 * nBlockSize;
-	float* pMaxExclusive = pTimers + 7 * nBlockSize;
-	float* pTotal = pTimers + 8 * nBlockSize;
+//called by flip with the frame it just processed. copies the frame to the staging ring, the file is written by the recorder thread
+void MicroProfileFlightRecorderFrame(uint32_t nFrame, uint32_t nFrameNext)
+{
+	MICROPROFILE_SCOPE(g_MicroProfileFlightRecorder);
+	MicroProfileFlightRecorder& R = *S.pFlightRecorder;
+	MicroProfileFlightRecorderStageMeta(R);
 
-	MicroProfileCalcAllTimers(pTimers, pAverage, pMax, pMin, pCallAverage, pTimersExclusive, pAverageExclusive, pMaxExclusive, pTotal, nNumTimers);
+	MicroProfileFlightFrame F;
+	memset(&F, 0, sizeof(F));
+	F.nFrameIndex = S.nFrameCurrentIndex;
+	F.nTickStart = S.Frames[nFrame].nFrameStartCpu;
+	F.nTickEnd = S.Frames[nFrameNext].nFrameStartCpu;
+	F.nDroppedFrames = R.nDroppedFrames;
 
-	MicroProfilePrintf(CB, Handle, "\nvar TimerInfo = Array(%d);\n\n", S.nTotalTimers);
-	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	MicroProfileFlightStageWriter W = MicroProfileFlightStageBegin(R);
+	uint64_t nFramePos = W.nPos;
+	MicroProfileFlightStagePut(W, &F, sizeof(F));
+	for(uint32_t i = 0; i < S.nNumLogs && !W.bFull; ++i)
 	{
-		uint32_t nIdx = i * 2;
-		MP_ASSERT(i == S.TimerInfo[i].nTimerIndex);
-
-		uint32_t nColor = S.TimerInfo[i].nColor;
-		uint32_t nColorDark = (nColor >> 1) & ~0x80808080;
-		MicroProfilePrintf(CB, Handle, "TimerInfo[%d] = MakeTimer(%d, \"%s\", %d, '#%06x','#%06x', %f, %f, %f, %f, %f, %f, %d, %f,\n",
-			S.TimerInfo[i].nTimerIndex, S.TimerInfo[i].nTimerIndex, S.TimerInfo[i].pName, S.TimerInfo[i].nGroupIndex, 
-			((MICROPROFILE_UNPACK_RED(nColor) & 0xff) << 16) | ((MICROPROFILE_UNPACK_GREEN(nColor) & 0xff) << 8) | (MICROPROFILE_UNPACK_BLUE(nColor) & 0xff),
-			((MICROPROFILE_UNPACK_RED(nColorDark) & 0xff) << 16) | ((MICROPROFILE_UNPACK_GREEN(nColorDark) & 0xff) << 8) | (MICROPROFILE_UNPACK_BLUE(nColorDark) & 0xff),
-			pAverage[nIdx],
-			pMax[nIdx],
-			pMin[nIdx],
-			pAverageExclusive[nIdx],
-			pMaxExclusive[nIdx],
-			pCallAverage[nIdx],
-			S.Aggregate[i].nCount,
-			pTotal[nIdx]);
-
-		MicroProfilePrintString(CB, Handle, "\t[");
-		for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
-		{
-			if(S.MetaCounters[j].pName)
-			{
-				MicroProfilePrintUIntComma(CB, Handle, S.MetaCounters[j].nCounters[i]);
-			}
-		}
-		MicroProfilePrintString(CB, Handle, "],[");
-		for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		uint32_t nEnd = S.Frames[nFrameNext].nLogStart[i];
+		if(!pLog || pLog->nGpu || !pLog->Log || S.Frames[nFrame].nLogStart[i] == nEnd)
+			continue;
+		MicroProfileFlightThread T;
+		memset(&T, 0, sizeof(T));
+		T.nThreadId = (uint64_t)pLog->nThreadId;
+		T.nLogIndex = i;
+		T.nFiber = pLog->nFiber;
+		memcpy(T.Name, pLog->ThreadName, sizeof(T.Name) - 1);
+		uint64_t nThreadPos = W.nPos;
+		MicroProfileFlightStagePut(W, &T, sizeof(T));
+		for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nFrame, nEnd); MicroProfileLogNext(It) && !W.bFull;)
 		{
-			if(S.MetaCounters[j].pName)
-			{
-				MicroProfilePrintUIntComma(CB, Handle, S.MetaCounters[j].nAggregate[i]);
-			}
+			MicroProfileFlightEvent E;
+			const char* pLabel;
+			if(!MicroProfileFlightEventFromLog(It.LE, F.nTickStart, false, &E, &pLabel))
+				continue;
+			MicroProfileFlightStagePut(W, &E, sizeof(E));
+			if(pLabel)
+				MicroProfileFlightStagePut(W, pLabel, (uint32_t)E.nValue);
+			T.nNumEvents++;
 		}
-		MicroProfilePrintString(CB, Handle, "],[");
-		for(int j = 0; j < MICROPROFILE_META_MAX; ++j)
+		if(!W.bFull)
+			MicroProfileFlightStageCopyIn(R, nThreadPos, &T, sizeof(T));
+		F.nNumThreads++;
+	}
+	if(S.ContextSwitch)
+	{
+		uint32_t nPut = S.nContextSwitchPut;
+		for(uint32_t j = R.nContextSwitchGet; j != nPut && !W.bFull; j = (j + 1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE)
 		{
-			if(S.MetaCounters[j].pName)
-			{
-				MicroProfilePrintUIntComma(CB, Handle, S.MetaCounters[j].nAggregateMax[i]);
-			}
+			const MicroProfileContextSwitch& CS = S.ContextSwitch[j];
+			MicroProfileFlightContextSwitch C = { CS.nTicks, (uint64_t)CS.nThreadIn, (uint64_t)CS.nThreadOut, (uint64_t)CS.nProcessIn, (uint32_t)CS.nCpu, 0 };
+			MicroProfileFlightStagePut(W, &C, sizeof(C));
+			F.nNumContextSwitches++;
 		}
-		MicroProfilePrintString(CB, Handle, "]);\n");
+		R.nContextSwitchGet = nPut;
+	}
+	F.nNumCounters = S.nNumCounters;
+	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+	{
+		int64_t nValue = MicroProfileCounterValue(i);
+		MicroProfileFlightStagePut(W, &nValue, sizeof(nValue));
 	}
+	if(!W.bFull)
+		MicroProfileFlightStageCopyIn(R, nFramePos, &F, sizeof(F));
+	if(!MicroProfileFlightStageEnd(W, MP_FLIGHT_CHUNK_FRAME))
+		R.nDroppedFrames++;
+}
 
-	MicroProfilePrintString(CB, Handle, "\nvar ThreadNames = [");
-	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+//copies a staged chunk to the file, payload first so the header only becomes valid once the chunk is complete
+void MicroProfileFlightWriteChunk(MicroProfileFlightRecorder& R, char* pDest, MicroProfileFlightChunk C, uint64_t nPayload, uint64_t nSeq)
+{
+	MicroProfileFlightStageCopyOut(R, nPayload, pDest + sizeof(C), C.nSize);
+	C.nHash = MicroProfileFlightHash(pDest + sizeof(C), C.nSize);
+	C.nSeq = nSeq;
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(pDest, &C, sizeof(C));
+}
+
+void MicroProfileFlightAppendMeta(MicroProfileFlightRecorder& R, const MicroProfileFlightChunk& C, uint64_t nPayload)
+{
+	MicroProfileFlightHeader* H = R.pHeader;
+	uint32_t nBytes = MicroProfileFlightChunkBytes(C.nSize);
+	if(H->nMetaBytes + nBytes > H->nMetaSize)
 	{
-		if(S.Pool[i])
-		{
-			MicroProfilePrintf(CB, Handle, "'%s',", S.Pool[i]->ThreadName);
-		}
-		else
-		{
-			MicroProfilePrintf(CB, Handle, "'Thread %d',", i);
-		}
+		H->nFlags |= MP_FLIGHT_FLAG_META_FULL;
+		return;
 	}
-	MicroProfilePrintString(CB, Handle, "];\n\n");
+	MicroProfileFlightWriteChunk(R, R.pFile + H->nMetaOffset + H->nMetaBytes, C, nPayload, 0);
+	std::atomic_thread_fence(std::memory_order_release);
+	H->nMetaBytes += nBytes;
+}
 
+//the ring continues at the start after a wrap marker, or when there is no room left for a chunk header
+inline uint64_t MicroProfileFlightRingSkip(const char* pRing, uint64_t nRingSize, uint64_t nPos)
+{
+	if(nRingSize - nPos < sizeof(MicroProfileFlightChunk))
+		return 0;
+	MicroProfileFlightChunk C;
+	memcpy(&C, pRing + nPos, sizeof(C));
+	return C.nMagic == MP_FLIGHT_CHUNK_MAGIC && C.nType == MP_FLIGHT_CHUNK_WRAP ? 0 : nPos;
+}
 
-	MicroProfilePrintString(CB, Handle, "\nvar ThreadIds = [");
-	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+void MicroProfileFlightRingWrite(MicroProfileFlightRecorder& R, const MicroProfileFlightChunk& C, uint64_t nPayload)
+{
+	MicroProfileFlightHeader* H = R.pHeader;
+	char* pRing = R.pFile + H->nRingOffset;
+	uint64_t nRingSize = H->nRingSize;
+	uint64_t nBytes = MicroProfileFlightChunkBytes(C.nSize);
+	if(nBytes > nRingSize / 2)
 	{
-		MicroProfileThreadIdType nThreadId = S.Pool[i] ? S.Pool[i]->nThreadId : 0;
-		MicroProfilePrintUIntComma(CB, Handle, nThreadId);
+		H->nDroppedChunks++;
+		return;
 	}
-	MicroProfilePrintString(CB, Handle, "];\n\n");
+	uint64_t nHead = H->nHead;
+	uint64_t nTail = H->nTail;
+	uint64_t nPos = nHead + nBytes > nRingSize ? 0 : nHead;
 
-
-	MicroProfilePrintString(CB, Handle, "\nvar ThreadGpu = [");
-	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	//release the oldest chunks until the new one fits. wrapping also releases everything between the head and the end
+	uint64_t nSeqTail = H->nSeqTail;
+	bool bEmpty = nSeqTail == H->nSeqHead;
+	while(!bEmpty && ((nPos != nHead && nTail >= nHead) || (nTail >= nPos && nTail < nPos + nBytes)))
 	{
-		uint32_t nGpu = S.Pool[i] ? S.Pool[i]->nGpu : 0;
-		MicroProfilePrintUIntComma(CB, Handle, nGpu);
+		MicroProfileFlightChunk Tail;
+		memcpy(&Tail, pRing + nTail, sizeof(Tail));
+		nTail = MicroProfileFlightRingSkip(pRing, nRingSize, nTail + MicroProfileFlightChunkBytes(Tail.nSize));
+		bEmpty = ++nSeqTail == H->nSeqHead;
 	}
-	MicroProfilePrintString(CB, Handle, "];\n\n");
+	if(bEmpty)
+		nTail = nPos;
+	H->nTail = nTail;
+	H->nSeqTail = nSeqTail;
+	std::atomic_thread_fence(std::memory_order_release);
 
-
-	MicroProfilePrintString(CB, Handle, "\nvar ThreadGroupTimeArray = [\n");
-	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	if(nPos != nHead && nRingSize - nHead >= sizeof(MicroProfileFlightChunk))
 	{
-		if(S.Pool[i])
-		{
-			float fToMs = S.Pool[i]->nGpu ? fToMsGPU : fToMsCPU;
-			MicroProfilePrintf(CB, Handle, "MakeTimes(%e,[", fToMs);
-			for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
-			{
-				MicroProfilePrintUIntComma(CB, Handle, S.Pool[i]->nAggregateGroupTicks[j]);
-			}
-			MicroProfilePrintString(CB, Handle, "]),\n");
-		}
+		MicroProfileFlightChunk Wrap = { MP_FLIGHT_CHUNK_MAGIC, MP_FLIGHT_CHUNK_WRAP, 0, 0, 0 };
+		memcpy(pRing + nHead, &Wrap, sizeof(Wrap));
 	}
-	MicroProfilePrintString(CB, Handle, "];");
-
+	MicroProfileFlightWriteChunk(R, pRing + nPos, C, nPayload, H->nSeqHead);
+	std::atomic_thread_fence(std::memory_order_release);
+	H->nHead = nPos + nBytes;
+	H->nSeqHead++;
+}
 
-	MicroProfilePrintString(CB, Handle, "\nvar MetaNames = [");
-	for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
+bool MicroProfileFlightRecorderDrain(MicroProfileFlightRecorder& R)
+{
+	uint64_t nGet = R.nStageGet.load(std::memory_order_relaxed);
+	uint64_t nPut = R.nStagePut.load(std::memory_order_acquire);
+	if(nGet == nPut)
+		return false;
+	while(nGet != nPut)
 	{
-		if(S.MetaCounters[i].pName)
-		{
-			MicroProfilePrintf(CB, Handle, "'%s',", S.MetaCounters[i].pName);
-		}
+		MicroProfileFlightChunk C;
+		MicroProfileFlightStageCopyOut(R, nGet, &C, sizeof(C));
+		if(C.nType == MP_FLIGHT_CHUNK_FRAME)
+			MicroProfileFlightRingWrite(R, C, nGet + sizeof(C));
+		else
+			MicroProfileFlightAppendMeta(R, C, nGet + sizeof(C));
+		nGet += sizeof(C) + C.nSize;
+		R.nStageGet.store(nGet, std::memory_order_release);
 	}
-	MicroProfilePrintString(CB, Handle, "];\n\n");
+	return true;
+}
 
-	MicroProfilePrintString(CB, Handle, "\nvar CounterInfo = [");
-	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+void* MicroProfileFlightRecorderThread(void*)
+{
+	MicroProfileFlightRecorder& R = *S.pFlightRecorder;
+	while(!R.nStop.load(std::memory_order_acquire))
 	{
-		int64_t nCounter = S.Counters[i].load();
-		int64_t nLimit = S.CounterInfo[i].nLimit;
-		float fCounterPrc = 0.f;
-		float fBoxPrc = 1.f;
-		if(nLimit)
+		if(!MicroProfileFlightRecorderDrain(R))
 		{
-			fCounterPrc = (float)nCounter / nLimit;
-			if(fCounterPrc>1.f)
-			{
-				fBoxPrc = 1.f / fCounterPrc;
-				fCounterPrc = 1.f;
-			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
 		}
+	}
+	MicroProfileFlightRecorderDrain(R);
+	return 0;
+}
 
-		int64_t nCounterMin = 0, nCounterMax = 0;
-
-	#if MICROPROFILE_COUNTER_HISTORY
-		nCounterMin = S.nCounterMin[i];
-		nCounterMax = S.nCounterMax[i];
-	#endif
+bool MicroProfileFlightFileOpen(MicroProfileFlightRecorder& R, const char* pPath, uint64_t nSize)
+{
+#if defined(__APPLE__) || defined(__linux__)
+	int nFile = open(pPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(nFile < 0)
+		return false;
+	void* pFile = 0 == ftruncate(nFile, (off_t)nSize) ? mmap(0, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFile, 0) : MAP_FAILED;
+	if(pFile == MAP_FAILED)
+	{
+		close(nFile);
+		return false;
+	}
+	R.nFile = nFile;
+#elif defined(_WIN32)
+	HANDLE hFile = CreateFileA(pPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE hMapping = CreateFileMappingA(hFile, 0, PAGE_READWRITE, (DWORD)(nSize >> 32), (DWORD)nSize, 0);
+	void* pFile = hMapping ? MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, (size_t)nSize) : 0;
+	if(!pFile)
+	{
+		if(hMapping)
+			CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+	R.hFile = hFile;
+	R.hMapping = hMapping;
+#else
+	(void)R;
+	(void)pPath;
+	(void)nSize;
+	void* pFile = 0;
+	return false;
+#endif
+	R.pFile = (char*)pFile;
+	R.nFileSize = nSize;
+	R.pHeader = (MicroProfileFlightHeader*)pFile;
+	return true;
+}
 
-		char Formatted[64];
-		char FormattedLimit[64];
-		MicroProfileFormatCounter(S.CounterInfo[i].eFormat, nCounter, Formatted, sizeof(Formatted)-1);
-		MicroProfileFormatCounter(S.CounterInfo[i].eFormat, S.CounterInfo[i].nLimit, FormattedLimit, sizeof(FormattedLimit)-1);
-		MicroProfilePrintf(CB, Handle, "MakeCounter(%d, %d, %d, %d, %d, '%s', %lld, %lld, %lld, '%s', %lld, '%s', %d, %f, %f, [",
-			i,
-			S.CounterInfo[i].nParent,
-			S.CounterInfo[i].nSibling,
- 	 		S.CounterInfo[i].nFirstChild,
- 	 		S.CounterInfo[i].nLevel,
-			S.CounterInfo[i].pName,
-			(long long)nCounter,
-			(long long)nCounterMin,
-			(long long)nCounterMax,
-			Formatted,
-			(long long)nLimit,
-			FormattedLimit,
-			S.CounterInfo[i].eFormat == MICROPROFILE_COUNTER_FORMAT_BYTES ? 1 : 0, 
-			fCounterPrc,
-			fBoxPrc
-			);
+void MicroProfileFlightFileClose(MicroProfileFlightRecorder& R)
+{
+#if defined(__APPLE__) || defined(__linux__)
+	msync(R.pFile, R.nFileSize, MS_SYNC);
+	munmap(R.pFile, R.nFileSize);
+	close(R.nFile);
+#elif defined(_WIN32)
+	FlushViewOfFile(R.pFile, 0);
+	UnmapViewOfFile(R.pFile);
+	CloseHandle(R.hMapping);
+	CloseHandle(R.hFile);
+#endif
+}
 
-	#if MICROPROFILE_COUNTER_HISTORY
-		if(0 != (S.CounterInfo[i].nFlags & MICROPROFILE_COUNTER_FLAG_DETAILED))
-		{
-			uint32_t nBaseIndex = S.nCounterHistoryPut;
-			for(uint32_t j = 0; j < MICROPROFILE_GRAPH_HISTORY; ++j)
-			{
-				uint32_t nHistoryIndex = (nBaseIndex + j) % MICROPROFILE_GRAPH_HISTORY;
-				int64_t nValue = MicroProfileClamp(S.nCounterHistory[nHistoryIndex][i], nCounterMin, nCounterMax);
-				MicroProfilePrintUIntComma(CB, Handle, nValue - nCounterMin);
-			}
-		}
-	#endif
+bool MicroProfileFlightRecorderStart(const char* pPath, uint64_t nSize)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	if(S.pFlightRecorder)
+		return false;
+	uint64_t nMetaOffset = MP_FLIGHT_HEADER_SIZE;
+	uint64_t nRingOffset = nMetaOffset + MICROPROFILE_FLIGHT_RECORDER_META_SIZE;
+	nSize = MicroProfileMax(nSize ? nSize : (uint64_t)MICROPROFILE_FLIGHT_RECORDER_SIZE, nRingOffset + (1 << 20));
 
-		MicroProfilePrintString(CB, Handle, "]),\n");
+	MicroProfileFlightRecorder* pRecorder = new MicroProfileFlightRecorder();
+	if(!MicroProfileFlightFileOpen(*pRecorder, pPath, nSize))
+	{
+		delete pRecorder;
+		return false;
 	}
-	MicroProfilePrintString(CB, Handle, "];\n\n");
+	MicroProfileFlightHeader* H = pRecorder->pHeader;
+	H->nVersion = MP_FLIGHT_VERSION;
+	H->nFileSize = nSize;
+	H->nMetaOffset = nMetaOffset;
+	H->nMetaSize = MICROPROFILE_FLIGHT_RECORDER_META_SIZE;
+	H->nRingOffset = nRingOffset;
+	H->nRingSize = nSize - nRingOffset;
+	H->nTicksPerSecond = MicroProfileTicksPerSecondCpu();
+	H->nTickReference = MP_TICK();
+	H->nTimeReference = (int64_t)time(0);
+	std::atomic_thread_fence(std::memory_order_release);
+	H->nMagic = MP_FLIGHT_MAGIC;
+
+	pRecorder->nStageSize = MICROPROFILE_FLIGHT_RECORDER_STAGE_SIZE;
+	pRecorder->pStage = (char*)MICROPROFILE_ALLOC_PAGES(pRecorder->nStageSize);
+	pRecorder->nContextSwitchGet = S.nContextSwitchPut;
+	S.nMemUsage += sizeof(MicroProfileFlightRecorder) + pRecorder->nStageSize;
+	S.pFlightRecorder = pRecorder;
+	MicroProfileThreadStart(&pRecorder->Thread, MicroProfileFlightRecorderThread);
+	return true;
+}
 
+void MicroProfileFlightRecorderStop()
+{
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	MicroProfileFlightRecorder* pRecorder = S.pFlightRecorder;
+	if(!pRecorder)
+		return;
+	pRecorder->nStop.store(1, std::memory_order_release);
+	MicroProfileThreadJoin(&pRecorder->Thread);
+	MicroProfileFlightFileClose(*pRecorder);
+	MICROPROFILE_FREE_PAGES(pRecorder->pStage, pRecorder->nStageSize);
+	S.nMemUsage -= sizeof(MicroProfileFlightRecorder) + pRecorder->nStageSize;
+	S.pFlightRecorder = 0;
+	delete pRecorder;
+}
+
+//walks the valid frame chunks of a recording from the oldest, stopping at the first chunk that is torn, stale or not yet committed
+struct MicroProfileFlightRingIterator
+{
+	const char* pRing;
+	uint64_t nRingSize;
+	uint64_t nPos;
+	uint64_t nSeqBegin;
+	uint64_t nSeqEnd;
+	uint32_t nCount;
+	MicroProfileFlightChunk C;
+	const char* pPayload;
+};
 
-	uint32_t nNumFrames = (MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 3); //leave a few to not overwrite
-	nNumFrames = MicroProfileMin(nNumFrames, (uint32_t)nMaxFrames);
+MicroProfileFlightRingIterator MicroProfileFlightRingIterate(const char* pRing, const MicroProfileFlightHeader& H)
+{
+	MicroProfileFlightRingIterator It;
+	memset(&It, 0, sizeof(It));
+	It.pRing = pRing;
+	It.nRingSize = H.nRingSize;
+	It.nPos = H.nTail;
+	It.nSeqBegin = H.nSeqTail;
+	It.nSeqEnd = H.nSeqHead;
+	return It;
+}
 
+bool MicroProfileFlightRingNext(MicroProfileFlightRingIterator& It)
+{
+	uint64_t nSeq = It.C.nSeq;
+	if(It.nCount)
+		It.nPos += MicroProfileFlightChunkBytes(It.C.nSize);
+	if(It.nPos > It.nRingSize)
+		return false;
+	It.nPos = MicroProfileFlightRingSkip(It.pRing, It.nRingSize, It.nPos);
+	memcpy(&It.C, It.pRing + It.nPos, sizeof(It.C));
+	const char* pPayload = It.pRing + It.nPos + sizeof(It.C);
+	if(It.C.nMagic != MP_FLIGHT_CHUNK_MAGIC || It.C.nType != MP_FLIGHT_CHUNK_FRAME || It.C.nSize > It.nRingSize - It.nPos - sizeof(It.C))
+		return false;
+	if(It.C.nSeq < It.nSeqBegin || It.C.nSeq >= It.nSeqEnd || (It.nCount && It.C.nSeq != nSeq + 1))
+		return false;
+	if(It.C.nHash != MicroProfileFlightHash(pPayload, It.C.nSize))
+		return false;
+	It.pPayload = pPayload;
+	It.nCount++;
+	return true;
+}
 
-	uint32_t nFirstFrame = (S.nFrameCurrent + MICROPROFILE_MAX_FRAME_HISTORY - nNumFrames) % MICROPROFILE_MAX_FRAME_HISTORY;
-	uint32_t nLastFrame = (nFirstFrame + nNumFrames) % MICROPROFILE_MAX_FRAME_HISTORY;
-	MP_ASSERT(nLastFrame == (S.nFrameCurrent % MICROPROFILE_MAX_FRAME_HISTORY));
-	MP_ASSERT(nFirstFrame < MICROPROFILE_MAX_FRAME_HISTORY);
-	MP_ASSERT(nLastFrame  < MICROPROFILE_MAX_FRAME_HISTORY);
-	const int64_t nTickStart = S.Frames[nFirstFrame].nFrameStartCpu;
-	const int64_t nTickEnd = S.Frames[nLastFrame].nFrameStartCpu;
-	int64_t nTickStartGpu = S.Frames[nFirstFrame].nFrameStartGpu;
+//bounds checked reads of a chunk payload
+struct MicroProfileFlightReader
+{
+	const char* pData;
+	uint32_t nSize;
+	uint32_t nPos;
+	bool bError;
+};
 
-	int64_t nTicksPerSecondCpu = MicroProfileTicksPerSecondCpu();
-	int64_t nTicksPerSecondGpu = MicroProfileTicksPerSecondGpu();
+MicroProfileFlightReader MicroProfileFlightRead(const char* pData, uint32_t nSize)
+{
+	MicroProfileFlightReader Reader = { pData, nSize, 0, false };
+	return Reader;
+}
 
-	int64_t nTickReferenceCpu = 0, nTickReferenceGpu = 0;
-	// Can't just call GetGpuTickReference off main thread...
-	if(0 && MicroProfileGetGpuTickReference(&nTickReferenceCpu, &nTickReferenceGpu))
+const char* MicroProfileFlightReadBytes(MicroProfileFlightReader& Reader, void* pOut, uint32_t nSize)
+{
+	if(Reader.bError || nSize > Reader.nSize - Reader.nPos)
 	{
-		nTickStartGpu = (nTickStart - nTickReferenceCpu) * (double(nTicksPerSecondGpu) / double(nTicksPerSecondCpu)) + nTickReferenceGpu;
+		Reader.bError = true;
+		if(pOut)
+			memset(pOut, 0, nSize);
+		return 0;
 	}
+	const char* p = Reader.pData + Reader.nPos;
+	if(pOut)
+		memcpy(pOut, p, nSize);
+	Reader.nPos += nSize;
+	return p;
+}
 
-#if MICROPROFILE_DEBUG
-	printf("dumping %d frames\n", nNumFrames);
-	printf("dumping frame %d to %d\n", nFirstFrame, nLastFrame);
-#endif
-
+void MicroProfileFlightReadName(MicroProfileFlightReader& Reader, char* pOut, uint32_t nOutSize)
+{
+	uint32_t nLen = MicroProfileMin(Reader.nSize - Reader.nPos, nOutSize - 1);
+	memcpy(pOut, Reader.pData + Reader.nPos, nLen);
+	pOut[nLen] = '\0';
+}
 
-	uint32_t* nTimerCounter = (uint32_t*)alloca(sizeof(uint32_t)* S.nTotalTimers);
-	memset(nTimerCounter, 0, sizeof(uint32_t) * S.nTotalTimers);
+//thread sections are matched to tool logs by log index and thread, a reused log index gets a new tool log
+uint32_t MicroProfileFlightLoadLog(uint32_t* pLogMap, const MicroProfileFlightThread& T)
+{
+	uint32_t nLog = pLogMap[T.nLogIndex];
+	if(nLog != (uint32_t)-1 && (uint64_t)S.Pool[nLog]->nThreadId == T.nThreadId && 0 == strncmp(S.Pool[nLog]->ThreadName, T.Name, sizeof(T.Name)))
+		return nLog;
+	if(S.nNumLogs == MICROPROFILE_MAX_THREADS)
+		return (uint32_t)-1;
+	char Name[sizeof(T.Name) + 1];
+	memcpy(Name, T.Name, sizeof(T.Name));
+	Name[sizeof(T.Name)] = '\0';
+	MicroProfileThreadLog* pLog = MicroProfileCreateThreadLog(Name);
+	pLog->nThreadId = (MicroProfileThreadIdType)T.nThreadId;
+	pLog->nFiber = T.nFiber;
+	pLogMap[T.nLogIndex] = pLog->nLogIndex;
+	return pLog->nLogIndex;
+}
+
+struct MicroProfileFlightLoadStack
+{
+	uint32_t nStackPos;
+	uint32_t nTimer[MICROPROFILE_STACK_MAX];
+	int64_t nTick[MICROPROFILE_STACK_MAX];
+	int64_t nChildTicks[MICROPROFILE_STACK_MAX];
+};
 
-	MicroProfilePrintf(CB, Handle, "var Frames = Array(%d);\n", nNumFrames);
-	for(uint32_t i = 0; i < nNumFrames; ++i)
-	{
-		uint32_t nFrameIndex = (nFirstFrame + i) % MICROPROFILE_MAX_FRAME_HISTORY;
-		uint32_t nFrameIndexNext = (nFrameIndex + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+bool MicroProfileFlightRecorderLoadMemory(const char* pData, uint64_t nDataSize, MicroProfileFlightRecorderWindow* pWindow)
+{
+	MicroProfileFlightHeader H;
+	if(nDataSize < sizeof(H))
+		return false;
+	memcpy(&H, pData, sizeof(H));
+	if(H.nMagic != MP_FLIGHT_MAGIC || H.nVersion != MP_FLIGHT_VERSION || H.nFileSize != nDataSize || H.nTicksPerSecond <= 0)
+		return false;
+	if(H.nMetaOffset > nDataSize || H.nMetaBytes > H.nMetaSize || H.nMetaSize > nDataSize - H.nMetaOffset || H.nRingOffset > nDataSize || H.nRingSize != nDataSize - H.nRingOffset || H.nTail >= H.nRingSize)
+		return false;
 
-		MicroProfilePrintf(CB, Handle, "var tt%d = [\n", i);
-		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	if(S.nFramePutIndex)
+		return false; //only loaded into a profiler that has not flipped
+
+	//names, mapped from indices in the recording to indices here
+	const uint32_t nMaxIndex = 0x10000;
+	uint32_t* pTimerMap = new uint32_t[nMaxIndex * 3];
+	uint32_t* pCounterMap = pTimerMap + nMaxIndex;
+	uint32_t* pGroupChunk = pCounterMap + nMaxIndex;
+	memset(pTimerMap, 0xff, sizeof(uint32_t) * nMaxIndex * 3);
+	const char* pMeta = pData + H.nMetaOffset;
+	for(uint64_t nPos = 0; nPos + sizeof(MicroProfileFlightChunk) <= H.nMetaBytes;)
+	{
+		MicroProfileFlightChunk C;
+		memcpy(&C, pMeta + nPos, sizeof(C));
+		if(C.nMagic != MP_FLIGHT_CHUNK_MAGIC || C.nSize > H.nMetaBytes - nPos - sizeof(C) || C.nHash != MicroProfileFlightHash(pMeta + nPos + sizeof(C), C.nSize))
+			break;
+		MicroProfileFlightReader Reader = MicroProfileFlightRead(pMeta + nPos + sizeof(C), C.nSize);
+		char Name[MICROPROFILE_NAME_MAX_LEN];
+		if(C.nType == MP_FLIGHT_CHUNK_GROUP)
 		{
-			MicroProfileThreadLog* pLog = S.Pool[j];
-			uint32_t nLogStart = S.Frames[nFrameIndex].nLogStart[j];
-			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
-
-			MicroProfilePrintString(CB, Handle, "[");
-			for(uint32_t k = nLogStart; k != nLogEnd; k = (k+1) % MICROPROFILE_BUFFER_SIZE)
+			MicroProfileFlightGroup Group;
+			MicroProfileFlightReadBytes(Reader, &Group, sizeof(Group));
+			if(!Reader.bError && Group.nIndex < nMaxIndex)
+				pGroupChunk[Group.nIndex] = (uint32_t)nPos;
+		}
+		else if(C.nType == MP_FLIGHT_CHUNK_TIMER)
+		{
+			MicroProfileFlightTimer Timer;
+			MicroProfileFlightReadBytes(Reader, &Timer, sizeof(Timer));
+			MicroProfileFlightReadName(Reader, Name, sizeof(Name));
+			if(!Reader.bError && Timer.nIndex < nMaxIndex && Timer.nGroup < nMaxIndex && pGroupChunk[Timer.nGroup] != (uint32_t)-1)
 			{
-				uint32_t nLogType = MicroProfileLogType(pLog->Log[k]);
-				if(nLogType == MP_LOG_META)
+				MicroProfileFlightChunk GC;
+				memcpy(&GC, pMeta + pGroupChunk[Timer.nGroup], sizeof(GC));
+				MicroProfileFlightReader GroupReader = MicroProfileFlightRead(pMeta + pGroupChunk[Timer.nGroup] + sizeof(GC), GC.nSize);
+				MicroProfileFlightGroup Group;
+				char GroupName[MICROPROFILE_NAME_MAX_LEN];
+				MicroProfileFlightReadBytes(GroupReader, &Group, sizeof(Group));
+				MicroProfileFlightReadName(GroupReader, GroupName, sizeof(GroupName));
+				if(S.nTotalTimers < MICROPROFILE_MAX_TIMERS && (S.nGroupCount < MICROPROFILE_MAX_GROUPS || *MicroProfileFindGroupSlot(GroupName)))
 				{
-					//for meta, store the count + 8, which is the tick part
-					nLogType = 8 + MicroProfileLogGetTick(pLog->Log[k]);
+					MicroProfileToken nToken = MicroProfileGetToken(GroupName, Name, Timer.nColor, (MicroProfileTokenType)Group.nType);
+					S.GroupInfo[MicroProfileGetGroupIndex(nToken)].nColor = Group.nColor;
+					pTimerMap[Timer.nIndex] = MicroProfileGetTimerIndex(nToken);
 				}
-				MicroProfilePrintUIntComma(CB, Handle, nLogType);
 			}
-			MicroProfilePrintString(CB, Handle, "],\n");
 		}
-		MicroProfilePrintString(CB, Handle, "];\n");
-
-		MicroProfilePrintf(CB, Handle, "var ts%d = [\n", i);
-		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		else if(C.nType == MP_FLIGHT_CHUNK_COUNTER)
 		{
-			MicroProfileThreadLog* pLog = S.Pool[j];
-			uint32_t nLogStart = S.Frames[nFrameIndex].nLogStart[j];
-			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
+			MicroProfileFlightCounter Counter;
+			MicroProfileFlightReadBytes(Reader, &Counter, sizeof(Counter));
+			MicroProfileFlightReadName(Reader, Name, sizeof(Name));
+			bool bParent = Counter.nParent < 0 || ((uint32_t)Counter.nParent < nMaxIndex && pCounterMap[Counter.nParent] != (uint32_t)-1);
+			if(!Reader.bError && Counter.nIndex < nMaxIndex && bParent && (pCounterMap[Counter.nIndex] != (uint32_t)-1 || S.nNumCounters < MICROPROFILE_MAX_COUNTERS))
+			{
+				int nCounter = MicroProfileGetCounterTokenByParent(Counter.nParent < 0 ? -1 : (int)pCounterMap[Counter.nParent], Name);
+				S.CounterInfo[nCounter].eFormat = (MicroProfileCounterFormat)Counter.nFormat;
+				S.CounterInfo[nCounter].nLimit = Counter.nLimit;
+				S.CounterInfo[nCounter].nFlags = Counter.nFlags;
+				pCounterMap[Counter.nIndex] = (uint32_t)nCounter;
+			}
+		}
+		nPos += MicroProfileFlightChunkBytes(C.nSize);
+	}
+
+	//pick the frames overlapping the window. only the last ones fit in the frame history
+	const char* pRing = pData + H.nRingOffset;
+	const uint32_t nMaxFrames = MICROPROFILE_MAX_FRAME_HISTORY - MICROPROFILE_GPU_FRAME_DELAY - 4;
+	const char** pFrames = new const char*[nMaxFrames];
+	uint32_t* pFrameSize = new uint32_t[nMaxFrames];
+	uint32_t nFramesInWindow = 0;
+	uint32_t nFramesRecorded = 0;
+	pWindow->fRecordingBegin = pWindow->fRecordingEnd = 0;
+	uint32_t nDroppedFrames = 0;
+	double fTickToSeconds = 1.0 / H.nTicksPerSecond;
+	for(MicroProfileFlightRingIterator It = MicroProfileFlightRingIterate(pRing, H); MicroProfileFlightRingNext(It);)
+	{
+		MicroProfileFlightFrame F;
+		memcpy(&F, It.pPayload, MicroProfileMin((uint32_t)sizeof(F), It.C.nSize));
+		double fBegin = H.nTimeReference + (F.nTickStart - H.nTickReference) * fTickToSeconds;
+		double fEnd = H.nTimeReference + (F.nTickEnd - H.nTickReference) * fTickToSeconds;
+		if(!nFramesRecorded++)
+			pWindow->fRecordingBegin = fBegin;
+		pWindow->fRecordingEnd = fEnd;
+		nDroppedFrames = F.nDroppedFrames;
+		if(It.C.nSize < sizeof(F) || (pWindow->fTimeBegin != 0 && fEnd < pWindow->fTimeBegin) || (pWindow->fTimeEnd != 0 && fBegin > pWindow->fTimeEnd))
+			continue;
+		pFrames[nFramesInWindow % nMaxFrames] = It.pPayload;
+		pFrameSize[nFramesInWindow % nMaxFrames] = It.C.nSize;
+		nFramesInWindow++;
+	}
+	uint32_t nFrames = MicroProfileMin(nFramesInWindow, nMaxFrames);
+	uint32_t nFirst = nFramesInWindow - nFrames;
+	pWindow->nFramesRecorded = nFramesRecorded;
+	pWindow->nFramesInWindow = nFramesInWindow;
+	pWindow->nFramesLoaded = nFrames;
+	pWindow->nFramesDropped = nDroppedFrames + (uint32_t)H.nDroppedChunks;
+
+	//create the tool logs up front, so fiber switches can refer to logs appearing later in the window
+	uint32_t pLogMap[MICROPROFILE_MAX_THREADS];
+	uint32_t pLogMapFirst[MICROPROFILE_MAX_THREADS];
+	memset(pLogMap, 0xff, sizeof(pLogMap));
+	memset(pLogMapFirst, 0xff, sizeof(pLogMapFirst));
+	for(uint32_t f = 0; f < nFrames; ++f)
+	{
+		uint32_t nFrame = (nFirst + f) % nMaxFrames;
+		MicroProfileFlightReader Reader = MicroProfileFlightRead(pFrames[nFrame], pFrameSize[nFrame]);
+		MicroProfileFlightFrame F;
+		MicroProfileFlightReadBytes(Reader, &F, sizeof(F));
+		for(uint32_t i = 0; i < F.nNumThreads && !Reader.bError; ++i)
+		{
+			MicroProfileFlightThread T;
+			MicroProfileFlightReadBytes(Reader, &T, sizeof(T));
+			if(T.nLogIndex < MICROPROFILE_MAX_THREADS)
+			{
+				uint32_t nLog = MicroProfileFlightLoadLog(pLogMap, T);
+				if(pLogMapFirst[T.nLogIndex] == (uint32_t)-1)
+					pLogMapFirst[T.nLogIndex] = nLog;
+			}
+			for(uint32_t j = 0; j < T.nNumEvents && !Reader.bError; ++j)
+			{
+				MicroProfileFlightEvent E;
+				MicroProfileFlightReadBytes(Reader, &E, sizeof(E));
+				if(E.nType == MP_LOG_LABEL)
+					MicroProfileFlightReadBytes(Reader, 0, (uint32_t)MicroProfileMin(E.nValue, (int64_t)0xffffffff));
+			}
+		}
+	}
 
-			int64_t nStartTick = pLog->nGpu ? nTickStartGpu : nTickStart;
-			float fToMs = pLog->nGpu ? fToMsGPU : fToMsCPU;
+	//ticks are moved to end now, in the ticks of this process
+	int64_t nFileBase = 0, nToolBase = 0;
+	double fTickScale = (double)MicroProfileTicksPerSecondCpu() / H.nTicksPerSecond;
+	if(nFrames)
+	{
+		MicroProfileFlightFrame First, Last;
+		memcpy(&First, pFrames[nFirst % nMaxFrames], sizeof(First));
+		memcpy(&Last, pFrames[(nFirst + nFrames - 1) % nMaxFrames], sizeof(Last));
+		nFileBase = First.nTickStart;
+		nToolBase = MP_TICK() - (int64_t)((Last.nTickEnd - nFileBase) * fTickScale);
+	}
+	auto ToTick = [&](int64_t nTick) { return nToolBase + (int64_t)((nTick - nFileBase) * fTickScale); };
+
+	MicroProfileFlightLoadStack* pStacks = new MicroProfileFlightLoadStack[MICROPROFILE_MAX_THREADS];
+	memset(pStacks, 0, sizeof(MicroProfileFlightLoadStack) * MICROPROFILE_MAX_THREADS);
+	memcpy(pLogMap, pLogMapFirst, sizeof(pLogMap));
+	uint32_t nTimers = S.nTotalTimers;
+	memset(&S.AggregateTicks[0], 0, sizeof(S.AggregateTicks[0]) * nTimers);
+	memset(&S.AggregateCount[0], 0, sizeof(S.AggregateCount[0]) * nTimers);
+	memset(&S.AggregateMax[0], 0, sizeof(S.AggregateMax[0]) * nTimers);
+	memset(&S.AggregateMin[0], 0xff, sizeof(S.AggregateMin[0]) * nTimers);
+	memset(&S.AggregateExclusive[0], 0, sizeof(S.AggregateExclusive[0]) * nTimers);
+	memset(&S.AggregateMaxExclusive[0], 0, sizeof(S.AggregateMaxExclusive[0]) * nTimers);
+	for(uint32_t f = 0; f <= nFrames && nFrames; ++f)
+	{
+		MicroProfileFrameState& FS = S.Frames[f];
+		for(uint32_t i = 0; i < S.nNumLogs; ++i)
+		{
+			MicroProfileThreadLog* pLog = S.Pool[i];
+			FS.nLogStart[i] = pLog->nPut.load(std::memory_order_relaxed);
+			FS.nLabelStart[i] = pLog->nLabelPut.load(std::memory_order_relaxed);
+#if MICROPROFILE_LOG_COMPACT
+			FS.nLogStartTick[i] = pLog->nCompactTick;
+#endif
+		}
+		FS.nFrameStartGpu = 0;
+		FS.nFrameStartGpuTimer = (uint32_t)-1;
+		uint32_t nFrame = (nFirst + MicroProfileMin(f, nFrames - 1)) % nMaxFrames; //the end of the last frame starts the closing frame
+		MicroProfileFlightReader Reader = MicroProfileFlightRead(pFrames[nFrame], pFrameSize[nFrame]);
+		MicroProfileFlightFrame F;
+		MicroProfileFlightReadBytes(Reader, &F, sizeof(F));
+		FS.nFrameStartCpu = ToTick(f == nFrames ? F.nTickEnd : F.nTickStart);
+		if(f == nFrames)
+			break;
 
-			if(pLog->nGpu)
-				MicroProfilePrintf(CB, Handle, "MakeTimesExtra(%e,%e,tt%d[%d],[", fToMs, fToMsCPU, i, j);
-			else
-				MicroProfilePrintf(CB, Handle, "MakeTimes(%e,[", fToMs);
-			for(uint32_t k = nLogStart; k != nLogEnd; k = (k+1) % MICROPROFILE_BUFFER_SIZE)
+		memset(&S.FrameTicks[0], 0, sizeof(S.FrameTicks[0]) * nTimers);
+		memset(&S.FrameCount[0], 0, sizeof(S.FrameCount[0]) * nTimers);
+		memset(&S.FrameExclusive[0], 0, sizeof(S.FrameExclusive[0]) * nTimers);
+		for(uint32_t i = 0; i < F.nNumThreads && !Reader.bError; ++i)
+		{
+			MicroProfileFlightThread T;
+			MicroProfileFlightReadBytes(Reader, &T, sizeof(T));
+			uint32_t nLog = (uint32_t)-1;
+			if(T.nLogIndex < MICROPROFILE_MAX_THREADS)
+				nLog = MicroProfileFlightLoadLog(pLogMap, T);
+			MicroProfileThreadLog* pLog = nLog != (uint32_t)-1 ? S.Pool[nLog] : 0;
+			MicroProfileFlightLoadStack& Stack = pStacks[nLog != (uint32_t)-1 ? nLog : 0];
+			uint32_t nLastExtended = (uint32_t)-1;
+			for(uint32_t j = 0; j < T.nNumEvents && !Reader.bError; ++j)
 			{
-				uint32_t nLogType = MicroProfileLogType(pLog->Log[k]);
-				uint64_t nTick =
-					(nLogType == MP_LOG_ENTER || nLogType == MP_LOG_LEAVE)
-					? MicroProfileLogTickDifference(nStartTick, pLog->Log[k])
-					: (nLogType == MP_LOG_GPU_EXTRA)
-					? MicroProfileLogTickDifference(nTickStart, pLog->Log[k])
-					: 0;
-				MicroProfilePrintUIntComma(CB, Handle, nTick);
+				MicroProfileFlightEvent E;
+				MicroProfileFlightReadBytes(Reader, &E, sizeof(E));
+				const char* pLabel = 0;
+				if(E.nType == MP_LOG_LABEL)
+					pLabel = MicroProfileFlightReadBytes(Reader, 0, (uint32_t)MicroProfileMin(E.nValue, (int64_t)0xffffffff));
+				if(!pLog || Reader.bError)
+					continue;
+				uint32_t nCpu = E.nCpu == 0xffff ? 0 : E.nCpu;
+				uint32_t nTimer = E.nIndex < nMaxIndex ? pTimerMap[E.nIndex] : (uint32_t)-1;
+				if(E.nType == MP_LOG_ENTER || E.nType == MP_LOG_LEAVE)
+				{
+					if(nTimer == (uint32_t)-1)
+						continue;
+					int64_t nTick = ToTick(E.nValue);
+					MicroProfileLogPutInternal(nTimer, nTick, E.nType, pLog, nCpu);
+					if(E.nType == MP_LOG_ENTER && Stack.nStackPos < MICROPROFILE_STACK_MAX)
+					{
+						Stack.nTimer[Stack.nStackPos] = nTimer;
+						Stack.nTick[Stack.nStackPos] = nTick;
+						Stack.nChildTicks[Stack.nStackPos] = 0;
+						Stack.nStackPos++;
+					}
+					else if(E.nType == MP_LOG_LEAVE && Stack.nStackPos && Stack.nTimer[Stack.nStackPos - 1] == nTimer)
+					{
+						Stack.nStackPos--;
+						int64_t nTicks = MicroProfileMax(nTick - Stack.nTick[Stack.nStackPos], (int64_t)0);
+						S.FrameTicks[nTimer] += nTicks;
+						S.FrameCount[nTimer] += nLastExtended == MP_LOG_EXTENDED_ASYNC_SUSPEND ? 0 : 1; //resumed async scopes are counted once, at their end
+						S.FrameExclusive[nTimer] += MicroProfileMax(nTicks - Stack.nChildTicks[Stack.nStackPos], (int64_t)0);
+						if(Stack.nStackPos)
+							Stack.nChildTicks[Stack.nStackPos - 1] += nTicks;
+					}
+					if(E.nType == MP_LOG_LEAVE)
+						nLastExtended = (uint32_t)-1;
+				}
+				else if(E.nType == MP_LOG_LABEL)
+				{
+					uint64_t nLabel = MicroProfileAllocateLabel(pLabel, (uint32_t)E.nValue, pLog);
+					if(nLabel != MICROPROFILE_INVALID_LABEL)
+						MicroProfileLogPutInternal(E.nIndex, nLabel, MP_LOG_LABEL, pLog, nCpu); //label tokens do not name a timer
+				}
+				else if(E.nType == MP_LOG_EXTENDED)
+				{
+					uint64_t nValue = E.nValue;
+					if(E.nIndex != MP_LOG_EXTENDED_PAYLOAD)
+					{
+						nValue = ToTick(E.nValue);
+						nLastExtended = E.nIndex;
+					}
+					else if(nLastExtended == MP_LOG_EXTENDED_FIBER_SWITCH)
+					{
+						nValue = nValue < MICROPROFILE_MAX_THREADS ? pLogMap[nValue] : nValue;
+					}
+					else if(nLastExtended >= MP_LOG_EXTENDED_ASYNC_BEGIN && nLastExtended <= MP_LOG_EXTENDED_ASYNC_END)
+					{
+						uint32_t nAsyncTimer = (nValue >> 32) < nMaxIndex ? pTimerMap[nValue >> 32] : (uint32_t)-1;
+						nValue = ((uint64_t)nAsyncTimer << 32) | (nValue & 0xffffffff);
+					}
+					MicroProfileLogPutInternal(E.nIndex, nValue, MP_LOG_EXTENDED, pLog, nCpu);
+				}
 			}
-			MicroProfilePrintString(CB, Handle, "]),\n");
 		}
-		MicroProfilePrintString(CB, Handle, "];\n");
+		S.pAccumulate(&S.AggregateTicks[0], &S.AggregateMax[0], &S.AggregateMin[0], &S.FrameTicks[0], nTimers);
+		S.pAccumulate(&S.AggregateCount[0], 0, 0, &S.FrameCount[0], nTimers);
+		S.pAccumulate(&S.AggregateExclusive[0], &S.AggregateMaxExclusive[0], 0, &S.FrameExclusive[0], nTimers);
 
-		MicroProfilePrintf(CB, Handle, "var ti%d = [\n", i);
-		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		for(uint32_t i = 0; i < F.nNumContextSwitches && !Reader.bError; ++i)
 		{
-			MicroProfileThreadLog* pLog = S.Pool[j];
-			uint32_t nLogStart = S.Frames[nFrameIndex].nLogStart[j];
-			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
-
-			uint32_t nLabelIndex = 0;
-			MicroProfilePrintString(CB, Handle, "[");
-			for(uint32_t k = nLogStart; k != nLogEnd; k = (k+1) % MICROPROFILE_BUFFER_SIZE)
+			MicroProfileFlightContextSwitch C;
+			MicroProfileFlightReadBytes(Reader, &C, sizeof(C));
+#if MICROPROFILE_CONTEXT_SWITCH_TRACE
+			if(!S.ContextSwitch)
 			{
-				uint32_t nLogType = MicroProfileLogType(pLog->Log[k]);
-				uint32_t nTimerIndex = (uint32_t)MicroProfileLogTimerIndex(pLog->Log[k]);
-				uint32_t nIndex = (nLogType == MP_LOG_LABEL) ? nLabelIndex++ : nTimerIndex;
-				MicroProfilePrintUIntComma(CB, Handle, nIndex);
-
-				if(nLogType == MP_LOG_ENTER)
-					nTimerCounter[nTimerIndex]++;
+				S.ContextSwitch = (MicroProfileContextSwitch*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileContextSwitch) * MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE);
+				S.nMemUsage += sizeof(MicroProfileContextSwitch) * MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE;
 			}
-			MicroProfilePrintString(CB, Handle, "],\n");
+			MicroProfileContextSwitch& CS = S.ContextSwitch[S.nContextSwitchPut];
+			CS.nThreadIn = (MicroProfileThreadIdType)C.nThreadIn;
+			CS.nThreadOut = (MicroProfileThreadIdType)C.nThreadOut;
+			CS.nProcessIn = (MicroProfileProcessIdType)C.nProcessIn;
+			CS.nCpu = C.nCpu;
+			CS.nTicks = ToTick(C.nTicks);
+			S.nContextSwitchPut = (S.nContextSwitchPut + 1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE;
+#endif
 		}
-		MicroProfilePrintString(CB, Handle, "];\n");
-
-		MicroProfilePrintf(CB, Handle, "var tl%d = [\n", i);
-		for(uint32_t j = 0; j < S.nNumLogs; ++j)
+		for(uint32_t i = 0; i < F.nNumCounters && !Reader.bError; ++i)
 		{
-			MicroProfileThreadLog* pLog = S.Pool[j];
-			uint32_t nLogStart = S.Frames[nFrameIndex].nLogStart[j];
-			uint32_t nLogEnd = S.Frames[nFrameIndexNext].nLogStart[j];
-
-			MicroProfilePrintString(CB, Handle, "[");
-			for(uint32_t k = nLogStart; k != nLogEnd; k = (k+1) % MICROPROFILE_BUFFER_SIZE)
+			int64_t nValue;
+			MicroProfileFlightReadBytes(Reader, &nValue, sizeof(nValue));
+			if(Reader.bError || i >= nMaxIndex || pCounterMap[i] == (uint32_t)-1)
+				continue;
+			uint32_t nCounter = pCounterMap[i];
+			MicroProfileCounterSet(nCounter, nValue);
+#if MICROPROFILE_COUNTER_HISTORY
+			if(0 != (S.CounterInfo[nCounter].nFlags & MICROPROFILE_COUNTER_FLAG_DETAILED))
 			{
-				uint32_t nLogType = MicroProfileLogType(pLog->Log[k]);
-				if(nLogType == MP_LOG_LABEL)
-				{
-					uint64_t nLabel = MicroProfileLogGetTick(pLog->Log[k]);
-					const char* pLabelName = MicroProfileGetLabel(nLabel);
-
-					if(pLabelName)
-					{
-						MicroProfilePrintString(CB, Handle, "\"");
-						MicroProfilePrintString(CB, Handle, pLabelName);
-						MicroProfilePrintString(CB, Handle, "\",");
-					}
-					else
-						MicroProfilePrintString(CB, Handle, "null,");
-				}
+				S.nCounterHistory[S.nCounterHistoryPut][nCounter] = nValue;
+				S.nCounterMin[nCounter] = MicroProfileMin(S.nCounterMin[nCounter], nValue);
+				S.nCounterMax[nCounter] = MicroProfileMax(S.nCounterMax[nCounter], nValue);
 			}
-			MicroProfilePrintString(CB, Handle, "],\n");
+#endif
 		}
-		MicroProfilePrintString(CB, Handle, "];\n");
+#if MICROPROFILE_COUNTER_HISTORY
+		S.nCounterHistoryPut = (S.nCounterHistoryPut + 1) % MICROPROFILE_GRAPH_HISTORY;
+#endif
+	}
 
-		int64_t nFrameStart = S.Frames[nFrameIndex].nFrameStartCpu;
-		int64_t nFrameEnd = S.Frames[nFrameIndexNext].nFrameStartCpu;
-		int64_t nFrameStartGpu = S.Frames[nFrameIndex].nFrameStartGpu;
-		int64_t nFrameEndGpu = S.Frames[nFrameIndexNext].nFrameStartGpu;
+	S.nFrameCurrent = nFrames;
+	S.nFrameCurrentIndex = nFrames;
+	S.nFramePut = (nFrames + MICROPROFILE_GPU_FRAME_DELAY + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+	S.nFramePutIndex = nFrames + MICROPROFILE_GPU_FRAME_DELAY + 1;
+	S.nAggregateFrames = nFrames;
+	S.nAggregateFlipTick = S.Frames[0].nFrameStartCpu;
+	if(!nFrames)
+		memset(&S.AggregateMin[0], 0, sizeof(S.AggregateMin[0]) * nTimers);
 
-		float fToMs = MicroProfileTickToMsMultiplier(nTicksPerSecondCpu);
-		float fFrameMs = MicroProfileLogTickDifference(nTickStart, nFrameStart) * fToMs;
-		float fFrameEndMs = MicroProfileLogTickDifference(nTickStart, nFrameEnd) * fToMs;
-		float fFrameGpuMs = MicroProfileLogTickDifference(nTickStartGpu, nFrameStartGpu) * fToMsGPU;
-		float fFrameGpuEndMs = MicroProfileLogTickDifference(nTickStartGpu, nFrameEndGpu) * fToMsGPU;
+	delete[] pStacks;
+	delete[] pFrames;
+	delete[] pFrameSize;
+	delete[] pTimerMap;
+	return true;
+}
 
-		MicroProfilePrintf(CB, Handle, "Frames[%d] = MakeFrame(%d, %f, %f, %f, %f, ts%d, tt%d, ti%d, tl%d);\n", i, 0, fFrameMs, fFrameEndMs, fFrameGpuMs, fFrameGpuEndMs, i, i, i, i);
-	}
+bool MicroProfileFlightRecorderLoad(const char* pPath, MicroProfileFlightRecorderWindow* pWindow)
+{
+	FILE* F = fopen(pPath, "rb");
+	if(!F)
+		return false;
+	fseek(F, 0, SEEK_END);
+	long nSize = ftell(F);
+	fseek(F, 0, SEEK_SET);
+	char* pData = nSize > 0 ? new char[nSize] : 0;
+	bool bResult = pData && 1 == fread(pData, nSize, 1, F) && MicroProfileFlightRecorderLoadMemory(pData, (uint64_t)nSize, pWindow);
+	fclose(F);
+	delete[] pData;
+	return bResult;
+}
+#else
+bool MicroProfileFlightRecorderStart(const char* pPath, uint64_t nSize)
+{
+	(void)pPath;
+	(void)nSize;
+	return false;
+}
 
+void MicroProfileFlightRecorderStop()
+{
+}
 
-	uint32_t nContextSwitchStart = 0;
-	uint32_t nContextSwitchEnd = 0;
-	MicroProfileContextSwitchSearch(&nContextSwitchStart, &nContextSwitchEnd, nTickStart, nTickEnd);
+bool MicroProfileFlightRecorderLoad(const char* pPath, MicroProfileFlightRecorderWindow* pWindow)
+{
+	(void)pPath;
+	(void)pWindow;
+	return false;
+}
+#endif
 
-	MicroProfilePrintString(CB, Handle, "var CSwitchThreadInOutCpu = [\n");
-	for(uint32_t j = nContextSwitchStart; j != nContextSwitchEnd; j = (j+1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE)
-	{
-		MicroProfileContextSwitch CS = S.ContextSwitch[j];
-		int nCpu = CS.nCpu;
-		MicroProfilePrintUIntComma(CB, Handle, CS.nThreadIn);
-		MicroProfilePrintUIntComma(CB, Handle, CS.nThreadOut);
-		MicroProfilePrintUIntComma(CB, Handle, nCpu);
-	}
-	MicroProfilePrintString(CB, Handle, "];\n");
+#if MICROPROFILE_CRASH_DUMP && (defined(__APPLE__) || defined(__linux__))
+//crash dumps use the flight recorder layout, so MicroProfileFlightRecorderLoad and src/flightrecorder.cpp read them.
+//they are written from signal handlers: only write(2) family calls on a descriptor opened up front, no locks and no allocation.
+//the live state is passed to the functions dumps share, as MP_DUMP_STATE goes through thread local storage
+static const int MicroProfileCrashDumpSignals[MP_CRASH_DUMP_NUM_SIGNALS] = { SIGSEGV, SIGABRT, SIGTERM, SIGUSR1 };
 
-	MicroProfilePrintString(CB, Handle, "var CSwitchTime = [\n");
-	float fToMsCpu = MicroProfileTickToMsMultiplier(MicroProfileTicksPerSecondCpu());
-	for(uint32_t j = nContextSwitchStart; j != nContextSwitchEnd; j = (j+1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE)
+void MicroProfileCrashDumpPwrite(MicroProfileCrashDump& D, const void* pData, uint64_t nSize, uint64_t nPos)
+{
+	const char* p = (const char*)pData;
+	while(nSize && !D.bError)
 	{
-		MicroProfileContextSwitch CS = S.ContextSwitch[j];
-		float fTime = MicroProfileLogTickDifference(nTickStart, CS.nTicks) * fToMsCpu;
-		MicroProfilePrintf(CB, Handle, "%f,", fTime);
+		ssize_t nWritten = pwrite(D.nFile, p, nSize, (off_t)nPos);
+		if(nWritten < 0 && errno == EINTR)
+			continue;
+		if(nWritten <= 0)
+		{
+			D.bError = true;
+			return;
+		}
+		p += nWritten;
+		nPos += nWritten;
+		nSize -= nWritten;
 	}
-	MicroProfilePrintString(CB, Handle, "];\n");
-
-	MicroProfileThreadInfo Threads[MICROPROFILE_MAX_CONTEXT_SWITCH_THREADS];
-	uint32_t nNumThreadsBase = 0;
-	uint32_t nNumThreads = MicroProfileContextSwitchGatherThreads(nContextSwitchStart, nContextSwitchEnd, Threads, &nNumThreadsBase);
+}
 
-	MicroProfilePrintString(CB, Handle, "var CSwitchThreads = {");
+void MicroProfileCrashDumpFlush(MicroProfileCrashDump& D)
+{
+	MicroProfileCrashDumpPwrite(D, D.Buffer, D.nBuffered, D.nFilePos);
+	D.nFilePos += D.nBuffered;
+	D.nBuffered = 0;
+}
 
-	for (uint32_t i = 0; i < nNumThreads; ++i)
+void MicroProfileCrashDumpPut(MicroProfileCrashDump& D, const void* pData, uint32_t nSize)
+{
+	D.nChunkHash = MicroProfileFlightHash(pData, nSize, D.nChunkHash);
+	D.nChunkSize += nSize;
+	const char* p = (const char*)pData;
+	while(nSize)
 	{
-		char Name[256];
-		const char* pProcessName = MicroProfileGetProcessName(Threads[i].nProcessId, Name, sizeof(Name));
+		uint32_t nCopy = MicroProfileMin(nSize, (uint32_t)sizeof(D.Buffer) - D.nBuffered);
+		memcpy(D.Buffer + D.nBuffered, p, nCopy);
+		D.nBuffered += nCopy;
+		p += nCopy;
+		nSize -= nCopy;
+		if(D.nBuffered == sizeof(D.Buffer))
+			MicroProfileCrashDumpFlush(D);
+	}
+}
 
-		const char* p1 = i < nNumThreadsBase ? S.Pool[i]->ThreadName : "?";
-		const char* p2 = pProcessName ? pProcessName : "?";
+void MicroProfileCrashDumpString(MicroProfileCrashDump& D, const char* pString)
+{
+	MicroProfileCrashDumpPut(D, pString, (uint32_t)strlen(pString));
+}
 
-		MicroProfilePrintf(CB, Handle, "%lld:{\'tid\':%lld,\'pid\':%lld,\'t\':\'%s\',\'p\':\'%s\'},",
-			(long long)Threads[i].nThreadId,
-			(long long)Threads[i].nThreadId,
-			(long long)Threads[i].nProcessId,
-			p1, p2
-			);
-	}
+//the payload is streamed behind a gap for the chunk, which is written once its size and hash are known
+void MicroProfileCrashDumpChunkBegin(MicroProfileCrashDump& D)
+{
+	MicroProfileCrashDumpFlush(D);
+	D.nChunkPos = D.nFilePos;
+	D.nFilePos += sizeof(MicroProfileFlightChunk);
+	D.nChunkSize = 0;
+	D.nChunkHash = MP_FLIGHT_HASH_SEED;
+}
 
-	MicroProfilePrintString(CB, Handle, "};\n");
+void MicroProfileCrashDumpChunkEnd(MicroProfileCrashDump& D, uint32_t nType, uint64_t nSeq)
+{
+	MicroProfileFlightChunk C;
+	C.nMagic = MP_FLIGHT_CHUNK_MAGIC;
+	C.nType = nType;
+	C.nSize = D.nChunkSize;
+	C.nHash = D.nChunkHash;
+	C.nSeq = nSeq;
+	static const char Pad[8] = { 0 };
+	uint32_t nPad = MicroProfileFlightChunkBytes(C.nSize) - (uint32_t)sizeof(C) - C.nSize;
+	MicroProfileCrashDumpPut(D, Pad, nPad);
+	MicroProfileCrashDumpFlush(D);
+	MicroProfileCrashDumpPwrite(D, &C, sizeof(C), D.nChunkPos);
+}
 
-	for(size_t i = 0; i < g_MicroProfileHtml_end_count; ++i)
+void MicroProfileCrashDumpMeta(MicroProfileCrashDump& D)
+{
+	for(uint32_t i = 0; i < S.nGroupCount; ++i)
 	{
-		CB(Handle, g_MicroProfileHtml_end_sizes[i]-1, g_MicroProfileHtml_end[i]);
+		const MicroProfileGroupInfo& G = S.GroupInfo[i];
+		MicroProfileFlightGroup Group = { i, (uint32_t)G.Type, G.nColor, 0 };
+		MicroProfileCrashDumpChunkBegin(D);
+		MicroProfileCrashDumpPut(D, &Group, sizeof(Group));
+		MicroProfileCrashDumpString(D, G.pName);
+		MicroProfileCrashDumpChunkEnd(D, MP_FLIGHT_CHUNK_GROUP, 0);
 	}
-
-	uint32_t* nGroupCounter = (uint32_t*)alloca(sizeof(uint32_t)* S.nGroupCount);
-
-	memset(nGroupCounter, 0, sizeof(uint32_t) * S.nGroupCount);
 	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
 	{
-		uint32_t nGroupIndex = S.TimerInfo[i].nGroupIndex;
-		nGroupCounter[nGroupIndex] += nTimerCounter[i];
+		const MicroProfileTimerInfo& T = S.TimerInfo[i];
+		MicroProfileFlightTimer Timer = { i, T.nGroupIndex, T.nColor, 0 };
+		MicroProfileCrashDumpChunkBegin(D);
+		MicroProfileCrashDumpPut(D, &Timer, sizeof(Timer));
+		MicroProfileCrashDumpString(D, T.pName);
+		MicroProfileCrashDumpChunkEnd(D, MP_FLIGHT_CHUNK_TIMER, 0);
 	}
-
-	uint32_t* nGroupCounterSort = (uint32_t*)alloca(sizeof(uint32_t)* S.nGroupCount);
-	uint32_t* nTimerCounterSort = (uint32_t*)alloca(sizeof(uint32_t)* S.nTotalTimers);
-	for(uint32_t i = 0; i < S.nGroupCount; ++i)
+	for(uint32_t i = 0; i < S.nNumCounters; ++i)
 	{
-		nGroupCounterSort[i] = i;
+		const MicroProfileCounterInfo& CI = S.CounterInfo[i];
+		MicroProfileFlightCounter Counter = { i, CI.nParent, (uint32_t)CI.eFormat, CI.nFlags, CI.nLimit };
+		MicroProfileCrashDumpChunkBegin(D);
+		MicroProfileCrashDumpPut(D, &Counter, sizeof(Counter));
+		MicroProfileCrashDumpString(D, CI.pName);
+		MicroProfileCrashDumpChunkEnd(D, MP_FLIGHT_CHUNK_COUNTER, 0);
 	}
-	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+}
+
+//walks the events of one thread in a frame, writing them when bWrite is set. a log torn by the crash is cut off after a buffer of entries
+uint32_t MicroProfileCrashDumpEvents(MicroProfileCrashDump& D, MicroProfileThreadLog* pLog, uint32_t nFrame, uint32_t nEnd, int64_t nTickStart, bool bWrite)
+{
+	uint32_t nNumEvents = 0, nNumEntries = 0;
+	for(MicroProfileLogIterator It = MicroProfileLogIterateFrame(g_MicroProfile, pLog, nFrame, nEnd); MicroProfileLogNext(It) && nNumEntries < MicroProfileLogSize(pLog); ++nNumEntries)
 	{
-		nTimerCounterSort[i] = i;
-	}
-	std::sort(nGroupCounterSort, nGroupCounterSort + S.nGroupCount, 
-		[nGroupCounter](const uint32_t l, const uint32_t r)
+		MicroProfileFlightEvent E;
+		const char* pLabel;
+		if(!MicroProfileFlightEventFromLog(It.LE, nTickStart, true, &E, &pLabel))
+			continue;
+		if(bWrite)
 		{
-			return nGroupCounter[l] > nGroupCounter[r];
+			MicroProfileCrashDumpPut(D, &E, sizeof(E));
+			if(pLabel)
+				MicroProfileCrashDumpPut(D, pLabel, (uint32_t)E.nValue);
 		}
-	);
+		nNumEvents++;
+	}
+	return nNumEvents;
+}
 
-	std::sort(nTimerCounterSort, nTimerCounterSort + S.nTotalTimers, 
-		[nTimerCounter](const uint32_t l, const uint32_t r)
-		{
-			return nTimerCounter[l] > nTimerCounter[r];
-		}
-	);
+void MicroProfileCrashDumpFrame(MicroProfileCrashDump& D, uint32_t nFrame, uint64_t nFrameIndex, bool bLast, uint64_t nSeq)
+{
+	uint32_t nFrameNext = (nFrame + 1) % MICROPROFILE_MAX_FRAME_HISTORY;
+	MicroProfileFlightFrame F;
+	memset(&F, 0, sizeof(F));
+	F.nFrameIndex = nFrameIndex;
+	F.nTickStart = S.Frames[nFrame].nFrameStartCpu;
+	F.nTickEnd = bLast ? D.nTickEnd : (int64_t)S.Frames[nFrameNext].nFrameStartCpu;
+	F.nNumCounters = bLast ? S.nNumCounters : 0;
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		uint32_t nEnd = bLast ? D.nLogEnd[i] : S.Frames[nFrameNext].nLogStart[i];
+		if(pLog && !pLog->nGpu && pLog->Log && S.Frames[nFrame].nLogStart[i] != nEnd)
+			F.nNumThreads++;
+	}
+	MicroProfileCrashDumpChunkBegin(D);
+	MicroProfileCrashDumpPut(D, &F, sizeof(F));
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		uint32_t nEnd = bLast ? D.nLogEnd[i] : S.Frames[nFrameNext].nLogStart[i];
+		if(!pLog || pLog->nGpu || !pLog->Log || S.Frames[nFrame].nLogStart[i] == nEnd)
+			continue;
+		MicroProfileFlightThread T;
+		memset(&T, 0, sizeof(T));
+		T.nThreadId = (uint64_t)pLog->nThreadId;
+		T.nLogIndex = i;
+		T.nFiber = pLog->nFiber;
+		memcpy(T.Name, pLog->ThreadName, sizeof(T.Name) - 1);
+		T.nNumEvents = MicroProfileCrashDumpEvents(D, pLog, nFrame, nEnd, F.nTickStart, false);
+		MicroProfileCrashDumpPut(D, &T, sizeof(T));
+		MicroProfileCrashDumpEvents(D, pLog, nFrame, nEnd, F.nTickStart, true);
+	}
+	MicroProfileCrashDumpPut(D, D.nCounters, F.nNumCounters * sizeof(int64_t));
+	MicroProfileCrashDumpChunkEnd(D, MP_FLIGHT_CHUNK_FRAME, nSeq);
+}
 
-	MicroProfilePrintf(CB, Handle, "\n<!--\nMarker Per Group\n");
-	for(uint32_t i = 0; i < S.nGroupCount; ++i)
+void MicroProfileCrashDumpWrite()
+{
+	MicroProfileCrashDump* pDump = S.pCrashDump;
+	if(!pDump || pDump->nBusy.exchange(1))
+		return;
+	MicroProfileCrashDump& D = *pDump;
+	D.nTickEnd = MP_TICK();
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
 	{
-		uint32_t idx = nGroupCounterSort[i];
-		MicroProfilePrintf(CB, Handle, "%8d:%s\n", nGroupCounter[idx], S.GroupInfo[idx].pName);
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		D.nLogEnd[i] = pLog ? pLog->nPut.load(std::memory_order_acquire) : 0;
 	}
-	MicroProfilePrintf(CB, Handle, "Marker Per Timer\n");
-	for(uint32_t i = 0; i < S.nTotalTimers; ++i)
+	for(uint32_t i = 0; i < S.nNumCounters; ++i)
+		D.nCounters[i] = MicroProfileCounterValue(g_MicroProfile, i);
+
+	//the header is written last, a dump cut short by a second crash is not mistaken for a complete one
+	MicroProfileFlightHeader H;
+	memset(&H, 0, sizeof(H));
+	D.bError = false;
+	D.nBuffered = 0;
+	MicroProfileCrashDumpPwrite(D, &H, sizeof(H), 0);
+	D.nFilePos = MP_FLIGHT_HEADER_SIZE;
+	MicroProfileCrashDumpMeta(D);
+	H.nMetaOffset = MP_FLIGHT_HEADER_SIZE;
+	H.nMetaSize = H.nMetaBytes = D.nFilePos - MP_FLIGHT_HEADER_SIZE;
+	H.nRingOffset = D.nFilePos;
+
+	//the frame being captured is cut at the snapshot, the frames before it end where the next one starts
+	uint32_t nFrames = (uint32_t)MicroProfileMin(MicroProfileMin((uint64_t)MICROPROFILE_CRASH_DUMP_FRAMES, (uint64_t)MICROPROFILE_MAX_FRAME_HISTORY - 2), S.nFramePutIndex + 1);
+	uint32_t nFramePut = S.nFramePut;
+	uint64_t nFramePutIndex = S.nFramePutIndex;
+	for(uint32_t i = 0; i < nFrames; ++i)
+	{
+		uint32_t nBack = nFrames - 1 - i;
+		uint32_t nFrame = (nFramePut + MICROPROFILE_MAX_FRAME_HISTORY - nBack) % MICROPROFILE_MAX_FRAME_HISTORY;
+		MicroProfileCrashDumpFrame(D, nFrame, nFramePutIndex - nBack, nBack == 0, i);
+	}
+	//a wrap marker ends the ring, so it is never empty
+	MicroProfileCrashDumpChunkBegin(D);
+	MicroProfileCrashDumpChunkEnd(D, MP_FLIGHT_CHUNK_WRAP, 0);
+
+	H.nVersion = MP_FLIGHT_VERSION;
+	H.nFileSize = D.nFilePos;
+	H.nRingSize = D.nFilePos - H.nRingOffset;
+	H.nSeqHead = nFrames;
+	H.nHead = H.nRingSize;
+	H.nTicksPerSecond = D.nTicksPerSecond;
+	H.nTickReference = D.nTickReference;
+	H.nTimeReference = D.nTimeReference;
+	H.nMagic = MP_FLIGHT_MAGIC;
+	if(0 == ftruncate(D.nFile, (off_t)H.nFileSize))
+		MicroProfileCrashDumpPwrite(D, &H, sizeof(H), 0);
+	D.nBusy.store(0);
+}
+
+void MicroProfileCrashDumpHandler(int nSignal, siginfo_t* pInfo, void* pContext)
+{
+	(void)pInfo;
+	(void)pContext;
+	int nErrno = errno;
+	MicroProfileCrashDumpWrite();
+	errno = nErrno;
+	if(nSignal == SIGUSR1)
+		return;
+	//let the previous handler, or the default action, finish the process once this handler returns
+	MicroProfileCrashDump* pDump = S.pCrashDump;
+	for(uint32_t i = 0; pDump && i < MP_CRASH_DUMP_NUM_SIGNALS; ++i)
 	{
-		uint32_t idx = nTimerCounterSort[i];
-		MicroProfilePrintf(CB, Handle, "%8d:%s(%s)\n", nTimerCounter[idx], S.TimerInfo[idx].pName, S.GroupInfo[S.TimerInfo[idx].nGroupIndex].pName);
+		if(MicroProfileCrashDumpSignals[i] == nSignal)
+			sigaction(nSignal, &pDump->Previous[i], 0);
 	}
-	MicroProfilePrintf(CB, Handle, "\n-->\n");
+	raise(nSignal);
+}
 
-	S.nActiveGroup = nActiveGroup;
-	S.nRunning = nRunning;
+bool MicroProfileCrashDumpStart(const char* pPath)
+{
+	MicroProfileInit();
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	if(S.pCrashDump)
+		return false;
+	int nFile = open(pPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(nFile < 0)
+		return false;
+	MicroProfileCrashDump* pDump = new MicroProfileCrashDump();
+	pDump->nFile = nFile;
+	pDump->nTicksPerSecond = MicroProfileTicksPerSecondCpu();
+	pDump->nTickReference = MP_TICK();
+	pDump->nTimeReference = (int64_t)time(0);
+	S.nMemUsage += sizeof(MicroProfileCrashDump);
+	S.pCrashDump = pDump;
+
+	//the handler can't run on a stack that overflowed
+	pDump->pStack = MICROPROFILE_ALLOC_PAGES(MICROPROFILE_CRASH_DUMP_STACK_SIZE);
+	S.nMemUsage += MICROPROFILE_CRASH_DUMP_STACK_SIZE;
+	stack_t Stack;
+	memset(&Stack, 0, sizeof(Stack));
+	Stack.ss_sp = pDump->pStack;
+	Stack.ss_size = MICROPROFILE_CRASH_DUMP_STACK_SIZE;
+	sigaltstack(&Stack, &pDump->PreviousStack);
+
+	struct sigaction Action;
+	memset(&Action, 0, sizeof(Action));
+	Action.sa_sigaction = MicroProfileCrashDumpHandler;
+	Action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+	sigemptyset(&Action.sa_mask);
+	for(uint32_t i = 0; i < MP_CRASH_DUMP_NUM_SIGNALS; ++i)
+		sigaction(MicroProfileCrashDumpSignals[i], &Action, &pDump->Previous[i]);
+	return true;
+}
 
-#if MICROPROFILE_DEBUG
-	int64_t nTicksEnd = MP_TICK();
-	float fMs = fToMsCpu * (nTicksEnd - S.nPauseTicks);
-	printf("html dump took %6.2fms\n", fMs);
-#endif
+void MicroProfileCrashDumpStop()
+{
+	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
+	MicroProfileCrashDump* pDump = S.pCrashDump;
+	if(!pDump)
+		return;
+	for(uint32_t i = 0; i < MP_CRASH_DUMP_NUM_SIGNALS; ++i)
+		sigaction(MicroProfileCrashDumpSignals[i], &pDump->Previous[i], 0);
+	S.pCrashDump = 0;
+	while(pDump->nBusy.exchange(1))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	close(pDump->nFile);
+	//signal stacks are set per thread, so it is only freed when stopped on the thread that started the dump
+	stack_t Stack;
+	if(0 == sigaltstack(0, &Stack) && Stack.ss_sp == pDump->pStack)
+	{
+		sigaltstack(&pDump->PreviousStack, 0);
+		MICROPROFILE_FREE_PAGES(pDump->pStack, MICROPROFILE_CRASH_DUMP_STACK_SIZE);
+	}
+	S.nMemUsage -= sizeof(MicroProfileCrashDump) + MICROPROFILE_CRASH_DUMP_STACK_SIZE;
+	delete pDump;
 }
 #else
-void MicroProfileDumpHtml(MicroProfileWriteCallback CB, void* Handle, int nMaxFrames, const char* pHost)
+bool MicroProfileCrashDumpStart(const char* pPath)
 {
-	MicroProfilePrintString("HTML output is disabled because MICROPROFILE_EMBED_HTML is 0\n");
+	(void)pPath;
+	return false;
 }
-#endif
 
-void MicroProfileWriteFile(void* Handle, size_t nSize, const char* pData)
+void MicroProfileCrashDumpStop()
 {
-	fwrite(pData, nSize, 1, (FILE*)Handle);
 }
 
-void MicroProfileDumpToFile()
+void MicroProfileCrashDumpWrite()
 {
-	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
-
-	FILE* F = fopen(S.DumpPath, "w");
-	if(F)
-	{
-		if(S.eDumpType == MicroProfileDumpTypeHtml)
-			MicroProfileDumpHtml(MicroProfileWriteFile, F, S.nDumpFrames, 0);
-		else if(S.eDumpType == MicroProfileDumpTypeCsv)
-			MicroProfileDumpCsv(MicroProfileWriteFile, F, S.nDumpFrames);
-
-		fclose(F);
-	}
 }
+#endif
 
 #if MICROPROFILE_WEBSERVER
 uint32_t MicroProfileWebServerPort()
@@ -3624,6 +8626,50 @@ int MicroProfileParseGet(const char* pGet)
 	}
 }
 
+//GET /threads lists the threads and whether they are captured
+//GET /threads/all, /threads/enable/<name> and /threads/disable/<name> change the selection
+void MicroProfileWebServerThreads(MpSocket Connection, const char* pArgs)
+{
+	char Name[MicroProfileThreadLog::THREAD_MAX_LEN];
+	uint32_t nLen = 0;
+	const char* pName = 0;
+	if(0 == strncmp(pArgs, "/enable/", 8))
+		pName = pArgs + 8;
+	else if(0 == strncmp(pArgs, "/disable/", 9))
+		pName = pArgs + 9;
+	else if(0 == strcmp(pArgs, "/all"))
+		S.nAllThreadsWanted = 1;
+	auto Hex = [](char c) -> int { return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1; };
+	while(pName && *pName && nLen < sizeof(Name) - 1)
+	{
+		char c = *pName++;
+		if(c == '%' && Hex(pName[0]) >= 0 && Hex(pName[1]) >= 0) //names are url encoded
+		{
+			c = (char)(Hex(pName[0]) * 16 + Hex(pName[1]));
+			pName += 2;
+		}
+		Name[nLen++] = c;
+	}
+	if(pName)
+	{
+		Name[nLen] = '\0';
+		MicroProfileEnableThread(Name, pArgs[1] == 'e');
+		S.nAllThreadsWanted = 0;
+	}
+
+#define MICROPROFILE_THREADS_HEADER "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\n"
+	MicroProfileSendSocket(Connection, MICROPROFILE_THREADS_HEADER, sizeof(MICROPROFILE_THREADS_HEADER)-1);
+	S.nWebServerPut = 0;
+	MicroProfilePrintf(MicroProfileWriteSocket, &Connection, "all,%d\n", S.nAllThreadsWanted);
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		if(pLog->nActive && !pLog->nGpu)
+			MicroProfilePrintf(MicroProfileWriteSocket, &Connection, "%s,%d\n", pLog->ThreadName, S.nAllThreadsWanted || S.nThreadActive[i] ? 1 : 0);
+	}
+	MicroProfileFlushSocket(Connection);
+}
+
 void MicroProfileWebServerHandleRequest(MpSocket Connection)
 {
 	char Request[8192];
@@ -3635,6 +8681,9 @@ void MicroProfileWebServerHandleRequest(MpSocket Connection)
 	std::lock_guard<std::recursive_mutex> Lock(MicroProfileMutex());
 
 	MICROPROFILE_SCOPE(g_MicroProfileWebServerUpdate);
+#if MICROPROFILE_AGGREGATE_ONLY
+	S.nAggregateOnlyHold = MICROPROFILE_AGGREGATE_ONLY_HOLD;
+#endif
 
 #if MICROPROFILE_MINIZ
 #define MICROPROFILE_HTML_HEADER "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nContent-Encoding: deflate\r\nExpires: Tue, 01 Jan 2199 16:00:00 GMT\r\n\r\n"
@@ -3646,6 +8695,22 @@ void MicroProfileWebServerHandleRequest(MpSocket Connection)
 	if(!pUrl)
 		return;
 
+	if(0 == strncmp(pUrl, "threads", 7) && (pUrl[7] == '\0' || pUrl[7] == '?' || pUrl[7] == '/'))
+	{
+		MicroProfileWebServerThreads(Connection, pUrl + 7);
+		return;
+	}
+
+	if(0 == strcmp(pUrl, "requests"))
+	{
+#define MICROPROFILE_REQUESTS_HEADER "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\n\r\n"
+		MicroProfileSendSocket(Connection, MICROPROFILE_REQUESTS_HEADER, sizeof(MICROPROFILE_REQUESTS_HEADER)-1);
+		S.nWebServerPut = 0;
+		MicroProfileDumpRequests(MicroProfileWriteSocket, &Connection);
+		MicroProfileFlushSocket(Connection);
+		return;
+	}
+
 	int nFrames = MicroProfileParseGet(pUrl);
 	if(nFrames <= 0)
 		return;
@@ -3782,6 +8847,12 @@ void MicroProfileContextSwitchTraceStart()
 {
 	if(!S.ContextSwitchThread)
 	{
+		if(!S.ContextSwitch)
+		{
+			//kept until exit, the ui and dumps keep reading it after the trace stops
+			S.ContextSwitch = (MicroProfileContextSwitch*)MICROPROFILE_ALLOC_PAGES(sizeof(MicroProfileContextSwitch) * MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE);
+			S.nMemUsage += sizeof(MicroProfileContextSwitch) * MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE;
+		}
 		MicroProfileThreadStart(&S.ContextSwitchThread, MicroProfileTraceThread);
 	}
 }
@@ -3796,9 +8867,16 @@ void MicroProfileContextSwitchTraceStop()
 	}
 }
 
+#undef S
+#define S MP_DUMP_STATE
 void MicroProfileContextSwitchSearch(uint32_t* pContextSwitchStart, uint32_t* pContextSwitchEnd, uint64_t nBaseTicksCpu, uint64_t nBaseTicksEndCpu)
 {
 	MICROPROFILE_SCOPE(g_MicroProfileContextSwitchSearch);
+	if(!S.ContextSwitch)
+	{
+		*pContextSwitchStart = *pContextSwitchEnd = 0;
+		return;
+	}
 	uint32_t nContextSwitchPut = S.nContextSwitchPut;
 	uint64_t nContextSwitchStart, nContextSwitchEnd;
 	nContextSwitchStart = nContextSwitchEnd = (nContextSwitchPut + MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE - 1) % MICROPROFILE_CONTEXT_SWITCH_BUFFER_SIZE;		
@@ -3867,6 +8945,8 @@ uint32_t MicroProfileContextSwitchGatherThreads(uint32_t nContextSwitchStart, ui
 
 	return nNumThreads;
 }
+#undef S
+#define S g_MicroProfile
 
 #if defined(_WIN32)
 #include <psapi.h>
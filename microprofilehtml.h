@@ -131,6 +131,7 @@ const char g_MicroProfileHtml_begin_0[] =
 "		<li><a href=\"javascript:void(0)\" onclick=\"ToggleDisableLod();\">LodDisable</a></li>\n"
 "		<li id=\'GroupColors\'><a href=\"javascript:void(0)\" onclick=\"ToggleGroupColors();\">Group Colors</a></li>\n"
 "        <li id=\'TimersMeta\'><a href=\"javascript:void(0)\" onclick=\"ToggleTimersMeta();\">Meta</a></li>\n"
+"        <li id=\'FlowsEnabled\'><a href=\"javascript:void(0)\" onclick=\"ToggleFlows();\">Flows</a></li>\n"
 "        <li id=\'ShowHelp\'><a href=\"javascript:void(0)\" onclick=\"ShowHelp(1,1);\">Help</a></li>\n"
 "<!--      	<li><a href=\"javascript:void(0)\" onclick=\"ToggleDebug();\">DEBUG</a></li> -->\n"
 "    </ul>\n"
@@ -180,7 +181,7 @@ const char g_MicroProfileHtml_begin_0[] =
 "\n"
 "function MakeTimer(id, name, group, color, colordark, average, max, min, exclaverage, exclmax, callaverage, callcount, total, meta, metaagg, metamax)\n"
 "{\n"
-"	var timer = {\"id\":id, \"name\":name, \"namelabel\":name.startsWith(\"$\"), \"color\":color, \"colordark\":colordark,\"timercolor\":color, \"textcolor\":InvertColor(color), \"group\":group, \"average\":average, \"max\":max, \"min\":min, \"exclaverage\":exclaverage, \"exclmax\":exclmax, \"callaverage\":callaverage, \"callcount\":callcount, \"total\":total, \"meta\":meta, \"textcolorindex\":InvertColorIndex(color), \"metaagg\":metaagg, \"metamax\":metamax, \"worst\":0, \"worststart\":0, \"worstend\":0};\n"
+"	var timer = {\"id\":id, \"name\":name, \"namelabel\":name.startsWith(\"$\"), \"color\":color, \"colordark\":colordark,\"timercolor\":color, \"textcolor\":InvertColor(color), \"group\":group, \"average\":average, \"max\":max, \"min\":min, \"exclaverage\":exclaverage, \"exclmax\":exclmax, \"callaverage\":callaverage, \"callcount\":callcount, \"total\":total, \"meta\":meta, \"textcolorindex\":InvertColorIndex(color), \"metaagg\":metaagg, \"metamax\":metamax, \"samplerate\":1, \"throttled\":0, \"worst\":0, \"worststart\":0, \"worstend\":0};\n"
 "	return timer;\n"
 "}\n"
 "\n"
@@ -290,6 +291,7 @@ const char g_MicroProfileHtml_end_0[] =
 "var DisableLod = 0;\n"
 "var DisableMerge = 0;\n"
 "var GroupColors = 0;\n"
+"var FlowsEnabled = 1;\n"
 "var nModDown = 0;\n"
 "var g_MSG = \'no\';\n"
 "var nDrawCount = 0;\n"
@@ -299,6 +301,8 @@ const char g_MicroProfileHtml_end_0[] =
 "var CSwitchHeight = 5;\n"
 "var FRAME_HISTORY_COLOR_CPU = \'#ff7f27\';\n"
 "var FRAME_HISTORY_COLOR_GPU = \'#ffffff\';\n"
+"var FLOW_COLOR = \'#ffffff\';\n"
+"var FLOW_CRITICAL_PATH_COLOR = \'#ff3030\';\n"
 "var ZOOM_TIME = 0.5;\n"
 "var AnimationActive = false;\n"
 "var nHoverCSCpu = -1;\n"
@@ -363,6 +367,10 @@ const char g_MicroProfileHtml_end_0[] =
 "var fRangeBeginSelect = 0;\n"
 "var fRangeEndSelect = -1;\n"
 "var ThreadY;\n"
+"var ThreadBarY;\n"
+"var g_Flows;\n"
+"var g_AsyncTimelines;\n"
+"var g_FiberIntervals;\n"
 "\n"
 "var ModeDetailed = 0;\n"
 "var ModeTimers = 1;\n"
@@ -919,6 +927,16 @@ const char g_MicroProfileHtml_end_0[] =
 "	ulTimersMeta.style[\'text-decoration\'] = TimersMeta ? \'underline\' : \'none\';\n"
 "	var ulGroupColors = document.getElementById(\'GroupColors\');\n"
 "	ulGroupColors.style[\'text-decoration\'] = GroupColors ? \'underline\' : \'none\';\n"
+"	var ulFlowsEnabled = document.getElementById(\'FlowsEnabled\');\n"
+"	ulFlowsEnabled.style[\'text-decoration\'] = FlowsEnabled ? \'underline\' : \'none\';\n"
+"}\n"
+"\n"
+"function ToggleFlows()\n"
+"{\n"
+"	FlowsEnabled = FlowsEnabled ? 0 : 1;\n"
+"	WriteCookie();\n"
+"	UpdateOptionsMenu();\n"
+"	RequestRedraw();\n"
 "}\n"
 "\n"
 "function ToggleTimersMeta()\n"
@@ -1276,13 +1294,15 @@ const char g_MicroProfileHtml_end_0[] =
 "						TimeDeltaExclusive = TimeDelta;\n"
 "					}\n"
 "\n"
+"					//sampled timers only record 1 in samplerate calls, scale up to an estimate\n"
+"					var SampleRate = TimerInfo[index].samplerate;\n"
 "					if(nToken < 0 || nToken == index)\n"
 "					{\n"
-"						TimerInfo[index].CallCount++;\n"
-"						TimerInfo[index].FrameSum += TimeDelta;\n"
-"						TimerInfo[index].ExclusiveFrameSum += TimeDeltaExclusive;\n"
-"						TimerInfo[index].Sum += TimeDelta;\n"
-"						TimerInfo[index].ExclusiveSum += TimeDeltaExclusive;\n"
+"						TimerInfo[index].CallCount += SampleRate;\n"
+"						TimerInfo[index].FrameSum += TimeDelta * SampleRate;\n"
+"						TimerInfo[index].ExclusiveFrameSum += TimeDeltaExclusive * SampleRate;\n"
+"						TimerInfo[index].Sum += TimeDelta * SampleRate;\n"
+"						TimerInfo[index].ExclusiveSum += TimeDeltaExclusive * SampleRate;\n"
 "						if(TimeDelta > TimerInfo[index].Max)\n"
 "						{\n"
 "							TimerInfo[index].Max = TimeDelta;\n"
@@ -1302,8 +1322,8 @@ const char g_MicroProfileHtml_end_0[] =
 "						}\n"
 "						if(GroupPos[groupid] == 0)\n"
 "						{\n"
-"							GroupInfo[groupid].Sum += TimeDelta;\n"
-"							GroupInfo[groupid].FrameSum += TimeDelta;\n"
+"							GroupInfo[groupid].Sum += TimeDelta * SampleRate;\n"
+"							GroupInfo[groupid].FrameSum += TimeDelta * SampleRate;\n"
 "						}\n"
 "					}\n"
 "				}\n"
@@ -1618,7 +1638,11 @@ const char g_MicroProfileHtml_end_0[] =
 "		WidthArray[i] = nWidth0;\n"
 "		WidthArray[i+1] = nWidth1;\n"
 "		if(nSum > nMaxWidth)\n"
-"		{\n"
+"		{";
+
+const size_t g_MicroProfileHtml_end_0_size = sizeof(g_MicroProfileHtml_end_0);
+const char g_MicroProfileHtml_end_1[] =
+"\n"
 "			nMaxWidth = nSum;\n"
 "		}\n"
 "		nHeight += BoxHeight;\n"
@@ -1647,11 +1671,7 @@ const char g_MicroProfileHtml_end_0[] =
 "	var YPos = y + BoxHeight-2;\n"
 "	for(i = 0; i < StringArray.length; i += 2)\n"
 "	{\n"
-"		context.fi";
-
-const size_t g_MicroProfileHtml_end_0_size = sizeof(g_MicroProfileHtml_end_0);
-const char g_MicroProfileHtml_end_1[] =
-"llText(StringArray[i], XPos, YPos);\n"
+"		context.fillText(StringArray[i], XPos, YPos);\n"
 "		context.fillText(StringArray[i+1], XPosRight - WidthArray[i+1], YPos);\n"
 "		YPos += BoxHeight;\n"
 "	}\n"
@@ -1700,6 +1720,21 @@ const char g_MicroProfileHtml_end_1[] =
 "		{\n"
 "			StringArray.push(\"Timer:\");\n"
 "			StringArray.push(Timer.name);\n"
+"			if(Timer.throttled == 2)\n"
+"			{\n"
+"				StringArray.push(\"Throttled:\");\n"
+"				StringArray.push(\"disabled, overhead \" + (100 * Overhead).toFixed(2) + \"% of frame\");\n"
+"			}\n"
+"			else if(Timer.samplerate > 1)\n"
+"			{\n"
+"				StringArray.push(Timer.throttled ? \"Throttled:\" : \"Sampled:\");\n"
+"				StringArray.push(\"1 in \" + Timer.samplerate + \", estimated\");\n"
+"			}\n"
+"			if(OverheadSubtract && !Group.isgpu)\n"
+"			{\n"
+"				StringArray.push(\"Overhead:\");\n"
+"				StringArray.push((CalibratedPairMs * 1000000).toFixed(1) + \"ns per child scope subtracted\");\n"
+"			}\n"
 "\n"
 "			StringArray.push(\"\");\n"
 "			StringArray.push(\"\");\n"
@@ -2047,7 +2082,7 @@ const char g_MicroProfileHtml_end_1[] =
 "		context.fillRect(0, Y, NameWidth, Height);\n"
 "		context.textAlign = \'right\';\n"
 "		context.fillStyle = Timer.color;\n"
-"		context.fillText(Timer.name, NameWidth - 5, YText);\n"
+"		context.fillText(Timer.throttled == 2 ? \'-\' + Timer.name : Timer.samplerate > 1 ? \'~\' + Timer.name : Timer.name, NameWidth - 5, YText);\n"
 "		context.textAlign = \'left\';\n"
 "		if(showgroup)\n"
 "		{\n"
@@ -2799,6 +2834,7 @@ const char g_MicroProfileHtml_end_1[] =
 "		if(!ThreadY)\n"
 "		{\n"
 "			ThreadY = new Array(ThreadNames.length+1);\n"
+"			ThreadBarY = new Array(ThreadNames.length);\n"
 "		}\n"
 "\n"
 "		for(var i = 0; i < 2; ++i)\n"
@@ -2814,6 +2850,7 @@ const char g_MicroProfileHtml_end_1[] =
 "		{\n"
 "			var ThreadName = ThreadNames[nLog];\n"
 "			ThreadY[nLog] = fOffsetY;\n"
+"			ThreadBarY[nLog] = -1;\n"
 "			if(ThreadsAllActive || ThreadsActive[ThreadName])\n"
 "			{\n"
 "				var LodIndex = 0;\n"
@@ -2836,12 +2873,22 @@ const char g_MicroProfileHtml_end_1[] =
 "\n"
 "				context.fillStyle = \'white\';\n"
 "				fOffsetY += BoxHeight;\n"
-"				context.fillText(ThreadName, 0, fOffsetY);\n"
+"				context.fillText(ThreadFiber[nLog] ? ThreadName + \' [fiber]\' : ThreadName, 0, fOffsetY);\n"
 "				if(nContextSwitchEnabled)\n"
 "				{\n"
+"";
+
+const size_t g_MicroProfileHtml_end_1_size = sizeof(g_MicroProfileHtml_end_1);
+const char g_MicroProfileHtml_end_2[] =
 "					DrawContextSwitchBars(context, ThreadIds[nLog], fScaleX, fOffsetY, fDetailedOffset, nHoverColor, MinWidth, bDrawEnabled);\n"
 "					fOffsetY += CSwitchHeight+1;\n"
 "				}\n"
+"				if(g_FiberIntervals[nLog])\n"
+"				{\n"
+"					DrawFiberBars(context, g_FiberIntervals[nLog], fScaleX, fOffsetY, MinWidth, bDrawEnabled);\n"
+"					fOffsetY += BoxHeight+1;\n"
+"				}\n"
+"				ThreadBarY[nLog] = fOffsetY;\n"
 "				var MaxDepth = 1;\n"
 "				var StackPos = 0;\n"
 "				var Stack = Array(20);\n"
@@ -2886,11 +2933,7 @@ const char g_MicroProfileHtml_end_1[] =
 "							var W = (timeend-timestart)*fScaleX;\n"
 "\n"
 "							if(W > MinWidth && X < nWidth && X+W > 0)\n"
-"		";
-
-const size_t g_MicroProfileHtml_end_1_size = sizeof(g_MicroProfileHtml_end_1);
-const char g_MicroProfileHtml_end_2[] =
-"					{\n"
+"							{\n"
 "								if(bDrawEnabled || index == nHoverToken)\n"
 "								{\n"
 "									Batches[index].push(X);\n"
@@ -2965,6 +3008,10 @@ const char g_MicroProfileHtml_end_2[] =
 "			}\n"
 "			ThreadY[nLog+1] = fOffsetY;\n"
 "		}\n"
+"		if(g_AsyncTimelines.length)\n"
+"		{\n"
+"			fOffsetY = DrawAsyncTimelines(context, fScaleX, fOffsetY, MinWidth, bDrawEnabled, Batches, BatchesTxt, BatchesTxtPos);\n"
+"		}\n"
 "\n"
 "		if(nContextSwitchEnabled) //non instrumented threads.\n"
 "		{\n"
@@ -3095,7 +3142,128 @@ const char g_MicroProfileHtml_end_2[] =
 "				context.fillText(TxtArray[j], PosArray[k],PosArray[k+1]);\n"
 "			}\n"
 "		}\n"
+"		if(FlowsEnabled && bDrawEnabled)\n"
+"		{\n"
+"			DrawFlows(context, fScaleX);\n"
+"		}\n"
+"\n"
+"	}\n"
+"}\n"
+"\n"
+"function DrawFiberBars(context, Intervals, fScaleX, fOffsetY, MinWidth, bDrawEnabled)\n"
+"{\n"
+"	if(!bDrawEnabled)\n"
+"		return;\n"
+"	for(var i = 0; i < Intervals.length; i += 3)\n"
+"	{\n"
+"		var Fiber = Intervals[i];\n"
+"		var X = (Intervals[i+1] - fDetailedOffset) * fScaleX;\n"
+"		var W = (Intervals[i+2] - Intervals[i+1]) * fScaleX;\n"
+"		if(X > nWidth)\n"
+"			break;\n"
+"		if(W > MinWidth && X+W > 0)\n"
+"		{\n"
+"			context.fillStyle = CSwitchColors[Fiber % CSwitchColors.length];\n"
+"			context.fillRect(X, fOffsetY, W, BoxHeight-1);\n"
+"			var XText = X < 0 ? 0 : X;\n"
+"			var Name = ThreadNames[Fiber];\n"
+"			if((X + W - XText - 2) > Name.length * FontWidth)\n"
+"			{\n"
+"				context.fillStyle = \'black\';\n"
+"				context.fillText(Name, XText + 2, fOffsetY + BoxHeight - FontAscent);\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"}\n"
 "\n"
+"function DrawAsyncTimelines(context, fScaleX, fOffsetY, MinWidth, bDrawEnabled, Batches, BatchesTxt, BatchesTxtPos)\n"
+"{\n"
+"	fOffsetY += BoxHeight;\n"
+"	if(bDrawEnabled)\n"
+"	{\n"
+"		context.fillStyle = \'white\';\n"
+"		context.fillText(\'Async\', 0, fOffsetY);\n"
+"	}\n"
+"	fOffsetY += 2;\n"
+"	var fTimeEnd = fDetailedOffset + fDetailedRange;\n"
+"	for(var i = 0; i < g_AsyncTimelines.length; ++i)\n"
+"	{\n"
+"		var T = g_AsyncTimelines[i];\n"
+"		if(bDrawEnabled && T.End > fDetailedOffset && T.Start < fTimeEnd)\n"
+"		{\n"
+"			var XStart = (T.Start - fDetailedOffset) * fScaleX;\n"
+"			var XEnd = (T.End - fDetailedOffset) * fScaleX;\n"
+"			//suspended time is shown as a thin line connecting the active segments\n"
+"			context.fillStyle = \'#808080\';\n"
+"			context.fillRect(XStart, fOffsetY + BoxHeight / 2, XEnd - XStart, 1);\n"
+"			var Segments = T.Segments;\n"
+"			for(var j = 0; j < Segments.length; j += 3)\n"
+"			{\n"
+"				var X = (Segments[j+1] - fDetailedOffset) * fScaleX;\n"
+"				var W = (Segments[j+2] - Segments[j+1]) * fScaleX;\n"
+"				if(W > MinWidth && X < nWidth && X+W > 0)\n"
+"				{\n"
+"					Batches[T.Timer].push(X);\n"
+"					Batches[T.Timer].push(fOffsetY);\n"
+"					Batches[T.Timer].push(W);\n"
+"				}\n"
+"			}\n"
+"			var Text = TimerInfo[T.Timer].name + \' active \' + TimeToMsString(T.Active) + \' suspended \' + TimeToMsString(T.Suspended);\n"
+"			var txtidx = TimerInfo[T.Timer].textcolorindex;\n"
+"			BatchesTxt[txtidx].push(Text);\n"
+"			BatchesTxtPos[txtidx].push((XStart < 0 ? 0 : XStart) + 2);\n"
+"			BatchesTxtPos[txtidx].push(fOffsetY + BoxHeight - FontAscent);\n"
+"		}\n"
+"		fOffsetY += BoxHeight;\n"
+"	}\n"
+"	return fOffsetY;\n"
+"}\n"
+"\n"
+"function DrawFlows(context, fScaleX)\n"
+"{\n"
+"	context.lineWidth = 3;\n"
+"	context.strokeStyle = FLOW_CRITICAL_PATH_COLOR;\n"
+"	context.beginPath();\n"
+"	for(var i = 0; i < FlowCriticalPath.length; ++i)\n"
+"	{\n"
+"		var Path = FlowCriticalPath[i];\n"
+"		for(var j = 0; j < Path.length; j += 3)\n"
+"		{\n"
+"			var Y = ThreadBarY[Path[j]];\n"
+"			var X0 = (Path[j+1] - fDetailedOffset) * fScaleX;\n"
+"			var X1 = (Path[j+2] - fDetailedOffset) * fScaleX;\n"
+"			if(Y >= 0 && X1 > 0 && X0 < nWidth)\n"
+"			{\n"
+"				context.moveTo(X0, Y);\n"
+"				context.lineTo(X1, Y);\n"
+"			}\n"
+"		}\n"
+"	}\n"
+"	context.stroke();\n"
+"\n"
+"	context.lineWidth = 1;\n"
+"	context.strokeStyle = FLOW_COLOR;\n"
+"	context.fillStyle = FLOW_COLOR;\n"
+"	for(var i = 0; i < g_Flows.length; i += 4)\n"
+"	{\n"
+"		var YBegin = ThreadBarY[g_Flows[i]];\n"
+"		var YEnd = ThreadBarY[g_Flows[i+2]];\n"
+"		var X0 = (g_Flows[i+1] - fDetailedOffset) * fScaleX;\n"
+"		var X1 = (g_Flows[i+3] - fDetailedOffset) * fScaleX;\n"
+"		if(YBegin < 0 || YEnd < 0 || X1 < 0 || X0 > nWidth)\n"
+"			continue;\n"
+"		var Y0 = YBegin + BoxHeight / 2;\n"
+"		var Y1 = YEnd + BoxHeight / 2;\n"
+"		context.beginPath();\n"
+"		context.moveTo(X0, Y0);\n"
+"		context.lineTo(X1, Y1);\n"
+"		context.stroke();\n"
+"		var fAngle = Math.atan2(Y1 - Y0, X1 - X0);\n"
+"		context.beginPath();\n"
+"		context.moveTo(X1, Y1);\n"
+"		context.lineTo(X1 - 6 * Math.cos(fAngle - 0.4), Y1 - 6 * Math.sin(fAngle - 0.4));\n"
+"		context.lineTo(X1 - 6 * Math.cos(fAngle + 0.4), Y1 - 6 * Math.sin(fAngle + 0.4));\n"
+"		context.fill();\n"
 "	}\n"
 "}\n"
 "function DrawTextBox(context, text, x, y, align)\n"
@@ -4068,7 +4236,11 @@ const char g_MicroProfileHtml_end_2[] =
 "function SetFilterInput(group, timer)\n"
 "{\n"
 "	FilterInputGroupString = group;\n"
-"	FilterInputTimerString = timer;\n"
+"	FilterInputTimerString = timer;";
+
+const size_t g_MicroProfileHtml_end_2_size = sizeof(g_MicroProfileHtml_end_2);
+const char g_MicroProfileHtml_end_3[] =
+"\n"
 "	FilterInputGroup.value = group?group:\'\';\n"
 "	FilterInputTimer.value = timer?timer:\'\';\n"
 "	FilterUpdate();\n"
@@ -4314,6 +4486,7 @@ const char g_MicroProfileHtml_end_2[] =
 "		}\n"
 "		TimersGroups = Obj.TimersGroups?Obj.TimersGroups:0;\n"
 "		TimersMeta = Obj.TimersMeta?0:1;\n"
+"		FlowsEnabled = Obj.FlowsDisabled?0:1;\n"
 "	}\n"
 "	SetContextSwitch(nContextSwitchEnabled);\n"
 "	SetMode(NewMode, TimersGroups);\n"
@@ -4334,6 +4507,7 @@ const char g_MicroProfileHtml_end_2[] =
 "	Obj.TimersGroups = TimersGroups?TimersGroups:0;\n"
 "	Obj.TimersMeta = TimersMeta?0:1;\n"
 "	Obj.GroupColors = GroupColors;\n"
+"	Obj.FlowsDisabled = FlowsEnabled?0:1;\n"
 "	if(nHideHelp)\n"
 "	{\n"
 "		Obj.nHideHelp = 1;\n"
@@ -4344,11 +4518,7 @@ const char g_MicroProfileHtml_end_2[] =
 "	document.cookie = cookie;\n"
 "}\n"
 "\n"
-"var mousewheelevt = (/Firefox/i.test(navigator.userAgent)) ? \"DOMMouseScroll\" : \"mousewheel\" //FF doesn\'t recogniz";
-
-const size_t g_MicroProfileHtml_end_2_size = sizeof(g_MicroProfileHtml_end_2);
-const char g_MicroProfileHtml_end_3[] =
-"e mousewheel as of FF3.x\n"
+"var mousewheelevt = (/Firefox/i.test(navigator.userAgent)) ? \"DOMMouseScroll\" : \"mousewheel\" //FF doesn\'t recognize mousewheel as of FF3.x\n"
 "\n"
 "CanvasDetailedView.addEventListener(\'mousemove\', MouseMove, false);\n"
 "CanvasDetailedView.addEventListener(\'mousedown\', function(evt) { MouseButton(true, evt); });\n"
@@ -4708,6 +4878,131 @@ const char g_MicroProfileHtml_end_3[] =
 "	ProfileLeave();\n"
 "}\n"
 "\n"
+"function PreprocessFlows()\n"
+"{\n"
+"	ProfileEnter(\"PreprocessFlows\");\n"
+"	//pair each flow end with the latest preceding begin of the same id. stored as [beginlog, begintime, endlog, endtime]\n"
+"	var Events = [];\n"
+"	for(var i = 0; i < FlowEvents.length; ++i)\n"
+"	{\n"
+"		var FE = FlowEvents[i];\n"
+"		for(var j = 0; j < FE.length; j += 4)\n"
+"		{\n"
+"			Events.push(j, i);\n"
+"		}\n"
+"	}\n"
+"	var Order = new Array(Events.length / 2);\n"
+"	for(var i = 0; i < Order.length; ++i)\n"
+"	{\n"
+"		Order[i] = i;\n"
+"	}\n"
+"	Order.sort(function(a, b)\n"
+"	{\n"
+"		return FlowEvents[Events[a*2+1]][Events[a*2]+3] - FlowEvents[Events[b*2+1]][Events[b*2]+3];\n"
+"	});\n"
+"	var LastBegin = {};\n"
+"	g_Flows = [];\n"
+"	for(var i = 0; i < Order.length; ++i)\n"
+"	{\n"
+"		var FE = FlowEvents[Events[Order[i]*2+1]];\n"
+"		var j = Events[Order[i]*2];\n"
+"		var Id = FE[j+2];\n"
+"		if(FE[j+1])\n"
+"		{\n"
+"			LastBegin[Id] = [FE[j], FE[j+3]];\n"
+"		}\n"
+"		else if(LastBegin[Id])\n"
+"		{\n"
+"			var B = LastBegin[Id];\n"
+"			g_Flows.push(B[0], B[1], FE[j], FE[j+3]);\n"
+"		}\n"
+"	}\n"
+"	ProfileLeave();\n"
+"}\n"
+"\n"
+"function PreprocessAsync()\n"
+"{\n"
+"	ProfileEnter(\"PreprocessAsync\");\n"
+"	//stitch the segments of each async scope into one timeline. subtypes are 3:begin 4:suspend 5:resume 6:end\n"
+"	var Events = [];\n"
+"	for(var i = 0; i < AsyncEvents.length; ++i)\n"
+"	{\n"
+"		var AE = AsyncEvents[i];\n"
+"		for(var j = 0; j < AE.length; j += 5)\n"
+"		{\n"
+"			Events.push(AE.slice(j, j + 5));\n"
+"		}\n"
+"	}\n"
+"	Events.sort(function(a, b) { return a[4] - b[4]; });\n"
+"	var Timelines = {};\n"
+"	g_AsyncTimelines = [];\n"
+"	for(var i = 0; i < Events.length; ++i)\n"
+"	{\n"
+"		var E = Events[i];\n"
+"		var Key = E[2] + \':\' + E[3];\n"
+"		var T = Timelines[Key];\n"
+"		if(!T)\n"
+"		{\n"
+"			T = {\"Timer\":E[3], \"Start\":E[4], \"End\":E[4], \"Active\":0, \"Suspended\":0, \"Segments\":[], \"Open\":-1, \"Log\":-1};\n"
+"			Timelines[Key] = T;\n"
+"			g_AsyncTimelines.push(T);\n"
+"		}\n"
+"		if(E[1] == 3 || E[1] == 5)\n"
+"		{\n"
+"			if(T.Open < 0 && T.Segments.length)\n"
+"			{\n"
+"				T.Suspended += E[4] - T.End;\n"
+"			}\n"
+"			T.Open = E[4];\n"
+"			T.Log = E[0];\n"
+"		}\n"
+"		else if(T.Open >= 0)\n"
+"		{\n"
+"			T.Segments.push(T.Log, T.Open, E[4]);\n"
+"			T.Active += E[4] - T.Open;\n"
+"			T.Open = -1;\n"
+"		}\n"
+"		T.End = E[4];\n"
+"	}\n"
+"	ProfileLeave();\n"
+"}\n"
+"\n"
+"function PreprocessFibers()\n"
+"{\n"
+"	ProfileEnter(\"PreprocessFibers\");\n"
+"	//per host thread, the intervals [fiber, start, end] during which a fiber was running on it\n"
+"	g_FiberIntervals = new Array(ThreadNames.length);\n"
+"	var Current = new Array(ThreadNames.length);\n"
+"	for(var i = 0; i < FiberEvents.length; ++i)\n"
+"	{\n"
+"		var FE = FiberEvents[i];\n"
+"		for(var j = 0; j < FE.length; j += 3)\n"
+"		{\n"
+"			var Host = FE[j];\n"
+"			var C = Current[Host];\n"
+"			if(C && C[0] >= 0)\n"
+"			{\n"
+"				g_FiberIntervals[Host].push(C[0], C[1], FE[j+2]);\n"
+"			}\n"
+"			if(!g_FiberIntervals[Host])\n"
+"			{\n"
+"				g_FiberIntervals[Host] = [];\n"
+"			}\n"
+"			Current[Host] = [FE[j+1], FE[j+2]];\n"
+"		}\n"
+"	}\n"
+"	var CaptureEnd = Frames[Frames.length-1].frameend;\n"
+"	for(var Host = 0; Host < Current.length; ++Host)\n"
+"	{\n"
+"		var C = Current[Host];\n"
+"		if(C && C[0] >= 0)\n"
+"		{\n"
+"			g_FiberIntervals[Host].push(C[0], C[1], CaptureEnd);\n"
+"		}\n"
+"	}\n"
+"	ProfileLeave();\n"
+"}\n"
+"\n"
 "function PreprocessFindFirstFrames()\n"
 "{\n"
 "	ProfileEnter(\"PreprocesFindFirstFrames\");\n"
@@ -4817,6 +5112,9 @@ const char g_MicroProfileHtml_end_3[] =
 "	PreprocessLods();\n"
 "	PreprocessMeta();\n"
 "	PreprocessContextSwitchCache();\n"
+"	PreprocessFlows();\n"
+"	PreprocessAsync();\n"
+"	PreprocessFibers();\n"
 "	ProfileLeave();\n"
 "	ProfileModeDump();\n"
 "	ProfileMode = ProfileModeOld;\n"
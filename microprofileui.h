@@ -121,6 +121,9 @@
 #define MICROPROFILE_FRAME_HISTORY_COLOR_HIGHTLIGHT 0x7733bb44
 #define MICROPROFILE_FRAME_COLOR_HIGHTLIGHT 0x20009900
 #define MICROPROFILE_FRAME_COLOR_HIGHTLIGHT_GPU 0x20996600
+#define MICROPROFILE_FLOW_COLOR 0xffffffff
+#define MICROPROFILE_FLOW_CRITICAL_PATH_COLOR 0xffff3030
+#define MICROPROFILE_FLOW_UI_MAX 512
 #define MICROPROFILE_NUM_FRAMES (MICROPROFILE_MAX_FRAME_HISTORY - (MICROPROFILE_GPU_FRAME_DELAY+1))
 
 #define MICROPROFILE_TOOLTIP_MAX_STRINGS (32 + MICROPROFILE_MAX_GROUPS*2)
@@ -210,7 +213,7 @@ struct MicroProfileCustom
 	uint32_t nAggregateFlip;	
 	uint32_t nNumTimers;
 	uint32_t nMaxTimers;
-	uint64_t nGroupMask;
+	MicroProfileGroupMask nGroupMask;
 	float fReference;
 	uint64_t* pTimers;
 };
@@ -296,7 +299,8 @@ struct MicroProfileUI
 	uint32_t				nModDown;
 	uint32_t 				nActiveMenu;
 
-	MicroProfileLogEntry* pDisplayMouseOver;
+	const MicroProfileLogWord* pDisplayMouseOver;
+	uint64_t nDisplayMouseOverTimer;
 
 	int64_t					nRangeBegin;
 	int64_t					nRangeEnd;
@@ -536,56 +540,48 @@ void MicroProfileToolTipMeta(MicroProfileStringArray* pToolTip)
 		uint64_t nMetaSum[MICROPROFILE_META_MAX] = {0};
 		uint64_t nMetaSumInclusive[MICROPROFILE_META_MAX] = {0};
 		int nStackDepth = 0;
-		uint32_t nRange[2][2];
-		MicroProfileThreadLog* pLog = UI.pRangeLog;
+		MicroProfileLogIterator It = MicroProfileLogIterate(UI.pRangeLog, UI.nRangeBeginIndex, UI.nRangeEndIndex, 0);
 
-
-		MicroProfileGetRange(UI.nRangeEndIndex, UI.nRangeBeginIndex, nRange);
-		for(uint32_t i = 0; i < 2; ++i)
+		while(MicroProfileLogNext(It))
 		{
-			uint32_t nStart = nRange[i][0];
-			uint32_t nEnd = nRange[i][1];
-			for(uint32_t j = nStart; j < nEnd; ++j)
+			MicroProfileLogEntry LE = It.LE;
+			uint64_t nType = MicroProfileLogType(LE);
+			switch(nType)
 			{
-				MicroProfileLogEntry LE = pLog->Log[j];
-				uint64_t nType = MicroProfileLogType(LE);
-				switch(nType)
+			case MP_LOG_META:
 				{
-				case MP_LOG_META:
+					int64_t nMetaIndex = MicroProfileLogTimerIndex(LE);
+					int64_t nMetaCount = MicroProfileLogGetTick(LE);
+					MP_ASSERT(nMetaIndex < MICROPROFILE_META_MAX);
+					if(nStackDepth>1)
 					{
-						int64_t nMetaIndex = MicroProfileLogTimerIndex(LE);
-						int64_t nMetaCount = MicroProfileLogGetTick(LE);
-						MP_ASSERT(nMetaIndex < MICROPROFILE_META_MAX);
-						if(nStackDepth>1)
-						{
-							nMetaSumInclusive[nMetaIndex] += nMetaCount;
-						}
-						else
-						{
-							nMetaSum[nMetaIndex] += nMetaCount;
-						}
+						nMetaSumInclusive[nMetaIndex] += nMetaCount;
 					}
-					break;
-				case MP_LOG_LEAVE:
-					if(nStackDepth)
+					else
 					{
-						nStackDepth--;
+						nMetaSum[nMetaIndex] += nMetaCount;
 					}
-					else
+				}
+				break;
+			case MP_LOG_LEAVE:
+				if(nStackDepth)
+				{
+					nStackDepth--;
+				}
+				else
+				{
+					for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
 					{
-						for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
-						{
-							nMetaSumInclusive[i] += nMetaSum[i];
-							nMetaSum[i] = 0;
-						}
+						nMetaSumInclusive[i] += nMetaSum[i];
+						nMetaSum[i] = 0;
 					}
-					break;
-				case MP_LOG_ENTER:
-					nStackDepth++;
-					break;
 				}
-
+				break;
+			case MP_LOG_ENTER:
+				nStackDepth++;
+				break;
 			}
+
 		}
 		bool bSpaced = false;
 		for(int i = 0; i < MICROPROFILE_META_MAX; ++i)
@@ -613,54 +609,47 @@ void MicroProfileToolTipLabel(MicroProfileStringArray* pToolTip)
 	{
 		bool bSpaced = false;
 		int nStackDepth = 0;
-		uint32_t nRange[2][2];
-		MicroProfileThreadLog* pLog = UI.pRangeLog;
-
-		MicroProfileGetRange(UI.nRangeEndIndex, UI.nRangeBeginIndex, nRange);
-		for(uint32_t i = 0; i < 2; ++i)
+		MicroProfileLogIterator It = MicroProfileLogIterate(UI.pRangeLog, UI.nRangeBeginIndex, UI.nRangeEndIndex, 0);
+		while(MicroProfileLogNext(It))
 		{
-			uint32_t nStart = nRange[i][0];
-			uint32_t nEnd = nRange[i][1];
-			for(uint32_t j = nStart; j < nEnd; ++j)
+			MicroProfileLogEntry LE = It.LE;
+			int nType = MicroProfileLogType(LE);
+			switch(nType)
 			{
-				MicroProfileLogEntry LE = pLog->Log[j];
-				int nType = MicroProfileLogType(LE);
-				switch(nType)
+			case MP_LOG_LABEL:
 				{
-				case MP_LOG_LABEL:
+					if(nStackDepth == 1)
 					{
-						if(nStackDepth == 1)
-						{
-							uint64_t nLabel = MicroProfileLogGetTick(LE);
-							const char* pLabelName = MicroProfileGetLabel(nLabel);
+						uint64_t nLabel = MicroProfileLogGetTick(LE);
+						const char* pLabelName = MicroProfileGetLabel(nLabel);
 
-							if (!bSpaced)
-							{
-								bSpaced = true;
-								MicroProfileStringArrayAddLiteral(pToolTip, "");
-								MicroProfileStringArrayAddLiteral(pToolTip, "");
-							}
+						if (!bSpaced)
+						{
+							bSpaced = true;
+							MicroProfileStringArrayAddLiteral(pToolTip, "");
+							MicroProfileStringArrayAddLiteral(pToolTip, "");
+						}
 
-							if (pToolTip->nNumStrings + 2 <= MICROPROFILE_TOOLTIP_MAX_STRINGS)
-							{
-								MicroProfileStringArrayAddLiteral(pToolTip, "Label:");
-								MicroProfileStringArrayAddLiteral(pToolTip, pLabelName ? pLabelName : "??");
-							}
+						if (pToolTip->nNumStrings + 2 <= MICROPROFILE_TOOLTIP_MAX_STRINGS)
+						{
+							MicroProfileStringArrayAddLiteral(pToolTip, "Label:");
+							//copied, deferred labels are formatted into a temporary buffer
+							MicroProfileStringArrayFormat(pToolTip, "%s", pLabelName ? pLabelName : "??");
 						}
 					}
-					break;
-				case MP_LOG_LEAVE:
-					if(nStackDepth)
-					{
-						nStackDepth--;
-					}
-					break;
-				case MP_LOG_ENTER:
-					nStackDepth++;
-					break;
 				}
-
+				break;
+			case MP_LOG_LEAVE:
+				if(nStackDepth)
+				{
+					nStackDepth--;
+				}
+				break;
+			case MP_LOG_ENTER:
+				nStackDepth++;
+				break;
 			}
+
 		}
 	}
 }
@@ -671,7 +660,7 @@ void MicroProfileDrawFloatTooltip(uint32_t nX, uint32_t nY, uint32_t nToken, uin
 
 	uint32_t nIndex = MicroProfileGetTimerIndex(nToken);
 	uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
-	uint32_t nAggregateCount = S.Aggregate[nIndex].nCount ? S.Aggregate[nIndex].nCount : 1;
+	uint32_t nAggregateCount = S.AggregateCount[nIndex] ? S.AggregateCount[nIndex] : 1;
 
 	uint32_t nGroupId = MicroProfileGetGroupIndex(nToken);
 	uint32_t nTimerId = MicroProfileGetTimerIndex(nToken);
@@ -680,9 +669,9 @@ void MicroProfileDrawFloatTooltip(uint32_t nX, uint32_t nY, uint32_t nToken, uin
 	float fToMs = MicroProfileTickToMsMultiplier(bGpu ? MicroProfileTicksPerSecondGpu() : MicroProfileTicksPerSecondCpu());
 
 	float fMs = fToMs * (nTime);
-	float fFrameMs = fToMs * (S.Frame[nIndex].nTicks);
-	float fAverage = fToMs * (S.Aggregate[nIndex].nTicks/nAggregateFrames);
-	float fCallAverage = fToMs * (S.Aggregate[nIndex].nTicks / nAggregateCount);
+	float fFrameMs = fToMs * (S.FrameTicks[nIndex]);
+	float fAverage = fToMs * (S.AggregateTicks[nIndex]/nAggregateFrames);
+	float fCallAverage = fToMs * (S.AggregateTicks[nIndex] / nAggregateCount);
 	float fMax = fToMs * (S.AggregateMax[nIndex]);
 	float fMin = fToMs * (S.AggregateMin[nIndex]);
 
@@ -701,6 +690,16 @@ void MicroProfileDrawFloatTooltip(uint32_t nX, uint32_t nY, uint32_t nToken, uin
 	const char* pTimerName = S.TimerInfo[nTimerId].pName;
 	MicroProfileStringArrayAddLiteral(&ToolTip, "Timer:");
 	MicroProfileStringArrayFormat(&ToolTip, "%s", pTimerName);
+	if(S.TimerSampleRate[nTimerId] == MICROPROFILE_SAMPLE_DISABLED)
+	{
+		MicroProfileStringArrayAddLiteral(&ToolTip, "Throttled:");
+		MicroProfileStringArrayFormat(&ToolTip, "disabled, overhead %.2f%% of frame", 100.f * S.fOverhead);
+	}
+	else if(S.TimerSampleRate[nTimerId] > 1)
+	{
+		MicroProfileStringArrayAddLiteral(&ToolTip, S.TimerSampleRateGovernor[nTimerId] ? "Throttled:" : "Sampled:");
+		MicroProfileStringArrayFormat(&ToolTip, "1 in %d, estimated", S.TimerSampleRate[nTimerId]);
+	}
 
 #if MICROPROFILE_DEBUG
 	MicroProfileStringArrayFormat(&ToolTip,"0x%p", UI.nHoverAddressEnter);
@@ -1015,6 +1014,56 @@ void MicroProfileGetFrameRange(int64_t nTicks, int64_t nTicksEnd, int32_t nLogIn
 	*nFrameEnd = nEnd;
 }
 
+void MicroProfileDrawDetailedFlows(const MicroProfileFlowEvent* pEvents, uint32_t nNumEvents, const int* nThreadBarY, int64_t nBaseTicks, float fTickToScreen)
+{
+	MicroProfile& S = *MicroProfileGet();
+	for(uint32_t i = 0; i < S.nFlowCriticalPathSegments; ++i)
+	{
+		const MicroProfileFlowSegment& Segment = S.FlowCriticalPath[i];
+		int nY = nThreadBarY[Segment.nLogIndex];
+		if(nY < 0)
+			continue;
+		float fXStart = fTickToScreen * MicroProfileLogTickDifference(nBaseTicks, Segment.nTickStart);
+		float fXEnd = fTickToScreen * MicroProfileLogTickDifference(nBaseTicks, Segment.nTickEnd);
+		MicroProfileDrawBox((int)fXStart, nY - 2, (int)fXEnd, nY, MICROPROFILE_FLOW_CRITICAL_PATH_COLOR);
+	}
+
+	//connect each flow end to the latest begin of the same id
+	for(uint32_t i = 0; i < nNumEvents; ++i)
+	{
+		const MicroProfileFlowEvent& End = pEvents[i];
+		if(End.nBegin)
+			continue;
+		int nBegin = -1;
+		for(uint32_t j = 0; j < nNumEvents; ++j)
+		{
+			const MicroProfileFlowEvent& E = pEvents[j];
+			if(E.nBegin && E.nFlowId == End.nFlowId && MicroProfileLogTickDifference(E.nTick, End.nTick) >= 0)
+			{
+				if(nBegin < 0 || MicroProfileLogTickDifference(pEvents[nBegin].nTick, E.nTick) > 0)
+					nBegin = j;
+			}
+		}
+		if(nBegin < 0 || nThreadBarY[pEvents[nBegin].nLogIndex] < 0 || nThreadBarY[End.nLogIndex] < 0)
+			continue;
+		const MicroProfileFlowEvent& Begin = pEvents[nBegin];
+		float fX0 = fTickToScreen * MicroProfileLogTickDifference(nBaseTicks, Begin.nTick);
+		float fX1 = fTickToScreen * MicroProfileLogTickDifference(nBaseTicks, End.nTick);
+		float fY0 = nThreadBarY[Begin.nLogIndex] + MICROPROFILE_DETAILED_BAR_HEIGHT * 0.5f;
+		float fY1 = nThreadBarY[End.nLogIndex] + MICROPROFILE_DETAILED_BAR_HEIGHT * 0.5f;
+		float fLine[4] = { fX0, fY0, fX1, fY1 };
+		MicroProfileDrawLine2D(2, fLine, MICROPROFILE_FLOW_COLOR);
+		float fAngle = atan2f(fY1 - fY0, fX1 - fX0);
+		float fHead[6] =
+		{
+			fX1 - 6.f * cosf(fAngle - 0.4f), fY1 - 6.f * sinf(fAngle - 0.4f),
+			fX1, fY1,
+			fX1 - 6.f * cosf(fAngle + 0.4f), fY1 - 6.f * sinf(fAngle + 0.4f),
+		};
+		MicroProfileDrawLine2D(3, fHead, MICROPROFILE_FLOW_COLOR);
+	}
+}
+
 void MicroProfileDrawDetailedBars(uint32_t nWidth, uint32_t nHeight, int nBaseY, int nSelectedFrame)
 {
 	MicroProfile& S = *MicroProfileGet();
@@ -1108,9 +1157,10 @@ void MicroProfileDrawDetailedBars(uint32_t nWidth, uint32_t nHeight, int nBaseY,
 	}
 
 	nY += MICROPROFILE_TEXT_HEIGHT+1;
-	MicroProfileLogEntry* pMouseOver = UI.pDisplayMouseOver;
-	MicroProfileLogEntry* pMouseOverNext = 0;
-	uint64_t nMouseOverToken = pMouseOver ? MicroProfileLogTimerIndex(*pMouseOver) : MICROPROFILE_INVALID_TOKEN;
+	const MicroProfileLogWord* pMouseOver = UI.pDisplayMouseOver;
+	const MicroProfileLogWord* pMouseOverNext = 0;
+	uint64_t nMouseOverToken = pMouseOver ? UI.nDisplayMouseOverTimer : MICROPROFILE_INVALID_TOKEN;
+	uint64_t nMouseOverTimerNext = 0;
 	float fMouseX = (float)UI.nMouseX;
 	float fMouseY = (float)UI.nMouseY;
 	uint64_t nHoverToken = MICROPROFILE_INVALID_TOKEN;
@@ -1141,14 +1191,19 @@ void MicroProfileDrawDetailedBars(uint32_t nWidth, uint32_t nHeight, int nBaseY,
 		MicroProfileContextSwitchSearch(&nContextSwitchStart, &nContextSwitchEnd, nBaseTicksCpu, nBaseTicksEndCpu);
 	}
 
-	uint64_t nActiveGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
+	MicroProfileGroupMask nActiveGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
 
 	bool bSkipBarView = S.bContextSwitchRunning && S.bContextSwitchNoBars;
 
+	int nThreadBarY[MICROPROFILE_MAX_THREADS];
+	MicroProfileFlowEvent FlowEvents[MICROPROFILE_FLOW_UI_MAX];
+	uint32_t nNumFlowEvents = 0;
+
 	if(!bSkipBarView)
 	{
 		for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
 		{
+			nThreadBarY[i] = -1;
 			MicroProfileThreadLog* pLog = S.Pool[i];
 			if(!pLog)
 				continue;
@@ -1169,13 +1224,12 @@ void MicroProfileDrawDetailedBars(uint32_t nWidth, uint32_t nHeight, int nBaseY,
 			if(nPut == nGet)
 				continue;
 
-			uint32_t nRange[2][2] = { {0, 0}, {0, 0}, };
-			MicroProfileGetRange(nPut, nGet, nRange);
+			MicroProfileLogIterator It = MicroProfileLogIterateFrame(pLog, nLogFrameBegin, nPut);
 
 			uint32_t nMaxStackDepth = 0;
 
 			nY += 3;
-			MicroProfileWriteThreadHeader(nY, nThreadId, &pLog->ThreadName[0], nullptr);
+			MicroProfileWriteThreadHeader(nY, nThreadId, &pLog->ThreadName[0], pLog->nFiber ? "fiber" : nullptr);
 			nY += 3;
 			nY += MICROPROFILE_TEXT_HEIGHT + 1;
 
@@ -1185,167 +1239,189 @@ void MicroProfileDrawDetailedBars(uint32_t nWidth, uint32_t nHeight, int nBaseY,
 				nY -= MICROPROFILE_DETAILED_BAR_HEIGHT;
 				nY += MICROPROFILE_DETAILED_CONTEXT_SWITCH_HEIGHT+1;
 			}
+			nThreadBarY[i] = nY + MICROPROFILE_DETAILED_BAR_HEIGHT;
 
 			uint32_t nYDelta = MICROPROFILE_DETAILED_BAR_HEIGHT;
 			uint32_t nStack[MICROPROFILE_STACK_MAX];
+			MicroProfileLogEntry StackEntry[MICROPROFILE_STACK_MAX];
 			uint32_t nStackPos = 0;
-			for(uint32_t j = 0; j < 2; ++j)
+			while(MicroProfileLogNext(It))
 			{
-				uint32_t nStart = nRange[j][0];
-				uint32_t nEnd = nRange[j][1];
-				for(uint32_t k = nStart; k < nEnd; ++k)
+				const MicroProfileLogWord* pEntry = pLog->Log + It.nPos;
+				MicroProfileLogEntry LE = It.LE;
+				uint64_t nType = MicroProfileLogType(LE);
+				if(MP_LOG_ENTER == nType)
+				{
+					MP_ASSERT(nStackPos < MICROPROFILE_STACK_MAX);
+					StackEntry[nStackPos] = LE;
+					nStack[nStackPos++] = It.nPos;
+				}
+				else if(MP_LOG_META == nType)
 				{
-					MicroProfileLogEntry* pEntry = pLog->Log + k;
-					uint64_t nType = MicroProfileLogType(*pEntry);
-					if(MP_LOG_ENTER == nType)
+
+				}
+				else if(MP_LOG_EXTENDED == nType)
+				{
+					uint64_t nSubType = MicroProfileLogTimerIndex(LE);
+					uint64_t nFlowId;
+					if(!bGpu && (MP_LOG_EXTENDED_FLOW_BEGIN == nSubType || MP_LOG_EXTENDED_FLOW_END == nSubType) && nNumFlowEvents < MICROPROFILE_FLOW_UI_MAX && MicroProfileLogGetPayload(It, &nFlowId))
 					{
-						MP_ASSERT(nStackPos < MICROPROFILE_STACK_MAX);
-						nStack[nStackPos++] = k;
+						MicroProfileFlowEvent& E = FlowEvents[nNumFlowEvents++];
+						E.nFlowId = nFlowId;
+						E.nTick = MicroProfileLogGetTick(LE);
+						E.nLogIndex = i;
+						E.nBegin = MP_LOG_EXTENDED_FLOW_BEGIN == nSubType ? 1 : 0;
 					}
-					else if(MP_LOG_META == nType)
+				}
+				else if(MP_LOG_LEAVE == nType)
+				{
+					if(0 == nStackPos)
 					{
+						continue;
+					}
 
+					const MicroProfileLogWord* pEntryEnter = pLog->Log + nStack[nStackPos-1];
+					MicroProfileLogEntry LEEnter = StackEntry[nStackPos-1];
+					if(MicroProfileLogTimerIndex(LEEnter) != MicroProfileLogTimerIndex(LE))
+					{
+						//uprintf("mismatch %llx %llx\n", pEntryEnter->nToken, pEntry->nToken);
+						continue;
 					}
-					else if(MP_LOG_LEAVE == nType)
+					int64_t nTickStart = MicroProfileLogGetTick(LEEnter);
+					int64_t nTickEnd = MicroProfileLogGetTick(LE);
+					uint64_t nTimerIndex = MicroProfileLogTimerIndex(LE);
+					uint32_t nColor = S.TimerInfo[nTimerIndex].nColor;
+					if(!nActiveGroup.Test(S.TimerInfo[nTimerIndex].nGroupIndex))
 					{
-						if(0 == nStackPos)
-						{
-							continue;
-						}
-
-						MicroProfileLogEntry* pEntryEnter = pLog->Log + nStack[nStackPos-1];
-						if(MicroProfileLogTimerIndex(*pEntryEnter) != MicroProfileLogTimerIndex(*pEntry))
-						{
-							//uprintf("mismatch %llx %llx\n", pEntryEnter->nToken, pEntry->nToken);
-							continue;
-						}
-						int64_t nTickStart = MicroProfileLogGetTick(*pEntryEnter);
-						int64_t nTickEnd = MicroProfileLogGetTick(*pEntry);
-						uint64_t nTimerIndex = MicroProfileLogTimerIndex(*pEntry);
-						uint32_t nColor = S.TimerInfo[nTimerIndex].nColor;
-						if(!(nActiveGroup & (1ull << S.TimerInfo[nTimerIndex].nGroupIndex)))
-						{
-							nStackPos--;
-							continue;
-						}
-						if(nMouseOverToken == nTimerIndex)
+						nStackPos--;
+						continue;
+					}
+					if(nMouseOverToken == nTimerIndex)
+					{
+						if(pEntry == pMouseOver)
 						{
-							if(pEntry == pMouseOver)
+							nColor = UI.nHoverColor;
+							if(bGpu)
 							{
-								nColor = UI.nHoverColor;
-								if(bGpu)
+								UI.nRangeBeginGpu = nTickStart;
+								UI.nRangeEndGpu = nTickEnd;
+								uint32_t nCpuBegin;
+								MicroProfileLogRead(pLog, nStack[nStackPos-1], &nCpuBegin);
+								MicroProfileLogEntry LogCpuBegin = MicroProfileLogRead(pLog, nCpuBegin, 0);
+								MicroProfileLogEntry LogCpuEnd = MicroProfileLogRead(pLog, It.nNext, 0);
+								if(MicroProfileLogType(LogCpuBegin) == MP_LOG_GPU_EXTRA && MicroProfileLogType(LogCpuEnd) == MP_LOG_GPU_EXTRA)
 								{
-									UI.nRangeBeginGpu = *pEntryEnter;
-									UI.nRangeEndGpu = *pEntry;
-									uint32_t nCpuBegin = (nStack[nStackPos-1] + 1) % MICROPROFILE_BUFFER_SIZE;
-									uint32_t nCpuEnd = (k + 1) % MICROPROFILE_BUFFER_SIZE;
-									MicroProfileLogEntry LogCpuBegin = pLog->Log[nCpuBegin];
-									MicroProfileLogEntry LogCpuEnd = pLog->Log[nCpuEnd];
-									if(MicroProfileLogType(LogCpuBegin) == MP_LOG_GPU_EXTRA && MicroProfileLogType(LogCpuEnd) == MP_LOG_GPU_EXTRA)
-									{
-										UI.nRangeBegin = LogCpuBegin;
-										UI.nRangeEnd = LogCpuEnd;
-									}
-									UI.nRangeBeginIndex = nStack[nStackPos-1];
-									UI.nRangeEndIndex = k;
-									UI.pRangeLog = pLog;
-								}
-								else
-								{
-									UI.nRangeBegin = *pEntryEnter;
-									UI.nRangeEnd = *pEntry;
-									UI.nRangeBeginIndex = nStack[nStackPos-1];
-									UI.nRangeEndIndex = k;
-									UI.pRangeLog = pLog;
-
+									UI.nRangeBegin = MicroProfileLogGetTick(LogCpuBegin);
+									UI.nRangeEnd = MicroProfileLogGetTick(LogCpuEnd);
 								}
+								UI.nRangeBeginIndex = nStack[nStackPos-1];
+								UI.nRangeEndIndex = It.nPos;
+								UI.pRangeLog = pLog;
 							}
 							else
 							{
-								nColor = UI.nHoverColorShared;
+								UI.nRangeBegin = nTickStart;
+								UI.nRangeEnd = nTickEnd;
+								UI.nRangeBeginIndex = nStack[nStackPos-1];
+								UI.nRangeEndIndex = It.nPos;
+								UI.pRangeLog = pLog;
+
 							}
 						}
+						else
+						{
+							nColor = UI.nHoverColorShared;
+						}
+					}
 
-						const char* pName = S.TimerInfo[nTimerIndex].pName;
-						uint32_t nNameLen = S.TimerInfo[nTimerIndex].nNameLen;
+					const char* pName = S.TimerInfo[nTimerIndex].pName;
+					uint32_t nNameLen = S.TimerInfo[nTimerIndex].nNameLen;
 
-						if (pName[0] == '$' && pEntryEnter < pEntry && MicroProfileLogType(pEntryEnter[1 + bGpu]) == MP_LOG_LABEL)
+					if (pName[0] == '$' && pEntryEnter < pEntry)
+					{
+						//the label follows the enter entry, and the cpu tick of gpu entries
+						uint32_t nLabelPos;
+						MicroProfileLogRead(pLog, nStack[nStackPos-1], &nLabelPos);
+						if(bGpu)
+							MicroProfileLogRead(pLog, nLabelPos, &nLabelPos);
+						MicroProfileLogEntry LELabel = MicroProfileLogRead(pLog, nLabelPos, 0);
+						const char* pLabel = nLabelPos != It.nPos && MicroProfileLogType(LELabel) == MP_LOG_LABEL ? MicroProfileGetLabel(MicroProfileLogGetTick(LELabel)) : 0;
+
+						if (pLabel)
 						{
-							const char* pLabel = MicroProfileGetLabel(MicroProfileLogGetTick(pEntryEnter[1 + bGpu]));
-
-							if (pLabel)
-							{
-								pName = pLabel;
-								nNameLen = strlen(pLabel);
-							}
+							pName = pLabel;
+							nNameLen = strlen(pLabel);
 						}
+					}
 
-						nMaxStackDepth = MicroProfileMax(nMaxStackDepth, nStackPos);
-						float fMsStart = fToMs * MicroProfileLogTickDifference(nBaseTicks, nTickStart);
-						float fMsEnd = fToMs * MicroProfileLogTickDifference(nBaseTicks, nTickEnd);
-						float fXStart = fMsStart * fMsToScreen;
-						float fXEnd = fMsEnd * fMsToScreen;
-						float fYStart = (float)(nY + nStackPos * nYDelta);
-						float fYEnd = fYStart + (MICROPROFILE_DETAILED_BAR_HEIGHT);
-						float fXDist = MicroProfileMax(fXStart - fMouseX, fMouseX - fXEnd);
-						bool bHover = fXDist < MICROPROFILE_HOVER_DIST && fYStart <= fMouseY && fMouseY <= fYEnd && nBaseY < fMouseY;
-						uint32_t nIntegerWidth = (uint32_t)(fXEnd - fXStart);
-						if(nIntegerWidth)
+					nMaxStackDepth = MicroProfileMax(nMaxStackDepth, nStackPos);
+					float fMsStart = fToMs * MicroProfileLogTickDifference(nBaseTicks, nTickStart);
+					float fMsEnd = fToMs * MicroProfileLogTickDifference(nBaseTicks, nTickEnd);
+					float fXStart = fMsStart * fMsToScreen;
+					float fXEnd = fMsEnd * fMsToScreen;
+					float fYStart = (float)(nY + nStackPos * nYDelta);
+					float fYEnd = fYStart + (MICROPROFILE_DETAILED_BAR_HEIGHT);
+					float fXDist = MicroProfileMax(fXStart - fMouseX, fMouseX - fXEnd);
+					bool bHover = fXDist < MICROPROFILE_HOVER_DIST && fYStart <= fMouseY && fMouseY <= fYEnd && nBaseY < fMouseY;
+					uint32_t nIntegerWidth = (uint32_t)(fXEnd - fXStart);
+					if(nIntegerWidth)
+					{
+						if(bHover && UI.nActiveMenu == (uint32_t)-1)
 						{
-							if(bHover && UI.nActiveMenu == (uint32_t)-1)
-							{
-								nHoverToken = MicroProfileLogTimerIndex(*pEntry);
-	#if MICROPROFILE_DEBUG
-								UI.nHoverAddressEnter = (uint64_t)pEntryEnter;
-								UI.nHoverAddressLeave = (uint64_t)pEntry;
-	#endif
-								nHoverTime = MicroProfileLogTickDifference(nTickStart, nTickEnd);
-								pMouseOverNext = pEntry;
-							}
+							nHoverToken = MicroProfileLogTimerIndex(LE);
+#if MICROPROFILE_DEBUG
+							UI.nHoverAddressEnter = (uint64_t)pEntryEnter;
+							UI.nHoverAddressLeave = (uint64_t)pEntry;
+#endif
+							nHoverTime = MicroProfileLogTickDifference(nTickStart, nTickEnd);
+							pMouseOverNext = pEntry;
+							nMouseOverTimerNext = nTimerIndex;
+						}
 
-							MicroProfileDrawBox((int)fXStart, (int)fYStart, (int)fXEnd, (int)fYEnd, nColor|UI.nOpacityForeground, MicroProfileBoxTypeBar);
+						MicroProfileDrawBox((int)fXStart, (int)fYStart, (int)fXEnd, (int)fYEnd, nColor|UI.nOpacityForeground, MicroProfileBoxTypeBar);
 #if MICROPROFILE_DETAILED_BAR_NAMES
-							if(nIntegerWidth>3*MICROPROFILE_TEXT_WIDTH)
+						if(nIntegerWidth>3*MICROPROFILE_TEXT_WIDTH)
+						{
+							float fXStartText = MicroProfileMax(fXStart, 0.f);
+							int nTextWidth = (int)(fXEnd - fXStartText);
+							int nCharacters = (nTextWidth - MICROPROFILE_TEXT_WIDTH) / (MICROPROFILE_TEXT_WIDTH+1);
+							if(nCharacters>0)
 							{
-								float fXStartText = MicroProfileMax(fXStart, 0.f);
-								int nTextWidth = (int)(fXEnd - fXStartText);
-								int nCharacters = (nTextWidth - MICROPROFILE_TEXT_WIDTH) / (MICROPROFILE_TEXT_WIDTH+1);
-								if(nCharacters>0)
-								{
-									MicroProfileDrawText((int)(fXStartText+1), (int)(fYStart+1), -1, pName, MicroProfileMin<uint32_t>(nNameLen, nCharacters));
-								}
+								MicroProfileDrawText((int)(fXStartText+1), (int)(fYStart+1), -1, pName, MicroProfileMin<uint32_t>(nNameLen, nCharacters));
 							}
-#endif
-							++nNumBoxes;
 						}
-						else
+#endif
+						++nNumBoxes;
+					}
+					else
+					{
+						float fXAvg = 0.5f * (fXStart + fXEnd);
+						int nLineX = (int)floor(fXAvg+0.5f);
+						if(nLineX != (int)nLinesDrawn[nStackPos])
 						{
-							float fXAvg = 0.5f * (fXStart + fXEnd);
-							int nLineX = (int)floor(fXAvg+0.5f);
-							if(nLineX != (int)nLinesDrawn[nStackPos])
+							if(bHover && UI.nActiveMenu == (uint32_t)-1)
 							{
-								if(bHover && UI.nActiveMenu == (uint32_t)-1)
-								{
-									nHoverToken = (uint32_t)MicroProfileLogTimerIndex(*pEntry);
-									nHoverTime = MicroProfileLogTickDifference(nTickStart, nTickEnd);
-									pMouseOverNext = pEntry;
-								}
-								nLinesDrawn[nStackPos] = nLineX;
-								MicroProfileDrawLineVertical(nLineX, (int)(fYStart + 0.5f), (int)(fYEnd + 0.5f), nColor|UI.nOpacityForeground);
-								++nNumLines;
+								nHoverToken = (uint32_t)MicroProfileLogTimerIndex(LE);
+								nHoverTime = MicroProfileLogTickDifference(nTickStart, nTickEnd);
+								pMouseOverNext = pEntry;
+								nMouseOverTimerNext = nTimerIndex;
 							}
+							nLinesDrawn[nStackPos] = nLineX;
+							MicroProfileDrawLineVertical(nLineX, (int)(fYStart + 0.5f), (int)(fYEnd + 0.5f), nColor|UI.nOpacityForeground);
+							++nNumLines;
 						}
-						nStackPos--;
+					}
+					nStackPos--;
 
-						if(0 == nStackPos && MicroProfileLogTickDifference(nTickEnd, nBaseTicksEnd) < 0)
-						{
-							break;
-						}
+					if(0 == nStackPos && MicroProfileLogTickDifference(nTickEnd, nBaseTicksEnd) < 0)
+					{
+						break;
 					}
 				}
 			}
 			nY += nMaxStackDepth * nYDelta + MICROPROFILE_DETAILED_BAR_HEIGHT+1;
 		}
+		MicroProfileDrawDetailedFlows(FlowEvents, nNumFlowEvents, nThreadBarY, nBaseTicksCpu, fToMsCpu * fMsToScreen);
 	}
 	if(S.bContextSwitchRunning && (S.bContextSwitchAllThreads||S.bContextSwitchNoBars))
 	{
@@ -1390,6 +1466,7 @@ void MicroProfileDrawDetailedBars(uint32_t nWidth, uint32_t nHeight, int nBaseY,
 
 
 	UI.pDisplayMouseOver = pMouseOverNext;
+	UI.nDisplayMouseOverTimer = nMouseOverTimerNext;
 
 	if(!S.nRunning)
 	{
@@ -1583,18 +1660,16 @@ void MicroProfileLoopActiveGroupsDraw(int32_t nX, int32_t nY, MicroProfileLoopGr
 {
 	MicroProfile& S = *MicroProfileGet();
 	nY += MICROPROFILE_TEXT_HEIGHT + 2;
-	uint64_t nGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
+	const MicroProfileGroupMask& nGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
 	uint32_t nCount = 0;
 	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
 	{
-		uint64_t nMask = 1ll << j;
-		if(nMask & nGroup)
+		if(nGroup.Test(j))
 		{
 			nY += MICROPROFILE_TEXT_HEIGHT + 1;
 			for(uint32_t i = 0; i < S.nTotalTimers;++i)
 			{
-				uint64_t nTokenMask = MicroProfileGetGroupMask(S.TimerInfo[i].nToken);
-				if(nTokenMask & nMask)
+				if(S.TimerInfo[i].nGroupIndex == j)
 				{
 					if(nY >= 0)
 						CB(i, nCount, nX, nY, pData);
@@ -1612,39 +1687,37 @@ void MicroProfileLoopActiveGroupsDraw(int32_t nX, int32_t nY, MicroProfileLoopGr
 }
 
 
-void MicroProfileCalcTimers(float* pTimers, float* pAverage, float* pMax, float* pMin, float* pCallAverage, float* pExclusive, float* pAverageExclusive, float* pMaxExclusive, uint64_t nGroup, uint32_t nSize)
+void MicroProfileCalcTimers(float* pTimers, float* pAverage, float* pMax, float* pMin, float* pCallAverage, float* pExclusive, float* pAverageExclusive, float* pMaxExclusive, const MicroProfileGroupMask& nGroup, uint32_t nSize)
 {
 	MicroProfile& S = *MicroProfileGet();
 
 	uint32_t nCount = 0;
-	uint64_t nMask = 1;
 
 	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
 	{
-		if(nMask & nGroup)
+		if(nGroup.Test(j))
 		{
 			const float fToMs = MicroProfileTickToMsMultiplier(S.GroupInfo[j].Type == MicroProfileTokenTypeGpu ? MicroProfileTicksPerSecondGpu() : MicroProfileTicksPerSecondCpu());
 			for(uint32_t i = 0; i < S.nTotalTimers;++i)
 			{
-				uint64_t nTokenMask = MicroProfileGetGroupMask(S.TimerInfo[i].nToken);
-				if(nTokenMask & nMask)
+				if(S.TimerInfo[i].nGroupIndex == j)
 				{
 					MP_ASSERT(nCount + 2 <= nSize);
 					{
 						uint32_t nTimer = i;
 						uint32_t nIdx = nCount;
 						uint32_t nAggregateFrames = S.nAggregateFrames ? S.nAggregateFrames : 1;
-						uint32_t nAggregateCount = S.Aggregate[nTimer].nCount ? S.Aggregate[nTimer].nCount : 1;
+						uint32_t nAggregateCount = S.AggregateCount[nTimer] ? S.AggregateCount[nTimer] : 1;
 						float fToPrc = S.fRcpReferenceTime;
-						float fMs = fToMs * (S.Frame[nTimer].nTicks);
+						float fMs = fToMs * (S.FrameTicks[nTimer]);
 						float fPrc = MicroProfileMin(fMs * fToPrc, 1.f);
-						float fAverageMs = fToMs * (S.Aggregate[nTimer].nTicks / nAggregateFrames);
+						float fAverageMs = fToMs * (S.AggregateTicks[nTimer] / nAggregateFrames);
 						float fAveragePrc = MicroProfileMin(fAverageMs * fToPrc, 1.f);
 						float fMaxMs = fToMs * (S.AggregateMax[nTimer]);
 						float fMaxPrc = MicroProfileMin(fMaxMs * fToPrc, 1.f);
 						float fMinMs = fToMs * (S.AggregateMin[nTimer] != uint64_t(-1) ? S.AggregateMin[nTimer] : 0);
 						float fMinPrc = MicroProfileMin(fMinMs * fToPrc, 1.f);
-						float fCallAverageMs = fToMs * (S.Aggregate[nTimer].nTicks / nAggregateCount);
+						float fCallAverageMs = fToMs * (S.AggregateTicks[nTimer] / nAggregateCount);
 						float fCallAveragePrc = MicroProfileMin(fCallAverageMs * fToPrc, 1.f);
 						float fMsExclusive = fToMs * (S.FrameExclusive[nTimer]);
 						float fPrcExclusive = MicroProfileMin(fMsExclusive * fToPrc, 1.f);
@@ -1673,7 +1746,6 @@ void MicroProfileCalcTimers(float* pTimers, float* pAverage, float* pMax, float*
 				}
 			}
 		}
-		nMask <<= 1ll;
 	}
 }
 
@@ -1718,7 +1790,7 @@ void MicroProfileDrawBarCallCountCallback(uint32_t nTimer, uint32_t nIdx, uint32
 
 	MicroProfile& S = *MicroProfileGet();
 	char sBuffer[SBUF_MAX];
-	int nLen = snprintf(sBuffer, SBUF_MAX-1, "%5d", S.Frame[nTimer].nCount);//fix
+	int nLen = snprintf(sBuffer, SBUF_MAX-1, "%5d", (int)S.FrameCount[nTimer]);
 	MicroProfileDrawText(nX, nY, (uint32_t)-1, sBuffer, nLen);
 }
 
@@ -1794,7 +1866,17 @@ void MicroProfileDrawBarLegendCallback(uint32_t nTimer, uint32_t nIdx, uint32_t
 	{
 		MicroProfileDrawText(nX, nY, S.TimerInfo[nTimer].nColor, ">", 1);
 	}
-	MicroProfileDrawTextRight(nX, nY, S.TimerInfo[nTimer].nColor, S.TimerInfo[nTimer].pName, (uint32_t)strlen(S.TimerInfo[nTimer].pName));
+	if(S.TimerSampleRate[nTimer] > 1)
+	{
+		//sampled timers are estimates, marked with ~. timers disabled by the overhead governor are marked with -
+		char Buffer[MICROPROFILE_NAME_MAX_LEN+1];
+		int nLen = snprintf(Buffer, sizeof(Buffer), "%c%s", S.TimerSampleRate[nTimer] == MICROPROFILE_SAMPLE_DISABLED ? '-' : '~', S.TimerInfo[nTimer].pName);
+		MicroProfileDrawTextRight(nX, nY, S.TimerInfo[nTimer].nColor, Buffer, (uint32_t)MicroProfileMin(nLen, (int)sizeof(Buffer)-1));
+	}
+	else
+	{
+		MicroProfileDrawTextRight(nX, nY, S.TimerInfo[nTimer].nColor, S.TimerInfo[nTimer].pName, (uint32_t)strlen(S.TimerInfo[nTimer].pName));
+	}
 	if(UI.nMouseY >= nY && UI.nMouseY < nY + MICROPROFILE_TEXT_HEIGHT+1)
 	{
 		UI.nHoverToken = nTimer;
@@ -1920,7 +2002,7 @@ void MicroProfileDumpTimers()
 {
 	MicroProfile& S = *MicroProfileGet();
 
-	uint64_t nActiveGroup = S.nGroupMask;
+	const MicroProfileGroupMask& nActiveGroup = S.nGroupMask;
 
 	uint32_t nNumTimers = S.nTotalTimers;
 	uint32_t nBlockSize = 2 * nNumTimers;
@@ -1946,14 +2028,12 @@ void MicroProfileDumpTimers()
 
 	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
 	{
-		uint64_t nMask = 1ll << j;
-		if(nMask & nActiveGroup)
+		if(nActiveGroup.Test(j))
 		{
 			MICROPROFILE_PRINTF("%s\n", S.GroupInfo[j].pName);
 			for(uint32_t i = 0; i < S.nTotalTimers;++i)
 			{
-				uint64_t nTokenMask = MicroProfileGetGroupMask(S.TimerInfo[i].nToken);
-				if(nTokenMask & nMask)
+				if(S.TimerInfo[i].nGroupIndex == j)
 				{
 					uint32_t nIdx = i * 2;
 					MICROPROFILE_PRINTF("%9.2fms, ", pTimers[nIdx]);
@@ -1961,7 +2041,7 @@ void MicroProfileDumpTimers()
 					MICROPROFILE_PRINTF("%9.2fms, ", pMax[nIdx]);
 					MICROPROFILE_PRINTF("%9.2fms, ", pMin[nIdx]);
 					MICROPROFILE_PRINTF("%9.2fms, ", pCallAverage[nIdx]);
-					MICROPROFILE_PRINTF("%9d, ", S.Frame[i].nCount);
+					MICROPROFILE_PRINTF("%9d, ", (int)S.FrameCount[i]);
 					MICROPROFILE_PRINTF("%9.2fms, ", pTimersExclusive[nIdx]);
 					MICROPROFILE_PRINTF("%9.2fms, ", pAverageExclusive[nIdx]);
 					MICROPROFILE_PRINTF("%9.2fms, ", pMaxExclusive[nIdx]);
@@ -2000,7 +2080,7 @@ uint32_t MicroProfileDrawCounterRecursive(uint32_t nIndex, uint32_t nY, uint32_t
 
 	MicroProfileDrawText(nIndent + MICROPROFILE_TEXT_WIDTH+1, nY0, 0xffffffff, CI.pName, CI.nNameLen);
 	char buffer[64];
-	int64_t nCounterValue = S.Counters[nIndex].load();
+	int64_t nCounterValue = MicroProfileCounterValue(nIndex);
 	uint32_t nX = nTimerWidth + nCounterWidth;
 	int nLen = MicroProfileFormatCounter(S.CounterInfo[nIndex].eFormat, nCounterValue, buffer, sizeof(buffer));
 	UI.nCounterWidthTemp = MicroProfileMax((uint32_t)nLen, UI.nCounterWidthTemp);
@@ -2232,8 +2312,8 @@ void MicroProfileDrawBarView(uint32_t nScreenWidth, uint32_t nScreenHeight)
 
 	MicroProfile& S = *MicroProfileGet();
 
-	uint64_t nActiveGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
-	if(!nActiveGroup)
+	const MicroProfileGroupMask& nActiveGroup = S.nAllGroupsWanted ? S.nGroupMask : S.nActiveGroupWanted;
+	if(!nActiveGroup.Any())
 		return;
 	MICROPROFILE_SCOPE(g_MicroProfileDrawBarView);
 
@@ -2244,7 +2324,7 @@ void MicroProfileDrawBarView(uint32_t nScreenWidth, uint32_t nScreenHeight)
 	uint32_t nNumGroups = 0;
 	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
 	{
-		if(nActiveGroup & (1ll << j))
+		if(nActiveGroup.Test(j))
 		{
 			nNumTimers += S.GroupInfo[j].nNumTimers;
 			nNumGroups += 1;
@@ -2361,7 +2441,7 @@ void MicroProfileDrawBarView(uint32_t nScreenWidth, uint32_t nScreenHeight)
 
 	for(uint32_t j = 0; j < MICROPROFILE_MAX_GROUPS; ++j)
 	{
-		if(nActiveGroup & (1ll << j))
+		if(nActiveGroup.Test(j))
 		{
 			MicroProfileDrawText(nX, nY + (1+nHeight) * nLegendOffset, (uint32_t)-1, S.GroupInfo[j].pName, S.GroupInfo[j].nNameLen);
 			nLegendOffset += S.GroupInfo[j].nNumTimers+1;
@@ -2428,13 +2508,12 @@ const char* MicroProfileUIMenuGroups(int nIndex, bool* bSelected)
 			static char buffer[MICROPROFILE_NAME_MAX_LEN+32];
 			if(Item.nIsCategory)
 			{
-				uint64_t nGroupMask = S.CategoryInfo[Item.nIndex].nGroupMask;
-				*bSelected = nGroupMask == (nGroupMask & S.nActiveGroupWanted);
+				*bSelected = S.nActiveGroupWanted.Contains(S.CategoryInfo[Item.nIndex].nGroupMask);
 				snprintf(buffer, sizeof(buffer)-1, "[%s]", Item.pName);
 			}
 			else
 			{
-				*bSelected = 0 != (S.nActiveGroupWanted & (1ll << Item.nIndex));
+				*bSelected = S.nActiveGroupWanted.Test(Item.nIndex);
 				snprintf(buffer, sizeof(buffer)-1, "   %s", Item.pName);
 			}
 			return buffer;
@@ -2443,6 +2522,42 @@ const char* MicroProfileUIMenuGroups(int nIndex, bool* bSelected)
 	}	
 }
 
+//threads other than the gpu log, in pool order
+MicroProfileThreadLog* MicroProfileUIThreadMenuLog(int nIndex, uint32_t* pLogIndex)
+{
+	MicroProfile& S = *MicroProfileGet();
+	for(uint32_t i = 0; i < S.nNumLogs; ++i)
+	{
+		MicroProfileThreadLog* pLog = S.Pool[i];
+		if(pLog->nActive && !pLog->nGpu && 0 == nIndex--)
+		{
+			*pLogIndex = i;
+			return pLog;
+		}
+	}
+	return 0;
+}
+
+const char* MicroProfileUIMenuThreads(int nIndex, bool* bSelected)
+{
+	MicroProfile& S = *MicroProfileGet();
+	*bSelected = false;
+	if(nIndex == 0)
+	{
+		*bSelected = S.nAllThreadsWanted != 0;
+		return "[ALL]";
+	}
+	uint32_t nLogIndex;
+	if(MicroProfileThreadLog* pLog = MicroProfileUIThreadMenuLog(nIndex-1, &nLogIndex))
+	{
+		static char buffer[MicroProfileThreadLog::THREAD_MAX_LEN+32];
+		*bSelected = S.nThreadActive[nLogIndex] != 0;
+		snprintf(buffer, sizeof(buffer)-1, "   %s", pLog->ThreadName);
+		return buffer;
+	}
+	return 0;
+}
+
 const char* MicroProfileUIMenuAggregate(int nIndex, bool* bSelected)
 {
 	MicroProfile& S = *MicroProfileGet();
@@ -2640,25 +2755,35 @@ void MicroProfileUIClickGroups(int nIndex)
 			MicroProfileGroupMenuItem& Item = UI.GroupMenu[nIndex];
 			if(Item.nIsCategory)
 			{
-				uint64_t nGroupMask = S.CategoryInfo[Item.nIndex].nGroupMask;
-				if(nGroupMask != (nGroupMask & S.nActiveGroupWanted))
+				const MicroProfileGroupMask& nGroupMask = S.CategoryInfo[Item.nIndex].nGroupMask;
+				if(!S.nActiveGroupWanted.Contains(nGroupMask))
 				{
-					S.nActiveGroupWanted |= nGroupMask;
+					S.nActiveGroupWanted.Add(nGroupMask);
 				}
 				else
 				{
-					S.nActiveGroupWanted &= ~nGroupMask;
+					S.nActiveGroupWanted.Remove(nGroupMask);
 				}
 			}
 			else
 			{
 				MP_ASSERT(Item.nIndex < S.nGroupCount);
-				S.nActiveGroupWanted ^= (1ll << Item.nIndex);
+				S.nActiveGroupWanted.Toggle(Item.nIndex);
 			}
 		}
 	}
 }
 
+void MicroProfileUIClickThreads(int nIndex)
+{
+	MicroProfile& S = *MicroProfileGet();
+	uint32_t nLogIndex;
+	if(nIndex == 0)
+		S.nAllThreadsWanted = 1-S.nAllThreadsWanted;
+	else if(MicroProfileUIThreadMenuLog(nIndex-1, &nLogIndex))
+		S.nThreadActive[nLogIndex] = 1-S.nThreadActive[nLogIndex];
+}
+
 void MicroProfileUIClickAggregate(int nIndex)
 {
 	MicroProfile& S = *MicroProfileGet();			
@@ -2800,6 +2925,7 @@ void MicroProfileDrawMenu(uint32_t nWidth, uint32_t nHeight)
 	nX += (sizeof("MicroProfile")+2) * (MICROPROFILE_TEXT_WIDTH+1);
 	pMenuText[nNumMenuItems++] = "Mode";
 	pMenuText[nNumMenuItems++] = "Groups";
+	pMenuText[nNumMenuItems++] = "Threads";
 	char AggregateText[64];
 	snprintf(AggregateText, sizeof(AggregateText)-1, "Aggregate[%d]", S.nAggregateFlip ? S.nAggregateFlip : S.nAggregateFlipCount);
 	pMenuText[nNumMenuItems++] = &AggregateText[0];
@@ -2860,6 +2986,7 @@ void MicroProfileDrawMenu(uint32_t nWidth, uint32_t nHeight)
 	{
 		MicroProfileUIMenuMode,
 		MicroProfileUIMenuGroups,
+		MicroProfileUIMenuThreads,
 		MicroProfileUIMenuAggregate,
 		MicroProfileUIMenuTimers,
 		MicroProfileUIMenuOptions,
@@ -2872,6 +2999,7 @@ void MicroProfileDrawMenu(uint32_t nWidth, uint32_t nHeight)
 	{
 		MicroProfileUIClickMode,
 		MicroProfileUIClickGroups,
+		MicroProfileUIClickThreads,
 		MicroProfileUIClickAggregate,
 		MicroProfileUIClickTimers,
 		MicroProfileUIClickOptions,
@@ -3037,8 +3165,8 @@ void MicroProfileDrawCustom(uint32_t nWidth, uint32_t nHeight)
 			uint16_t nTimerIndex = MicroProfileGetTimerIndex(pCustom->pTimers[i]);
 			uint16_t nGroupIndex = MicroProfileGetGroupIndex(pCustom->pTimers[i]);
 			float fToMs = MicroProfileTickToMsMultiplier(S.GroupInfo[nGroupIndex].Type == MicroProfileTokenTypeGpu ? MicroProfileTicksPerSecondGpu() : MicroProfileTicksPerSecondCpu());
-			pTime[i] = S.Frame[nTimerIndex].nTicks * fToMs;
-			pTimeAvg[i] = fToMs * (S.Aggregate[nTimerIndex].nTicks / nAggregateFrames);
+			pTime[i] = S.FrameTicks[nTimerIndex] * fToMs;
+			pTimeAvg[i] = fToMs * (S.AggregateTicks[nTimerIndex] / nAggregateFrames);
 			pTimeMax[i] = fToMs * (S.AggregateMax[nTimerIndex]);
 			pColors[i] = S.TimerInfo[nTimerIndex].nColor;
 		}
@@ -3261,8 +3389,9 @@ void MicroProfileDraw(uint32_t nWidth, uint32_t nHeight)
 					{
 						uint32_t nEnd = pFrameNext->nLogStart[i];
 						uint32_t nStart = pFrameCurrent->nLogStart[i];
-						uint32_t nUsage = nStart <= nEnd ? (nEnd - nStart) : (nEnd + MICROPROFILE_BUFFER_SIZE - nStart);
-						uint32_t nFrameSupport = (nUsage == 0) ? MICROPROFILE_BUFFER_SIZE : MICROPROFILE_BUFFER_SIZE / nUsage;
+						uint32_t nSize = MicroProfileLogSize(S.Pool[i]);
+						uint32_t nUsage = nStart <= nEnd ? (nEnd - nStart) : (nEnd + nSize - nStart);
+						uint32_t nFrameSupport = (nUsage == 0) ? nSize : nSize / nUsage;
 						MicroProfileStringArrayFormat(&Debug, "%s", &S.Pool[i]->ThreadName[0]);
 						MicroProfileStringArrayFormat(&Debug, "%9d [%7d]", nUsage, nFrameSupport);
 					}
@@ -3496,7 +3625,7 @@ void MicroProfileDrawLineHorizontal(int nLeft, int nRight, int nY, uint32_t nCol
 #include <stdio.h>
 
 #define MICROPROFILE_PRESET_HEADER_MAGIC 0x28586813
-#define MICROPROFILE_PRESET_HEADER_VERSION 0x00000102
+#define MICROPROFILE_PRESET_HEADER_VERSION 0x00000103
 struct MicroProfilePresetHeader
 {
 	uint32_t nMagic;
@@ -3549,10 +3678,9 @@ void MicroProfileSavePreset(const char* pPresetName)
 	Header.nOpacityForeground = UI.nOpacityForeground;
 	Header.nShowSpikes = UI.bShowSpikes ? 1 : 0;
 	fwrite(&Header, sizeof(Header), 1, F);
-	uint64_t nMask = 1;
 	for(uint32_t i = 0; i < MICROPROFILE_MAX_GROUPS; ++i)
 	{
-		if(S.nActiveGroupWanted & nMask)
+		if(S.nActiveGroupWanted.Test(i))
 		{
 			uint32_t offset = ftell(F);
 			const char* pName = S.GroupInfo[i].pName;
@@ -3560,7 +3688,6 @@ void MicroProfileSavePreset(const char* pPresetName)
 			fwrite(pName, nLen, 1, F);
 			Header.nGroups[i] = offset;
 		}
-		nMask <<= 1;
 	}
 	for(uint32_t i = 0; i < MICROPROFILE_MAX_THREADS; ++i)
 	{
@@ -3638,7 +3765,7 @@ void MicroProfileLoadPreset(const char* pSuffix)
 	S.nAllGroupsWanted = Header.nAllGroupsWanted;
 	S.nAllThreadsWanted = Header.nAllThreadsWanted;
 	S.nDisplay = Header.nDisplay;
-	S.nActiveGroupWanted = 0;
+	S.nActiveGroupWanted.Reset();
 	UI.nOpacityBackground = Header.nOpacityBackground;
 	UI.nOpacityForeground = Header.nOpacityForeground;
 	UI.bShowSpikes = Header.nShowSpikes == 1;
@@ -3654,7 +3781,7 @@ void MicroProfileLoadPreset(const char* pSuffix)
 			{
 				if(0 == MP_STRCASECMP(pGroupName, S.GroupInfo[j].pName))
 				{
-					S.nActiveGroupWanted |= (1ll << j);
+					S.nActiveGroupWanted.Set(j);
 				}
 			}
 		}
@@ -3687,7 +3814,7 @@ void MicroProfileLoadPreset(const char* pSuffix)
 				uint64_t nGroupIndex = S.TimerInfo[j].nGroupIndex;
 				if(0 == MP_STRCASECMP(pGraphName, S.TimerInfo[j].pName) && 0 == MP_STRCASECMP(pGraphGroupName, S.GroupInfo[nGroupIndex].pName))
 				{
-					MicroProfileToken nToken = MicroProfileMakeToken(1ll << nGroupIndex, (uint16_t)j);
+					MicroProfileToken nToken = MicroProfileMakeToken((uint16_t)nGroupIndex, (uint16_t)j);
 					S.Graph[i].nToken = nToken;			// note: group index is stored here but is checked without in MicroProfileToggleGraph()!
 					S.TimerInfo[j].bGraph = true;
 					if(nToken != nPrevToken)
@@ -3802,7 +3929,7 @@ void MicroProfileCustomGroupEnable(const char* pCustomName)
 void MicroProfileCustomGroupDisable()
 {
 	MicroProfile& S = *MicroProfileGet();
-	S.nForceGroupUI = 0;
+	S.nForceGroupUI.Reset();
 	UI.nCustomActive = (uint32_t)-1;
 }
 
@@ -3819,7 +3946,7 @@ void MicroProfileCustomGroupAddTimer(const char* pCustomName, const char* pGroup
 	MP_ASSERT(nToken != MICROPROFILE_INVALID_TOKEN); //Timer must be registered first.
 	UI.Custom[nIndex].pTimers[nTimerIndex] = nToken;	
 	uint16_t nGroup = MicroProfileGetGroupIndex(nToken);
-	UI.Custom[nIndex].nGroupMask |= (1ll << nGroup);
+	UI.Custom[nIndex].nGroupMask.Set(nGroup);
 	UI.Custom[nIndex].nNumTimers++;
 }
 
@@ -0,0 +1,86 @@
+// times the html and csv dumps of a captured session, writing to memory so only formatting is measured.
+// usage: bench_dump.o [frames] [events] [repeats]
+// events are enter/leave pairs logged per frame. prints a bench_dump key=value line per format
+#define MICROPROFILE_IMPL
+#include "microprofile.h"
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+	NUM_TIMERS = 64,
+};
+
+struct DumpBuffer
+{
+	std::vector<char> Data;
+};
+
+static void DumpWrite(void* Handle, size_t nSize, const char* pData)
+{
+	DumpBuffer* pBuffer = (DumpBuffer*)Handle;
+	pBuffer->Data.insert(pBuffer->Data.end(), pData, pData + nSize);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nFrames = argc > 1 ? (uint32_t)atoi(argv[1]) : 64;
+	uint32_t nEvents = argc > 2 ? (uint32_t)atoi(argv[2]) : 2000;
+	uint32_t nRepeats = argc > 3 ? (uint32_t)atoi(argv[3]) : 5;
+	nRepeats = nRepeats < 1 ? 1 : nRepeats;
+
+	MicroProfileOnThreadCreate("Main");
+	MicroProfileSetEnableAllGroups(true);
+	MicroProfileToken Tokens[NUM_TIMERS];
+	for(uint32_t i = 0; i < NUM_TIMERS; ++i)
+	{
+		char Name[32];
+		snprintf(Name, sizeof(Name), "Timer%u", i);
+		Tokens[i] = MicroProfileGetToken("Bench", Name, -1);
+	}
+	MicroProfileToken Label = MicroProfileGetLabelToken("Bench");
+	MicroProfileToken Counter = MicroProfileGetCounterToken("bench/events");
+
+	//nested scopes two deep, every 16th with a label
+	for(uint32_t nFrame = 0; nFrame < nFrames; ++nFrame)
+	{
+		for(uint32_t i = 0; i < nEvents; i += 2)
+		{
+			MicroProfileToken Outer = Tokens[i % NUM_TIMERS];
+			MicroProfileToken Inner = Tokens[(i + 1) % NUM_TIMERS];
+			uint64_t nOuter = MicroProfileEnter(Outer);
+			uint64_t nInner = MicroProfileEnter(Inner);
+			if(0 == (i % 16))
+				MicroProfileLabelFormat(Label, "frame %u item %u", nFrame, i);
+			MicroProfileLeave(Inner, nInner);
+			MicroProfileLeave(Outer, nOuter);
+		}
+		MicroProfileCounterAdd(Counter, nEvents);
+		MicroProfileFlip();
+	}
+
+	for(int nFormat = 0; nFormat < 2; ++nFormat)
+	{
+		DumpBuffer Buffer;
+		double fSeconds = 0, fMin = 1e9;
+		for(uint32_t i = 0; i < nRepeats; ++i)
+		{
+			Buffer.Data.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			if(nFormat)
+				MicroProfileDumpCsv(DumpWrite, &Buffer, nFrames);
+			else
+				MicroProfileDumpHtml(DumpWrite, &Buffer, nFrames, "bench");
+			double fDump = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+			fSeconds += fDump;
+			fMin = fDump < fMin ? fDump : fMin;
+		}
+		double fMB = Buffer.Data.size() / (1024.0 * 1024.0);
+		printf("bench_dump format=%s frames=%u events=%u bytes=%u ms_per_dump=%.2f mb_per_s=%.1f mb_per_s_max=%.1f\n", nFormat ? "csv" : "html", nFrames, nEvents,
+			(uint32_t)Buffer.Data.size(), fSeconds * 1e3 / nRepeats, fMB * nRepeats / fSeconds, fMB / fMin);
+	}
+	MicroProfileOnThreadExit();
+	return 0;
+}
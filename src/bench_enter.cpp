@@ -0,0 +1,123 @@
+// times an enter/leave pair on one thread, in a disabled and an enabled group, and with a label, formatted label, counter or meta update inside.
+// usage: bench_enter.o [pairs]
+// prints one line per case, as bench_enter case=<name> key=value ...
+#define MICROPROFILE_IMPL
+#include "microprofile.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+	PAIRS_PER_FRAME = 4096, //flip often enough that the thread buffer never fills
+};
+
+enum BenchCase
+{
+	CASE_DISABLED,
+	CASE_ENABLED,
+	CASE_LABEL,
+	CASE_LABELF,
+	CASE_COUNTER,
+	CASE_META,
+	CASE_COUNT,
+};
+
+static const char* g_CaseNames[CASE_COUNT] = { "disabled", "enabled", "label", "labelf", "counter", "meta" };
+
+static MicroProfileToken g_TokenOff;
+static MicroProfileToken g_TokenOn;
+static MicroProfileToken g_TokenLabel;
+static MicroProfileToken g_TokenCounter;
+static MicroProfileToken g_TokenMeta;
+
+static void RunPairs(BenchCase eCase, uint32_t nPairs)
+{
+	for(uint32_t i = 0; i < nPairs; ++i)
+	{
+		switch(eCase)
+		{
+		case CASE_DISABLED:
+		{
+			uint64_t nTick = MicroProfileEnter(g_TokenOff);
+			MicroProfileLeave(g_TokenOff, nTick);
+			break;
+		}
+		case CASE_ENABLED:
+		{
+			uint64_t nTick = MicroProfileEnter(g_TokenOn);
+			MicroProfileLeave(g_TokenOn, nTick);
+			break;
+		}
+		case CASE_LABEL:
+		{
+			uint64_t nTick = MicroProfileEnter(g_TokenOn);
+			MicroProfileLabel(g_TokenLabel, "bench label");
+			MicroProfileLeave(g_TokenOn, nTick);
+			break;
+		}
+		case CASE_LABELF:
+		{
+			uint64_t nTick = MicroProfileEnter(g_TokenOn);
+			MicroProfileLabelFormat(g_TokenLabel, "item %d of %s", (int)i, "bench");
+			MicroProfileLeave(g_TokenOn, nTick);
+			break;
+		}
+		case CASE_COUNTER:
+		{
+			uint64_t nTick = MicroProfileEnter(g_TokenOn);
+			MicroProfileCounterAdd(g_TokenCounter, 1);
+			MicroProfileLeave(g_TokenOn, nTick);
+			break;
+		}
+		case CASE_META:
+		{
+			uint64_t nTick = MicroProfileEnter(g_TokenOn);
+			MicroProfileMetaUpdate(g_TokenMeta, 1, MicroProfileTokenTypeCpu);
+			MicroProfileLeave(g_TokenOn, nTick);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nPairs = argc > 1 ? (uint32_t)atoi(argv[1]) : (1 << 22);
+	nPairs = nPairs < PAIRS_PER_FRAME ? (uint32_t)PAIRS_PER_FRAME : nPairs;
+
+	MicroProfileOnThreadCreate("Main");
+	MicroProfileSetEnableAllGroups(false);
+	MicroProfileForceEnableGroup("Bench", MicroProfileTokenTypeCpu);
+	MicroProfileSetForceMetaCounters(true);
+	g_TokenOff = MicroProfileGetToken("Off", "Off", -1);
+	g_TokenOn = MicroProfileGetToken("Bench", "On", -1);
+	g_TokenLabel = MicroProfileGetLabelToken("Bench");
+	g_TokenCounter = MicroProfileGetCounterToken("bench/counter");
+	g_TokenMeta = MicroProfileGetMetaToken("BenchMeta");
+	MicroProfileFlip();
+
+	for(int i = 0; i < CASE_COUNT; ++i)
+	{
+		BenchCase eCase = (BenchCase)i;
+		RunPairs(eCase, PAIRS_PER_FRAME); //warm up caches and the thread log
+		MicroProfileFlip();
+		double fSeconds = 0;
+		double fBatchMin = 1e9; //the fastest frame, less affected by preemption than the mean
+		for(uint32_t nDone = 0; nDone < nPairs; nDone += PAIRS_PER_FRAME)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			RunPairs(eCase, PAIRS_PER_FRAME);
+			double fBatch = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+			fSeconds += fBatch;
+			fBatchMin = fBatch < fBatchMin ? fBatch : fBatchMin;
+			MicroProfileFlip();
+		}
+		uint32_t nMeasured = (nPairs + PAIRS_PER_FRAME - 1) / PAIRS_PER_FRAME * PAIRS_PER_FRAME;
+		printf("bench_enter case=%s pairs=%u ns_per_pair=%.2f ns_per_pair_min=%.2f\n", g_CaseNames[i], nMeasured, fSeconds * 1e9 / nMeasured, fBatchMin * 1e9 / PAIRS_PER_FRAME);
+	}
+	MicroProfileOnThreadExit();
+	return 0;
+}
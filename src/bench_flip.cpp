@@ -0,0 +1,130 @@
+// times MicroProfileFlipCpu, the cpu side of MicroProfileFlip, against the number of registered timers, the number of threads logging and the events each thread logs per frame.
+// usage: bench_flip.o [timers threads events]
+// without arguments, runs a sweep of each, printing a bench_flip key=value line per configuration
+#define MICROPROFILE_IMPL
+#define MICROPROFILE_MAX_TIMERS 8192
+#include "microprofile.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+	MAX_WORKERS = 16,
+	MAX_BENCH_TIMERS = 8000, //leaves room for the timers the profiler registers itself
+	WARMUP_FRAMES = 4,
+	MEASURE_FRAMES = 32,
+};
+
+static MicroProfileToken g_Tokens[MAX_BENCH_TIMERS];
+static uint32_t g_nTimers;
+static std::atomic<uint32_t> g_nFrame;
+static std::atomic<uint32_t> g_nLogged;
+static std::atomic<int> g_nStop;
+static uint32_t g_nThreads;
+static uint32_t g_nEvents;
+
+//each frame, the first g_nThreads workers log g_nEvents enter/leave pairs spread over the timers, then wait for the flip
+static void WorkerMain(uint32_t nIndex)
+{
+	char Name[32];
+	snprintf(Name, sizeof(Name), "Worker%u", nIndex);
+	MicroProfileOnThreadCreate(Name);
+	uint32_t nFrame = 0;
+	while(!g_nStop.load())
+	{
+		uint32_t nNext = g_nFrame.load();
+		if(nNext == nFrame)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		nFrame = nNext;
+		if(nIndex < g_nThreads)
+		{
+			uint32_t nTimer = nIndex;
+			for(uint32_t i = 0; i < g_nEvents; ++i)
+			{
+				MicroProfileToken Token = g_Tokens[nTimer];
+				uint64_t nTick = MicroProfileEnter(Token);
+				MicroProfileLeave(Token, nTick);
+				nTimer = nTimer + 1 == g_nTimers ? 0 : nTimer + 1;
+			}
+		}
+		g_nLogged.fetch_add(1);
+	}
+	MicroProfileOnThreadExit();
+}
+
+static void RunFrame(double* pFlipUs)
+{
+	g_nLogged.store(0);
+	g_nFrame.fetch_add(1);
+	while(g_nLogged.load() != MAX_WORKERS)
+		std::this_thread::yield();
+	auto Start = std::chrono::high_resolution_clock::now();
+	MicroProfileFlipCpu(); //no gpu timers are logged, so the gpu side has nothing to flip
+	*pFlipUs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count() * 1e6;
+}
+
+//timers can only be added, so configurations are run in order of increasing timer count
+static void Run(uint32_t nTimers, uint32_t nThreads, uint32_t nEvents)
+{
+	for(uint32_t i = g_nTimers; i < nTimers; ++i)
+	{
+		char Name[32];
+		snprintf(Name, sizeof(Name), "Timer%u", i);
+		g_Tokens[i] = MicroProfileGetToken("Bench", Name, -1);
+	}
+	g_nTimers = nTimers;
+	g_nThreads = nThreads;
+	g_nEvents = nEvents;
+	double fFlipUs = 0;
+	for(uint32_t i = 0; i < WARMUP_FRAMES; ++i)
+		RunFrame(&fFlipUs);
+	double fSum = 0, fMin = 1e9, fMax = 0;
+	for(uint32_t i = 0; i < MEASURE_FRAMES; ++i)
+	{
+		RunFrame(&fFlipUs);
+		fSum += fFlipUs;
+		fMin = fFlipUs < fMin ? fFlipUs : fMin;
+		fMax = fFlipUs > fMax ? fFlipUs : fMax;
+	}
+	printf("bench_flip timers=%u threads=%u events=%u us_per_flip=%.1f us_per_flip_min=%.1f us_per_flip_max=%.1f\n", nTimers, nThreads, nEvents, fSum / MEASURE_FRAMES, fMin, fMax);
+}
+
+int main(int argc, char** argv)
+{
+	MicroProfileOnThreadCreate("Main");
+	MicroProfileSetEnableAllGroups(true);
+	std::thread Workers[MAX_WORKERS];
+	for(uint32_t i = 0; i < MAX_WORKERS; ++i)
+		Workers[i] = std::thread(WorkerMain, i);
+
+	if(argc > 3)
+	{
+		uint32_t nTimers = (uint32_t)atoi(argv[1]);
+		uint32_t nThreads = (uint32_t)atoi(argv[2]);
+		nTimers = nTimers < 1 ? 1 : nTimers > MAX_BENCH_TIMERS ? (uint32_t)MAX_BENCH_TIMERS : nTimers;
+		nThreads = nThreads > MAX_WORKERS ? (uint32_t)MAX_WORKERS : nThreads;
+		Run(nTimers, nThreads, (uint32_t)atoi(argv[3]));
+	}
+	else
+	{
+		const uint32_t Timers[] = { 64, 1024, MAX_BENCH_TIMERS };
+		const uint32_t Threads[] = { 1, 4, MAX_WORKERS };
+		const uint32_t Events[] = { 0, 1000, 10000 };
+		for(uint32_t nTimers : Timers)
+			for(uint32_t nThreads : Threads)
+				for(uint32_t nEvents : Events)
+					Run(nTimers, nThreads, nEvents);
+	}
+
+	g_nStop.store(1);
+	for(uint32_t i = 0; i < MAX_WORKERS; ++i)
+		Workers[i].join();
+	MicroProfileOnThreadExit();
+	return 0;
+}
@@ -0,0 +1,70 @@
+// times the flip statistics kernels over tens of thousands of timers, for each instruction set the cpu supports.
+// usage: bench_stats.o [timers] [iterations]
+// prints a bench_stats key=value line per instruction set
+#define MICROPROFILE_IMPL
+#include "microprofile.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct Kernels
+{
+	const char* pName;
+	MicroProfileAccumulateFunc* pAccumulate;
+	MicroProfileTicksToMsFunc* pTicksToMs;
+	uint32_t nLevel;
+};
+
+int main(int argc, char** argv)
+{
+	uint32_t nTimers = argc > 1 ? (uint32_t)atoi(argv[1]) : 32768;
+	uint32_t nIterations = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000;
+	nTimers = nTimers < 1 ? 1 : nTimers;
+
+	std::vector<uint64_t> Value(nTimers), Sum(nTimers), Max(nTimers), Min(nTimers, uint64_t(-1));
+	std::vector<float> ToMs(nTimers, 1e-6f), Ms(nTimers);
+	for(uint32_t i = 0; i < nTimers; ++i)
+		Value[i] = (i * 2654435761u) & 0xfffff;
+
+	Kernels K[] =
+	{
+		{ "scalar", MicroProfileAccumulateScalar, MicroProfileTicksToMsScalar, 0 },
+#if MICROPROFILE_SIMD
+		{ "sse4.2", MicroProfileAccumulateSse42, MicroProfileTicksToMsSse42, 1 },
+		{ "avx2", MicroProfileAccumulateAvx2, MicroProfileTicksToMsAvx2, 2 },
+#endif
+	};
+#if MICROPROFILE_SIMD
+	uint32_t nLevel = MicroProfileSimdLevel();
+#else
+	uint32_t nLevel = 0;
+#endif
+	for(const Kernels& k : K)
+	{
+		if(k.nLevel > nLevel)
+			continue;
+		std::fill(Sum.begin(), Sum.end(), 0);
+		std::fill(Max.begin(), Max.end(), 0);
+		std::fill(Min.begin(), Min.end(), uint64_t(-1));
+		auto Start = std::chrono::high_resolution_clock::now();
+		for(uint32_t i = 0; i < nIterations; ++i)
+		{
+			//the three accumulations done by each flip
+			k.pAccumulate(&Sum[0], &Max[0], &Min[0], &Value[0], nTimers);
+			k.pAccumulate(&Sum[0], 0, 0, &Value[0], nTimers);
+			k.pAccumulate(&Sum[0], &Max[0], 0, &Value[0], nTimers);
+		}
+		auto Mid = std::chrono::high_resolution_clock::now();
+		for(uint32_t i = 0; i < nIterations; ++i)
+		{
+			k.pTicksToMs(&Ms[0], &Sum[0], &ToMs[0], 0.5f, nTimers);
+		}
+		auto End = std::chrono::high_resolution_clock::now();
+		double fAccumulateUs = std::chrono::duration<double>(Mid - Start).count() * 1e6 / nIterations;
+		double fTicksToMsUs = std::chrono::duration<double>(End - Mid).count() * 1e6 / nIterations;
+		printf("bench_stats kernel=%s timers=%u us_accumulate_per_flip=%.1f us_ticks_to_ms_per_array=%.1f checksum=%f\n", k.pName, nTimers, fAccumulateUs, fTicksToMsUs, Ms[nTimers - 1]);
+	}
+	return 0;
+}
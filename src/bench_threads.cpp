@@ -0,0 +1,113 @@
+// worker threads log timers while the main thread flips, which writes state the workers read on every timer.
+// usage: bench_threads.o [threads] [seconds] [aggregate]
+// without a thread count, runs 1, 2, 4 .. up to the hardware thread count, printing a bench_threads key=value line for each
+#define MICROPROFILE_IMPL
+#define MICROPROFILE_AGGREGATE_ONLY 1
+#include "microprofile.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum
+{
+	MAX_WORKERS = 64,
+	PAIRS_PER_BATCH = 256,
+};
+
+static std::atomic<int> g_nStop;
+
+struct Worker
+{
+	MicroProfileToken Token;
+	uint64_t nPairs;
+	double fSeconds;
+	char Name[32];
+};
+
+static void WorkerMain(Worker* pWorker)
+{
+	MicroProfileOnThreadCreate(pWorker->Name);
+	MicroProfileToken Token = pWorker->Token;
+	uint64_t nPairs = 0;
+	auto Start = std::chrono::high_resolution_clock::now();
+	while(!g_nStop.load(std::memory_order_relaxed))
+	{
+		for(int i = 0; i < PAIRS_PER_BATCH; ++i)
+		{
+			uint64_t nTick = MicroProfileEnter(Token);
+			MicroProfileLeave(Token, nTick);
+		}
+		nPairs += PAIRS_PER_BATCH;
+	}
+	pWorker->fSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+	pWorker->nPairs = nPairs;
+	MicroProfileOnThreadExit();
+}
+
+static void RunWorkers(int nThreads, double fDuration, bool bAggregateOnly)
+{
+	static Worker Workers[MAX_WORKERS];
+	std::thread Threads[MAX_WORKERS];
+	g_nStop.store(0);
+	for(int i = 0; i < nThreads; ++i)
+	{
+		snprintf(Workers[i].Name, sizeof(Workers[i].Name), "Worker%d", i);
+		Workers[i].Token = MicroProfileGetToken("Bench", Workers[i].Name, -1);
+	}
+	MicroProfileFlip();
+	for(int i = 0; i < nThreads; ++i)
+		Threads[i] = std::thread(WorkerMain, &Workers[i]);
+
+	//flip at ~1khz, so the shared state is written far more often than a game would
+	uint32_t nFlips = 0;
+	auto Start = std::chrono::high_resolution_clock::now();
+	while(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count() < fDuration)
+	{
+		MicroProfileFlip();
+		nFlips++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	g_nStop.store(1);
+	for(int i = 0; i < nThreads; ++i)
+		Threads[i].join();
+	MicroProfileFlip();
+
+	double fNsTotal = 0;
+	uint64_t nPairsTotal = 0;
+	for(int i = 0; i < nThreads; ++i)
+	{
+		fNsTotal += Workers[i].fSeconds * 1e9;
+		nPairsTotal += Workers[i].nPairs;
+	}
+	printf("bench_threads threads=%d aggregate=%d flips=%u ns_per_pair=%.1f mpairs_per_s=%.1f\n", nThreads, bAggregateOnly ? 1 : 0, nFlips, fNsTotal / nPairsTotal, nPairsTotal / fDuration / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+	int nThreads = argc > 1 ? atoi(argv[1]) : 0;
+	double fDuration = argc > 2 ? atof(argv[2]) : 1.0;
+	bool bAggregateOnly = argc > 3 && 0 == strcmp(argv[3], "aggregate");
+	nThreads = nThreads < 0 ? 0 : nThreads > MAX_WORKERS ? MAX_WORKERS : nThreads;
+
+	MicroProfileOnThreadCreate("Main");
+	MicroProfileSetEnableAllGroups(true);
+	MicroProfileSetAggregateOnly(bAggregateOnly);
+
+	if(nThreads)
+	{
+		RunWorkers(nThreads, fDuration, bAggregateOnly);
+	}
+	else
+	{
+		//scale from 1 to the hardware thread count, doubling each step
+		int nMax = (int)std::thread::hardware_concurrency();
+		nMax = nMax < 1 ? 1 : nMax > MAX_WORKERS ? MAX_WORKERS : nMax;
+		for(int i = 1; i <= nMax; i = i < nMax && 2 * i > nMax ? nMax : 2 * i)
+			RunWorkers(i, fDuration, bAggregateOnly);
+	}
+	MicroProfileOnThreadExit();
+	return 0;
+}
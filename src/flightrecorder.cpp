@@ -0,0 +1,55 @@
+// extracts a time window of a flight recorder file, written by MicroProfileFlightRecorderStart or MicroProfileCrashDumpStart, as a html or csv capture.
+// usage: flightrecorder.o <recording> [<out.html|out.csv> [<begin> <end>]]
+// begin and end are utc seconds, as printed when run without an output. 0 leaves that end of the window open
+#define MICROPROFILE_IMPL
+#define MICROPROFILE_FLIGHT_RECORDER 1
+#define MICROPROFILE_WEBSERVER 0
+#define MICROPROFILE_PER_THREAD_BUFFER_SIZE (64<<20)
+#define MICROPROFILE_LABEL_BUFFER_SIZE (16<<20)
+#include "microprofile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char** argv)
+{
+	if(argc != 2 && argc != 3 && argc != 5)
+	{
+		printf("usage: %s <recording> [<out.html|out.csv> [<begin> <end>]]\n", argv[0]);
+		return 1;
+	}
+	MicroProfileFlightRecorderWindow Window;
+	memset(&Window, 0, sizeof(Window));
+	if(argc == 5)
+	{
+		Window.fTimeBegin = atof(argv[3]);
+		Window.fTimeEnd = atof(argv[4]);
+	}
+	if(!MicroProfileFlightRecorderLoad(argv[1], &Window))
+	{
+		printf("%s is not a flight recorder file\n", argv[1]);
+		return 1;
+	}
+	printf("%s: %.3f - %.3f, %u frames recorded, %u dropped, %u in window, %u loaded\n", argv[1], Window.fRecordingBegin, Window.fRecordingEnd,
+		Window.nFramesRecorded, Window.nFramesDropped, Window.nFramesInWindow, Window.nFramesLoaded);
+	if(argc == 2)
+		return 0;
+	if(!Window.nFramesLoaded)
+	{
+		printf("no frames in window\n");
+		return 1;
+	}
+	FILE* F = fopen(argv[2], "w");
+	if(!F)
+	{
+		printf("could not open %s\n", argv[2]);
+		return 1;
+	}
+	size_t nLen = strlen(argv[2]);
+	if(nLen > 4 && 0 == strcmp(argv[2] + nLen - 4, ".csv"))
+		MicroProfileDumpCsv(MicroProfileWriteFile, F, Window.nFramesLoaded);
+	else
+		MicroProfileDumpHtml(MicroProfileWriteFile, F, Window.nFramesLoaded, argv[1]);
+	fclose(F);
+	return 0;
+}
@@ -1,4 +1,10 @@
 #define MICROPROFILE_IMPL
+#define MICROPROFILE_LABEL_DEFERRED 1
+#define MICROPROFILE_LABEL_INTERN 1
+#define MICROPROFILE_LOG_COMPACT 1
+#define MICROPROFILE_AGGREGATE_ONLY 1
+#define MICROPROFILE_FLIGHT_RECORDER 1
+#define MICROPROFILE_CRASH_DUMP 1
 
 #include "microprofile.h"
 
@@ -7,14 +13,90 @@ int main()
 	MicroProfileSetForceEnable(true);
 
 	MicroProfileOnThreadCreate("Main");
+	MicroProfileFlightRecorderStart("test_noui.mpfr", 8 << 20);
+	MicroProfileCrashDumpStart("test_noui.crash");
 
 	{
 		MICROPROFILE_SCOPEI("Group", "Name", -1);
 		MICROPROFILE_LABEL("Group", "Label");
 		MICROPROFILE_LABELF("Group", "Label %d", 5);
+		MICROPROFILE_LABELF("Group", "Label %s %.2f %u", "deferred", 0.5f, 7u);
+		MICROPROFILE_FLOW_BEGIN(1);
 	}
 
+	{
+		MICROPROFILE_SCOPEI("Group", "Flow", -1);
+		MICROPROFILE_FLOW_END(1);
+	}
+
+	{
+		MICROPROFILE_SCOPEI_ASYNC(Scope, "Group", "Async", -1);
+		Scope.Suspend();
+		Scope.Resume();
+	}
+
+	uint32_t nFiber = MicroProfileFiberRegister("Fiber");
+	MicroProfileFiberSwitch(MICROPROFILE_FIBER_THREAD, nFiber);
+	{
+		MICROPROFILE_SCOPEI("Group", "Fiber", -1);
+	}
+	MicroProfileFiberSwitch(nFiber, MICROPROFILE_FIBER_THREAD);
+	MicroProfileFiberUnregister(nFiber);
+
+	MICROPROFILE_REQUEST(1);
+	{
+		MICROPROFILE_SCOPEI("Group", "Request", -1);
+	}
+	MICROPROFILE_REQUEST(0);
+
+	MicroProfileSetGroupSampleRate("Sampled", 4);
+	MicroProfileSetOverheadBudget(0.01f);
+	MicroProfileCalibrate();
+	MicroProfileSetOverheadSubtract(true);
+	for(int i = 0; i < 16; ++i)
+	{
+		MICROPROFILE_SCOPEI("Sampled", "Hot", -1);
+	}
+
+	MICROPROFILE_COUNTER_ADD("Counter/Add", 2);
+	MICROPROFILE_COUNTER_SET("Counter/Set", 5);
+	MICROPROFILE_COUNTER_ADD("Counter/Set", 1);
+
+	MicroProfileFlip();
+
+	MicroProfileSetAggregateOnly(true);
+	MicroProfileFlip();
+	{
+		MICROPROFILE_SCOPEI("Group", "Aggregate", -1);
+		MICROPROFILE_LABEL("Group", "Dropped");
+		for(int i = 0; i < 16; ++i)
+		{
+			MICROPROFILE_SCOPEI("Sampled", "Hot", -1);
+		}
+	}
+	MicroProfileFlip();
+	MicroProfileSetAggregateOnly(false);
+	MicroProfileFlip();
+
+	MicroProfileSetEnableAllThreads(false);
+	MicroProfileEnableThread("Main");
+	MicroProfileFlip();
+	{
+		MICROPROFILE_SCOPEI("Group", "Selected", -1);
+	}
+	MicroProfileDisableThread("Main");
+	MicroProfileFlip();
+	{
+		MICROPROFILE_SCOPEI("Group", "Deselected", -1);
+		MICROPROFILE_LABEL("Group", "Dropped");
+	}
+	MicroProfileSetEnableAllThreads(true);
 	MicroProfileFlip();
 
+	MicroProfileCrashDumpWrite();
+	MicroProfileCrashDumpStop();
+	remove("test_noui.crash");
+	MicroProfileFlightRecorderStop();
+	remove("test_noui.mpfr");
 	MicroProfileOnThreadExit();
 }
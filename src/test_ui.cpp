@@ -1,5 +1,7 @@
 #define MICROPROFILE_IMPL
 #define MICROPROFILEUI_IMPL
+#define MICROPROFILE_LOG_WIDE 1
+#define MICROPROFILE_PER_CPU_LOG 1
 
 #include "microprofile.h"
 #include "microprofileui.h"